@@ -0,0 +1,860 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <getopt.h>
+#include <locale.h>
+#include <sys/utsname.h>
+
+#include "dbus-common.h"
+#include "util.h"
+#include "log.h"
+#include "build.h"
+#include "strv.h"
+#include "hashmap.h"
+#include "set.h"
+#include "special.h"
+
+/* 1000px = 10s */
+#define SCALE_X (0.1 / 1000.0)
+#define BAR_HEIGHT 20
+#define BAR_SPACE 2
+#define BORDER 100
+
+static bool arg_user = false;
+static bool arg_json = false;
+
+typedef struct UnitTimes {
+        char *name;
+        usec_t activating;
+        usec_t activated;
+        usec_t deactivating;
+        usec_t deactivated;
+        char **after;
+} UnitTimes;
+
+typedef struct BootTimes {
+        usec_t firmware_time;
+        usec_t loader_time;
+        usec_t kernel_time;
+        usec_t initrd_time;
+        usec_t userspace_time;
+        usec_t finish_time;
+} BootTimes;
+
+static void unit_times_free(UnitTimes *t, unsigned n) {
+        unsigned i;
+
+        for (i = 0; i < n; i++) {
+                free(t[i].name);
+                strv_free(t[i].after);
+        }
+
+        free(t);
+}
+
+static int acquire_time_data(DBusConnection *bus, UnitTimes **out) {
+        _cleanup_dbus_message_unref_ DBusMessage *reply = NULL;
+        DBusMessageIter iter, sub;
+        UnitTimes *unit_times = NULL;
+        unsigned c = 0, n_units = 0;
+        int r;
+
+        /* All timestamps and ordering dependencies are fetched in a
+         * single call, rather than with four property calls per
+         * unit */
+        r = bus_method_call_with_reply(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.systemd1.Manager",
+                        "ListUnitTimes",
+                        &reply,
+                        NULL,
+                        DBUS_TYPE_INVALID);
+        if (r < 0)
+                return r;
+
+        if (!dbus_message_iter_init(reply, &iter) ||
+            dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY ||
+            dbus_message_iter_get_element_type(&iter) != DBUS_TYPE_STRUCT) {
+                log_error("Failed to parse reply.");
+                return -EIO;
+        }
+
+        for (dbus_message_iter_recurse(&iter, &sub);
+             dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID;
+             dbus_message_iter_next(&sub)) {
+                DBusMessageIter sub2;
+                const char *name;
+                UnitTimes *t;
+
+                if (dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_STRUCT) {
+                        log_error("Failed to parse reply.");
+                        r = -EIO;
+                        goto fail;
+                }
+
+                if (c >= n_units) {
+                        UnitTimes *w;
+
+                        n_units = MAX(2*c, 16u);
+                        w = realloc(unit_times, sizeof(UnitTimes) * n_units);
+                        if (!w) {
+                                r = log_oom();
+                                goto fail;
+                        }
+
+                        unit_times = w;
+                }
+
+                t = unit_times + c;
+                zero(*t);
+
+                dbus_message_iter_recurse(&sub, &sub2);
+
+                if (bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_STRING, &name, true) < 0 ||
+                    bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_UINT64, &t->activating, true) < 0 ||
+                    bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_UINT64, &t->activated, true) < 0 ||
+                    bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_UINT64, &t->deactivating, true) < 0 ||
+                    bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_UINT64, &t->deactivated, true) < 0) {
+                        log_error("Failed to parse reply.");
+                        r = -EIO;
+                        goto fail;
+                }
+
+                r = bus_parse_strv_iter(&sub2, &t->after);
+                if (r < 0) {
+                        log_error("Failed to parse reply.");
+                        goto fail;
+                }
+
+                t->name = strdup(name);
+                if (!t->name) {
+                        strv_free(t->after);
+                        r = log_oom();
+                        goto fail;
+                }
+
+                c++;
+        }
+
+        *out = unit_times;
+        return c;
+
+fail:
+        unit_times_free(unit_times, c);
+        return r;
+}
+
+static int acquire_boot_times(DBusConnection *bus, BootTimes *t) {
+        _cleanup_dbus_message_unref_ DBusMessage *reply = NULL;
+        const char *interface = "org.freedesktop.systemd1.Manager";
+        DBusMessageIter iter, sub;
+        int r;
+
+        static const struct {
+                const char *property;
+                size_t offset;
+        } table[] = {
+                { "FirmwareTimestampMonotonic",  offsetof(BootTimes, firmware_time)  },
+                { "LoaderTimestampMonotonic",    offsetof(BootTimes, loader_time)    },
+                { "KernelTimestamp",             offsetof(BootTimes, kernel_time)    },
+                { "InitRDTimestampMonotonic",    offsetof(BootTimes, initrd_time)    },
+                { "UserspaceTimestampMonotonic", offsetof(BootTimes, userspace_time) },
+                { "FinishTimestampMonotonic",    offsetof(BootTimes, finish_time)    },
+        };
+
+        assert(t);
+
+        /* Note that the firmware/loader times are returned as
+         * positive values but are actually considered negative from
+         * the point in time of kernel initialization. Also, the
+         * monotonic kernel time will always be 0 since that's the
+         * epoch of the monotonic clock. Since we want to know whether
+         * the kernel timestamp is set at all we will instead ask for
+         * the realtime clock for this timestamp. */
+
+        r = bus_method_call_with_reply(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.DBus.Properties",
+                        "GetAll",
+                        &reply,
+                        NULL,
+                        DBUS_TYPE_STRING, &interface,
+                        DBUS_TYPE_INVALID);
+        if (r < 0)
+                return r;
+
+        if (!dbus_message_iter_init(reply, &iter) ||
+            dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY ||
+            dbus_message_iter_get_element_type(&iter) != DBUS_TYPE_DICT_ENTRY) {
+                log_error("Failed to parse reply.");
+                return -EIO;
+        }
+
+        zero(*t);
+
+        for (dbus_message_iter_recurse(&iter, &sub);
+             dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID;
+             dbus_message_iter_next(&sub)) {
+                DBusMessageIter sub2, sub3;
+                const char *name;
+                unsigned i;
+
+                if (dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_DICT_ENTRY) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                dbus_message_iter_recurse(&sub, &sub2);
+
+                if (bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_STRING, &name, true) < 0 ||
+                    dbus_message_iter_get_arg_type(&sub2) != DBUS_TYPE_VARIANT) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                for (i = 0; i < ELEMENTSOF(table); i++)
+                        if (streq(name, table[i].property))
+                                break;
+
+                if (i >= ELEMENTSOF(table))
+                        continue;
+
+                dbus_message_iter_recurse(&sub2, &sub3);
+
+                if (bus_iter_get_basic_and_next(&sub3, DBUS_TYPE_UINT64, (uint8_t*) t + table[i].offset, false) < 0) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+        }
+
+        if (t->finish_time <= 0) {
+                log_error("Bootup is not yet finished. Please try again later.");
+                return -EAGAIN;
+        }
+
+        return 0;
+}
+
+static const char *json_escape(const char *s, char *buf, size_t l) {
+        char *d = buf;
+
+        /* Unit names are ASCII and never contain control characters,
+         * but let's be safe */
+        for (; *s && d + 7 < buf + l; s++) {
+                if (*s == '"' || *s == '\\') {
+                        *(d++) = '\\';
+                        *(d++) = *s;
+                } else if ((unsigned char) *s < ' ')
+                        d += sprintf(d, "\\u%04x", (unsigned char) *s);
+                else
+                        *(d++) = *s;
+        }
+
+        *d = 0;
+        return buf;
+}
+
+static const char *xml_escape(const char *s, char *buf, size_t l) {
+        char *d = buf;
+
+        for (; *s && d + 6 < buf + l; s++) {
+                if (*s == '<')
+                        d = stpcpy(d, "&lt;");
+                else if (*s == '>')
+                        d = stpcpy(d, "&gt;");
+                else if (*s == '&')
+                        d = stpcpy(d, "&amp;");
+                else
+                        *(d++) = *s;
+        }
+
+        *d = 0;
+        return buf;
+}
+
+static int compare_unit_time(const void *a, const void *b) {
+        const UnitTimes *x = a, *y = b;
+        usec_t dx, dy;
+
+        dx = x->activated > x->activating ? x->activated - x->activating : 0;
+        dy = y->activated > y->activating ? y->activated - y->activating : 0;
+
+        if (dx < dy)
+                return 1;
+        if (dx > dy)
+                return -1;
+
+        return strcmp(x->name, y->name);
+}
+
+static int compare_unit_start(const void *a, const void *b) {
+        const UnitTimes *x = a, *y = b;
+
+        if (x->activating < y->activating)
+                return -1;
+        if (x->activating > y->activating)
+                return 1;
+
+        return strcmp(x->name, y->name);
+}
+
+static int analyze_time(DBusConnection *bus, char **args) {
+        BootTimes t;
+        int r;
+
+        r = acquire_boot_times(bus, &t);
+        if (r < 0)
+                return r;
+
+        printf("Startup finished in ");
+
+        if (t.firmware_time > 0)
+                printf("%llums (firmware) + ", (unsigned long long) ((t.firmware_time - t.loader_time) / USEC_PER_MSEC));
+        if (t.loader_time > 0)
+                printf("%llums (loader) + ", (unsigned long long) (t.loader_time / USEC_PER_MSEC));
+        if (t.initrd_time > 0)
+                printf("%llums (kernel) + %llums (initrd) + ",
+                       (unsigned long long) (t.initrd_time / USEC_PER_MSEC),
+                       (unsigned long long) ((t.userspace_time - t.initrd_time) / USEC_PER_MSEC));
+        else if (t.kernel_time > 0)
+                printf("%llums (kernel) + ", (unsigned long long) (t.userspace_time / USEC_PER_MSEC));
+
+        printf("%llums (userspace) ", (unsigned long long) ((t.finish_time - t.userspace_time) / USEC_PER_MSEC));
+
+        if (t.kernel_time > 0)
+                printf("= %llums\n", (unsigned long long) ((t.firmware_time + t.finish_time) / USEC_PER_MSEC));
+        else
+                printf("= %llums\n", (unsigned long long) ((t.finish_time - t.userspace_time) / USEC_PER_MSEC));
+
+        return 0;
+}
+
+static int analyze_blame(DBusConnection *bus, char **args) {
+        UnitTimes *times = NULL;
+        unsigned i;
+        int n;
+
+        n = acquire_time_data(bus, &times);
+        if (n < 0)
+                return n;
+
+        qsort(times, n, sizeof(UnitTimes), compare_unit_time);
+
+        for (i = 0; i < (unsigned) n; i++) {
+                char ts[FORMAT_TIMESPAN_MAX];
+
+                if (times[i].activating <= 0 || times[i].activated <= times[i].activating)
+                        continue;
+
+                printf("%16s %s\n",
+                       format_timespan(ts, sizeof(ts), times[i].activated - times[i].activating),
+                       times[i].name);
+        }
+
+        unit_times_free(times, n);
+        return 0;
+}
+
+static UnitTimes *critical_predecessor(Hashmap *h, UnitTimes *u) {
+        UnitTimes *best = NULL;
+        usec_t until;
+        char **a;
+
+        /* The unit that held this one up is the last one it was
+         * ordered after that became active before this one started
+         * activating */
+        until = u->activating > 0 ? u->activating : u->activated;
+
+        STRV_FOREACH(a, u->after) {
+                UnitTimes *o;
+
+                o = hashmap_get(h, *a);
+                if (!o)
+                        continue;
+
+                if (o->activated <= 0 || o->activated > until)
+                        continue;
+
+                if (!best || o->activated > best->activated)
+                        best = o;
+        }
+
+        return best;
+}
+
+static int print_critical_chain(Hashmap *h, const char *name, BootTimes *boot) {
+        _cleanup_set_free_ Set *seen = NULL;
+        UnitTimes *u;
+        unsigned level = 0;
+
+        u = hashmap_get(h, name);
+        if (!u) {
+                log_error("Unit %s not known.", name);
+                return -ENOENT;
+        }
+
+        if (u->activated <= 0) {
+                log_error("Unit %s has not been activated.", name);
+                return -ENOENT;
+        }
+
+        seen = set_new(trivial_hash_func, trivial_compare_func);
+        if (!seen)
+                return log_oom();
+
+        for (; u; u = critical_predecessor(h, u), level++) {
+                char at[FORMAT_TIMESPAN_MAX], took[FORMAT_TIMESPAN_MAX];
+                unsigned k;
+
+                /* The After= graph is acyclic when the manager is
+                 * done with it, but let's not rely on that */
+                if (set_put(seen, u) <= 0)
+                        break;
+
+                for (k = 0; k < level; k++)
+                        fputs("  ", stdout);
+
+                if (level > 0)
+                        fputs("\\-", stdout);
+
+                if (u->activating > 0 && u->activated > u->activating)
+                        printf("%s @%s +%s\n",
+                               u->name,
+                               format_timespan(at, sizeof(at), u->activated - MIN(u->activated, boot->userspace_time)),
+                               format_timespan(took, sizeof(took), u->activated - u->activating));
+                else
+                        printf("%s @%s\n",
+                               u->name,
+                               format_timespan(at, sizeof(at), u->activated - MIN(u->activated, boot->userspace_time)));
+        }
+
+        return 0;
+}
+
+static int analyze_critical_chain(DBusConnection *bus, char **args) {
+        Hashmap *h = NULL;
+        UnitTimes *times = NULL;
+        BootTimes boot;
+        char **name;
+        int n, i, r;
+
+        r = acquire_boot_times(bus, &boot);
+        if (r < 0)
+                return r;
+
+        n = acquire_time_data(bus, &times);
+        if (n < 0)
+                return n;
+
+        h = hashmap_new(string_hash_func, string_compare_func);
+        if (!h) {
+                r = log_oom();
+                goto finish;
+        }
+
+        for (i = 0; i < n; i++) {
+                r = hashmap_put(h, times[i].name, times + i);
+                if (r < 0) {
+                        log_oom();
+                        goto finish;
+                }
+        }
+
+        printf("The time after the unit is active or started is printed after the \"@\" character.\n"
+               "The time the unit takes to start is printed after the \"+\" character.\n\n");
+
+        if (strv_isempty(args + 1))
+                r = print_critical_chain(h, SPECIAL_DEFAULT_TARGET, &boot);
+        else
+                STRV_FOREACH(name, args + 1) {
+                        r = print_critical_chain(h, *name, &boot);
+                        if (r < 0)
+                                break;
+                }
+
+finish:
+        hashmap_free(h);
+        unit_times_free(times, n);
+        return r;
+}
+
+static void svg_bar(const char *class, double x1, double x2, unsigned y) {
+        printf("  <rect class=\"%s\" x=\"%.03f\" y=\"%u\" width=\"%.03f\" height=\"%u\" />\n",
+               class, x1, y * (BAR_HEIGHT + BAR_SPACE), MAX(x2 - x1, 0.0), BAR_HEIGHT);
+}
+
+static void svg_text(bool right, double x, unsigned y, const char *text) {
+        char escaped[LINE_MAX];
+
+        printf("  <text class=\"%s\" x=\"%.03f\" y=\"%u\">%s</text>\n",
+               right ? "right" : "left", x + (right ? -5 : 5),
+               y * (BAR_HEIGHT + BAR_SPACE) + BAR_HEIGHT * 3 / 4,
+               xml_escape(text, escaped, sizeof(escaped)));
+}
+
+static usec_t next_after(usec_t from, usec_t a, usec_t b, usec_t c) {
+        usec_t r = (usec_t) -1;
+
+        /* The earliest of the specified timestamps after from */
+        if (a >= from && a < r)
+                r = a;
+        if (b >= from && b < r)
+                r = b;
+        if (c >= from && c < r)
+                r = c;
+
+        return r;
+}
+
+static bool in_boot(const BootTimes *boot, usec_t t) {
+        return t >= boot->userspace_time && t <= boot->finish_time;
+}
+
+static void plot_svg(const BootTimes *boot, UnitTimes *times, unsigned n) {
+        char osrel[LINE_MAX] = "Linux";
+        _cleanup_free_ char *pretty_name = NULL;
+        struct utsname name;
+        double width, height;
+        unsigned i, y = 0, count;
+
+        count = boot->initrd_time > 0 ? 3 : 2;
+        for (i = 0; i < n; i++)
+                if (in_boot(boot, times[i].activating) ||
+                    in_boot(boot, times[i].activated) ||
+                    in_boot(boot, times[i].deactivating))
+                        count++;
+
+        width = MAX(SCALE_X * boot->finish_time + BORDER * 2, 1000.0);
+        height = count * (BAR_HEIGHT + BAR_SPACE) + BORDER * 2;
+
+        if (parse_env_file("/etc/os-release", NEWLINE, "PRETTY_NAME", &pretty_name, NULL) >= 0 && pretty_name)
+                xml_escape(pretty_name, osrel, sizeof(osrel));
+
+        assert_se(uname(&name) >= 0);
+
+        printf("<?xml version=\"1.0\" standalone=\"no\"?>\n"
+               "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" "
+               "\"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n"
+               "<svg width=\"%.0fpx\" height=\"%.0fpx\" version=\"1.1\" "
+               "xmlns=\"http://www.w3.org/2000/svg\">\n\n"
+               "<defs>\n"
+               "  <style type=\"text/css\">\n"
+               "    <![CDATA[\n"
+               "      rect       { stroke-width: 1; stroke-opacity: 0; }\n"
+               "      rect.activating   { fill: rgb(255,0,0); fill-opacity: 0.7; }\n"
+               "      rect.active       { fill: rgb(200,150,150); fill-opacity: 0.7; }\n"
+               "      rect.deactivating { fill: rgb(150,100,100); fill-opacity: 0.7; }\n"
+               "      rect.kernel       { fill: rgb(150,150,150); fill-opacity: 0.7; }\n"
+               "      rect.initrd       { fill: rgb(150,150,150); fill-opacity: 0.7; }\n"
+               "      rect.userspace    { fill: rgb(150,150,150); fill-opacity: 0.7; }\n"
+               "      rect.background   { fill: rgb(255,255,255); }\n"
+               "      line       { stroke: rgb(64,64,64); stroke-width: 1; }\n"
+               "      line.sec1  { }\n"
+               "      line.sec5  { stroke-width: 2; }\n"
+               "      text       { font-family: Verdana, Helvetica; font-size: 10; }\n"
+               "      text.left  { font-family: Verdana, Helvetica; font-size: 10; text-anchor: start; }\n"
+               "      text.right { font-family: Verdana, Helvetica; font-size: 10; text-anchor: end; }\n"
+               "      text.sec   { font-size: 8; text-anchor: middle; }\n"
+               "    ]]>\n"
+               "   </style>\n"
+               "</defs>\n\n",
+               width, height);
+
+        printf("<rect class=\"background\" width=\"100%%\" height=\"100%%\" />\n"
+               "<text x=\"20\" y=\"50\">%s %s (%s %s) %s</text>\n",
+               osrel, name.nodename, name.release, name.version, name.machine);
+
+        printf("<g transform=\"translate(%u,%u)\">\n", BORDER, BORDER);
+
+        /* One line per second */
+        for (i = 0; i * USEC_PER_SEC <= boot->finish_time; i++) {
+                double x = SCALE_X * i * USEC_PER_SEC;
+
+                printf("  <line class=\"%s\" x1=\"%.03f\" y1=\"0\" x2=\"%.03f\" y2=\"%.03f\" />\n"
+                       "  <text class=\"sec\" x=\"%.03f\" y=\"-5\">%us</text>\n",
+                       i % 5 == 0 ? "sec5" : "sec1", x, x, height - BORDER * 2, x, i);
+        }
+
+        if (boot->initrd_time > 0) {
+                svg_bar("kernel", 0, SCALE_X * boot->initrd_time, y);
+                svg_text(false, 0, y++, "kernel");
+                svg_bar("initrd", SCALE_X * boot->initrd_time, SCALE_X * boot->userspace_time, y);
+                svg_text(false, SCALE_X * boot->initrd_time, y++, "initrd");
+        } else {
+                svg_bar("kernel", 0, SCALE_X * boot->userspace_time, y);
+                svg_text(false, 0, y++, "kernel");
+        }
+
+        svg_bar("userspace", SCALE_X * boot->userspace_time, SCALE_X * boot->finish_time, y);
+        svg_text(false, SCALE_X * boot->userspace_time, y++, "userspace");
+
+        for (i = 0; i < n; i++) {
+                UnitTimes *u = times + i;
+                usec_t left = (usec_t) -1;
+
+                if (in_boot(boot, u->activating)) {
+                        svg_bar("activating",
+                                SCALE_X * u->activating,
+                                SCALE_X * MIN(next_after(u->activating, u->activated, u->deactivating, u->deactivated), boot->finish_time),
+                                y);
+                        left = MIN(left, u->activating);
+                }
+
+                if (in_boot(boot, u->activated)) {
+                        svg_bar("active",
+                                SCALE_X * u->activated,
+                                SCALE_X * MIN(next_after(u->activated, u->deactivating, u->deactivated, (usec_t) -1), boot->finish_time),
+                                y);
+                        left = MIN(left, u->activated);
+                }
+
+                if (in_boot(boot, u->deactivating)) {
+                        svg_bar("deactivating",
+                                SCALE_X * u->deactivating,
+                                SCALE_X * MIN(next_after(u->deactivating, u->deactivated, (usec_t) -1, (usec_t) -1), boot->finish_time),
+                                y);
+                        left = MIN(left, u->deactivating);
+                }
+
+                if (left == (usec_t) -1)
+                        continue;
+
+                svg_text(SCALE_X * left >= width / 2 - BORDER, SCALE_X * left, y++, u->name);
+        }
+
+        printf("</g>\n\n"
+               "<text x=\"%u\" y=\"%.0f\">Legend: Red = Activating; Pink = Active; Dark Pink = Deactivating</text>\n"
+               "</svg>\n",
+               BORDER, height - BORDER / 2);
+}
+
+static void plot_json(const BootTimes *boot, UnitTimes *times, unsigned n) {
+        unsigned i;
+        bool first = true;
+
+        printf("{\n"
+               "  \"firmware\": %llu,\n"
+               "  \"loader\": %llu,\n"
+               "  \"kernel\": %llu,\n"
+               "  \"initrd\": %llu,\n"
+               "  \"userspace\": %llu,\n"
+               "  \"finish\": %llu,\n"
+               "  \"units\": [",
+               (unsigned long long) boot->firmware_time,
+               (unsigned long long) boot->loader_time,
+               (unsigned long long) boot->kernel_time,
+               (unsigned long long) boot->initrd_time,
+               (unsigned long long) boot->userspace_time,
+               (unsigned long long) boot->finish_time);
+
+        for (i = 0; i < n; i++) {
+                char escaped[LINE_MAX];
+
+                if (times[i].activating <= 0 && times[i].activated <= 0)
+                        continue;
+
+                printf("%s\n    { \"name\": \"%s\", \"activating\": %llu, \"activated\": %llu, \"deactivating\": %llu, \"deactivated\": %llu }",
+                       first ? "" : ",",
+                       json_escape(times[i].name, escaped, sizeof(escaped)),
+                       (unsigned long long) times[i].activating,
+                       (unsigned long long) times[i].activated,
+                       (unsigned long long) times[i].deactivating,
+                       (unsigned long long) times[i].deactivated);
+
+                first = false;
+        }
+
+        printf("\n  ]\n"
+               "}\n");
+}
+
+static int analyze_plot(DBusConnection *bus, char **args) {
+        UnitTimes *times = NULL;
+        BootTimes boot;
+        int n, r;
+
+        r = acquire_boot_times(bus, &boot);
+        if (r < 0)
+                return r;
+
+        n = acquire_time_data(bus, &times);
+        if (n < 0)
+                return n;
+
+        qsort(times, n, sizeof(UnitTimes), compare_unit_start);
+
+        if (arg_json)
+                plot_json(&boot, times, n);
+        else
+                plot_svg(&boot, times, n);
+
+        unit_times_free(times, n);
+        return 0;
+}
+
+static int help(void) {
+
+        printf("%s [OPTIONS...] {COMMAND} ...\n\n"
+               "Process systemd profiling information\n\n"
+               "  -h --help           Show this help\n"
+               "     --version        Show package version\n"
+               "     --system         Connect to system manager\n"
+               "     --user           Connect to user service manager\n"
+               "     --json           Output plot data as JSON instead of SVG\n\n"
+               "Commands:\n"
+               "  time                Print time spent in the kernel before reaching userspace\n"
+               "  blame               Print list of running units ordered by time to init\n"
+               "  critical-chain [UNIT...]\n"
+               "                      Print a tree of the time critical chain of units\n"
+               "  plot                Output SVG graphic showing service initialization\n",
+               program_invocation_short_name);
+
+        return 0;
+}
+
+static int parse_argv(int argc, char *argv[]) {
+
+        enum {
+                ARG_VERSION = 0x100,
+                ARG_USER,
+                ARG_SYSTEM,
+                ARG_JSON
+        };
+
+        static const struct option options[] = {
+                { "help",      no_argument,       NULL, 'h'           },
+                { "version",   no_argument,       NULL, ARG_VERSION   },
+                { "user",      no_argument,       NULL, ARG_USER      },
+                { "system",    no_argument,       NULL, ARG_SYSTEM    },
+                { "json",      no_argument,       NULL, ARG_JSON      },
+                { NULL,        0,                 NULL, 0             }
+        };
+
+        int c;
+
+        assert(argc >= 0);
+        assert(argv);
+
+        while ((c = getopt_long(argc, argv, "h", options, NULL)) >= 0) {
+
+                switch (c) {
+
+                case 'h':
+                        help();
+                        return 0;
+
+                case ARG_VERSION:
+                        puts(PACKAGE_STRING);
+                        puts(SYSTEMD_FEATURES);
+                        return 0;
+
+                case ARG_USER:
+                        arg_user = true;
+                        break;
+
+                case ARG_SYSTEM:
+                        arg_user = false;
+                        break;
+
+                case ARG_JSON:
+                        arg_json = true;
+                        break;
+
+                case '?':
+                        return -EINVAL;
+
+                default:
+                        log_error("Unknown option code %c", c);
+                        return -EINVAL;
+                }
+        }
+
+        return 1;
+}
+
+int main(int argc, char *argv[]) {
+
+        static const struct {
+                const char *verb;
+                int (* const dispatch)(DBusConnection *bus, char **args);
+        } verbs[] = {
+                { "time",           analyze_time           },
+                { "blame",          analyze_blame          },
+                { "critical-chain", analyze_critical_chain },
+                { "plot",           analyze_plot           },
+        };
+
+        DBusConnection *bus = NULL;
+        DBusError error;
+        unsigned i;
+        int r;
+
+        dbus_error_init(&error);
+
+        setlocale(LC_ALL, "");
+        log_parse_environment();
+        log_open();
+
+        r = parse_argv(argc, argv);
+        if (r <= 0)
+                goto finish;
+
+        if (optind >= argc)
+                /* Special rule: no arguments means "time" */
+                i = 0;
+        else {
+                for (i = 0; i < ELEMENTSOF(verbs); i++)
+                        if (streq(argv[optind], verbs[i].verb))
+                                break;
+
+                if (i >= ELEMENTSOF(verbs)) {
+                        log_error("Unknown operation %s", argv[optind]);
+                        r = -EINVAL;
+                        goto finish;
+                }
+        }
+
+        bus = dbus_bus_get_private(arg_user ? DBUS_BUS_SESSION : DBUS_BUS_SYSTEM, &error);
+        if (!bus) {
+                log_error("Failed to get D-Bus connection: %s", bus_error_message(&error));
+                r = -EIO;
+                goto finish;
+        }
+
+        r = verbs[i].dispatch(bus, argv + optind);
+
+finish:
+        if (bus) {
+                dbus_connection_flush(bus);
+                dbus_connection_close(bus);
+                dbus_connection_unref(bus);
+        }
+
+        dbus_error_free(&error);
+        dbus_shutdown();
+
+        return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
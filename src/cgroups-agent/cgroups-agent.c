@@ -22,10 +22,46 @@
 #include <dbus/dbus.h>
 
 #include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stddef.h>
 
 #include "log.h"
+#include "util.h"
+#include "def.h"
 #include "dbus-common.h"
 
+static int send_datagram(const char *group) {
+        union {
+                struct sockaddr sa;
+                struct sockaddr_un un;
+        } sa;
+        int _cleanup_close_ fd = -1;
+        size_t l;
+
+        /* Hand the cgroup path to PID 1 with a single datagram. This
+         * is much cheaper than setting up a D-Bus connection for each
+         * emptied cgroup. */
+
+        l = strlen(group);
+        if (l > PATH_MAX)
+                return -EINVAL;
+
+        fd = socket(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+        if (fd < 0)
+                return -errno;
+
+        zero(sa);
+        sa.un.sun_family = AF_UNIX;
+        strncpy(sa.un.sun_path, SYSTEMD_CGROUP_AGENT_SOCKET, sizeof(sa.un.sun_path));
+
+        if (sendto(fd, group, l, MSG_NOSIGNAL, &sa.sa, offsetof(struct sockaddr_un, sun_path) + strlen(sa.un.sun_path)) < 0)
+                return -errno;
+
+        return 0;
+}
+
 int main(int argc, char *argv[]) {
         DBusError error;
         DBusConnection *bus = NULL;
@@ -43,6 +79,12 @@ int main(int argc, char *argv[]) {
         log_parse_environment();
         log_open();
 
+        if (send_datagram(argv[1]) >= 0)
+                return EXIT_SUCCESS;
+
+        /* Fall back to D-Bus, in case we are running with an older
+         * PID 1 that does not know the socket yet. */
+
         /* We send this event to the private D-Bus socket and then the
          * system instance will forward this to the system bus. We do
          * this to avoid an activation loop when we start dbus when we
@@ -78,6 +78,8 @@ void cgroup_bonding_free(CGroupBonding *b, bool trim) {
                                 hashmap_replace(b->unit->manager->cgroup_bondings, b->path, f);
                         else
                                 hashmap_remove(b->unit->manager->cgroup_bondings, b->path);
+
+                        cgroup_bonding_index(b->unit->manager, b->path, f);
                 }
         }
 
@@ -424,43 +426,187 @@ void manager_shutdown_cgroup(Manager *m, bool delete) {
         m->cgroup_hierarchy = NULL;
 }
 
-int cgroup_bonding_get(Manager *m, const char *cgroup, CGroupBonding **bonding) {
-        CGroupBonding *b;
-        char *p;
+static CGroupNode *cgroup_node_new(CGroupNode *parent, const char *name) {
+        CGroupNode *n;
+
+        n = new0(CGroupNode, 1);
+        if (!n)
+                return NULL;
+
+        n->name = strdup(name);
+        if (!n->name) {
+                free(n);
+                return NULL;
+        }
+
+        if (parent) {
+                if (!parent->children) {
+                        parent->children = hashmap_new(string_hash_func, string_compare_func);
+                        if (!parent->children)
+                                goto fail;
+                }
+
+                if (hashmap_put(parent->children, n->name, n) < 0)
+                        goto fail;
+
+                n->parent = parent;
+        }
+
+        return n;
+
+fail:
+        free(n->name);
+        free(n);
+        return NULL;
+}
+
+void cgroup_node_free(CGroupNode *n) {
+        CGroupNode *c;
+
+        if (!n)
+                return;
+
+        while ((c = hashmap_first(n->children)))
+                cgroup_node_free(c);
+
+        if (n->parent)
+                hashmap_remove(n->parent->children, n->name);
+
+        hashmap_free(n->children);
+        free(n->name);
+        free(n);
+}
+
+static void cgroup_node_prune(CGroupNode *n) {
+
+        /* Remove nodes that neither carry bondings nor lead to any */
+        while (n && n->parent && !n->bondings && hashmap_isempty(n->children)) {
+                CGroupNode *p = n->parent;
+
+                cgroup_node_free(n);
+                n = p;
+        }
+}
+
+int cgroup_bonding_index(Manager *m, const char *cgroup, CGroupBonding *l) {
+        CGroupNode *n;
+        const char *p;
 
         assert(m);
         assert(cgroup);
-        assert(bonding);
 
-        b = hashmap_get(m->cgroup_bondings, cgroup);
-        if (b) {
-                *bonding = b;
-                return 1;
+        /* Updates the trie entry for the specified path, to be called
+         * whenever the Manager::cgroup_bondings entry for it
+         * changed. Passing NULL as list removes the entry. */
+
+        if (!m->cgroup_root) {
+                if (!l)
+                        return 0;
+
+                m->cgroup_root = cgroup_node_new(NULL, "");
+                if (!m->cgroup_root)
+                        return -ENOMEM;
         }
 
-        p = strdup(cgroup);
-        if (!p)
-                return -ENOMEM;
+        n = m->cgroup_root;
+        p = cgroup;
 
         for (;;) {
-                char *e;
+                char name[NAME_MAX+1];
+                CGroupNode *c;
+                size_t k;
 
-                e = strrchr(p, '/');
-                if (!e || e == p) {
-                        free(p);
-                        *bonding = NULL;
-                        return 0;
-                }
+                p += strspn(p, "/");
+                if (!*p)
+                        break;
+
+                k = strcspn(p, "/");
+                if (k > NAME_MAX)
+                        return -ENAMETOOLONG;
+
+                memcpy(name, p, k);
+                name[k] = 0;
+                p += k;
 
-                *e = 0;
+                c = hashmap_get(n->children, name);
+                if (!c) {
+                        if (!l)
+                                return 0;
 
-                b = hashmap_get(m->cgroup_bondings, p);
-                if (b) {
-                        free(p);
-                        *bonding = b;
-                        return 1;
+                        c = cgroup_node_new(n, name);
+                        if (!c) {
+                                cgroup_node_prune(n);
+                                return -ENOMEM;
+                        }
                 }
+
+                n = c;
+        }
+
+        n->bondings = l;
+
+        if (!l)
+                cgroup_node_prune(n);
+
+        return 0;
+}
+
+static CGroupBonding *cgroup_bonding_lookup(Manager *m, const char *cgroup) {
+        CGroupBonding *l = NULL;
+        CGroupNode *n;
+        const char *p;
+
+        assert(m);
+        assert(cgroup);
+
+        /* Finds the bondings of the closest enclosing group of the
+         * specified path, walking the trie component by component. The
+         * root group is only considered if it is asked for directly. */
+
+        n = m->cgroup_root;
+        if (!n)
+                return NULL;
+
+        p = cgroup + strspn(cgroup, "/");
+        if (!*p)
+                return n->bondings;
+
+        while (*p) {
+                char name[NAME_MAX+1];
+                size_t k;
+
+                k = strcspn(p, "/");
+                if (k > NAME_MAX)
+                        break;
+
+                memcpy(name, p, k);
+                name[k] = 0;
+
+                n = hashmap_get(n->children, name);
+                if (!n)
+                        break;
+
+                if (n->bondings)
+                        l = n->bondings;
+
+                p += k;
+                p += strspn(p, "/");
         }
+
+        return l;
+}
+
+int cgroup_bonding_get(Manager *m, const char *cgroup, CGroupBonding **bonding) {
+        CGroupBonding *b;
+
+        assert(m);
+        assert(cgroup);
+        assert(bonding);
+
+        b = cgroup_bonding_lookup(m, cgroup);
+
+        *bonding = b;
+        return !!b;
 }
 
 int cgroup_notify_empty(Manager *m, const char *group) {
@@ -504,33 +650,29 @@ int cgroup_notify_empty(Manager *m, const char *group) {
 
 Unit* cgroup_unit_by_pid(Manager *m, pid_t pid) {
         CGroupBonding *l, *b;
-        char *group = NULL;
+        char group[PATH_MAX];
+        int r;
 
         assert(m);
 
         if (pid <= 1)
                 return NULL;
 
-        if (cg_get_by_pid(SYSTEMD_CGROUP_CONTROLLER, pid, &group) < 0)
-                return NULL;
-
-        l = hashmap_get(m->cgroup_bondings, group);
-
-        if (!l) {
-                char *slash;
-
-                while ((slash = strrchr(group, '/'))) {
-                        if (slash == group)
-                                break;
+        /* This is on the hot path for notification messages and
+         * SIGCHLD of processes we do not watch directly, hence avoid
+         * allocating memory for the common case. */
+        r = cg_get_by_pid_buf(SYSTEMD_CGROUP_CONTROLLER, pid, group, sizeof(group));
+        if (r == -E2BIG) {
+                char _cleanup_free_ *p = NULL;
 
-                        *slash = 0;
+                if (cg_get_by_pid(SYSTEMD_CGROUP_CONTROLLER, pid, &p) < 0)
+                        return NULL;
 
-                        if ((l = hashmap_get(m->cgroup_bondings, group)))
-                                break;
-                }
-        }
-
-        free(group);
+                l = cgroup_bonding_lookup(m, p);
+        } else if (r < 0)
+                return NULL;
+        else
+                l = cgroup_bonding_lookup(m, group);
 
         LIST_FOREACH(by_path, b, l) {
 
@@ -22,6 +22,7 @@
 ***/
 
 typedef struct CGroupBonding CGroupBonding;
+typedef struct CGroupNode CGroupNode;
 
 #include "unit.h"
 
@@ -49,6 +50,18 @@ struct CGroupBonding {
         bool realized:1;
 };
 
+/* A trie of the paths in Manager::cgroup_bondings, one node per path
+ * component, so that the bondings of the closest enclosing group of
+ * a cgroup path can be found without hashing every prefix of it */
+struct CGroupNode {
+        char *name;
+        CGroupNode *parent;
+        Hashmap *children; /* name string => CGroupNode object 1:1 */
+
+        /* Same as the Manager::cgroup_bondings entry for this path */
+        CGroupBonding *bondings;
+};
+
 int cgroup_bonding_realize(CGroupBonding *b);
 int cgroup_bonding_realize_list(CGroupBonding *first);
 
@@ -89,6 +102,8 @@ int manager_setup_cgroup(Manager *m);
 void manager_shutdown_cgroup(Manager *m, bool delete);
 
 int cgroup_bonding_get(Manager *m, const char *cgroup, CGroupBonding **bonding);
+int cgroup_bonding_index(Manager *m, const char *cgroup, CGroupBonding *l);
+void cgroup_node_free(CGroupNode *n);
 int cgroup_notify_empty(Manager *m, const char *group);
 
 Unit* cgroup_unit_by_pid(Manager *m, pid_t pid);
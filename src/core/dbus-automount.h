@@ -26,6 +26,7 @@
 #include "unit.h"
 
 DBusHandlerResult bus_automount_message_handler(Unit *u, DBusConnection *c, DBusMessage *message);
+int bus_automount_append_properties(Unit *u, DBusMessageIter *i, char **properties);
 
 extern const char bus_automount_interface[];
 extern const char bus_automount_invalidating_properties[];
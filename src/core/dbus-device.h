@@ -26,6 +26,7 @@
 #include "unit.h"
 
 DBusHandlerResult bus_device_message_handler(Unit *u, DBusConnection *c, DBusMessage *message);
+int bus_device_append_properties(Unit *u, DBusMessageIter *i, char **properties);
 
 extern const char bus_device_interface[];
 extern const char bus_device_invalidating_properties[];
@@ -225,14 +225,40 @@ static int job_send_message(Job *j, DBusMessage* (*new_message)(Job *j)) {
         assert(new_message);
 
         if (bus_has_subscriber(j->manager) || j->forgot_bus_clients) {
+                JobBusClient *cl;
+
                 m = new_message(j);
                 if (!m)
                         goto oom;
-                r = bus_broadcast(j->manager, m);
+                r = bus_broadcast_unit(j->manager, j->unit, m);
                 dbus_message_unref(m);
+                m = NULL;
                 if (r < 0)
                         return r;
 
+                /* Subscribers interested in other units only don't
+                 * get the broadcast, but still want to hear about
+                 * the jobs they created */
+                LIST_FOREACH(client, cl, j->bus_client_list) {
+                        assert(cl->bus);
+
+                        if (bus_client_receives_unit(j->manager, cl->bus, cl->name, j->unit))
+                                continue;
+
+                        m = new_message(j);
+                        if (!m)
+                                goto oom;
+
+                        if (!dbus_message_set_destination(m, cl->name))
+                                goto oom;
+
+                        if (!dbus_connection_send(cl->bus, m, NULL))
+                                goto oom;
+
+                        dbus_message_unref(m);
+                        m = NULL;
+                }
+
         } else {
                 /* If nobody is subscribed, we just send the message
                  * to the client(s) which created the job */
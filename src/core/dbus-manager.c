@@ -21,6 +21,7 @@
 
 #include <errno.h>
 #include <unistd.h>
+#include <fnmatch.h>
 
 #include "dbus.h"
 #include "log.h"
@@ -142,11 +143,27 @@
         "  <method name=\"ListJobs\">\n"                                \
         "   <arg name=\"jobs\" type=\"a(usssoo)\" direction=\"out\"/>\n" \
         "  </method>\n"                                                 \
+        "  <method name=\"GetUnitProperties\">\n"                       \
+        "   <arg name=\"names\" type=\"as\" direction=\"in\"/>\n"       \
+        "   <arg name=\"states\" type=\"as\" direction=\"in\"/>\n"      \
+        "   <arg name=\"properties\" type=\"as\" direction=\"in\"/>\n"  \
+        "   <arg name=\"units\" type=\"a(sa{sv})\" direction=\"out\"/>\n" \
+        "  </method>\n"                                                 \
+        "  <method name=\"ListUnitTimes\">\n"                           \
+        "   <arg name=\"units\" type=\"a(sttttas)\" direction=\"out\"/>\n" \
+        "  </method>\n"                                                 \
         "  <method name=\"Subscribe\"/>\n"                              \
+        "  <method name=\"SubscribeUnits\">\n"                          \
+        "   <arg name=\"units\" type=\"as\" direction=\"in\"/>\n"       \
+        "   <arg name=\"types\" type=\"as\" direction=\"in\"/>\n"       \
+        "  </method>\n"                                                 \
         "  <method name=\"Unsubscribe\"/>\n"                            \
         "  <method name=\"Dump\">\n"                                    \
         "   <arg name=\"dump\" type=\"s\" direction=\"out\"/>\n"        \
         "  </method>\n"                                                 \
+        "  <method name=\"DumpProfile\">\n"                             \
+        "   <arg name=\"profile\" type=\"s\" direction=\"out\"/>\n"     \
+        "  </method>\n"                                                 \
         "  <method name=\"CreateSnapshot\">\n"                          \
         "   <arg name=\"name\" type=\"s\" direction=\"in\"/>\n"         \
         "   <arg name=\"cleanup\" type=\"b\" direction=\"in\"/>\n"      \
@@ -156,6 +173,9 @@
         "   <arg name=\"name\" type=\"s\" direction=\"in\"/>\n"         \
         "  </method>\n"                                                 \
         "  <method name=\"Reload\"/>\n"                                 \
+        "  <method name=\"ReloadIncremental\">\n"                      \
+        "   <arg name=\"changed\" type=\"u\" direction=\"out\"/>\n"    \
+        "  </method>\n"                                                 \
         "  <method name=\"Reexecute\"/>\n"                              \
         "  <method name=\"Exit\"/>\n"                                   \
         "  <method name=\"Reboot\"/>\n"                                 \
@@ -279,6 +299,8 @@
         "  <property name=\"NJobs\" type=\"u\" access=\"read\"/>\n"     \
         "  <property name=\"NInstalledJobs\" type=\"u\" access=\"read\"/>\n" \
         "  <property name=\"NFailedJobs\" type=\"u\" access=\"read\"/>\n" \
+        "  <property name=\"LastReloadUSec\" type=\"t\" access=\"read\"/>\n" \
+        "  <property name=\"LastReloadUnits\" type=\"u\" access=\"read\"/>\n" \
         "  <property name=\"Progress\" type=\"d\" access=\"read\"/>\n"  \
         "  <property name=\"Environment\" type=\"as\" access=\"read\"/>\n" \
         "  <property name=\"ConfirmSpawn\" type=\"b\" access=\"read\"/>\n" \
@@ -584,6 +606,8 @@ static const BusProperty bus_manager_properties[] = {
         { "NJobs",                       bus_manager_append_n_jobs,      "u",  0                                                },
         { "NInstalledJobs",              bus_property_append_uint32,     "u",  offsetof(Manager, n_installed_jobs)              },
         { "NFailedJobs",                 bus_property_append_uint32,     "u",  offsetof(Manager, n_failed_jobs)                 },
+        { "LastReloadUSec",              bus_property_append_usec,       "t",  offsetof(Manager, reload_usec)                   },
+        { "LastReloadUnits",             bus_property_append_unsigned,   "u",  offsetof(Manager, n_reload_units)                },
         { "Progress",                    bus_manager_append_progress,    "d",  0                                                },
         { "Environment",                 bus_property_append_strv,       "as", offsetof(Manager, environment),                  true },
         { "ConfirmSpawn",                bus_property_append_bool,       "b",  offsetof(Manager, confirm_spawn)                 },
@@ -599,6 +623,183 @@ static const BusProperty bus_manager_properties[] = {
         { NULL, }
 };
 
+static int subscribe_client(Manager *m, DBusConnection *connection, const char *name) {
+        char *client;
+        Set *s;
+        int r;
+
+        s = BUS_CONNECTION_SUBSCRIBED(m, connection);
+        if (!s) {
+                s = set_new(string_hash_func, string_compare_func);
+                if (!s)
+                        return -ENOMEM;
+
+                if (!dbus_connection_set_data(connection, m->subscribed_data_slot, s, NULL)) {
+                        set_free(s);
+                        return -ENOMEM;
+                }
+        }
+
+        client = strdup(name);
+        if (!client)
+                return -ENOMEM;
+
+        r = set_put(s, client);
+        if (r < 0) {
+                free(client);
+                return r;
+        }
+
+        return 0;
+}
+
+static int subscribe_client_filtered(Manager *m, DBusConnection *connection, const char *name, BusSubscriptionFilter *f) {
+        char *client;
+        Hashmap *h;
+        int r;
+
+        /* Takes possession of f on success */
+
+        h = BUS_CONNECTION_SUBSCRIPTION_FILTERS(m, connection);
+        if (!h) {
+                h = hashmap_new(string_hash_func, string_compare_func);
+                if (!h)
+                        return -ENOMEM;
+
+                if (!dbus_connection_set_data(connection, m->subscription_filters_data_slot, h, NULL)) {
+                        hashmap_free(h);
+                        return -ENOMEM;
+                }
+        }
+
+        client = strdup(name);
+        if (!client)
+                return -ENOMEM;
+
+        r = hashmap_put(h, client, f);
+        if (r < 0) {
+                free(client);
+                return r;
+        }
+
+        if (!set_get(BUS_CONNECTION_SUBSCRIBED(m, connection), (char*) name)) {
+                r = subscribe_client(m, connection, name);
+                if (r < 0) {
+                        hashmap_remove(h, client);
+                        free(client);
+                        return r;
+                }
+        }
+
+        return 0;
+}
+
+static int append_unit_properties(DBusMessageIter *iter, Unit *u, char **states, char **properties) {
+        DBusMessageIter sub;
+        int r;
+
+        assert(iter);
+        assert(u);
+
+        /* Server side filtering: the unit has to be in one of the
+         * specified load, active or sub states */
+        if (!strv_isempty(states) &&
+            !strv_contains(states, unit_load_state_to_string(u->load_state)) &&
+            !strv_contains(states, unit_active_state_to_string(unit_active_state(u))) &&
+            !strv_contains(states, unit_sub_state_to_string(u)))
+                return 0;
+
+        if (!UNIT_VTABLE(u)->bus_append_properties)
+                return 0;
+
+        if (!dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &sub) ||
+            !dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &u->id))
+                return -ENOMEM;
+
+        r = UNIT_VTABLE(u)->bus_append_properties(u, &sub, properties);
+        if (r < 0)
+                return r;
+
+        if (!dbus_message_iter_close_container(iter, &sub))
+                return -ENOMEM;
+
+        return 1;
+}
+
+/* A unit which could not be returned is reported as its name and a
+ * single "Error" entry, holding the D-Bus error name and message. */
+static int append_unit_error(DBusMessageIter *iter, const char *name, DBusError *error, int r) {
+        DBusMessageIter sub, sub2, sub3, sub4, sub5;
+        const char *key = "Error", *error_name, *error_message;
+
+        assert(iter);
+        assert(name);
+        assert(error);
+
+        if (dbus_error_is_set(error)) {
+                error_name = error->name;
+                error_message = error->message;
+        } else {
+                error_name = bus_errno_to_dbus(r);
+                error_message = strempty(strerror(-r));
+        }
+
+        if (!dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &sub) ||
+            !dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &name) ||
+            !dbus_message_iter_open_container(&sub, DBUS_TYPE_ARRAY, "{sv}", &sub2) ||
+            !dbus_message_iter_open_container(&sub2, DBUS_TYPE_DICT_ENTRY, NULL, &sub3) ||
+            !dbus_message_iter_append_basic(&sub3, DBUS_TYPE_STRING, &key) ||
+            !dbus_message_iter_open_container(&sub3, DBUS_TYPE_VARIANT, "(ss)", &sub4) ||
+            !dbus_message_iter_open_container(&sub4, DBUS_TYPE_STRUCT, NULL, &sub5) ||
+            !dbus_message_iter_append_basic(&sub5, DBUS_TYPE_STRING, &error_name) ||
+            !dbus_message_iter_append_basic(&sub5, DBUS_TYPE_STRING, &error_message) ||
+            !dbus_message_iter_close_container(&sub4, &sub5) ||
+            !dbus_message_iter_close_container(&sub3, &sub4) ||
+            !dbus_message_iter_close_container(&sub2, &sub3) ||
+            !dbus_message_iter_close_container(&sub, &sub2) ||
+            !dbus_message_iter_close_container(iter, &sub))
+                return -ENOMEM;
+
+        return 0;
+}
+
+/* Append a unit once, if the caller may look at it. Units which
+ * were asked for by name are reported if access is denied, units
+ * matched by a glob are skipped. */
+static int append_unit_properties_checked(
+                DBusConnection *connection,
+                DBusMessage *message,
+                DBusMessageIter *iter,
+                Set *seen,
+                Unit *u,
+                char **states,
+                char **properties,
+                bool by_name) {
+
+        DBusError error;
+        int r;
+
+        assert(seen);
+        assert(u);
+
+        if (set_get(seen, u))
+                return 0;
+
+        r = set_put(seen, u);
+        if (r < 0)
+                return r;
+
+        dbus_error_init(&error);
+        r = selinux_access_check(connection, message, u->source_path ?: u->fragment_path, "status", &error);
+        if (r < 0) {
+                r = by_name ? append_unit_error(iter, u->id, &error, r) : 0;
+                dbus_error_free(&error);
+                return r;
+        }
+
+        return append_unit_properties(iter, u, states, properties);
+}
+
 static DBusHandlerResult bus_manager_message_handler(DBusConnection *connection, DBusMessage *message, void *data) {
         _cleanup_dbus_message_unref_ DBusMessage *reply = NULL;
         _cleanup_free_ char * path = NULL;
@@ -1160,31 +1361,232 @@ static DBusHandlerResult bus_manager_message_handler(DBusConnection *connection,
                 if (!dbus_message_iter_close_container(&iter, &sub))
                         goto oom;
 
+        } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "GetUnitProperties")) {
+                _cleanup_strv_free_ char **names = NULL, **states = NULL, **properties = NULL;
+                _cleanup_set_free_ Set *seen = NULL;
+                DBusMessageIter iter, sub;
+                char **n;
+
+                SELINUX_ACCESS_CHECK(connection, message, "status");
+
+                if (!dbus_message_iter_init(message, &iter))
+                        goto oom;
+
+                r = bus_parse_strv_iter(&iter, &names);
+                if (r >= 0)
+                        r = dbus_message_iter_next(&iter) ? bus_parse_strv_iter(&iter, &states) : -EINVAL;
+                if (r >= 0)
+                        r = dbus_message_iter_next(&iter) ? bus_parse_strv_iter(&iter, &properties) : -EINVAL;
+                if (r == -ENOMEM)
+                        goto oom;
+                if (r < 0)
+                        return bus_send_error_reply(connection, message, NULL, r);
+
+                /* names and globs might refer to the same unit, return it only once */
+                seen = set_new(trivial_hash_func, trivial_compare_func);
+                if (!seen)
+                        goto oom;
+
+                reply = dbus_message_new_method_return(message);
+                if (!reply)
+                        goto oom;
+
+                dbus_message_iter_init_append(reply, &iter);
+
+                if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(sa{sv})", &sub))
+                        goto oom;
+
+                if (strv_isempty(names)) {
+                        Iterator i;
+                        Unit *u;
+                        const char *k;
+
+                        HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                                if (k != u->id)
+                                        continue;
+
+                                r = append_unit_properties_checked(connection, message, &sub, seen, u, states, properties, false);
+                                if (r == -ENOMEM)
+                                        goto oom;
+                                if (r < 0)
+                                        return bus_send_error_reply(connection, message, NULL, r);
+                        }
+                }
+
+                /* Units are returned in the order they were asked
+                 * for. Plain names are loaded if necessary, globs are
+                 * matched against the units already loaded. A name
+                 * which cannot be loaded is reported in its place. */
+                STRV_FOREACH(n, names) {
+                        Unit *u;
+
+                        if (strpbrk(*n, "*?[")) {
+                                Iterator i;
+                                const char *k;
+
+                                HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                                        if (k != u->id || fnmatch(*n, k, FNM_NOESCAPE) != 0)
+                                                continue;
+
+                                        r = append_unit_properties_checked(connection, message, &sub, seen, u, states, properties, false);
+                                        if (r == -ENOMEM)
+                                                goto oom;
+                                        if (r < 0)
+                                                return bus_send_error_reply(connection, message, NULL, r);
+                                }
+
+                                continue;
+                        }
+
+                        r = manager_load_unit(m, *n, NULL, &error, &u);
+                        if (r < 0) {
+                                r = append_unit_error(&sub, *n, &error, r);
+                                dbus_error_free(&error);
+                                if (r < 0)
+                                        goto oom;
+                                continue;
+                        }
+
+                        r = append_unit_properties_checked(connection, message, &sub, seen, u, states, properties, true);
+                        if (r == -ENOMEM)
+                                goto oom;
+                        if (r < 0)
+                                return bus_send_error_reply(connection, message, NULL, r);
+                }
+
+                if (!dbus_message_iter_close_container(&iter, &sub))
+                        goto oom;
+
+        } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "ListUnitTimes")) {
+                DBusMessageIter iter, sub;
+                Iterator i;
+                Unit *u;
+                const char *k;
+
+                /* Returns the activation timestamps and the ordering
+                 * dependencies of all units in one go, so that boot
+                 * analysis doesn't need a round trip per unit */
+
+                SELINUX_ACCESS_CHECK(connection, message, "status");
+
+                reply = dbus_message_new_method_return(message);
+                if (!reply)
+                        goto oom;
+
+                dbus_message_iter_init_append(reply, &iter);
+
+                if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(sttttas)", &sub))
+                        goto oom;
+
+                HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+                        DBusMessageIter sub2, sub3;
+                        Iterator j;
+                        Unit *other;
+
+                        if (k != u->id)
+                                continue;
+
+                        if (!dbus_message_iter_open_container(&sub, DBUS_TYPE_STRUCT, NULL, &sub2))
+                                goto oom;
+
+                        if (!dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &u->id) ||
+                            !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &u->inactive_exit_timestamp.monotonic) ||
+                            !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &u->active_enter_timestamp.monotonic) ||
+                            !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &u->active_exit_timestamp.monotonic) ||
+                            !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_UINT64, &u->inactive_enter_timestamp.monotonic))
+                                goto oom;
+
+                        if (!dbus_message_iter_open_container(&sub2, DBUS_TYPE_ARRAY, "s", &sub3))
+                                goto oom;
+
+                        SET_FOREACH(other, u->dependencies[UNIT_AFTER], j)
+                                if (!dbus_message_iter_append_basic(&sub3, DBUS_TYPE_STRING, &other->id))
+                                        goto oom;
+
+                        if (!dbus_message_iter_close_container(&sub2, &sub3) ||
+                            !dbus_message_iter_close_container(&sub, &sub2))
+                                goto oom;
+                }
+
+                if (!dbus_message_iter_close_container(&iter, &sub))
+                        goto oom;
+
         } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "Subscribe")) {
-                char *client;
-                Set *s;
+                const char *client;
 
                 SELINUX_ACCESS_CHECK(connection, message, "status");
 
-                s = BUS_CONNECTION_SUBSCRIBED(m, connection);
-                if (!s) {
-                        s = set_new(string_hash_func, string_compare_func);
-                        if (!s)
+                client = bus_message_get_sender_with_fallback(message);
+
+                /* Subscribing without filter after subscribing with
+                 * one just drops the filter */
+                if (hashmap_get(BUS_CONNECTION_SUBSCRIPTION_FILTERS(m, connection), client))
+                        bus_subscription_filter_remove(m, connection, client);
+                else {
+                        r = subscribe_client(m, connection, client);
+                        if (r == -ENOMEM)
                                 goto oom;
+                        if (r < 0)
+                                return bus_send_error_reply(connection, message, NULL, r);
+                }
+
+                reply = dbus_message_new_method_return(message);
+                if (!reply)
+                        goto oom;
+
+        } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "SubscribeUnits")) {
+                _cleanup_strv_free_ char **types = NULL;
+                BusSubscriptionFilter *f;
+                DBusMessageIter iter;
+                const char *client;
+                char **t;
+
+                SELINUX_ACCESS_CHECK(connection, message, "status");
+
+                if (!dbus_message_iter_init(message, &iter))
+                        goto oom;
+
+                f = new0(BusSubscriptionFilter, 1);
+                if (!f)
+                        goto oom;
 
-                        if (!dbus_connection_set_data(connection, m->subscribed_data_slot, s, NULL)) {
-                                set_free(s);
+                r = bus_parse_strv_iter(&iter, &f->units);
+                if (r >= 0) {
+                        if (dbus_message_iter_next(&iter))
+                                r = bus_parse_strv_iter(&iter, &types);
+                        else
+                                r = -EINVAL;
+                }
+                if (r < 0) {
+                        bus_subscription_filter_free(f);
+                        if (r == -ENOMEM)
                                 goto oom;
+
+                        return bus_send_error_reply(connection, message, NULL, r);
+                }
+
+                STRV_FOREACH(t, types) {
+                        UnitType ut;
+
+                        ut = unit_type_from_string(*t);
+                        if (ut < 0) {
+                                bus_subscription_filter_free(f);
+                                dbus_set_error(&error, DBUS_ERROR_INVALID_ARGS, "Unknown unit type %s.", *t);
+                                return bus_send_error_reply(connection, message, &error, -EINVAL);
                         }
+
+                        f->types |= 1U << ut;
                 }
 
-                client = strdup(bus_message_get_sender_with_fallback(message));
-                if (!client)
-                        goto oom;
+                client = bus_message_get_sender_with_fallback(message);
+                bus_subscription_filter_remove(m, connection, client);
 
-                r = set_put(s, client);
+                r = subscribe_client_filtered(m, connection, client, f);
                 if (r < 0) {
-                        free(client);
+                        bus_subscription_filter_free(f);
+                        if (r == -ENOMEM)
+                                goto oom;
+
                         return bus_send_error_reply(connection, message, NULL, r);
                 }
 
@@ -1203,6 +1605,7 @@ static DBusHandlerResult bus_manager_message_handler(DBusConnection *connection,
                         return bus_send_error_reply(connection, message, &error, -ENOENT);
                 }
 
+                bus_subscription_filter_remove(m, connection, client);
                 free(client);
 
                 reply = dbus_message_new_method_return(message);
@@ -1240,6 +1643,37 @@ static DBusHandlerResult bus_manager_message_handler(DBusConnection *connection,
                         goto oom;
                 }
 
+                free(dump);
+        } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "DumpProfile")) {
+                FILE *f;
+                char *dump = NULL;
+                size_t size;
+
+                SELINUX_ACCESS_CHECK(connection, message, "status");
+
+                reply = dbus_message_new_method_return(message);
+                if (!reply)
+                        goto oom;
+
+                f = open_memstream(&dump, &size);
+                if (!f)
+                        goto oom;
+
+                manager_dump_profile(m, f);
+
+                if (ferror(f)) {
+                        fclose(f);
+                        free(dump);
+                        goto oom;
+                }
+
+                fclose(f);
+
+                if (!dbus_message_append_args(reply, DBUS_TYPE_STRING, &dump, DBUS_TYPE_INVALID)) {
+                        free(dump);
+                        goto oom;
+                }
+
                 free(dump);
         } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "CreateSnapshot")) {
                 const char *name;
@@ -1390,6 +1824,45 @@ static DBusHandlerResult bus_manager_message_handler(DBusConnection *connection,
                 m->queued_message_connection = connection;
                 m->exit_code = MANAGER_RELOAD;
 
+        } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "ReloadIncremental")) {
+                uint32_t changed;
+                unsigned n = 0;
+
+                SELINUX_ACCESS_CHECK(connection, message, "reload");
+
+                /* Only go through the whole serialize, flush and
+                 * deserialize cycle if any unit file, drop-in or
+                 * unit directory changed since the last reload. */
+
+                if (!manager_need_reload(m, &n)) {
+                        log_debug("Configuration unchanged, not reloading.");
+
+                        changed = 0;
+                        reply = dbus_message_new_method_return(message);
+                        if (!reply)
+                                goto oom;
+
+                        if (!dbus_message_append_args(reply, DBUS_TYPE_UINT32, &changed, DBUS_TYPE_INVALID))
+                                goto oom;
+
+                } else {
+                        assert(!m->queued_message);
+
+                        changed = n;
+                        m->queued_message = dbus_message_new_method_return(message);
+                        if (!m->queued_message)
+                                goto oom;
+
+                        if (!dbus_message_append_args(m->queued_message, DBUS_TYPE_UINT32, &changed, DBUS_TYPE_INVALID)) {
+                                dbus_message_unref(m->queued_message);
+                                m->queued_message = NULL;
+                                goto oom;
+                        }
+
+                        m->queued_message_connection = connection;
+                        m->exit_code = MANAGER_RELOAD;
+                }
+
         } else if (dbus_message_is_method_call(message, "org.freedesktop.systemd1.Manager", "Reexecute")) {
 
                 SELINUX_ACCESS_CHECK(connection, message, "reload");
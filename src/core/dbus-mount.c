@@ -152,17 +152,27 @@ static const BusProperty bus_mount_properties[] = {
         { NULL, }
 };
 
+#define BOUND_PROPERTIES(u, m)                                                                       \
+        {                                                                                            \
+                { "org.freedesktop.systemd1.Unit",  bus_unit_properties,         u },                \
+                { "org.freedesktop.systemd1.Mount", bus_mount_properties,        m },                \
+                { "org.freedesktop.systemd1.Mount", bus_exec_context_properties, &m->exec_context }, \
+                { "org.freedesktop.systemd1.Mount", bus_kill_context_properties, &m->kill_context }, \
+                { "org.freedesktop.systemd1.Mount", bus_unit_cgroup_properties,  u },                \
+                { NULL, }                                                                            \
+        }
+
+int bus_mount_append_properties(Unit *u, DBusMessageIter *i, char **properties) {
+        Mount *m = MOUNT(u);
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, m);
+
+        return bus_append_bound_properties(i, bps, NULL, properties);
+}
+
 DBusHandlerResult bus_mount_message_handler(Unit *u, DBusConnection *c, DBusMessage *message) {
         Mount *m = MOUNT(u);
 
-        const BusBoundProperties bps[] = {
-                { "org.freedesktop.systemd1.Unit",  bus_unit_properties,         u },
-                { "org.freedesktop.systemd1.Mount", bus_mount_properties,        m },
-                { "org.freedesktop.systemd1.Mount", bus_exec_context_properties, &m->exec_context },
-                { "org.freedesktop.systemd1.Mount", bus_kill_context_properties, &m->kill_context },
-                { "org.freedesktop.systemd1.Mount", bus_unit_cgroup_properties,  u },
-                { NULL, }
-        };
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, m);
 
         SELINUX_UNIT_ACCESS_CHECK(u, c, message, "status");
 
@@ -33,6 +33,7 @@
         "  <property name=\"Paths\" type=\"a(ss)\" access=\"read\"/>\n" \
         "  <property name=\"MakeDirectory\" type=\"b\" access=\"read\"/>\n" \
         "  <property name=\"DirectoryMode\" type=\"u\" access=\"read\"/>\n" \
+        "  <property name=\"CoalesceUSec\" type=\"t\" access=\"read\"/>\n" \
         "  <property name=\"Result\" type=\"s\" access=\"read\"/>\n"    \
         " </interface>\n"
 
@@ -104,17 +105,28 @@ static const BusProperty bus_path_properties[] = {
         { "Paths",         bus_path_append_paths, "a(ss)", 0 },
         { "MakeDirectory", bus_property_append_bool,  "b", offsetof(Path, make_directory) },
         { "DirectoryMode", bus_property_append_mode,  "u", offsetof(Path, directory_mode) },
+        { "CoalesceUSec",  bus_property_append_usec,  "t", offsetof(Path, coalesce_usec) },
         { "Result",        bus_path_append_path_result, "s", offsetof(Path, result) },
         { NULL, }
 };
 
+#define BOUND_PROPERTIES(u, p)                                               \
+        {                                                                    \
+                { "org.freedesktop.systemd1.Unit", bus_unit_properties, u }, \
+                { "org.freedesktop.systemd1.Path", bus_path_properties, p }, \
+                { NULL, }                                                    \
+        }
+
+int bus_path_append_properties(Unit *u, DBusMessageIter *i, char **properties) {
+        Path *p = PATH(u);
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, p);
+
+        return bus_append_bound_properties(i, bps, NULL, properties);
+}
+
 DBusHandlerResult bus_path_message_handler(Unit *u, DBusConnection *c, DBusMessage *message) {
         Path *p = PATH(u);
-        const BusBoundProperties bps[] = {
-                { "org.freedesktop.systemd1.Unit", bus_unit_properties, u },
-                { "org.freedesktop.systemd1.Path", bus_path_properties, p },
-                { NULL, }
-        };
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, p);
 
         SELINUX_UNIT_ACCESS_CHECK(u, c, message, "status");
 
@@ -26,6 +26,7 @@
 #include "unit.h"
 
 DBusHandlerResult bus_path_message_handler(Unit *u, DBusConnection *c, DBusMessage *message);
+int bus_path_append_properties(Unit *u, DBusMessageIter *i, char **properties);
 
 extern const char bus_path_interface[];
 
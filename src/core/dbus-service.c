@@ -42,6 +42,8 @@
         "  <property name=\"StartLimitInterval\" type=\"t\" access=\"read\"/>\n" \
         "  <property name=\"StartLimitBurst\" type=\"u\" access=\"read\"/>\n" \
         "  <property name=\"StartLimitAction\" type=\"s\" access=\"readwrite\"/>\n" \
+        "  <property name=\"NotifyLimitInterval\" type=\"t\" access=\"read\"/>\n" \
+        "  <property name=\"NotifyLimitBurst\" type=\"u\" access=\"read\"/>\n" \
         BUS_EXEC_COMMAND_INTERFACE("ExecStartPre")                      \
         BUS_EXEC_COMMAND_INTERFACE("ExecStart")                         \
         BUS_EXEC_COMMAND_INTERFACE("ExecStartPost")                     \
@@ -59,6 +61,8 @@
         "  <property name=\"ControlPID\" type=\"u\" access=\"read\"/>\n" \
         "  <property name=\"BusName\" type=\"s\" access=\"read\"/>\n"   \
         "  <property name=\"StatusText\" type=\"s\" access=\"read\"/>\n" \
+        "  <property name=\"NNotifyMessages\" type=\"u\" access=\"read\"/>\n" \
+        "  <property name=\"NNotifyDropped\" type=\"u\" access=\"read\"/>\n" \
         "  <property name=\"Result\" type=\"s\" access=\"read\"/>\n"    \
        " </interface>\n"
 
@@ -91,6 +95,8 @@ const char bus_service_invalidating_properties[] =
         "MainPID\0"
         "ControlPID\0"
         "StatusText\0"
+        "NNotifyMessages\0"
+        "NNotifyDropped\0"
         "Result\0";
 
 static DEFINE_BUS_PROPERTY_APPEND_ENUM(bus_service_append_type, service_type, ServiceType);
@@ -126,6 +132,8 @@ static const BusProperty bus_service_properties[] = {
         { "StartLimitInterval",     bus_property_append_usec,         "t", offsetof(Service, start_limit.interval)         },
         { "StartLimitBurst",        bus_property_append_uint32,       "u", offsetof(Service, start_limit.burst)            },
         { "StartLimitAction",       bus_service_append_start_limit_action,"s", offsetof(Service, start_limit_action), false, bus_service_set_start_limit_action},
+        { "NotifyLimitInterval",    bus_property_append_usec,         "t", offsetof(Service, notify_limit.interval)        },
+        { "NotifyLimitBurst",       bus_property_append_uint32,       "u", offsetof(Service, notify_limit.burst)           },
         BUS_EXEC_COMMAND_PROPERTY("ExecStartPre",  offsetof(Service, exec_command[SERVICE_EXEC_START_PRE]),  true ),
         BUS_EXEC_COMMAND_PROPERTY("ExecStart",     offsetof(Service, exec_command[SERVICE_EXEC_START]),      true ),
         BUS_EXEC_COMMAND_PROPERTY("ExecStartPost", offsetof(Service, exec_command[SERVICE_EXEC_START_POST]), true ),
@@ -140,22 +148,34 @@ static const BusProperty bus_service_properties[] = {
         { "ControlPID",             bus_property_append_pid,          "u", offsetof(Service, control_pid)                  },
         { "BusName",                bus_property_append_string,       "s", offsetof(Service, bus_name),               true },
         { "StatusText",             bus_property_append_string,       "s", offsetof(Service, status_text),            true },
+        { "NNotifyMessages",        bus_property_append_unsigned,     "u", offsetof(Service, n_notify_messages)            },
+        { "NNotifyDropped",         bus_property_append_unsigned,     "u", offsetof(Service, n_notify_dropped)             },
         { "Result",                 bus_service_append_service_result,"s", offsetof(Service, result)                       },
         { NULL, }
 };
 
+#define BOUND_PROPERTIES(u, s)                                                                                 \
+        {                                                                                                      \
+                { "org.freedesktop.systemd1.Unit",    bus_unit_properties,             u },                    \
+                { "org.freedesktop.systemd1.Service", bus_service_properties,          s },                    \
+                { "org.freedesktop.systemd1.Service", bus_exec_context_properties,     &s->exec_context },     \
+                { "org.freedesktop.systemd1.Service", bus_kill_context_properties,     &s->kill_context },     \
+                { "org.freedesktop.systemd1.Service", bus_exec_main_status_properties, &s->main_exec_status }, \
+                { "org.freedesktop.systemd1.Service", bus_unit_cgroup_properties,      u },                    \
+                { NULL, }                                                                                      \
+        }
+
+int bus_service_append_properties(Unit *u, DBusMessageIter *i, char **properties) {
+        Service *s = SERVICE(u);
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, s);
+
+        return bus_append_bound_properties(i, bps, NULL, properties);
+}
+
 DBusHandlerResult bus_service_message_handler(Unit *u, DBusConnection *connection, DBusMessage *message) {
         Service *s = SERVICE(u);
 
-        const BusBoundProperties bps[] = {
-                { "org.freedesktop.systemd1.Unit",    bus_unit_properties,             u },
-                { "org.freedesktop.systemd1.Service", bus_service_properties,          s },
-                { "org.freedesktop.systemd1.Service", bus_exec_context_properties,     &s->exec_context },
-                { "org.freedesktop.systemd1.Service", bus_kill_context_properties,     &s->kill_context },
-                { "org.freedesktop.systemd1.Service", bus_exec_main_status_properties, &s->main_exec_status },
-                { "org.freedesktop.systemd1.Service", bus_unit_cgroup_properties,      u },
-                { NULL, }
-        };
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, s);
 
         SELINUX_UNIT_ACCESS_CHECK(u, connection, message, "status");
 
@@ -51,6 +51,20 @@ static const BusProperty bus_snapshot_properties[] = {
         { NULL, }
 };
 
+#define BOUND_PROPERTIES(u, s)                                                       \
+        {                                                                            \
+                { "org.freedesktop.systemd1.Unit",     bus_unit_properties,     u }, \
+                { "org.freedesktop.systemd1.Snapshot", bus_snapshot_properties, s }, \
+                { NULL, }                                                            \
+        }
+
+int bus_snapshot_append_properties(Unit *u, DBusMessageIter *i, char **properties) {
+        Snapshot *s = SNAPSHOT(u);
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, s);
+
+        return bus_append_bound_properties(i, bps, NULL, properties);
+}
+
 DBusHandlerResult bus_snapshot_message_handler(Unit *u, DBusConnection *c, DBusMessage *message) {
         Snapshot *s = SNAPSHOT(u);
         _cleanup_dbus_message_unref_ DBusMessage *reply = NULL;
@@ -66,11 +80,7 @@ DBusHandlerResult bus_snapshot_message_handler(Unit *u, DBusConnection *c, DBusM
                 snapshot_remove(SNAPSHOT(u));
 
         } else {
-                const BusBoundProperties bps[] = {
-                        { "org.freedesktop.systemd1.Unit",     bus_unit_properties,     u },
-                        { "org.freedesktop.systemd1.Snapshot", bus_snapshot_properties, s },
-                        { NULL, }
-                };
+                const BusBoundProperties bps[] = BOUND_PROPERTIES(u, s);
 
                 SELINUX_UNIT_ACCESS_CHECK(u, c, message, "status");
 
@@ -136,16 +136,26 @@ static const BusProperty bus_socket_properties[] = {
         { NULL, }
 };
 
+#define BOUND_PROPERTIES(u, s)                                                                        \
+        {                                                                                             \
+                { "org.freedesktop.systemd1.Unit",   bus_unit_properties,         u },                \
+                { "org.freedesktop.systemd1.Socket", bus_socket_properties,       s },                \
+                { "org.freedesktop.systemd1.Socket", bus_exec_context_properties, &s->exec_context }, \
+                { "org.freedesktop.systemd1.Socket", bus_kill_context_properties, &s->kill_context }, \
+                { "org.freedesktop.systemd1.Socket", bus_unit_properties,         u },                \
+                { NULL, }                                                                             \
+        }
+
+int bus_socket_append_properties(Unit *u, DBusMessageIter *i, char **properties) {
+        Socket *s = SOCKET(u);
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, s);
+
+        return bus_append_bound_properties(i, bps, NULL, properties);
+}
+
 DBusHandlerResult bus_socket_message_handler(Unit *u, DBusConnection *c, DBusMessage *message) {
         Socket *s = SOCKET(u);
-        const BusBoundProperties bps[] = {
-                { "org.freedesktop.systemd1.Unit",   bus_unit_properties,         u },
-                { "org.freedesktop.systemd1.Socket", bus_socket_properties,       s },
-                { "org.freedesktop.systemd1.Socket", bus_exec_context_properties, &s->exec_context },
-                { "org.freedesktop.systemd1.Socket", bus_kill_context_properties, &s->kill_context },
-                { "org.freedesktop.systemd1.Socket", bus_unit_properties,         u },
-                { NULL, }
-        };
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, s);
 
         SELINUX_UNIT_ACCESS_CHECK(u, c, message, "status");
 
@@ -26,6 +26,7 @@
 #include "unit.h"
 
 DBusHandlerResult bus_socket_message_handler(Unit *u, DBusConnection *c, DBusMessage *message);
+int bus_socket_append_properties(Unit *u, DBusMessageIter *i, char **properties);
 
 extern const char bus_socket_interface[];
 extern const char bus_socket_invalidating_properties[];
@@ -100,16 +100,26 @@ static const BusProperty bus_swap_properties[] = {
         { NULL, }
 };
 
+#define BOUND_PROPERTIES(u, s)                                                                      \
+        {                                                                                           \
+                { "org.freedesktop.systemd1.Unit", bus_unit_properties,         u },                \
+                { "org.freedesktop.systemd1.Swap", bus_swap_properties,         s },                \
+                { "org.freedesktop.systemd1.Swap", bus_exec_context_properties, &s->exec_context }, \
+                { "org.freedesktop.systemd1.Swap", bus_kill_context_properties, &s->kill_context }, \
+                { "org.freedesktop.systemd1.Swap", bus_unit_cgroup_properties,  u },                \
+                { NULL, }                                                                           \
+        }
+
+int bus_swap_append_properties(Unit *u, DBusMessageIter *i, char **properties) {
+        Swap *s = SWAP(u);
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, s);
+
+        return bus_append_bound_properties(i, bps, NULL, properties);
+}
+
 DBusHandlerResult bus_swap_message_handler(Unit *u, DBusConnection *c, DBusMessage *message) {
         Swap *s = SWAP(u);
-        const BusBoundProperties bps[] = {
-                { "org.freedesktop.systemd1.Unit", bus_unit_properties,         u },
-                { "org.freedesktop.systemd1.Swap", bus_swap_properties,         s },
-                { "org.freedesktop.systemd1.Swap", bus_exec_context_properties, &s->exec_context },
-                { "org.freedesktop.systemd1.Swap", bus_kill_context_properties, &s->kill_context },
-                { "org.freedesktop.systemd1.Swap", bus_unit_cgroup_properties,  u },
-                { NULL, }
-        };
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, s);
 
         SELINUX_UNIT_ACCESS_CHECK(u, c, message, "status");
 
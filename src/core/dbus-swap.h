@@ -27,6 +27,7 @@
 #include "unit.h"
 
 DBusHandlerResult bus_swap_message_handler(Unit *u, DBusConnection *c, DBusMessage *message);
+int bus_swap_append_properties(Unit *u, DBusMessageIter *i, char **properties);
 
 extern const char bus_swap_interface[];
 extern const char bus_swap_invalidating_properties[];
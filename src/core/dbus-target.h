@@ -26,5 +26,6 @@
 #include "unit.h"
 
 DBusHandlerResult bus_target_message_handler(Unit *u, DBusConnection *c, DBusMessage *message);
+int bus_target_append_properties(Unit *u, DBusMessageIter *i, char **properties);
 
 extern const char bus_target_interface[];
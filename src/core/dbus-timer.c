@@ -177,13 +177,23 @@ static const BusProperty bus_timer_properties[] = {
         { NULL, }
 };
 
+#define BOUND_PROPERTIES(u, t)                                                 \
+        {                                                                      \
+                { "org.freedesktop.systemd1.Unit",  bus_unit_properties,  u }, \
+                { "org.freedesktop.systemd1.Timer", bus_timer_properties, t }, \
+                { NULL, }                                                      \
+        }
+
+int bus_timer_append_properties(Unit *u, DBusMessageIter *i, char **properties) {
+        Timer *t = TIMER(u);
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, t);
+
+        return bus_append_bound_properties(i, bps, NULL, properties);
+}
+
 DBusHandlerResult bus_timer_message_handler(Unit *u, DBusConnection *c, DBusMessage *message) {
         Timer *t = TIMER(u);
-        const BusBoundProperties bps[] = {
-                { "org.freedesktop.systemd1.Unit",  bus_unit_properties,  u },
-                { "org.freedesktop.systemd1.Timer", bus_timer_properties, t },
-                { NULL, }
-        };
+        const BusBoundProperties bps[] = BOUND_PROPERTIES(u, t);
 
         SELINUX_UNIT_ACCESS_CHECK(u, c, message, "status");
 
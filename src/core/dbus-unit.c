@@ -80,6 +80,22 @@ static int bus_unit_append_following(DBusMessageIter *i, const char *property, v
         return 0;
 }
 
+static int bus_unit_append_blocked_by(DBusMessageIter *i, const char *property, void *data) {
+        Unit *u = data;
+        const char *d;
+
+        assert(i);
+        assert(property);
+        assert(u);
+
+        d = strempty(u->blocked_by);
+
+        if (!dbus_message_iter_append_basic(i, DBUS_TYPE_STRING, &d))
+                return -ENOMEM;
+
+        return 0;
+}
+
 static int bus_unit_append_dependencies(DBusMessageIter *i, const char *property, void *data) {
         Unit *u;
         Iterator j;
@@ -699,9 +715,68 @@ const DBusObjectPathVTable bus_unit_vtable = {
         .message_function = bus_unit_message_handler
 };
 
+/* NeedDaemonReload is left alone, it stat()s the unit files and is
+ * only looked at when a signal is actually built */
+static void unit_get_bus_state(Unit *u, UnitBusState *s) {
+        assert(u);
+        assert(s);
+
+        s->load_state = u->load_state;
+        s->active_state = unit_active_state(u);
+        s->sub_state = unit_sub_state_to_string(u);
+        s->inactive_exit_timestamp = u->inactive_exit_timestamp.realtime;
+        s->active_enter_timestamp = u->active_enter_timestamp.realtime;
+        s->active_exit_timestamp = u->active_exit_timestamp.realtime;
+        s->inactive_enter_timestamp = u->inactive_enter_timestamp.realtime;
+        s->job_id = u->job ? u->job->id : 0;
+}
+
+/* Records the current values of the generic properties, for when no
+ * signal is sent */
+void bus_unit_update_state(Unit *u) {
+        assert(u);
+
+        unit_get_bus_state(u, &u->bus_state);
+}
+
+static void append_property(char **p, const char *name) {
+        *p = stpcpy(*p, name) + 1;
+}
+
+static void unit_changed_properties(const UnitBusState *old, const UnitBusState *new, char *buf) {
+        char *p = buf;
+
+        /* Writes the names of the properties from
+         * INVALIDATING_PROPERTIES whose values differ into buf, as
+         * NULSTR */
+
+        if (old->load_state != new->load_state)
+                append_property(&p, "LoadState");
+        if (old->active_state != new->active_state)
+                append_property(&p, "ActiveState");
+        if (!streq_ptr(old->sub_state, new->sub_state))
+                append_property(&p, "SubState");
+        if (old->inactive_exit_timestamp != new->inactive_exit_timestamp)
+                append_property(&p, "InactiveExitTimestamp");
+        if (old->active_enter_timestamp != new->active_enter_timestamp)
+                append_property(&p, "ActiveEnterTimestamp");
+        if (old->active_exit_timestamp != new->active_exit_timestamp)
+                append_property(&p, "ActiveExitTimestamp");
+        if (old->inactive_enter_timestamp != new->inactive_enter_timestamp)
+                append_property(&p, "InactiveEnterTimestamp");
+        if (old->job_id != new->job_id)
+                append_property(&p, "Job");
+        if (old->need_daemon_reload != new->need_daemon_reload)
+                append_property(&p, "NeedDaemonReload");
+
+        *p = 0;
+}
+
 void bus_unit_send_change_signal(Unit *u) {
         _cleanup_free_ char *p = NULL;
         _cleanup_dbus_message_unref_ DBusMessage *m = NULL;
+        char changed[sizeof(INVALIDATING_PROPERTIES)];
+        UnitBusState state;
 
         assert(u);
 
@@ -713,6 +788,16 @@ void bus_unit_send_change_signal(Unit *u) {
         if (!u->id)
                 return;
 
+        /* Keep track of the generic properties also while nobody
+         * listens, so that the next signal lists exactly what
+         * changed since the state subscribers last saw */
+        state = u->bus_state;
+        unit_get_bus_state(u, &state);
+        if (bus_has_subscriber(u->manager))
+                state.need_daemon_reload = unit_need_daemon_reload(u);
+        unit_changed_properties(&u->bus_state, &state, changed);
+        u->bus_state = state;
+
         if (!bus_has_subscriber(u->manager)) {
                 u->sent_dbus_new_signal = true;
                 return;
@@ -736,14 +821,19 @@ void bus_unit_send_change_signal(Unit *u) {
                         if (!m)
                                 goto oom;
 
-                        if (bus_broadcast(u->manager, m) < 0)
+                        if (bus_broadcast_unit(u->manager, u, m) < 0)
                                 goto oom;
 
                         dbus_message_unref(m);
+                        m = NULL;
                 }
 
-                m = bus_properties_changed_new(p, "org.freedesktop.systemd1.Unit",
-                                               INVALIDATING_PROPERTIES);
+                /* Only list the generic properties whose values
+                 * changed since the last signal */
+                if (!changed[0])
+                        return;
+
+                m = bus_properties_changed_new(p, "org.freedesktop.systemd1.Unit", changed);
                 if (!m)
                         goto oom;
 
@@ -763,7 +853,7 @@ void bus_unit_send_change_signal(Unit *u) {
                         goto oom;
         }
 
-        if (bus_broadcast(u->manager, m) < 0)
+        if (bus_broadcast_unit(u->manager, u, m) < 0)
                 goto oom;
 
         u->sent_dbus_new_signal = true;
@@ -805,7 +895,7 @@ void bus_unit_send_removed_signal(Unit *u) {
                                       DBUS_TYPE_INVALID))
                 goto oom;
 
-        if (bus_broadcast(u->manager, m) < 0)
+        if (bus_broadcast_unit(u->manager, u, m) < 0)
                 goto oom;
 
         return;
@@ -1249,6 +1339,15 @@ const BusProperty bus_unit_properties[] = {
         { "ConditionTimestamp",   bus_property_append_usec,           "t", offsetof(Unit, condition_timestamp.realtime)       },
         { "ConditionTimestampMonotonic", bus_property_append_usec,    "t", offsetof(Unit, condition_timestamp.monotonic)      },
         { "ConditionResult",      bus_property_append_bool,           "b", offsetof(Unit, condition_result)                   },
+        { "JobEnqueueTimestamp",  bus_property_append_usec,           "t", offsetof(Unit, job_enqueue_timestamp.realtime)     },
+        { "JobEnqueueTimestampMonotonic", bus_property_append_usec,   "t", offsetof(Unit, job_enqueue_timestamp.monotonic)    },
+        { "JobStartTimestamp",    bus_property_append_usec,           "t", offsetof(Unit, job_start_timestamp.realtime)       },
+        { "JobStartTimestampMonotonic", bus_property_append_usec,     "t", offsetof(Unit, job_start_timestamp.monotonic)      },
+        { "ExecTimestamp",        bus_property_append_usec,           "t", offsetof(Unit, exec_timestamp.realtime)            },
+        { "ExecTimestampMonotonic", bus_property_append_usec,         "t", offsetof(Unit, exec_timestamp.monotonic)           },
+        { "ReadyTimestamp",       bus_property_append_usec,           "t", offsetof(Unit, ready_timestamp.realtime)           },
+        { "ReadyTimestampMonotonic", bus_property_append_usec,        "t", offsetof(Unit, ready_timestamp.monotonic)          },
+        { "BlockedBy",            bus_unit_append_blocked_by,         "s", 0 },
         { "LoadError",            bus_unit_append_load_error,      "(ss)", 0 },
         { NULL, }
 };
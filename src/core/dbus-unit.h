@@ -120,6 +120,15 @@
         "  <property name=\"ConditionTimestamp\" type=\"t\" access=\"read\"/>\n" \
         "  <property name=\"ConditionTimestampMonotonic\" type=\"t\" access=\"read\"/>\n" \
         "  <property name=\"ConditionResult\" type=\"b\" access=\"read\"/>\n" \
+        "  <property name=\"JobEnqueueTimestamp\" type=\"t\" access=\"read\"/>\n" \
+        "  <property name=\"JobEnqueueTimestampMonotonic\" type=\"t\" access=\"read\"/>\n" \
+        "  <property name=\"JobStartTimestamp\" type=\"t\" access=\"read\"/>\n" \
+        "  <property name=\"JobStartTimestampMonotonic\" type=\"t\" access=\"read\"/>\n" \
+        "  <property name=\"ExecTimestamp\" type=\"t\" access=\"read\"/>\n" \
+        "  <property name=\"ExecTimestampMonotonic\" type=\"t\" access=\"read\"/>\n" \
+        "  <property name=\"ReadyTimestamp\" type=\"t\" access=\"read\"/>\n" \
+        "  <property name=\"ReadyTimestampMonotonic\" type=\"t\" access=\"read\"/>\n" \
+        "  <property name=\"BlockedBy\" type=\"s\" access=\"read\"/>\n" \
         "  <property name=\"LoadError\" type=\"(ss)\" access=\"read\"/>\n" \
         " </interface>\n"
 
@@ -156,6 +165,7 @@ extern const BusProperty bus_unit_properties[];
 extern const BusProperty bus_unit_cgroup_properties[];
 
 void bus_unit_send_change_signal(Unit *u);
+void bus_unit_update_state(Unit *u);
 void bus_unit_send_removed_signal(Unit *u);
 
 DBusHandlerResult bus_unit_queue_job(
@@ -23,6 +23,7 @@
 #include <sys/timerfd.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fnmatch.h>
 #include <dbus/dbus.h>
 
 #include "dbus.h"
@@ -344,6 +345,8 @@ static DBusHandlerResult api_bus_message_filter(DBusConnection *connection, DBus
                         if (set_remove(BUS_CONNECTION_SUBSCRIBED(m, connection), (char*) name))
                                 log_debug("Subscription client vanished: %s (left: %u)", name, set_size(BUS_CONNECTION_SUBSCRIBED(m, connection)));
 
+                        bus_subscription_filter_remove(m, connection, name);
+
                         if (old_owner[0] == 0)
                                 old_owner = NULL;
 
@@ -1138,6 +1141,10 @@ int bus_init(Manager *m, bool try_bus_connect) {
                 if (!dbus_connection_allocate_data_slot(&m->subscribed_data_slot))
                         goto oom;
 
+        if (m->subscription_filters_data_slot < 0)
+                if (!dbus_connection_allocate_data_slot(&m->subscription_filters_data_slot))
+                        goto oom;
+
         if (try_bus_connect) {
                 if ((r = bus_init_system(m)) < 0 ||
                     (r = bus_init_api(m)) < 0)
@@ -1154,6 +1161,7 @@ oom:
 
 static void shutdown_connection(Manager *m, DBusConnection *c) {
         Set *s;
+        Hashmap *h;
         Job *j;
         Iterator i;
 
@@ -1179,6 +1187,17 @@ static void shutdown_connection(Manager *m, DBusConnection *c) {
                 set_free(s);
         }
 
+        if ((h = BUS_CONNECTION_SUBSCRIPTION_FILTERS(m, c))) {
+                char *t;
+
+                while ((t = hashmap_first_key(h))) {
+                        bus_subscription_filter_free(hashmap_remove(h, t));
+                        free(t);
+                }
+
+                hashmap_free(h);
+        }
+
         if (m->queued_message_connection == c) {
                 m->queued_message_connection = NULL;
 
@@ -1255,6 +1274,9 @@ void bus_done(Manager *m) {
 
         if (m->subscribed_data_slot >= 0)
                 dbus_connection_free_data_slot(&m->subscribed_data_slot);
+
+        if (m->subscription_filters_data_slot >= 0)
+                dbus_connection_free_data_slot(&m->subscription_filters_data_slot);
 }
 
 static void query_pid_pending_cb(DBusPendingCall *pending, void *userdata) {
@@ -1372,6 +1394,153 @@ int bus_broadcast(Manager *m, DBusMessage *message) {
         return oom ? -ENOMEM : 0;
 }
 
+static bool bus_connection_is_filtered(Manager *m, DBusConnection *c) {
+        Hashmap *h;
+
+        /* A connection is filtered if every subscriber on it asked
+         * for a subset of units only. If anybody wants everything
+         * we just broadcast. */
+
+        h = BUS_CONNECTION_SUBSCRIPTION_FILTERS(m, c);
+        if (hashmap_isempty(h))
+                return false;
+
+        return set_size(BUS_CONNECTION_SUBSCRIBED(m, c)) <= hashmap_size(h);
+}
+
+static int bus_broadcast_unit_one(Manager *m, DBusConnection *c, Unit *u, DBusMessage *message) {
+        BusSubscriptionFilter *f;
+        const char *client;
+        Iterator i;
+
+        if (!bus_connection_is_filtered(m, c))
+                return dbus_connection_send(c, message, NULL) ? 0 : -ENOMEM;
+
+        HASHMAP_FOREACH_KEY(f, client, BUS_CONNECTION_SUBSCRIPTION_FILTERS(m, c), i) {
+                DBusMessage *copy;
+                bool ok;
+
+                if (!bus_subscription_filter_test(f, u))
+                        continue;
+
+                /* Peer-to-peer connections have a single client */
+                if (c != m->api_bus && c != m->system_bus)
+                        return dbus_connection_send(c, message, NULL) ? 0 : -ENOMEM;
+
+                /* On a bus, turn the signal into a unicast one for
+                 * each interested client */
+                copy = dbus_message_copy(message);
+                if (!copy)
+                        return -ENOMEM;
+
+                ok = dbus_message_set_destination(copy, client) &&
+                        dbus_connection_send(c, copy, NULL);
+                dbus_message_unref(copy);
+
+                if (!ok)
+                        return -ENOMEM;
+        }
+
+        return 0;
+}
+
+int bus_broadcast_unit(Manager *m, Unit *u, DBusMessage *message) {
+        bool oom = false;
+        Iterator i;
+        DBusConnection *c;
+
+        assert(m);
+        assert(u);
+        assert(message);
+
+        /* Like bus_broadcast(), but for messages about a specific
+         * unit, which are only sent to subscribers interested in
+         * it */
+
+        SET_FOREACH(c, m->bus_connections_for_dispatch, i)
+                if (c != m->system_bus || m->running_as == SYSTEMD_SYSTEM)
+                        if (bus_broadcast_unit_one(m, c, u, message) < 0)
+                                oom = true;
+
+        SET_FOREACH(c, m->bus_connections, i)
+                if (c != m->system_bus || m->running_as == SYSTEMD_SYSTEM)
+                        if (bus_broadcast_unit_one(m, c, u, message) < 0)
+                                oom = true;
+
+        return oom ? -ENOMEM : 0;
+}
+
+bool bus_client_receives_unit(Manager *m, DBusConnection *c, const char *client, Unit *u) {
+        BusSubscriptionFilter *f;
+
+        assert(m);
+        assert(c);
+        assert(client);
+        assert(u);
+
+        /* Checks whether a bus_broadcast_unit() reaches the client */
+
+        if (c == m->system_bus && m->running_as != SYSTEMD_SYSTEM)
+                return false;
+
+        if (!bus_connection_is_filtered(m, c))
+                return true;
+
+        f = hashmap_get(BUS_CONNECTION_SUBSCRIPTION_FILTERS(m, c), client);
+        return f && bus_subscription_filter_test(f, u);
+}
+
+void bus_subscription_filter_free(BusSubscriptionFilter *f) {
+        if (!f)
+                return;
+
+        strv_free(f->units);
+        free(f);
+}
+
+bool bus_subscription_filter_test(BusSubscriptionFilter *f, Unit *u) {
+        char **p;
+
+        assert(f);
+        assert(u);
+
+        if (f->types != 0 &&
+            (u->type < 0 || !(f->types & (1U << u->type))))
+                return false;
+
+        if (strv_isempty(f->units))
+                return true;
+
+        if (!u->id)
+                return false;
+
+        STRV_FOREACH(p, f->units)
+                if (fnmatch(*p, u->id, FNM_NOESCAPE) == 0)
+                        return true;
+
+        return false;
+}
+
+void bus_subscription_filter_remove(Manager *m, DBusConnection *c, const char *client) {
+        Hashmap *h;
+        BusSubscriptionFilter *f;
+        void *t;
+
+        assert(m);
+        assert(c);
+        assert(client);
+
+        h = BUS_CONNECTION_SUBSCRIPTION_FILTERS(m, c);
+
+        f = hashmap_get2(h, client, &t);
+        if (!f)
+                return;
+
+        hashmap_remove(h, client);
+        bus_subscription_filter_free(f);
+        free(t);
+}
+
 bool bus_has_subscriber(Manager *m) {
         Iterator i;
         DBusConnection *c;
@@ -25,6 +25,14 @@
 
 #include "manager.h"
 
+typedef struct BusSubscriptionFilter {
+        /* Globs matched against the unit id, empty for all units */
+        char **units;
+
+        /* Bitmask of (1 << UnitType), 0 for all types */
+        unsigned types;
+} BusSubscriptionFilter;
+
 int bus_init(Manager *m, bool try_bus_connect);
 void bus_done(Manager *m);
 
@@ -36,6 +44,12 @@ void bus_timeout_event(Manager *m, Watch *w, int events);
 int bus_query_pid(Manager *m, const char *name);
 
 int bus_broadcast(Manager *m, DBusMessage *message);
+int bus_broadcast_unit(Manager *m, Unit *u, DBusMessage *message);
+bool bus_client_receives_unit(Manager *m, DBusConnection *c, const char *client, Unit *u);
+
+void bus_subscription_filter_free(BusSubscriptionFilter *f);
+bool bus_subscription_filter_test(BusSubscriptionFilter *f, Unit *u);
+void bus_subscription_filter_remove(Manager *m, DBusConnection *c, const char *client);
 
 bool bus_has_subscriber(Manager *m);
 bool bus_connection_has_subscriber(Manager *m, DBusConnection *c);
@@ -45,6 +59,7 @@ int bus_fdset_add_all(Manager *m, FDSet *fds);
 void bus_broadcast_finished(Manager *m, usec_t firmware_usec, usec_t loader_usec, usec_t kernel_usec, usec_t initrd_usec, usec_t userspace_usec, usec_t total_usec);
 
 #define BUS_CONNECTION_SUBSCRIBED(m, c) dbus_connection_get_data((c), (m)->subscribed_data_slot)
+#define BUS_CONNECTION_SUBSCRIPTION_FILTERS(m, c) dbus_connection_get_data((c), (m)->subscription_filters_data_slot)
 #define BUS_PENDING_CALL_NAME(m, p) dbus_pending_call_get_data((p), (m)->name_data_slot)
 
 extern const char * const bus_interface_table[];
@@ -623,6 +623,7 @@ const UnitVTable device_vtable = {
         .sub_state_to_string = device_sub_state_to_string,
 
         .bus_interface = "org.freedesktop.systemd1.Device",
+        .bus_append_properties = bus_device_append_properties,
         .bus_message_handler = bus_device_message_handler,
         .bus_invalidating_properties =  bus_device_invalidating_properties,
 
@@ -0,0 +1,661 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "fragment-cache.h"
+#include "hashmap.h"
+#include "log.h"
+#include "macro.h"
+#include "mkdir.h"
+#include "sparse-endian.h"
+#include "strbuf.h"
+#include "util.h"
+
+#define FRAGMENT_CACHE_SIG { 'S', 'D', 'U', 'N', 'I', 'T', 'F', 'C' }
+
+/* on-disk objects */
+struct fragment_cache_header_f {
+        uint8_t signature[8];
+
+        /* version of systemd which created the file */
+        le64_t tool_version;
+        le64_t file_size;
+
+        /* size of structures to allow them to grow */
+        le64_t header_size;
+        le64_t entry_size;
+        le64_t record_size;
+
+        le64_t entries_off;
+        le64_t entries_count;
+
+        le64_t strings_off;
+        le64_t strings_len;
+} _packed_;
+
+/* one entry per fragment file, followed by its records elsewhere in the file */
+struct fragment_cache_entry_f {
+        le64_t path_off;
+        le64_t mtime;
+        le64_t size;
+        le64_t records_off;
+        le64_t records_count;
+} _packed_;
+
+/* one record per assignment, in the order they appear in the file;
+ * section_off is 0 for assignments outside of any section */
+struct fragment_cache_record_f {
+        le64_t section_off;
+        le64_t lvalue_off;
+        le64_t rvalue_off;
+        le64_t line;
+} _packed_;
+
+typedef struct FragmentCacheRecord {
+        unsigned line;
+        char *section;
+        char *lvalue;
+        char *rvalue;
+} FragmentCacheRecord;
+
+typedef struct FragmentCacheEntry {
+        char *path;
+        usec_t mtime;
+        uint64_t size;
+
+        /* Either the entry is still valid in the mapped file, or we
+         * parsed the fragment freshly and recorded its assignments */
+        const struct fragment_cache_entry_f *mapped;
+
+        FragmentCacheRecord *records;
+        unsigned n_records, n_allocated;
+
+        bool cacheable:1;
+} FragmentCacheEntry;
+
+struct FragmentCache {
+        char *path;
+
+        int fd;
+        const uint8_t *map;
+        size_t map_size;
+        const struct fragment_cache_header_f *head;
+
+        /* path => mapped entry, as found in the file */
+        Hashmap *index;
+
+        /* path => FragmentCacheEntry, what we write out next */
+        Hashmap *entries;
+
+        unsigned n_hits, n_misses;
+        bool dirty:1;
+};
+
+static void fragment_cache_entry_free(FragmentCacheEntry *e) {
+        unsigned i;
+
+        if (!e)
+                return;
+
+        for (i = 0; i < e->n_records; i++) {
+                free(e->records[i].section);
+                free(e->records[i].lvalue);
+                free(e->records[i].rvalue);
+        }
+
+        free(e->records);
+        free(e->path);
+        free(e);
+}
+
+static const char *map_string(FragmentCache *c, uint64_t off) {
+        assert(c);
+        assert(c->head);
+
+        if (off >= le64toh(c->head->strings_len))
+                return NULL;
+
+        return (const char*) c->map + le64toh(c->head->strings_off) + off;
+}
+
+static int fragment_cache_map(FragmentCache *c) {
+        const char sig[] = FRAGMENT_CACHE_SIG;
+        const struct fragment_cache_entry_f *entries;
+        uint64_t n, i, strings_off, strings_len, entries_off;
+        struct stat st;
+        int r;
+
+        assert(c);
+
+        c->fd = open(c->path, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (c->fd < 0)
+                return errno == ENOENT ? 0 : -errno;
+
+        if (fstat(c->fd, &st) < 0)
+                return -errno;
+
+        if ((size_t) st.st_size < sizeof(struct fragment_cache_header_f))
+                return -EBADMSG;
+
+        c->map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, c->fd, 0);
+        if (c->map == MAP_FAILED) {
+                c->map = NULL;
+                return -errno;
+        }
+        c->map_size = st.st_size;
+        c->head = (const struct fragment_cache_header_f*) c->map;
+
+        if (memcmp(c->head->signature, sig, sizeof(c->head->signature)) != 0 ||
+            le64toh(c->head->file_size) != c->map_size ||
+            le64toh(c->head->tool_version) != (uint64_t) atoi(VERSION) ||
+            le64toh(c->head->header_size) != sizeof(struct fragment_cache_header_f) ||
+            le64toh(c->head->entry_size) != sizeof(struct fragment_cache_entry_f) ||
+            le64toh(c->head->record_size) != sizeof(struct fragment_cache_record_f))
+                return -EBADMSG;
+
+        entries_off = le64toh(c->head->entries_off);
+        n = le64toh(c->head->entries_count);
+        strings_off = le64toh(c->head->strings_off);
+        strings_len = le64toh(c->head->strings_len);
+
+        if (entries_off > c->map_size ||
+            n > (c->map_size - entries_off) / sizeof(struct fragment_cache_entry_f) ||
+            strings_len <= 0 ||
+            strings_off > c->map_size ||
+            strings_len > c->map_size - strings_off ||
+            c->map[strings_off + strings_len - 1] != 0)
+                return -EBADMSG;
+
+        c->index = hashmap_new(string_hash_func, string_compare_func);
+        if (!c->index)
+                return -ENOMEM;
+
+        entries = (const struct fragment_cache_entry_f*) (c->map + entries_off);
+        for (i = 0; i < n; i++) {
+                const char *p;
+                uint64_t records_off, records_count;
+
+                records_off = le64toh(entries[i].records_off);
+                records_count = le64toh(entries[i].records_count);
+
+                if (records_off > c->map_size ||
+                    records_count > (c->map_size - records_off) / sizeof(struct fragment_cache_record_f))
+                        return -EBADMSG;
+
+                p = map_string(c, le64toh(entries[i].path_off));
+                if (!p)
+                        return -EBADMSG;
+
+                r = hashmap_put(c->index, p, (void*) &entries[i]);
+                if (r < 0 && r != -EEXIST)
+                        return r;
+        }
+
+        return 0;
+}
+
+static void fragment_cache_unmap(FragmentCache *c) {
+        assert(c);
+
+        hashmap_free(c->index);
+        c->index = NULL;
+
+        if (c->map)
+                munmap((void*) c->map, c->map_size);
+        c->map = NULL;
+        c->map_size = 0;
+        c->head = NULL;
+
+        if (c->fd >= 0)
+                close_nointr_nofail(c->fd);
+        c->fd = -1;
+}
+
+FragmentCache *fragment_cache_new(const char *path) {
+        FragmentCache *c;
+        int r;
+
+        assert(path);
+
+        c = new0(FragmentCache, 1);
+        if (!c)
+                return NULL;
+
+        c->fd = -1;
+
+        c->path = strdup(path);
+        if (!c->path)
+                goto fail;
+
+        c->entries = hashmap_new(string_hash_func, string_compare_func);
+        if (!c->entries)
+                goto fail;
+
+        r = fragment_cache_map(c);
+        if (r == -ENOMEM)
+                goto fail;
+        if (r < 0) {
+                /* A broken cache is not fatal, we'll just
+                 * overwrite it with a good one later on */
+                log_debug("Ignoring unit fragment cache %s: %s", c->path, strerror(-r));
+                fragment_cache_unmap(c);
+        }
+
+        return c;
+
+fail:
+        fragment_cache_free(c);
+        return NULL;
+}
+
+void fragment_cache_free(FragmentCache *c) {
+        FragmentCacheEntry *e;
+
+        if (!c)
+                return;
+
+        while ((e = hashmap_steal_first(c->entries)))
+                fragment_cache_entry_free(e);
+        hashmap_free(c->entries);
+
+        fragment_cache_unmap(c);
+
+        free(c->path);
+        free(c);
+}
+
+static int record_assignment(
+                const char *filename,
+                unsigned line,
+                const char *section,
+                const char *lvalue,
+                const char *rvalue,
+                void *userdata) {
+
+        FragmentCacheEntry *e = userdata;
+        FragmentCacheRecord *r;
+
+        assert(e);
+
+        if (!e->cacheable)
+                return 0;
+
+        /* We only validate the fragment itself, hence anything that
+         * pulls in other files via .include is not cached */
+        if (!streq(filename, e->path)) {
+                e->cacheable = false;
+                return 0;
+        }
+
+        if (e->n_records >= e->n_allocated) {
+                unsigned n;
+
+                n = MAX(e->n_allocated * 2, 16U);
+                r = realloc(e->records, n * sizeof(FragmentCacheRecord));
+                if (!r)
+                        return -ENOMEM;
+
+                e->records = r;
+                e->n_allocated = n;
+        }
+
+        r = e->records + e->n_records;
+        zero(*r);
+        r->line = line;
+
+        if ((section && !(r->section = strdup(section))) ||
+            !(r->lvalue = strdup(lvalue)) ||
+            !(r->rvalue = strdup(rvalue))) {
+                free(r->section);
+                free(r->lvalue);
+                return -ENOMEM;
+        }
+
+        e->n_records++;
+        return 0;
+}
+
+static bool entry_verify(FragmentCache *c, const struct fragment_cache_entry_f *m) {
+        const struct fragment_cache_record_f *records;
+        uint64_t i, n;
+
+        assert(c);
+        assert(m);
+
+        /* Check everything up front, so that we never apply half
+         * of a fragment from the cache and then parse it again */
+
+        records = (const struct fragment_cache_record_f*) (c->map + le64toh(m->records_off));
+        n = le64toh(m->records_count);
+
+        for (i = 0; i < n; i++) {
+                uint64_t section_off;
+
+                section_off = le64toh(records[i].section_off);
+                if (section_off > 0 && !map_string(c, section_off))
+                        return false;
+
+                if (!map_string(c, le64toh(records[i].lvalue_off)) ||
+                    !map_string(c, le64toh(records[i].rvalue_off)))
+                        return false;
+        }
+
+        return true;
+}
+
+static int replay_entry(
+                FragmentCache *c,
+                const struct fragment_cache_entry_f *m,
+                const char *filename,
+                ConfigItemLookup lookup,
+                void *table,
+                bool relaxed,
+                void *userdata) {
+
+        const struct fragment_cache_record_f *records;
+        uint64_t i, n;
+        int r;
+
+        records = (const struct fragment_cache_record_f*) (c->map + le64toh(m->records_off));
+        n = le64toh(m->records_count);
+
+        for (i = 0; i < n; i++) {
+                uint64_t section_off;
+                const char *section = NULL;
+
+                section_off = le64toh(records[i].section_off);
+                if (section_off > 0)
+                        section = map_string(c, section_off);
+
+                r = config_parse_assignment(filename, (unsigned) le64toh(records[i].line),
+                                            lookup, table, section,
+                                            map_string(c, le64toh(records[i].lvalue_off)),
+                                            map_string(c, le64toh(records[i].rvalue_off)),
+                                            relaxed, userdata);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+int fragment_cache_parse(
+                FragmentCache *c,
+                const char *filename,
+                FILE *f,
+                const struct stat *st,
+                const char *sections,
+                ConfigItemLookup lookup,
+                void *table,
+                bool relaxed,
+                void *userdata) {
+
+        const struct fragment_cache_entry_f *m;
+        FragmentCacheEntry *e, *old;
+        usec_t mtime;
+        int r;
+
+        assert(c);
+        assert(filename);
+        assert(f);
+        assert(st);
+
+        mtime = timespec_load(&st->st_mtim);
+
+        e = new0(FragmentCacheEntry, 1);
+        if (!e)
+                return -ENOMEM;
+
+        e->path = strdup(filename);
+        if (!e->path) {
+                free(e);
+                return -ENOMEM;
+        }
+
+        e->mtime = mtime;
+        e->size = (uint64_t) st->st_size;
+        e->cacheable = true;
+
+        m = hashmap_get(c->index, filename);
+        if (m &&
+            le64toh(m->mtime) == mtime &&
+            le64toh(m->size) == (uint64_t) st->st_size) {
+
+                if (entry_verify(c, m)) {
+                        r = replay_entry(c, m, filename, lookup, table, relaxed, userdata);
+                        if (r < 0) {
+                                fragment_cache_entry_free(e);
+                                return r;
+                        }
+
+                        e->mapped = m;
+                        c->n_hits++;
+                        goto finish;
+                }
+
+                log_debug("Unit fragment cache entry for %s is corrupt, parsing.", filename);
+        }
+
+        c->n_misses++;
+
+        r = config_parse_full(filename, f, sections, lookup, table, relaxed, record_assignment, e, userdata);
+        if (r < 0) {
+                fragment_cache_entry_free(e);
+                return r;
+        }
+
+        if (!e->cacheable) {
+                fragment_cache_entry_free(e);
+                return 0;
+        }
+
+        c->dirty = true;
+
+finish:
+        old = hashmap_remove(c->entries, e->path);
+        fragment_cache_entry_free(old);
+
+        r = hashmap_put(c->entries, e->path, e);
+        if (r < 0)
+                /* Not being able to cache this is no reason to
+                 * fail loading the unit */
+                fragment_cache_entry_free(e);
+
+        return 0;
+}
+
+static int store_string(struct strbuf *sb, const char *s, le64_t *ret) {
+        ssize_t off;
+
+        off = strbuf_add_string(sb, s, strlen(s));
+        if (off < 0)
+                return (int) off;
+
+        *ret = htole64((uint64_t) off);
+        return 0;
+}
+
+static int fragment_cache_write(FragmentCache *c) {
+        struct fragment_cache_header_f h = {
+                .signature = FRAGMENT_CACHE_SIG,
+                .header_size = htole64(sizeof(struct fragment_cache_header_f)),
+                .entry_size = htole64(sizeof(struct fragment_cache_entry_f)),
+                .record_size = htole64(sizeof(struct fragment_cache_record_f)),
+        };
+        struct fragment_cache_entry_f *entries = NULL;
+        struct fragment_cache_record_f *records = NULL;
+        uint64_t n_records = 0, k = 0, offset;
+        unsigned n_entries, j = 0;
+        FragmentCacheEntry *e;
+        struct strbuf *sb;
+        char *t = NULL;
+        FILE *f = NULL;
+        Iterator i;
+        int r;
+
+        assert(c);
+
+        h.tool_version = htole64((uint64_t) atoi(VERSION));
+
+        n_entries = hashmap_size(c->entries);
+        HASHMAP_FOREACH(e, c->entries, i)
+                n_records += e->mapped ? le64toh(e->mapped->records_count) : e->n_records;
+
+        sb = strbuf_new();
+        entries = new0(struct fragment_cache_entry_f, MAX(n_entries, 1U));
+        records = new0(struct fragment_cache_record_f, MAX(n_records, 1U));
+        if (!sb || !entries || !records) {
+                r = -ENOMEM;
+                goto finish;
+        }
+
+        offset = sizeof(struct fragment_cache_header_f);
+
+        HASHMAP_FOREACH(e, c->entries, i) {
+                struct fragment_cache_entry_f *ef = entries + j++;
+                uint64_t n, l;
+
+                r = store_string(sb, e->path, &ef->path_off);
+                if (r < 0)
+                        goto finish;
+
+                ef->mtime = htole64(e->mtime);
+                ef->size = htole64(e->size);
+                ef->records_off = htole64(offset + k * sizeof(struct fragment_cache_record_f));
+
+                n = e->mapped ? le64toh(e->mapped->records_count) : e->n_records;
+                ef->records_count = htole64(n);
+
+                for (l = 0; l < n; l++, k++) {
+                        struct fragment_cache_record_f *rf = records + k;
+                        const char *section, *lvalue, *rvalue;
+                        unsigned line;
+
+                        if (e->mapped) {
+                                const struct fragment_cache_record_f *m;
+
+                                m = (const struct fragment_cache_record_f*) (c->map + le64toh(e->mapped->records_off)) + l;
+                                section = le64toh(m->section_off) > 0 ? map_string(c, le64toh(m->section_off)) : NULL;
+                                lvalue = map_string(c, le64toh(m->lvalue_off));
+                                rvalue = map_string(c, le64toh(m->rvalue_off));
+                                line = (unsigned) le64toh(m->line);
+
+                                /* Verified when it was replayed */
+                                assert(lvalue && rvalue);
+                        } else {
+                                section = e->records[l].section;
+                                lvalue = e->records[l].lvalue;
+                                rvalue = e->records[l].rvalue;
+                                line = e->records[l].line;
+                        }
+
+                        /* The empty string is stored at offset 0
+                         * which we use for "no section", which is
+                         * fine since sections cannot be empty. */
+                        if (section && *section) {
+                                r = store_string(sb, section, &rf->section_off);
+                                if (r < 0)
+                                        goto finish;
+                        }
+
+                        r = store_string(sb, lvalue, &rf->lvalue_off);
+                        if (r < 0)
+                                goto finish;
+
+                        r = store_string(sb, rvalue, &rf->rvalue_off);
+                        if (r < 0)
+                                goto finish;
+
+                        rf->line = htole64(line);
+                }
+        }
+
+        strbuf_complete(sb);
+
+        h.entries_off = htole64(offset + n_records * sizeof(struct fragment_cache_record_f));
+        h.entries_count = htole64(n_entries);
+        h.strings_off = htole64(le64toh(h.entries_off) + n_entries * sizeof(struct fragment_cache_entry_f));
+        h.strings_len = htole64(sb->len);
+        h.file_size = htole64(le64toh(h.strings_off) + sb->len);
+
+        mkdir_parents(c->path, 0755);
+
+        r = fopen_temporary(c->path, &f, &t);
+        if (r < 0)
+                goto finish;
+
+        fchmod(fileno(f), 0644);
+
+        fwrite(&h, sizeof(h), 1, f);
+        fwrite(records, sizeof(struct fragment_cache_record_f), n_records, f);
+        fwrite(entries, sizeof(struct fragment_cache_entry_f), n_entries, f);
+        fwrite(sb->buf, sb->len, 1, f);
+        fflush(f);
+
+        if (ferror(f)) {
+                r = -EIO;
+                goto finish;
+        }
+
+        if (rename(t, c->path) < 0) {
+                r = -errno;
+                goto finish;
+        }
+
+        log_debug("Wrote unit fragment cache %s: %u fragments, %llu assignments, %zu bytes of strings.",
+                  c->path, n_entries, (unsigned long long) n_records, sb->len);
+
+        free(t);
+        t = NULL;
+        r = 0;
+
+finish:
+        if (f)
+                fclose(f);
+
+        if (t) {
+                unlink(t);
+                free(t);
+        }
+
+        free(entries);
+        free(records);
+        strbuf_cleanup(sb);
+
+        return r;
+}
+
+int fragment_cache_flush(FragmentCache *c) {
+        assert(c);
+
+        log_debug("Unit fragment cache: %u hits, %u misses.", c->n_hits, c->n_misses);
+
+        /* If we didn't use everything that is in the file it
+         * contains stale entries, drop them */
+        if (!c->dirty && hashmap_size(c->entries) == hashmap_size(c->index))
+                return 0;
+
+        return fragment_cache_write(c);
+}
@@ -0,0 +1,50 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+#pragma once
+
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+
+#include "conf-parser.h"
+
+/* A cache of the tokenized assignments of unit files, keyed by path,
+ * mtime and size. The cache file is mmap()ed while units are loaded,
+ * and fragments that did not change since it was written are loaded
+ * by replaying their assignments instead of reading and parsing the
+ * file again. */
+
+typedef struct FragmentCache FragmentCache;
+
+FragmentCache *fragment_cache_new(const char *path);
+void fragment_cache_free(FragmentCache *c);
+
+int fragment_cache_parse(
+                FragmentCache *c,
+                const char *filename,
+                FILE *f,
+                const struct stat *st,
+                const char *sections,
+                ConfigItemLookup lookup,
+                void *table,
+                bool relaxed,
+                void *userdata);
+
+int fragment_cache_flush(FragmentCache *c);
@@ -169,6 +169,12 @@ static void job_merge_into_installed(Job *j, Job *other) {
         j->ignore_order = j->ignore_order || other->ignore_order;
 }
 
+static bool job_is_activation(Job *j) {
+        /* Whether this job is recorded in the profiling data of the
+         * unit */
+        return j->type == JOB_START || j->type == JOB_RESTART;
+}
+
 Job* job_install(Job *j) {
         Job **pj;
         Job *uj;
@@ -211,6 +217,14 @@ Job* job_install(Job *j) {
         *pj = j;
         j->installed = true;
         j->manager->n_installed_jobs ++;
+
+        if (job_is_activation(j)) {
+                dual_timestamp_get(&j->unit->job_enqueue_timestamp);
+                zero(j->unit->job_start_timestamp);
+                free(j->unit->blocked_by);
+                j->unit->blocked_by = NULL;
+        }
+
         log_debug_unit(j->unit->id,
                        "Installed new job %s/%s as %u",
                        j->unit->id, job_type_to_string(j->type), (unsigned) j->id);
@@ -409,24 +423,24 @@ int job_type_merge_and_collapse(JobType *a, JobType b, Unit *u) {
         return 0;
 }
 
-bool job_is_runnable(Job *j) {
+static Unit *job_get_blocker(Job *j) {
         Iterator i;
         Unit *other;
 
         assert(j);
         assert(j->installed);
 
-        /* Checks whether there is any job running for the units this
-         * job needs to be running after (in the case of a 'positive'
-         * job type) or before (in the case of a 'negative' job
-         * type. */
+        /* Returns a unit with a job this job needs to be running
+         * after (in the case of a 'positive' job type) or before (in
+         * the case of a 'negative' job type), or NULL if there is
+         * none. */
 
         /* First check if there is an override */
         if (j->ignore_order)
-                return true;
+                return NULL;
 
         if (j->type == JOB_NOP)
-                return true;
+                return NULL;
 
         if (j->type == JOB_START ||
             j->type == JOB_VERIFY_ACTIVE ||
@@ -439,7 +453,7 @@ bool job_is_runnable(Job *j) {
 
                 SET_FOREACH(other, j->unit->dependencies[UNIT_AFTER], i)
                         if (other->job)
-                                return false;
+                                return other;
         }
 
         /* Also, if something else is being stopped and we should
@@ -449,7 +463,7 @@ bool job_is_runnable(Job *j) {
                 if (other->job &&
                     (other->job->type == JOB_STOP ||
                      other->job->type == JOB_RESTART))
-                        return false;
+                        return other;
 
         /* This means that for a service a and a service b where b
          * shall be started after a:
@@ -462,7 +476,11 @@ bool job_is_runnable(Job *j) {
          *  This has the side effect that restarts are properly
          *  synchronized too. */
 
-        return true;
+        return NULL;
+}
+
+bool job_is_runnable(Job *j) {
+        return !job_get_blocker(j);
 }
 
 static void job_change_type(Job *j, JobType newtype) {
@@ -478,6 +496,7 @@ int job_run_and_invalidate(Job *j) {
         int r;
         uint32_t id;
         Manager *m;
+        Unit *blocker;
 
         assert(j);
         assert(j->installed);
@@ -490,12 +509,25 @@ int job_run_and_invalidate(Job *j) {
         if (j->state != JOB_WAITING)
                 return 0;
 
-        if (!job_is_runnable(j))
+        blocker = job_get_blocker(j);
+        if (blocker) {
+                /* Remember whom we waited for. The last one before
+                 * we become runnable is our critical predecessor. It
+                 * is only recorded by name, to not keep it loaded. */
+                if (job_is_activation(j) && !streq_ptr(j->unit->blocked_by, blocker->id)) {
+                        free(j->unit->blocked_by);
+                        j->unit->blocked_by = strdup(blocker->id);
+                }
+
                 return -EAGAIN;
+        }
 
         j->state = JOB_RUNNING;
         job_add_to_dbus_queue(j);
 
+        if (job_is_activation(j))
+                dual_timestamp_get(&j->unit->job_start_timestamp);
+
         /* While we execute this operation the job might go away (for
          * example: because it is replaced by a new, conflicting
          * job.) To make sure we don't access a freed job later on we
@@ -940,53 +972,37 @@ void job_timer_event(Job *j, uint64_t n_elapsed, Watch *w) {
 }
 
 int job_serialize(Job *j, FILE *f, FDSet *fds) {
-        fprintf(f, "job-id=%u\n", j->id);
-        fprintf(f, "job-type=%s\n", job_type_to_string(j->type));
-        fprintf(f, "job-state=%s\n", job_state_to_string(j->state));
-        fprintf(f, "job-override=%s\n", yes_no(j->override));
-        fprintf(f, "job-sent-dbus-new-signal=%s\n", yes_no(j->sent_dbus_new_signal));
-        fprintf(f, "job-ignore-order=%s\n", yes_no(j->ignore_order));
+        serialize_item_format(f, "job-id", "%u", j->id);
+        serialize_item(f, "job-type", job_type_to_string(j->type));
+        serialize_item(f, "job-state", job_state_to_string(j->state));
+        serialize_item(f, "job-override", yes_no(j->override));
+        serialize_item(f, "job-sent-dbus-new-signal", yes_no(j->sent_dbus_new_signal));
+        serialize_item(f, "job-ignore-order", yes_no(j->ignore_order));
         /* Cannot save bus clients. Just note the fact that we're losing
          * them. job_send_message() will fallback to broadcasting. */
-        fprintf(f, "job-forgot-bus-clients=%s\n",
-                yes_no(j->forgot_bus_clients || j->bus_client_list));
+        serialize_item(f, "job-forgot-bus-clients",
+                       yes_no(j->forgot_bus_clients || j->bus_client_list));
         if (j->timer_watch.type == WATCH_JOB_TIMER) {
                 int copy = fdset_put_dup(fds, j->timer_watch.fd);
                 if (copy < 0)
                         return copy;
-                fprintf(f, "job-timer-watch-fd=%d\n", copy);
+                serialize_item_format(f, "job-timer-watch-fd", "%d", copy);
         }
 
         /* End marker */
-        fputc('\n', f);
+        serialize_end(f);
         return 0;
 }
 
-int job_deserialize(Job *j, FILE *f, FDSet *fds) {
+int job_deserialize(Job *j, Deserializer *d, FDSet *fds) {
         for (;;) {
-                char line[LINE_MAX], *l, *v;
-                size_t k;
-
-                if (!fgets(line, sizeof(line), f)) {
-                        if (feof(f))
-                                return 0;
-                        return -errno;
-                }
-
-                char_array_0(line);
-                l = strstrip(line);
+                char *l, *v;
+                int r;
 
                 /* End marker */
-                if (l[0] == 0)
-                        return 0;
-
-                k = strcspn(l, "=");
-
-                if (l[k] == '=') {
-                        l[k] = 0;
-                        v = l+k+1;
-                } else
-                        v = l+k;
+                r = deserializer_next(d, &l, &v);
+                if (r <= 0)
+                        return r;
 
                 if (streq(l, "job-id")) {
                         if (safe_atou32(v, &j->id) < 0)
@@ -105,6 +105,7 @@ enum JobResult {
 #include "unit.h"
 #include "hashmap.h"
 #include "list.h"
+#include "serialize.h"
 
 struct JobDependency {
         /* Encodes that the 'subject' job needs the 'object' job in
@@ -173,7 +174,7 @@ int job_install_deserialized(Job *j);
 void job_uninstall(Job *j);
 void job_dump(Job *j, FILE*f, const char *prefix);
 int job_serialize(Job *j, FILE *f, FDSet *fds);
-int job_deserialize(Job *j, FILE *f, FDSet *fds);
+int job_deserialize(Job *j, Deserializer *d, FDSet *fds);
 int job_coldplug(Job *j);
 
 JobDependency* job_dependency_new(Job *subject, Job *object, bool matters, bool conflicts);
@@ -21,6 +21,8 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "unit.h"
 #include "load-dropin.h"
@@ -31,8 +33,30 @@
 #include "load-fragment.h"
 #include "conf-files.h"
 
+static int add_dropin_path(Unit *u, const char *path, const struct stat *st) {
+        int r;
+
+        assert(u);
+        assert(path);
+        assert(st);
+
+        /* Remember where we loaded drop-ins from, so that we can
+         * tell later on whether they changed */
+
+        if (strv_contains(u->dropin_paths, path))
+                return 0;
+
+        r = strv_extend(&u->dropin_paths, path);
+        if (r < 0)
+                return r;
+
+        u->dropin_mtime = MAX(u->dropin_mtime, timespec_load(&st->st_mtim));
+        return 0;
+}
+
 static int iterate_dir(Unit *u, const char *path, UnitDependency dependency, char ***strv) {
         _cleanup_closedir_ DIR *d = NULL;
+        struct stat st;
         int r;
 
         assert(u);
@@ -41,6 +65,12 @@ static int iterate_dir(Unit *u, const char *path, UnitDependency dependency, cha
         /* The config directories are special, since the order of the
          * drop-ins matters */
         if (dependency < 0)  {
+                if (stat(path, &st) >= 0) {
+                        r = add_dropin_path(u, path, &st);
+                        if (r < 0)
+                                return log_oom();
+                }
+
                 r = strv_extend(strv, path);
                 if (r < 0)
                         return log_oom();
@@ -56,6 +86,12 @@ static int iterate_dir(Unit *u, const char *path, UnitDependency dependency, cha
                 return -errno;
         }
 
+        if (fstat(dirfd(d), &st) >= 0) {
+                r = add_dropin_path(u, path, &st);
+                if (r < 0)
+                        return log_oom();
+        }
+
         for (;;) {
                 struct dirent *de;
                 union dirent_storage buf;
@@ -178,11 +214,79 @@ int unit_load_dropin(Unit *u) {
                 }
 
                 STRV_FOREACH(f, files) {
+                        struct stat st;
+
                         r = config_parse(*f, NULL, UNIT_VTABLE(u)->sections, config_item_perf_lookup, (void*) load_fragment_gperf_lookup, false, u);
                         if (r < 0)
                                 return r;
+
+                        if (stat(*f, &st) >= 0) {
+                                r = add_dropin_path(u, *f, &st);
+                                if (r < 0)
+                                        return log_oom();
+                        }
                 }
         }
 
         return 0;
 }
+
+static bool dropin_dir_added(Unit *u, const char *unit_path, const char *name) {
+        const char *suffix;
+
+        NULSTR_FOREACH(suffix, ".wants\0" ".requires\0" ".d\0") {
+                _cleanup_free_ char *path = NULL;
+
+                path = strjoin(unit_path, "/", name, suffix, NULL);
+                if (!path) {
+                        log_oom();
+                        return true;
+                }
+
+                if (access(path, F_OK) >= 0 && !strv_contains(u->dropin_paths, path))
+                        return true;
+        }
+
+        return false;
+}
+
+bool unit_dropin_added(Unit *u) {
+        unsigned k = 0;
+        char **p;
+
+        assert(u);
+
+        /* Checks whether a drop-in directory was created since the
+         * unit was loaded. That changes the mtime of the unit
+         * directory it is created in, hence we only look into those
+         * whose mtime changed since the last reload. */
+
+        STRV_FOREACH(p, u->manager->lookup_paths.unit_path) {
+                Iterator i;
+                char *t;
+
+                if (!manager_unit_path_changed(u->manager, k++))
+                        continue;
+
+                SET_FOREACH(t, u->names, i) {
+                        _cleanup_free_ char *template = NULL;
+
+                        if (dropin_dir_added(u, *p, t))
+                                return true;
+
+                        if (!u->instance)
+                                continue;
+
+                        template = unit_name_template(t);
+                        if (!template) {
+                                log_oom();
+                                return true;
+                        }
+
+                        if (dropin_dir_added(u, *p, template))
+                                return true;
+                }
+        }
+
+        return false;
+}
@@ -26,3 +26,5 @@
 /* Read service data supplementary drop-in directories */
 
 int unit_load_dropin(Unit *u);
+
+bool unit_dropin_added(Unit *u);
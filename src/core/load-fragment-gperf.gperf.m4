@@ -169,6 +169,8 @@ m4_ifdef(`HAVE_SYSV_COMPAT',
 Service.NonBlocking,             config_parse_bool,                  0,                             offsetof(Service, exec_context.non_blocking)
 Service.BusName,                 config_parse_unit_string_printf,    0,                             offsetof(Service, bus_name)
 Service.NotifyAccess,            config_parse_notify_access,         0,                             offsetof(Service, notify_access)
+Service.NotifyLimitInterval,     config_parse_usec,                  0,                             offsetof(Service, notify_limit.interval)
+Service.NotifyLimitBurst,        config_parse_unsigned,              0,                             offsetof(Service, notify_limit.burst)
 Service.Sockets,                 config_parse_service_sockets,       0,                             0
 Service.FsckPassNo,              config_parse_fsck_passno,           0,                             offsetof(Service, fsck_passno)
 EXEC_CONTEXT_CONFIG_ITEMS(Service)m4_dnl
@@ -248,9 +250,11 @@ Path.PathExistsGlob,             config_parse_path_spec,             0,
 Path.PathChanged,                config_parse_path_spec,             0,                             0
 Path.PathModified,               config_parse_path_spec,             0,                             0
 Path.DirectoryNotEmpty,          config_parse_path_spec,             0,                             0
+Path.DirectoryNotEmptyRecursive, config_parse_path_spec,             0,                             0
 Path.Unit,                       config_parse_path_unit,             0,                             0
 Path.MakeDirectory,              config_parse_bool,                  0,                             offsetof(Path, make_directory)
 Path.DirectoryMode,              config_parse_mode,                  0,                             offsetof(Path, directory_mode)
+Path.CoalesceSec,                config_parse_usec,                  0,                             offsetof(Path, coalesce_usec)
 m4_dnl The [Install] section is ignored here.
 Install.Alias,                   NULL,                               0,                             0
 Install.WantedBy,                NULL,                               0,                             0
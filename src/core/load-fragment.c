@@ -1300,7 +1300,6 @@ int config_parse_path_spec(
 
         s->path = path_kill_slashes(k);
         s->type = b;
-        s->inotify_fd = -1;
 
         LIST_PREPEND(PathSpec, spec, p->specs, s);
 
@@ -2420,8 +2419,13 @@ static int load_from_path(Unit *u, const char *path) {
         if (null_or_empty(&st))
                 u->load_state = UNIT_MASKED;
         else {
-                /* Now, parse the file contents */
-                r = config_parse(filename, f, UNIT_VTABLE(u)->sections, config_item_perf_lookup, (void*) load_fragment_gperf_lookup, false, u);
+                /* Now, parse the file contents, or replay them
+                 * from the cache if the file didn't change */
+                if (u->manager->fragment_cache)
+                        r = fragment_cache_parse(u->manager->fragment_cache, filename, f, &st,
+                                                 UNIT_VTABLE(u)->sections, config_item_perf_lookup, (void*) load_fragment_gperf_lookup, false, u);
+                else
+                        r = config_parse(filename, f, UNIT_VTABLE(u)->sections, config_item_perf_lookup, (void*) load_fragment_gperf_lookup, false, u);
                 if (r < 0)
                         goto finish;
 
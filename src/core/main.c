@@ -1094,7 +1094,8 @@ static int prepare_reexecute(Manager *m, FILE **_f, FDSet **_fds, bool serialize
                 goto fail;
         }
 
-        r = manager_serialize(m, f, fds, serialize_jobs);
+        /* The binary we execute might be older, and only read text */
+        r = manager_serialize(m, f, fds, serialize_jobs, false);
         if (r < 0) {
                 log_error("Failed to serialize state: %s", strerror(-r));
                 goto fail;
@@ -71,6 +71,7 @@
 #include "path-util.h"
 #include "audit-fd.h"
 #include "efivars.h"
+#include "serialize.h"
 
 /* As soon as 16 units are in our GC queue, make sure to run a gc sweep */
 #define GC_QUEUE_ENTRIES_MAX 16
@@ -78,9 +79,16 @@
 /* As soon as 5s passed since a unit was added to our GC queue, make sure to run a gc sweep */
 #define GC_QUEUE_USEC_MAX (10*USEC_PER_SEC)
 
+/* Send change signals at most every 50ms, so that objects changing
+ * state several times in a row result in one signal only */
+#define DBUS_QUEUE_USEC (50*USEC_PER_MSEC)
+
 /* Where clients shall send notification messages to */
 #define NOTIFY_SOCKET "@/org/freedesktop/systemd1/notify"
 
+/* Where we keep the tokenized unit files between reloads */
+#define FRAGMENT_CACHE_PATH "/run/systemd/unit-fragment-cache"
+
 #define TIME_T_MAX (time_t)((1UL << ((sizeof(time_t) << 3) - 1)) - 1)
 
 static int manager_setup_notify(Manager *m) {
@@ -139,6 +147,73 @@ static int manager_setup_notify(Manager *m) {
         return 0;
 }
 
+static int manager_setup_cgroups_agent(Manager *m) {
+        union {
+                struct sockaddr sa;
+                struct sockaddr_un un;
+        } sa;
+        struct epoll_event ev;
+        int one = 1, n = 8*1024*1024;
+
+        assert(m);
+
+        /* The kernel still has to fork off the release agent for us
+         * on every emptied cgroup, but instead of having each agent
+         * connect to the bus it just drops the path into this
+         * datagram socket. Only the system instance running as PID 1
+         * is registered as release agent, hence nobody else needs
+         * this. */
+
+        if (m->running_as != SYSTEMD_SYSTEM || getpid() != 1)
+                return 0;
+
+        m->cgroup_empty_queue = set_new(string_hash_func, string_compare_func);
+        if (!m->cgroup_empty_queue)
+                return log_oom();
+
+        m->cgroups_agent_watch.type = WATCH_CGROUPS_AGENT;
+        m->cgroups_agent_watch.fd = socket(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC|SOCK_NONBLOCK, 0);
+        if (m->cgroups_agent_watch.fd < 0) {
+                log_error("Failed to allocate cgroups agent socket: %m");
+                return -errno;
+        }
+
+        /* Bursts of emptied cgroups are common during shutdown, make
+         * sure they fit into the socket buffer. */
+        if (setsockopt(m->cgroups_agent_watch.fd, SOL_SOCKET, SO_RCVBUFFORCE, &n, sizeof(n)) < 0)
+                log_debug("SO_RCVBUFFORCE on cgroups agent socket failed: %m");
+
+        zero(sa);
+        sa.un.sun_family = AF_UNIX;
+        strncpy(sa.un.sun_path, SYSTEMD_CGROUP_AGENT_SOCKET, sizeof(sa.un.sun_path));
+
+        mkdir_parents_label(SYSTEMD_CGROUP_AGENT_SOCKET, 0755);
+        unlink(SYSTEMD_CGROUP_AGENT_SOCKET);
+
+        if (bind(m->cgroups_agent_watch.fd, &sa.sa, offsetof(struct sockaddr_un, sun_path) + strlen(sa.un.sun_path)) < 0) {
+                log_error("bind() failed: %m");
+                return -errno;
+        }
+
+        if (setsockopt(m->cgroups_agent_watch.fd, SOL_SOCKET, SO_PASSCRED, &one, sizeof(one)) < 0) {
+                log_error("SO_PASSCRED failed: %m");
+                return -errno;
+        }
+
+        zero(ev);
+        ev.events = EPOLLIN;
+        ev.data.ptr = &m->cgroups_agent_watch;
+
+        if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, m->cgroups_agent_watch.fd, &ev) < 0) {
+                log_error("Failed to add cgroups agent socket fd to epoll: %m");
+                return -errno;
+        }
+
+        log_debug("Using cgroups agent socket " SYSTEMD_CGROUP_AGENT_SOCKET);
+
+        return 0;
+}
+
 static int manager_setup_time_change(Manager *m) {
         struct epoll_event ev;
         struct itimerspec its;
@@ -308,7 +383,7 @@ int manager_new(SystemdRunningAs running_as, Manager **_m) {
         efi_get_boot_timestamps(&m->userspace_timestamp, &m->firmware_timestamp, &m->loader_timestamp);
 
         m->running_as = running_as;
-        m->name_data_slot = m->conn_data_slot = m->subscribed_data_slot = -1;
+        m->name_data_slot = m->conn_data_slot = m->subscribed_data_slot = m->subscription_filters_data_slot = -1;
         m->exit_code = _MANAGER_EXIT_CODE_INVALID;
         m->pin_cgroupfs_fd = -1;
         m->idle_pipe[0] = m->idle_pipe[1] = -1;
@@ -318,6 +393,8 @@ int manager_new(SystemdRunningAs running_as, Manager **_m) {
         watch_init(&m->swap_watch);
         watch_init(&m->udev_watch);
         watch_init(&m->time_change_watch);
+        watch_init(&m->cgroups_agent_watch);
+        watch_init(&m->inotify_watch);
 
         m->epoll_fd = m->dev_autofs_fd = -1;
         m->current_job_id = 1; /* start as id #1, so that we can leave #0 around as "null-like" value */
@@ -365,6 +442,10 @@ int manager_new(SystemdRunningAs running_as, Manager **_m) {
         if (r < 0)
                 goto fail;
 
+        r = manager_setup_cgroups_agent(m);
+        if (r < 0)
+                goto fail;
+
         r = manager_setup_time_change(m);
         if (r < 0)
                 goto fail;
@@ -546,6 +627,7 @@ void manager_free(Manager *m) {
         bus_done(m);
 
         hashmap_free(m->units);
+        free(m->units_by_dense_id);
         hashmap_free(m->jobs);
         hashmap_free(m->watch_pids);
         hashmap_free(m->watch_bus);
@@ -558,6 +640,8 @@ void manager_free(Manager *m) {
                 close_nointr_nofail(m->notify_watch.fd);
         if (m->time_change_watch.fd >= 0)
                 close_nointr_nofail(m->time_change_watch.fd);
+        if (m->cgroups_agent_watch.fd >= 0)
+                close_nointr_nofail(m->cgroups_agent_watch.fd);
 
         free(m->notify_socket);
 
@@ -567,7 +651,11 @@ void manager_free(Manager *m) {
         strv_free(m->default_controllers);
 
         hashmap_free(m->cgroup_bondings);
+        cgroup_node_free(m->cgroup_root);
+        set_free_free(m->cgroup_empty_queue);
         set_free_free(m->unit_path_cache);
+        fragment_cache_free(m->fragment_cache);
+        free(m->unit_path_mtimes);
 
         close_pipe(m->idle_pipe);
 
@@ -679,6 +767,79 @@ fail:
         m->unit_path_cache = NULL;
 }
 
+static usec_t unit_dir_mtime(const char *path) {
+        struct stat st;
+
+        /* Directories that don't exist are recorded as 0, so that
+         * we notice when they are created. */
+        if (stat(path, &st) < 0)
+                return 0;
+
+        return timespec_load(&st.st_mtim);
+}
+
+static void manager_stamp_unit_paths(Manager *m) {
+        unsigned k = 0;
+        char **i;
+
+        assert(m);
+
+        /* Adding or removing unit files and drop-in directories
+         * changes the mtime of the directory they live in. Remember
+         * them, so that we can tell whether unit names might resolve
+         * differently now. */
+
+        free(m->unit_path_mtimes);
+        m->unit_path_mtimes = new(usec_t, MAX(strv_length(m->lookup_paths.unit_path), 1U));
+        if (!m->unit_path_mtimes) {
+                log_oom();
+                return;
+        }
+
+        STRV_FOREACH(i, m->lookup_paths.unit_path)
+                m->unit_path_mtimes[k++] = unit_dir_mtime(*i);
+}
+
+bool manager_unit_path_changed(Manager *m, unsigned k) {
+        assert(m);
+        assert(k < strv_length(m->lookup_paths.unit_path));
+
+        return !m->unit_path_mtimes ||
+                unit_dir_mtime(m->lookup_paths.unit_path[k]) != m->unit_path_mtimes[k];
+}
+
+static void manager_open_fragment_cache(Manager *m) {
+        assert(m);
+
+        /* The user instance has no runtime directory it could
+         * safely keep this in, hence only the system instance
+         * caches unit files. */
+        if (m->running_as != SYSTEMD_SYSTEM)
+                return;
+
+        fragment_cache_free(m->fragment_cache);
+
+        m->fragment_cache = fragment_cache_new(FRAGMENT_CACHE_PATH);
+        if (!m->fragment_cache)
+                log_error("Failed to allocate unit fragment cache.");
+}
+
+static void manager_close_fragment_cache(Manager *m) {
+        int r;
+
+        assert(m);
+
+        if (!m->fragment_cache)
+                return;
+
+        r = fragment_cache_flush(m->fragment_cache);
+        if (r < 0)
+                log_warning("Failed to write unit fragment cache: %s", strerror(-r));
+
+        fragment_cache_free(m->fragment_cache);
+        m->fragment_cache = NULL;
+}
+
 int manager_startup(Manager *m, FILE *serialization, FDSet *fds) {
         int r, q;
 
@@ -695,6 +856,8 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds) {
                 return r;
 
         manager_build_unit_path_cache(m);
+        manager_stamp_unit_paths(m);
+        manager_open_fragment_cache(m);
 
         /* If we will deserialize make sure that during enumeration
          * this is already known, so we increase the counter here
@@ -727,6 +890,8 @@ int manager_startup(Manager *m, FILE *serialization, FDSet *fds) {
         if (q < 0)
                 r = q;
 
+        manager_close_fragment_cache(m);
+
         if (serialization) {
                 assert(m->n_reloading > 0);
                 m->n_reloading --;
@@ -954,6 +1119,44 @@ void manager_dump_units(Manager *s, FILE *f, const char *prefix) {
                         unit_dump(u, f, prefix);
 }
 
+void manager_dump_profile(Manager *s, FILE *f) {
+        Iterator i;
+        Unit *u;
+        const char *t;
+
+        assert(s);
+        assert(f);
+
+        /* Writes the profiling data of all units that had a start
+         * job as tab separated CLOCK_MONOTONIC timestamps in usec,
+         * 0 meaning unset, so that external tools can reconstruct
+         * the critical chain by following the blocked-by column. */
+
+        fprintf(f,
+                "# userspace\t%llu\n"
+                "# finish\t%llu\n"
+                "# unit\tjob-enqueue\tjob-start\texec\tready\tactive\tblocked-by\n",
+                (unsigned long long) s->userspace_timestamp.monotonic,
+                (unsigned long long) s->finish_timestamp.monotonic);
+
+        HASHMAP_FOREACH_KEY(u, t, s->units, i) {
+                if (u->id != t)
+                        continue;
+
+                if (!dual_timestamp_is_set(&u->job_enqueue_timestamp))
+                        continue;
+
+                fprintf(f, "%s\t%llu\t%llu\t%llu\t%llu\t%llu\t%s\n",
+                        u->id,
+                        (unsigned long long) u->job_enqueue_timestamp.monotonic,
+                        (unsigned long long) u->job_start_timestamp.monotonic,
+                        (unsigned long long) u->exec_timestamp.monotonic,
+                        (unsigned long long) u->ready_timestamp.monotonic,
+                        (unsigned long long) u->active_enter_timestamp.monotonic,
+                        u->blocked_by ? u->blocked_by : "-");
+        }
+}
+
 void manager_clear_jobs(Manager *m) {
         Job *j;
 
@@ -995,6 +1198,12 @@ unsigned manager_dispatch_dbus_queue(Manager *m) {
         if (m->dispatching_dbus_queue)
                 return 0;
 
+        if (!m->dbus_unit_queue && !m->dbus_job_queue)
+                return 0;
+
+        if (m->dbus_queue_timestamp + DBUS_QUEUE_USEC > now(CLOCK_MONOTONIC))
+                return 0;
+
         m->dispatching_dbus_queue = true;
 
         while ((u = m->dbus_unit_queue)) {
@@ -1012,9 +1221,32 @@ unsigned manager_dispatch_dbus_queue(Manager *m) {
         }
 
         m->dispatching_dbus_queue = false;
+        m->dbus_queue_timestamp = now(CLOCK_MONOTONIC);
         return n;
 }
 
+static void manager_dispatch_notify_message(Unit *u, pid_t pid, char *buf) {
+        char **tags, *state;
+        unsigned k = 0;
+        char *p;
+
+        /* Split the message in place, services may send lots of
+         * these. There is at most one tag more than separators. */
+        for (p = buf; *p; p++)
+                if (*p == '\n' || *p == '\r')
+                        k++;
+
+        tags = newa(char*, k + 2);
+
+        k = 0;
+        for (tags[k] = strtok_r(buf, "\n\r", &state);
+             tags[k];
+             tags[k] = strtok_r(NULL, "\n\r", &state))
+                k++;
+
+        UNIT_VTABLE(u)->notify_message(u, pid, tags);
+}
+
 static int manager_process_notify_fd(Manager *m) {
         ssize_t n;
 
@@ -1030,7 +1262,6 @@ static int manager_process_notify_fd(Manager *m) {
                         uint8_t buf[CMSG_SPACE(sizeof(struct ucred))];
                 } control;
                 Unit *u;
-                char **tags;
 
                 zero(iovec);
                 iovec.iov_base = buf;
@@ -1075,21 +1306,111 @@ static int manager_process_notify_fd(Manager *m) {
 
                 assert((size_t) n < sizeof(buf));
                 buf[n] = 0;
-                tags = strv_split(buf, "\n\r");
-                if (!tags)
-                        return log_oom();
-
-                log_debug_unit(u->id, "Got notification message for unit %s", u->id);
 
                 if (UNIT_VTABLE(u)->notify_message)
-                        UNIT_VTABLE(u)->notify_message(u, ucred->pid, tags);
+                        manager_dispatch_notify_message(u, ucred->pid, buf);
+        }
 
-                strv_free(tags);
+        return 0;
+}
+
+static int manager_process_cgroups_agent_fd(Manager *m) {
+        ssize_t n;
+
+        assert(m);
+
+        for (;;) {
+                char buf[PATH_MAX+1];
+                struct msghdr msghdr;
+                struct iovec iovec;
+                struct ucred *ucred;
+                union {
+                        struct cmsghdr cmsghdr;
+                        uint8_t buf[CMSG_SPACE(sizeof(struct ucred))];
+                } control;
+                char *p;
+                int r;
+
+                zero(iovec);
+                iovec.iov_base = buf;
+                iovec.iov_len = sizeof(buf)-1;
+
+                zero(control);
+                zero(msghdr);
+                msghdr.msg_iov = &iovec;
+                msghdr.msg_iovlen = 1;
+                msghdr.msg_control = &control;
+                msghdr.msg_controllen = sizeof(control);
+
+                n = recvmsg(m->cgroups_agent_watch.fd, &msghdr, MSG_DONTWAIT);
+                if (n < 0) {
+                        if (errno == EAGAIN || errno == EINTR)
+                                break;
+
+                        return -errno;
+                }
+
+                if (msghdr.msg_controllen < CMSG_LEN(sizeof(struct ucred)) ||
+                    control.cmsghdr.cmsg_level != SOL_SOCKET ||
+                    control.cmsghdr.cmsg_type != SCM_CREDENTIALS ||
+                    control.cmsghdr.cmsg_len != CMSG_LEN(sizeof(struct ucred))) {
+                        log_warning("Received cgroups agent message without credentials. Ignoring.");
+                        continue;
+                }
+
+                ucred = (struct ucred*) CMSG_DATA(&control.cmsghdr);
+                if (ucred->uid != 0) {
+                        log_warning("Received cgroups agent message from unprivileged process %lu. Ignoring.", (unsigned long) ucred->pid);
+                        continue;
+                }
+
+                if (n == 0 || (msghdr.msg_flags & MSG_TRUNC)) {
+                        log_warning("Received invalid cgroups agent message. Ignoring.");
+                        continue;
+                }
+
+                assert((size_t) n < sizeof(buf));
+                buf[n] = 0;
+
+                /* The agents of a burst of emptied cgroups queue up
+                 * here, and we process them in one go once the socket
+                 * is drained. Duplicates are folded by the set. */
+                if (set_get(m->cgroup_empty_queue, buf))
+                        continue;
+
+                p = strdup(buf);
+                if (!p)
+                        return log_oom();
+
+                r = set_put(m->cgroup_empty_queue, p);
+                if (r < 0) {
+                        free(p);
+                        return r;
+                }
         }
 
         return 0;
 }
 
+static unsigned manager_dispatch_cgroup_empty_queue(Manager *m) {
+        unsigned n = 0;
+        char *p;
+
+        assert(m);
+
+        if (!m->cgroup_empty_queue)
+                return 0;
+
+        while ((p = set_steal_first(m->cgroup_empty_queue))) {
+                log_debug("Got cgroup empty notification for: %s", p);
+                cgroup_notify_empty(m, p);
+                free(p);
+                n++;
+        }
+
+        return n;
+}
+
 static int manager_dispatch_sigchld(Manager *m) {
         assert(m);
 
@@ -1447,6 +1768,23 @@ static int process_event(Manager *m, struct epoll_event *ev) {
 
                 break;
 
+        case WATCH_CGROUPS_AGENT:
+
+                /* A cgroup has run empty? */
+                if (ev->events != EPOLLIN)
+                        return -EINVAL;
+
+                if ((r = manager_process_cgroups_agent_fd(m)) < 0)
+                        return r;
+
+                break;
+
+        case WATCH_INOTIFY:
+
+                /* Some file system change a path unit watches? */
+                path_inotify_event(m, ev->events);
+                break;
+
         case WATCH_FD:
 
                 /* Some fd event, to be dispatched to the units */
@@ -1576,6 +1914,9 @@ int manager_loop(Manager *m) {
                 if (manager_dispatch_cleanup_queue(m) > 0)
                         continue;
 
+                if (manager_dispatch_cgroup_empty_queue(m) > 0)
+                        continue;
+
                 if (manager_dispatch_gc_queue(m) > 0)
                         continue;
 
@@ -1593,6 +1934,19 @@ int manager_loop(Manager *m) {
                 } else
                         wait_msec = -1;
 
+                /* Wake up when the coalesced change signals are due */
+                if (m->dbus_unit_queue || m->dbus_job_queue) {
+                        usec_t k, due;
+                        int msec;
+
+                        k = now(CLOCK_MONOTONIC);
+                        due = m->dbus_queue_timestamp + DBUS_QUEUE_USEC;
+                        msec = due > k ? (int) ((due - k + USEC_PER_MSEC - 1) / USEC_PER_MSEC) : 0;
+
+                        if (wait_msec < 0 || msec < wait_msec)
+                                wait_msec = msec;
+                }
+
                 n = epoll_wait(m->epoll_fd, &event, 1, wait_msec);
                 if (n < 0) {
 
@@ -1848,7 +2202,7 @@ int manager_open_serialization(Manager *m, FILE **_f) {
         return 0;
 }
 
-int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool serialize_jobs) {
+int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool serialize_jobs, bool binary) {
         Iterator i;
         Unit *u;
         const char *t;
@@ -1860,22 +2214,28 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool serialize_jobs) {
 
         m->n_reloading ++;
 
-        fprintf(f, "current-job-id=%i\n", m->current_job_id);
-        fprintf(f, "taint-usr=%s\n", yes_no(m->taint_usr));
-        fprintf(f, "n-installed-jobs=%u\n", m->n_installed_jobs);
-        fprintf(f, "n-failed-jobs=%u\n", m->n_failed_jobs);
+        r = serialize_header(f, binary);
+        if (r < 0) {
+                m->n_reloading --;
+                return r;
+        }
 
-        dual_timestamp_serialize(f, "firmware-timestamp", &m->firmware_timestamp);
-        dual_timestamp_serialize(f, "kernel-timestamp", &m->kernel_timestamp);
-        dual_timestamp_serialize(f, "loader-timestamp", &m->loader_timestamp);
-        dual_timestamp_serialize(f, "initrd-timestamp", &m->initrd_timestamp);
+        serialize_item_format(f, "current-job-id", "%i", m->current_job_id);
+        serialize_item(f, "taint-usr", yes_no(m->taint_usr));
+        serialize_item_format(f, "n-installed-jobs", "%u", m->n_installed_jobs);
+        serialize_item_format(f, "n-failed-jobs", "%u", m->n_failed_jobs);
+
+        serialize_dual_timestamp(f, "firmware-timestamp", &m->firmware_timestamp);
+        serialize_dual_timestamp(f, "kernel-timestamp", &m->kernel_timestamp);
+        serialize_dual_timestamp(f, "loader-timestamp", &m->loader_timestamp);
+        serialize_dual_timestamp(f, "initrd-timestamp", &m->initrd_timestamp);
 
         if (!in_initrd()) {
-                dual_timestamp_serialize(f, "userspace-timestamp", &m->userspace_timestamp);
-                dual_timestamp_serialize(f, "finish-timestamp", &m->finish_timestamp);
+                serialize_dual_timestamp(f, "userspace-timestamp", &m->userspace_timestamp);
+                serialize_dual_timestamp(f, "finish-timestamp", &m->finish_timestamp);
         }
 
-        fputc('\n', f);
+        serialize_end(f);
 
         HASHMAP_FOREACH_KEY(u, t, m->units, i) {
                 if (u->id != t)
@@ -1885,8 +2245,7 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool serialize_jobs) {
                         continue;
 
                 /* Start marker */
-                fputs(u->id, f);
-                fputc('\n', f);
+                serialize_item(f, u->id, "");
 
                 if ((r = unit_serialize(u, f, fds, serialize_jobs)) < 0) {
                         m->n_reloading --;
@@ -1897,8 +2256,9 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool serialize_jobs) {
         assert(m->n_reloading > 0);
         m->n_reloading --;
 
-        if (ferror(f))
-                return -EIO;
+        r = serialize_finish(f);
+        if (r < 0)
+                return r;
 
         r = bus_fdset_add_all(m, fds);
         if (r < 0)
@@ -1908,107 +2268,103 @@ int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool serialize_jobs) {
 }
 
 int manager_deserialize(Manager *m, FILE *f, FDSet *fds) {
-        int r = 0;
+        Deserializer d;
+        int r;
 
         assert(m);
         assert(f);
 
         log_debug("Deserializing state...");
 
+        r = deserializer_init(&d, f);
+        if (r < 0) {
+                deserializer_done(&d);
+                return r;
+        }
+
         m->n_reloading ++;
 
         for (;;) {
-                char line[LINE_MAX], *l;
-
-                if (!fgets(line, sizeof(line), f)) {
-                        if (feof(f))
-                                r = 0;
-                        else
-                                r = -errno;
+                char *l, *v;
 
+                r = deserializer_next(&d, &l, &v);
+                if (r < 0)
                         goto finish;
-                }
-
-                char_array_0(line);
-                l = strstrip(line);
-
-                if (l[0] == 0)
+                if (r == 0)
                         break;
 
-                if (startswith(l, "current-job-id=")) {
+                if (streq(l, "current-job-id")) {
                         uint32_t id;
 
-                        if (safe_atou32(l+15, &id) < 0)
-                                log_debug("Failed to parse current job id value %s", l+15);
+                        if (safe_atou32(v, &id) < 0)
+                                log_debug("Failed to parse current job id value %s", v);
                         else
                                 m->current_job_id = MAX(m->current_job_id, id);
-                } else if (startswith(l, "n-installed-jobs=")) {
+                } else if (streq(l, "n-installed-jobs")) {
                         uint32_t n;
 
-                        if (safe_atou32(l+17, &n) < 0)
-                                log_debug("Failed to parse installed jobs counter %s", l+17);
+                        if (safe_atou32(v, &n) < 0)
+                                log_debug("Failed to parse installed jobs counter %s", v);
                         else
                                 m->n_installed_jobs += n;
-                } else if (startswith(l, "n-failed-jobs=")) {
+                } else if (streq(l, "n-failed-jobs")) {
                         uint32_t n;
 
-                        if (safe_atou32(l+14, &n) < 0)
-                                log_debug("Failed to parse failed jobs counter %s", l+14);
+                        if (safe_atou32(v, &n) < 0)
+                                log_debug("Failed to parse failed jobs counter %s", v);
                         else
                                 m->n_failed_jobs += n;
-                } else if (startswith(l, "taint-usr=")) {
+                } else if (streq(l, "taint-usr")) {
                         int b;
 
-                        if ((b = parse_boolean(l+10)) < 0)
-                                log_debug("Failed to parse taint /usr flag %s", l+10);
+                        if ((b = parse_boolean(v)) < 0)
+                                log_debug("Failed to parse taint /usr flag %s", v);
                         else
                                 m->taint_usr = m->taint_usr || b;
-                } else if (startswith(l, "firmware-timestamp="))
-                        dual_timestamp_deserialize(l+19, &m->firmware_timestamp);
-                else if (startswith(l, "loader-timestamp="))
-                        dual_timestamp_deserialize(l+17, &m->loader_timestamp);
-                else if (startswith(l, "kernel-timestamp="))
-                        dual_timestamp_deserialize(l+17, &m->kernel_timestamp);
-                else if (startswith(l, "initrd-timestamp="))
-                        dual_timestamp_deserialize(l+17, &m->initrd_timestamp);
-                else if (startswith(l, "userspace-timestamp="))
-                        dual_timestamp_deserialize(l+20, &m->userspace_timestamp);
-                else if (startswith(l, "finish-timestamp="))
-                        dual_timestamp_deserialize(l+17, &m->finish_timestamp);
+                } else if (streq(l, "firmware-timestamp"))
+                        dual_timestamp_deserialize(v, &m->firmware_timestamp);
+                else if (streq(l, "loader-timestamp"))
+                        dual_timestamp_deserialize(v, &m->loader_timestamp);
+                else if (streq(l, "kernel-timestamp"))
+                        dual_timestamp_deserialize(v, &m->kernel_timestamp);
+                else if (streq(l, "initrd-timestamp"))
+                        dual_timestamp_deserialize(v, &m->initrd_timestamp);
+                else if (streq(l, "userspace-timestamp"))
+                        dual_timestamp_deserialize(v, &m->userspace_timestamp);
+                else if (streq(l, "finish-timestamp"))
+                        dual_timestamp_deserialize(v, &m->finish_timestamp);
                 else
                         log_debug("Unknown serialization item '%s'", l);
         }
 
         for (;;) {
                 Unit *u;
-                char name[UNIT_NAME_MAX+2];
+                char *name, *v;
 
                 /* Start marker */
-                if (!fgets(name, sizeof(name), f)) {
-                        if (feof(f))
-                                r = 0;
-                        else
-                                r = -errno;
-
+                r = deserializer_next(&d, &name, &v);
+                if (r < 0)
+                        goto finish;
+                if (r == 0 && d.eof)
+                        break;
+                if (r == 0 || strlen(name) > UNIT_NAME_MAX) {
+                        r = -EBADMSG;
                         goto finish;
                 }
 
-                char_array_0(name);
-
-                r = manager_load_unit(m, strstrip(name), NULL, NULL, &u);
+                r = manager_load_unit(m, name, NULL, NULL, &u);
                 if (r < 0)
                         goto finish;
 
-                r = unit_deserialize(u, f, fds);
+                r = unit_deserialize(u, &d, fds);
                 if (r < 0)
                         goto finish;
         }
 
+        r = 0;
+
 finish:
-        if (ferror(f)) {
-                r = -EIO;
-                goto finish;
-        }
+        deserializer_done(&d);
 
         assert(m->n_reloading > 0);
         m->n_reloading --;
@@ -2038,13 +2394,46 @@ int manager_distribute_fds(Manager *m, FDSet *fds) {
         return 0;
 }
 
+static unsigned manager_count_changed_units(Manager *m) {
+        unsigned n = 0;
+        Iterator i;
+        Unit *u;
+        const char *t;
+
+        assert(m);
+
+        HASHMAP_FOREACH_KEY(u, t, m->units, i) {
+                if (u->id != t)
+                        continue;
+
+                if (u->load_state == UNIT_STUB || u->load_state == UNIT_MERGED)
+                        continue;
+
+                if (unit_need_daemon_reload(u)) {
+                        log_debug_unit(u->id, "Configuration of %s changed.", u->id);
+                        n++;
+                }
+        }
+
+        return n;
+}
+
 int manager_reload(Manager *m) {
         int r, q;
         FILE *f;
         FDSet *fds;
+        usec_t before;
+        unsigned n_changed;
+        char timespan[FORMAT_TIMESPAN_MAX];
 
         assert(m);
 
+        before = now(CLOCK_MONOTONIC);
+
+        /* Only the units whose configuration changed count as
+         * reloaded, the others are merely loaded again */
+        n_changed = manager_count_changed_units(m);
+
         r = manager_open_serialization(m, &f);
         if (r < 0)
                 return r;
@@ -2058,7 +2447,8 @@ int manager_reload(Manager *m) {
                 goto finish;
         }
 
-        r = manager_serialize(m, f, fds, true);
+        /* We stay the same binary, hence can use the faster format */
+        r = manager_serialize(m, f, fds, true, true);
         if (r < 0) {
                 m->n_reloading --;
                 goto finish;
@@ -2087,6 +2477,8 @@ int manager_reload(Manager *m) {
                 r = q;
 
         manager_build_unit_path_cache(m);
+        manager_stamp_unit_paths(m);
+        manager_open_fragment_cache(m);
 
         /* First, enumerate what we can from all config files */
         q = manager_enumerate(m);
@@ -2106,9 +2498,18 @@ int manager_reload(Manager *m) {
         if (q < 0)
                 r = q;
 
+        manager_close_fragment_cache(m);
+
         assert(m->n_reloading > 0);
         m->n_reloading--;
 
+        m->n_reload_units = n_changed;
+        m->reload_usec = now(CLOCK_MONOTONIC) - before;
+
+        log_info("Reloaded in %s, configuration of %u units changed.",
+                 format_timespan(timespan, sizeof(timespan), m->reload_usec),
+                 m->n_reload_units);
+
 finish:
         if (f)
                 fclose(f);
@@ -2119,6 +2520,31 @@ finish:
         return r;
 }
 
+bool manager_need_reload(Manager *m, unsigned *n_changed) {
+        unsigned n = 0, n_paths, k;
+
+        assert(m);
+
+        /* Checks whether a reload would make any difference, and
+         * counts the unit directories and units that changed. Note
+         * that we don't rerun the generators for this, hence
+         * changes to their input are not noticed. */
+
+        n_paths = strv_length(m->lookup_paths.unit_path);
+        for (k = 0; k < n_paths; k++)
+                if (manager_unit_path_changed(m, k)) {
+                        log_debug("Unit directory %s changed.", m->lookup_paths.unit_path[k]);
+                        n++;
+                }
+
+        n += manager_count_changed_units(m);
+
+        if (n_changed)
+                *n_changed = n;
+
+        return n > 0;
+}
+
 bool manager_is_booting_or_shutting_down(Manager *m) {
         Unit *u;
 
@@ -61,7 +61,9 @@ enum WatchType {
         WATCH_UDEV,
         WATCH_DBUS_WATCH,
         WATCH_DBUS_TIMEOUT,
-        WATCH_TIME_CHANGE
+        WATCH_TIME_CHANGE,
+        WATCH_CGROUPS_AGENT,
+        WATCH_INOTIFY
 };
 
 struct Watch {
@@ -84,6 +86,7 @@ struct Watch {
 #include "set.h"
 #include "dbus.h"
 #include "path-lookup.h"
+#include "fragment-cache.h"
 
 struct Manager {
         /* Note that the set of units we know of is allowed to be
@@ -98,6 +101,11 @@ struct Manager {
          * type we maintain a per type linked list */
         LIST_HEAD(Unit, units_by_type[_UNIT_TYPE_MAX]);
 
+        /* All unit objects, indexed by their dense id, so that
+         * transactions can keep per-unit state in flat arrays */
+        Unit **units_by_dense_id;
+        unsigned n_units_by_dense_id, n_units_by_dense_id_allocated;
+
         /* To optimize iteration of units that have requires_mounts_for set */
         LIST_HEAD(Unit, has_requires_mounts_for);
 
@@ -127,6 +135,11 @@ struct Manager {
         Watch notify_watch;
         Watch signal_watch;
         Watch time_change_watch;
+        Watch cgroups_agent_watch;
+
+        /* cgroups whose release notification has been received but
+         * not processed yet */
+        Set *cgroup_empty_queue;
 
         int epoll_fd;
 
@@ -134,6 +147,11 @@ struct Manager {
 
         LookupPaths lookup_paths;
         Set *unit_path_cache;
+        FragmentCache *fragment_cache;
+
+        /* mtimes of the unit directories at the time we loaded
+         * units from them, in the same order as the unit path */
+        usec_t *unit_path_mtimes;
 
         char **environment;
         char **default_controllers;
@@ -183,6 +201,7 @@ struct Manager {
         int32_t name_data_slot;
         int32_t conn_data_slot;
         int32_t subscribed_data_slot;
+        int32_t subscription_filters_data_slot;
 
         uint32_t current_job_id;
         uint32_t default_unit_job_id;
@@ -190,12 +209,21 @@ struct Manager {
         /* Data specific to the Automount subsystem */
         int dev_autofs_fd;
 
+        /* Data specific to the path subsystem */
+        Watch inotify_watch;
+        Hashmap *inotify_wds;      /* wd => PathInotify object 1:1 */
+        Set *inotify_pending;      /* PathSpec objects with events to dispatch */
+
         /* Data specific to the cgroup subsystem */
         Hashmap *cgroup_bondings; /* path string => CGroupBonding object 1:n */
+        struct CGroupNode *cgroup_root; /* trie of the above */
         char *cgroup_hierarchy;
 
         usec_t gc_queue_timestamp;
         int gc_marker;
+
+        /* When we last sent the change signals of the D-Bus queue */
+        usec_t dbus_queue_timestamp;
         unsigned n_in_gc_queue;
 
         /* Make sure the user cannot accidentally unmount our cgroup
@@ -225,6 +253,10 @@ struct Manager {
         unsigned n_installed_jobs;
         unsigned n_failed_jobs;
 
+        /* Statistics of the last reload */
+        usec_t reload_usec;
+        unsigned n_reload_units;
+
         /* Type=idle pipes */
         int idle_pipe[2];
 
@@ -253,6 +285,7 @@ int manager_add_job_by_name(Manager *m, JobType type, const char *name, JobMode
 
 void manager_dump_units(Manager *s, FILE *f, const char *prefix);
 void manager_dump_jobs(Manager *s, FILE *f, const char *prefix);
+void manager_dump_profile(Manager *s, FILE *f);
 
 void manager_clear_jobs(Manager *m);
 
@@ -270,11 +303,13 @@ void manager_dispatch_bus_query_pid_done(Manager *m, const char *name, pid_t pid
 
 int manager_open_serialization(Manager *m, FILE **_f);
 
-int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool serialize_jobs);
+int manager_serialize(Manager *m, FILE *f, FDSet *fds, bool serialize_jobs, bool binary);
 int manager_deserialize(Manager *m, FILE *f, FDSet *fds);
 int manager_distribute_fds(Manager *m, FDSet *fds);
 
 int manager_reload(Manager *m);
+bool manager_need_reload(Manager *m, unsigned *n_changed);
+bool manager_unit_path_changed(Manager *m, unsigned k);
 
 bool manager_is_booting_or_shutting_down(Manager *m);
 
@@ -1900,6 +1900,7 @@ const UnitVTable mount_vtable = {
         .reset_failed = mount_reset_failed,
 
         .bus_interface = "org.freedesktop.systemd1.Mount",
+        .bus_append_properties = bus_mount_append_properties,
         .bus_message_handler = bus_mount_message_handler,
         .bus_invalidating_properties =  bus_mount_invalidating_properties,
 
@@ -24,6 +24,7 @@
 #include <sys/ioctl.h>
 #include <errno.h>
 #include <unistd.h>
+#include <dirent.h>
 
 #include "unit.h"
 #include "unit-name.h"
@@ -41,6 +42,209 @@ static const UnitActiveState state_translation_table[_PATH_STATE_MAX] = {
         [PATH_FAILED] = UNIT_FAILED
 };
 
+/* Bound on the number of subdirectories watched for recursive specs */
+#define PATH_RECURSIVE_WATCHES_MAX 4096
+
+static int path_inotify_setup(Manager *m) {
+        struct epoll_event ev;
+
+        assert(m);
+
+        if (m->inotify_watch.fd >= 0)
+                return 0;
+
+        if (!m->inotify_wds) {
+                m->inotify_wds = hashmap_new(trivial_hash_func, trivial_compare_func);
+                if (!m->inotify_wds)
+                        return -ENOMEM;
+        }
+
+        if (!m->inotify_pending) {
+                m->inotify_pending = set_new(trivial_hash_func, trivial_compare_func);
+                if (!m->inotify_pending)
+                        return -ENOMEM;
+        }
+
+        m->inotify_watch.fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+        if (m->inotify_watch.fd < 0)
+                return -errno;
+
+        m->inotify_watch.type = WATCH_INOTIFY;
+
+        zero(ev);
+        ev.events = EPOLLIN;
+        ev.data.ptr = &m->inotify_watch;
+
+        if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, m->inotify_watch.fd, &ev) < 0) {
+                close_nointr_nofail(m->inotify_watch.fd);
+                watch_init(&m->inotify_watch);
+                return -errno;
+        }
+
+        return 0;
+}
+
+static void path_inotify_free(Manager *m, PathInotify *i) {
+        assert(m);
+        assert(i);
+
+        hashmap_remove(m->inotify_wds, INT_TO_PTR(i->wd));
+        hashmap_free(i->specs);
+        free(i);
+}
+
+static int path_spec_add_watch(PathSpec *s, Manager *m, const char *path, uint32_t flags, int **wds, unsigned *n_wds) {
+        PathInotify *i;
+        int wd, *n;
+
+        assert(s);
+        assert(m);
+        assert(path);
+
+        /* Adds a reference to the watch for the specified path on
+         * the shared inotify fd. Since watches are per inode, other
+         * specs might already watch it, possibly with a different
+         * mask. We extend the mask in that case, and remember which
+         * events each spec asked for on this watch, so that it is
+         * only woken up for those. */
+
+        wd = inotify_add_watch(m->inotify_watch.fd, path, flags|IN_MASK_ADD);
+        if (wd < 0)
+                return -errno;
+
+        i = hashmap_get(m->inotify_wds, INT_TO_PTR(wd));
+        if (!i) {
+                i = new0(PathInotify, 1);
+                if (!i)
+                        goto fail;
+
+                i->wd = wd;
+                i->specs = hashmap_new(trivial_hash_func, trivial_compare_func);
+                if (!i->specs) {
+                        free(i);
+                        goto fail;
+                }
+
+                if (hashmap_put(m->inotify_wds, INT_TO_PTR(wd), i) < 0) {
+                        hashmap_free(i->specs);
+                        free(i);
+                        goto fail;
+                }
+        }
+
+        i->mask |= flags;
+
+        n = realloc(*wds, sizeof(int) * (*n_wds + 1));
+        if (!n)
+                goto fail_put;
+
+        *wds = n;
+
+        /* A re-watch of the same spec replaces the mask it asked for */
+        if (hashmap_replace(i->specs, s, UINT32_TO_PTR(flags)) < 0)
+                goto fail_put;
+
+        n[(*n_wds)++] = wd;
+        return wd;
+
+fail_put:
+        if (hashmap_isempty(i->specs)) {
+                path_inotify_free(m, i);
+                inotify_rm_watch(m->inotify_watch.fd, wd);
+        }
+
+        return -ENOMEM;
+
+fail:
+        inotify_rm_watch(m->inotify_watch.fd, wd);
+        return -ENOMEM;
+}
+
+static void path_spec_release_watches(PathSpec *s, Manager *m, int *wds, unsigned n_wds) {
+        unsigned k;
+
+        assert(s);
+        assert(m);
+
+        for (k = 0; k < n_wds; k++) {
+                PathInotify *i;
+
+                i = hashmap_get(m->inotify_wds, INT_TO_PTR(wds[k]));
+                if (!i)
+                        continue;
+
+                /* If the spec was watched and re-watched with the
+                 * same wd it's still in use */
+                if (s->wds != wds && hashmap_get(i->specs, s)) {
+                        unsigned j;
+                        bool used = false;
+
+                        for (j = 0; j < s->n_wds; j++)
+                                if (s->wds[j] == wds[k]) {
+                                        used = true;
+                                        break;
+                                }
+
+                        if (used)
+                                continue;
+                }
+
+                hashmap_remove(i->specs, s);
+
+                if (hashmap_isempty(i->specs)) {
+                        inotify_rm_watch(m->inotify_watch.fd, i->wd);
+                        path_inotify_free(m, i);
+                }
+        }
+}
+
+static int path_spec_watch_recursive(PathSpec *s, Manager *m, const char *path, uint32_t flags, int **wds, unsigned *n_wds) {
+        DIR _cleanup_closedir_ *d = NULL;
+        struct dirent *de;
+        int r;
+
+        assert(s);
+        assert(path);
+
+        /* Watch all subdirectories too, so that we notice files
+         * showing up anywhere below the directory */
+
+        d = opendir(path);
+        if (!d)
+                return errno == ENOENT || errno == ENOTDIR ? 0 : -errno;
+
+        while ((de = readdir(d))) {
+                char _cleanup_free_ *p = NULL;
+
+                if (ignore_file(de->d_name))
+                        continue;
+
+                if (de->d_type != DT_DIR && de->d_type != DT_UNKNOWN)
+                        continue;
+
+                if (*n_wds >= PATH_RECURSIVE_WATCHES_MAX) {
+                        log_warning("Too many subdirectories below %s, not watching all of them.", s->path);
+                        return 0;
+                }
+
+                p = strjoin(path, "/", de->d_name, NULL);
+                if (!p)
+                        return -ENOMEM;
+
+                r = path_spec_add_watch(s, m, p, flags|IN_ONLYDIR|IN_DONT_FOLLOW, wds, n_wds);
+                if (r == -ENOMEM)
+                        return r;
+                if (r < 0)
+                        continue;
+
+                r = path_spec_watch_recursive(s, m, p, flags, wds, n_wds);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
 int path_spec_watch(PathSpec *s, Unit *u) {
 
         static const int flags_table[_PATH_TYPE_MAX] = {
@@ -48,34 +252,54 @@ int path_spec_watch(PathSpec *s, Unit *u) {
                 [PATH_EXISTS_GLOB] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB,
                 [PATH_CHANGED] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CLOSE_WRITE|IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO,
                 [PATH_MODIFIED] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CLOSE_WRITE|IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_MODIFY,
-                [PATH_DIRECTORY_NOT_EMPTY] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CREATE|IN_MOVED_TO
+                [PATH_DIRECTORY_NOT_EMPTY] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CREATE|IN_MOVED_TO,
+                [PATH_DIRECTORY_NOT_EMPTY_RECURSIVE] = IN_DELETE_SELF|IN_MOVE_SELF|IN_ATTRIB|IN_CREATE|IN_MOVED_TO
         };
 
+        Manager *m;
         bool exists = false;
         char *k, *slash;
+        int *old_wds, *wds = NULL;
+        unsigned n_old_wds, n_wds = 0;
         int r;
 
         assert(u);
         assert(s);
 
-        path_spec_unwatch(s, u);
+        m = u->manager;
+
+        r = path_inotify_setup(m);
+        if (r < 0)
+                return r;
 
         if (!(k = strdup(s->path)))
                 return -ENOMEM;
 
-        if ((s->inotify_fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC)) < 0) {
-                r = -errno;
-                goto fail;
-        }
+        /* Set up the new watches before dropping the old ones, so
+         * that watches we keep are not removed and re-added in the
+         * kernel */
+        old_wds = s->wds;
+        n_old_wds = s->n_wds;
+        s->wds = NULL;
+        s->n_wds = 0;
 
-        if (unit_watch_fd(u, s->inotify_fd, EPOLLIN, &s->watch) < 0) {
-                r = -errno;
-                goto fail;
-        }
+        s->watch.type = WATCH_FD;
+        s->watch.fd = m->inotify_watch.fd;
+        s->watch.data.unit = u;
 
-        s->primary_wd = inotify_add_watch(s->inotify_fd, k, flags_table[s->type]);
+        s->primary_wd = path_spec_add_watch(s, m, k, flags_table[s->type], &wds, &n_wds);
         if (s->primary_wd >= 0)
                 exists = true;
+        else if (s->primary_wd == -ENOMEM) {
+                r = -ENOMEM;
+                goto fail;
+        }
+
+        if (exists && s->type == PATH_DIRECTORY_NOT_EMPTY_RECURSIVE) {
+                r = path_spec_watch_recursive(s, m, k, flags_table[s->type], &wds, &n_wds);
+                if (r < 0)
+                        goto fail;
+        }
 
         do {
                 int flags;
@@ -92,83 +316,211 @@ int path_spec_watch(PathSpec *s, Unit *u) {
                 if (!exists)
                         flags |= IN_DELETE_SELF | IN_ATTRIB | IN_CREATE | IN_MOVED_TO;
 
-                if (inotify_add_watch(s->inotify_fd, k, flags) >= 0)
+                r = path_spec_add_watch(s, m, k, flags, &wds, &n_wds);
+                if (r >= 0)
                         exists = true;
+                else if (r == -ENOMEM)
+                        goto fail;
         } while (slash != k);
 
+        free(k);
+
+        s->wds = wds;
+        s->n_wds = n_wds;
+
+        path_spec_release_watches(s, m, old_wds, n_old_wds);
+        free(old_wds);
+
         return 0;
 
 fail:
         free(k);
 
+        s->wds = wds;
+        s->n_wds = n_wds;
+        path_spec_release_watches(s, m, old_wds, n_old_wds);
+        free(old_wds);
+
         path_spec_unwatch(s, u);
         return r;
 }
 
 void path_spec_unwatch(PathSpec *s, Unit *u) {
+        int *wds;
+        unsigned n_wds;
+
+        assert(s);
+        assert(u);
 
-        if (s->inotify_fd < 0)
+        if (s->n_wds <= 0)
                 return;
 
-        unit_unwatch_fd(u, &s->watch);
+        wds = s->wds;
+        n_wds = s->n_wds;
+        s->wds = NULL;
+        s->n_wds = 0;
 
-        close_nointr_nofail(s->inotify_fd);
-        s->inotify_fd = -1;
+        path_spec_release_watches(s, u->manager, wds, n_wds);
+        free(wds);
+
+        set_remove(u->manager->inotify_pending, s);
+        s->primary_changed = false;
 }
 
 int path_spec_fd_event(PathSpec *s, uint32_t events) {
-        uint8_t *buf = NULL;
-        struct inotify_event *e;
-        ssize_t k;
-        int l;
-        int r = 0;
+        bool changed;
+
+        assert(s);
 
         if (events != EPOLLIN) {
                 log_error("Got invalid poll event on inotify.");
-                r = -EINVAL;
-                goto out;
+                return -EINVAL;
+        }
+
+        /* The events themselves have already been read off the
+         * shared inotify fd by path_inotify_event() */
+        changed = s->primary_changed;
+        s->primary_changed = false;
+
+        return changed;
+}
+
+static void path_inotify_mark(Manager *m, PathInotify *i, const struct inotify_event *e) {
+        PathSpec *s;
+        Iterator j;
+        void *p;
+
+        assert(m);
+        assert(i);
+
+        HASHMAP_FOREACH_KEY(p, s, i->specs, j) {
+                uint32_t mask = PTR_TO_UINT32(p);
+
+                /* The watch mask is shared with other specs on the
+                 * same inode, and this spec might watch it as its
+                 * path or only as one of the parent directories. Skip
+                 * the events the spec did not ask for on this watch.
+                 * A dropped watch or lost events always need a
+                 * recheck. */
+                if (!(e->mask & (IN_Q_OVERFLOW|IN_IGNORED|IN_UNMOUNT)) &&
+                    !(e->mask & mask))
+                        continue;
+
+                if ((s->type == PATH_CHANGED || s->type == PATH_MODIFIED) &&
+                    ((e->mask & IN_Q_OVERFLOW) ||
+                     (s->primary_wd == e->wd && (e->mask & mask))))
+                        s->primary_changed = true;
+
+                if (set_put(m->inotify_pending, s) < 0)
+                        log_oom();
         }
+}
+
+void path_inotify_event(Manager *m, uint32_t events) {
+        PathSpec *s;
+        PathInotify *i;
+        Iterator j;
+
+        assert(m);
 
-        if (ioctl(s->inotify_fd, FIONREAD, &l) < 0) {
-                log_error("FIONREAD failed: %m");
-                r = -errno;
-                goto out;
+        if (events != EPOLLIN) {
+                log_error("Got invalid poll event on inotify.");
+                return;
         }
 
-        assert(l > 0);
+        /* Read everything that is queued, and collect the specs that
+         * got events, so that each of them is dispatched only once
+         * per wakeup, however many events it got */
+
+        for (;;) {
+                uint8_t buf[64 * 1024] _alignas_(struct inotify_event);
+                struct inotify_event *e;
+                ssize_t k;
+
+                k = read(m->inotify_watch.fd, buf, sizeof(buf));
+                if (k < 0) {
+                        if (errno == EINTR)
+                                continue;
+
+                        if (errno != EAGAIN)
+                                log_error("Failed to read inotify event: %m");
+
+                        break;
+                }
+
+                e = (struct inotify_event*) buf;
+
+                while (k > 0) {
+                        size_t step;
+
+                        if (e->mask & IN_Q_OVERFLOW) {
+                                /* We lost events, everybody needs to
+                                 * recheck */
+                                HASHMAP_FOREACH(i, m->inotify_wds, j)
+                                        path_inotify_mark(m, i, e);
+
+                        } else {
+                                i = hashmap_get(m->inotify_wds, INT_TO_PTR(e->wd));
+                                if (i) {
+                                        path_inotify_mark(m, i, e);
+
+                                        /* The kernel dropped the watch,
+                                         * and might reuse the wd */
+                                        if (e->mask & IN_IGNORED)
+                                                path_inotify_free(m, i);
+                                }
+                        }
+
+                        step = sizeof(struct inotify_event) + e->len;
+                        assert(step <= (size_t) k);
 
-        buf = malloc(l);
-        if (!buf) {
-                log_error("Failed to allocate buffer: %m");
-                r = -errno;
-                goto out;
+                        e = (struct inotify_event*) ((uint8_t*) e + step);
+                        k -= step;
+                }
         }
 
-        k = read(s->inotify_fd, buf, l);
-        if (k < 0) {
-                log_error("Failed to read inotify event: %m");
-                r = -errno;
-                goto out;
+        while ((s = set_steal_first(m->inotify_pending))) {
+                Unit *u = s->watch.data.unit;
+
+                UNIT_VTABLE(u)->fd_event(u, m->inotify_watch.fd, EPOLLIN, &s->watch);
         }
+}
 
-        e = (struct inotify_event*) buf;
+static int path_recursive_not_empty(const char *path, unsigned level) {
+        DIR _cleanup_closedir_ *d = NULL;
+        struct dirent *de;
 
-        while (k > 0) {
-                size_t step;
+        d = opendir(path);
+        if (!d)
+                return -errno;
 
-                if ((s->type == PATH_CHANGED || s->type == PATH_MODIFIED) &&
-                    s->primary_wd == e->wd)
-                        r = 1;
+        while ((de = readdir(d))) {
+                char _cleanup_free_ *p = NULL;
+                struct stat st;
+
+                if (ignore_file(de->d_name))
+                        continue;
 
-                step = sizeof(struct inotify_event) + e->len;
-                assert(step <= (size_t) k);
+                if (de->d_type != DT_DIR && de->d_type != DT_UNKNOWN)
+                        return 1;
 
-                e = (struct inotify_event*) ((uint8_t*) e + step);
-                k -= step;
+                p = strjoin(path, "/", de->d_name, NULL);
+                if (!p)
+                        return -ENOMEM;
+
+                if (de->d_type == DT_UNKNOWN) {
+                        if (lstat(p, &st) < 0)
+                                continue;
+
+                        if (!S_ISDIR(st.st_mode))
+                                return 1;
+                }
+
+                if (level > 0 && path_recursive_not_empty(p, level - 1) > 0)
+                        return 1;
         }
-out:
-        free(buf);
-        return r;
+
+        return 0;
 }
 
 static bool path_spec_check_good(PathSpec *s, bool initial) {
@@ -192,6 +544,11 @@ static bool path_spec_check_good(PathSpec *s, bool initial) {
                 break;
         }
 
+        case PATH_DIRECTORY_NOT_EMPTY_RECURSIVE:
+                /* Only files count, not empty subdirectories */
+                good = path_recursive_not_empty(s->path, 64) > 0;
+                break;
+
         case PATH_CHANGED:
         case PATH_MODIFIED: {
                 bool b;
@@ -234,7 +591,7 @@ static void path_spec_dump(PathSpec *s, FILE *f, const char *prefix) {
 
 void path_spec_done(PathSpec *s) {
         assert(s);
-        assert(s->inotify_fd == -1);
+        assert(s->n_wds == 0);
 
         free(s->path);
 }
@@ -246,6 +603,8 @@ static void path_init(Unit *u) {
         assert(u->load_state == UNIT_STUB);
 
         p->directory_mode = 0755;
+
+        watch_init(&p->coalesce_watch);
 }
 
 void path_free_specs(Path *p) {
@@ -268,6 +627,7 @@ static void path_done(Unit *u) {
 
         unit_ref_unset(&p->unit);
         path_free_specs(p);
+        unit_unwatch_timer(u, &p->coalesce_watch);
 }
 
 int path_add_one_mount_link(Path *p, Mount *m) {
@@ -393,6 +753,14 @@ static void path_dump(Unit *u, FILE *f, const char *prefix) {
                 prefix, yes_no(p->make_directory),
                 prefix, p->directory_mode);
 
+        if (p->coalesce_usec > 0) {
+                char buf[FORMAT_TIMESPAN_MAX];
+
+                fprintf(f,
+                        "%sCoalesceSec: %s\n",
+                        prefix, format_timespan(buf, sizeof(buf), p->coalesce_usec));
+        }
+
         LIST_FOREACH(spec, s, p->specs)
                 path_spec_dump(s, f, prefix);
 }
@@ -404,6 +772,9 @@ static void path_unwatch(Path *p) {
 
         LIST_FOREACH(spec, s, p->specs)
                 path_spec_unwatch(s, UNIT(p));
+
+        unit_unwatch_timer(UNIT(p), &p->coalesce_watch);
+        p->coalesce_changed = false;
 }
 
 static int path_watch(Path *p) {
@@ -655,11 +1026,11 @@ static void path_fd_event(Unit *u, int fd, uint32_t events, Watch *w) {
         /* log_debug("inotify wakeup on %s.", u->id); */
 
         LIST_FOREACH(spec, s, p->specs)
-                if (path_spec_owns_inotify_fd(s, fd))
+                if (path_spec_owns_watch(s, w))
                         break;
 
         if (!s) {
-                log_error("Got event on unknown fd.");
+                log_error("Got event on unknown watch.");
                 goto fail;
         }
 
@@ -672,6 +1043,24 @@ static void path_fd_event(Unit *u, int fd, uint32_t events, Watch *w) {
          * actually changed on disk */
         p->inotify_triggered = true;
 
+        if (p->coalesce_usec > 0) {
+                /* Collect everything that happens within the
+                 * coalescing window and act on it only once */
+                p->coalesce_changed = p->coalesce_changed || changed;
+
+                /* The window is already open, the timer acts on it */
+                if (p->coalesce_watch.type == WATCH_UNIT_TIMER)
+                        return;
+
+                if (unit_watch_timer(u, CLOCK_MONOTONIC, true, p->coalesce_usec, &p->coalesce_watch) >= 0)
+                        return;
+
+                /* No timer, act right away */
+
+                changed = p->coalesce_changed;
+                p->coalesce_changed = false;
+        }
+
         if (changed)
                 path_enter_running(p);
         else
@@ -683,6 +1072,49 @@ fail:
         path_enter_dead(p, PATH_FAILURE_RESOURCES);
 }
 
+static void path_timer_event(Unit *u, uint64_t elapsed, Watch *w) {
+        Path *p = PATH(u);
+        bool changed;
+
+        assert(p);
+        assert(elapsed == 1);
+        assert(w == &p->coalesce_watch);
+
+        unit_unwatch_timer(u, &p->coalesce_watch);
+
+        changed = p->coalesce_changed;
+        p->coalesce_changed = false;
+
+        if (p->state != PATH_WAITING &&
+            p->state != PATH_RUNNING)
+                return;
+
+        if (changed)
+                path_enter_running(p);
+        else
+                path_enter_waiting(p, false, true);
+}
+
+static void path_shutdown(Manager *m) {
+        PathInotify *i;
+
+        assert(m);
+
+        while ((i = hashmap_first(m->inotify_wds)))
+                path_inotify_free(m, i);
+
+        hashmap_free(m->inotify_wds);
+        m->inotify_wds = NULL;
+
+        set_free(m->inotify_pending);
+        m->inotify_pending = NULL;
+
+        if (m->inotify_watch.fd >= 0) {
+                close_nointr_nofail(m->inotify_watch.fd);
+                watch_init(&m->inotify_watch);
+        }
+}
+
 void path_unit_notify(Unit *u, UnitActiveState new_state) {
         Iterator i;
         Unit *k;
@@ -737,7 +1169,8 @@ static const char* const path_type_table[_PATH_TYPE_MAX] = {
         [PATH_EXISTS_GLOB] = "PathExistsGlob",
         [PATH_CHANGED] = "PathChanged",
         [PATH_MODIFIED] = "PathModified",
-        [PATH_DIRECTORY_NOT_EMPTY] = "DirectoryNotEmpty"
+        [PATH_DIRECTORY_NOT_EMPTY] = "DirectoryNotEmpty",
+        [PATH_DIRECTORY_NOT_EMPTY_RECURSIVE] = "DirectoryNotEmptyRecursive"
 };
 
 DEFINE_STRING_TABLE_LOOKUP(path_type, PathType);
@@ -762,6 +1195,8 @@ const UnitVTable path_vtable = {
 
         .coldplug = path_coldplug,
 
+        .shutdown = path_shutdown,
+
         .dump = path_dump,
 
         .start = path_start,
@@ -774,10 +1209,12 @@ const UnitVTable path_vtable = {
         .sub_state_to_string = path_sub_state_to_string,
 
         .fd_event = path_fd_event,
+        .timer_event = path_timer_event,
 
         .reset_failed = path_reset_failed,
 
         .bus_interface = "org.freedesktop.systemd1.Path",
+        .bus_append_properties = bus_path_append_properties,
         .bus_message_handler = bus_path_message_handler,
         .bus_invalidating_properties = bus_path_invalidating_properties
 };
@@ -39,6 +39,7 @@ typedef enum PathType {
         PATH_EXISTS,
         PATH_EXISTS_GLOB,
         PATH_DIRECTORY_NOT_EMPTY,
+        PATH_DIRECTORY_NOT_EMPTY_RECURSIVE,
         PATH_CHANGED,
         PATH_MODIFIED,
         _PATH_TYPE_MAX,
@@ -48,26 +49,42 @@ typedef enum PathType {
 typedef struct PathSpec {
         char *path;
 
+        /* Passed to the owning unit's fd_event() when one of our
+         * inotify watches fired */
         Watch watch;
 
         LIST_FIELDS(struct PathSpec, spec);
 
         PathType type;
-        int inotify_fd;
+
+        /* Watch descriptors on the manager's shared inotify fd */
+        int *wds;
+        unsigned n_wds;
         int primary_wd;
 
+        bool primary_changed;
         bool previous_exists;
 } PathSpec;
 
+/* A watch descriptor on Manager::inotify_watch, shared by all path
+ * specs that watch the same inode */
+typedef struct PathInotify {
+        int wd;
+        uint32_t mask;
+        Hashmap *specs; /* PathSpec -> the mask it asked for */
+} PathInotify;
+
 int path_spec_watch(PathSpec *s, Unit *u);
 void path_spec_unwatch(PathSpec *s, Unit *u);
 int path_spec_fd_event(PathSpec *s, uint32_t events);
 void path_spec_done(PathSpec *s);
 
-static inline bool path_spec_owns_inotify_fd(PathSpec *s, int fd) {
-        return s->inotify_fd == fd;
+static inline bool path_spec_owns_watch(PathSpec *s, Watch *w) {
+        return &s->watch == w;
 }
 
+void path_inotify_event(Manager *m, uint32_t events);
+
 typedef enum PathResult {
         PATH_SUCCESS,
         PATH_FAILURE_RESOURCES,
@@ -86,6 +103,12 @@ struct Path {
 
         bool inotify_triggered;
 
+        /* Events arriving within this time after the first one are
+         * handled together */
+        usec_t coalesce_usec;
+        Watch coalesce_watch;
+        bool coalesce_changed;
+
         bool make_directory;
         mode_t directory_mode;
 
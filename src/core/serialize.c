@@ -0,0 +1,341 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "serialize.h"
+#include "util.h"
+#include "log.h"
+
+/* Items larger than this are considered corruption */
+#define SERIALIZE_ITEM_MAX (16U*1024U*1024U)
+
+typedef struct SerializeRecord {
+        uint32_t key_size;
+        uint32_t value_size;
+} SerializeRecord;
+
+/* The stream binary records are written to, and the first error
+ * hit while writing, for the serialization currently in progress */
+static FILE *binary_file = NULL;
+static int write_error = 0;
+
+int serialize_header(FILE *f, bool binary) {
+        uint32_t version = SERIALIZE_VERSION;
+
+        assert(f);
+
+        binary_file = binary ? f : NULL;
+        write_error = 0;
+
+        /* The text format has no header */
+        if (!binary)
+                return 0;
+
+        if (fwrite(SERIALIZE_MAGIC, sizeof(SERIALIZE_MAGIC) - 1, 1, f) != 1 ||
+            fwrite(&version, sizeof(version), 1, f) != 1)
+                write_error = -EIO;
+
+        return write_error;
+}
+
+static void serialize_record(FILE *f, const char *key, size_t key_size, const char *value, size_t value_size) {
+        bool ok;
+
+        if (f == binary_file) {
+                SerializeRecord r;
+
+                r.key_size = (uint32_t) key_size;
+                r.value_size = (uint32_t) value_size;
+
+                ok = fwrite(&r, sizeof(r), 1, f) == 1 &&
+                        (key_size == 0 || fwrite(key, key_size, 1, f) == 1) &&
+                        (value_size == 0 || fwrite(value, value_size, 1, f) == 1);
+        } else
+                /* key=value lines, or just the key if the value is
+                 * empty, as older versions wrote them */
+                ok = (key_size == 0 || fwrite(key, key_size, 1, f) == 1) &&
+                        (value_size == 0 || (fputc('=', f) != EOF && fwrite(value, value_size, 1, f) == 1)) &&
+                        fputc('\n', f) != EOF;
+
+        if (!ok && write_error == 0)
+                write_error = -EIO;
+}
+
+void serialize_item(FILE *f, const char *key, const char *value) {
+        assert(f);
+        assert(key);
+        assert(key[0]);
+        assert(value);
+
+        serialize_record(f, key, strlen(key), value, strlen(value));
+}
+
+void serialize_item_formatv(FILE *f, const char *key, const char *format, va_list ap) {
+        char buf[LINE_MAX], *p = NULL;
+        va_list aq;
+        int k;
+
+        assert(f);
+        assert(key);
+        assert(key[0]);
+        assert(format);
+
+        /* Most items are short, format them on the stack */
+        va_copy(aq, ap);
+        k = vsnprintf(buf, sizeof(buf), format, aq);
+        va_end(aq);
+
+        if (k < 0)
+                return;
+
+        if ((size_t) k >= sizeof(buf)) {
+                k = vasprintf(&p, format, ap);
+                if (k < 0) {
+                        if (write_error == 0)
+                                write_error = log_oom();
+                        return;
+                }
+        }
+
+        serialize_record(f, key, strlen(key), p ? p : buf, (size_t) k);
+        free(p);
+}
+
+void serialize_item_format(FILE *f, const char *key, const char *format, ...) {
+        va_list ap;
+
+        va_start(ap, format);
+        serialize_item_formatv(f, key, format, ap);
+        va_end(ap);
+}
+
+void serialize_dual_timestamp(FILE *f, const char *key, dual_timestamp *t) {
+        assert(f);
+        assert(key);
+        assert(t);
+
+        if (!dual_timestamp_is_set(t))
+                return;
+
+        serialize_item_format(f, key, "%llu %llu",
+                              (unsigned long long) t->realtime,
+                              (unsigned long long) t->monotonic);
+}
+
+void serialize_end(FILE *f) {
+        assert(f);
+
+        serialize_record(f, NULL, 0, NULL, 0);
+}
+
+int serialize_finish(FILE *f) {
+        assert(f);
+
+        binary_file = NULL;
+
+        if (fflush(f) != 0 && write_error == 0)
+                write_error = -errno;
+
+        if (write_error < 0)
+                return write_error;
+
+        return ferror(f) ? -EIO : 0;
+}
+
+static int deserializer_reserve(Deserializer *d, size_t size) {
+        char *p;
+        size_t a;
+
+        assert(d);
+
+        if (size <= d->allocated)
+                return 0;
+
+        a = MAX(size, d->allocated * 2);
+
+        p = realloc(d->buf, a);
+        if (!p)
+                return -ENOMEM;
+
+        d->buf = p;
+        d->allocated = a;
+        return 0;
+}
+
+int deserializer_init(Deserializer *d, FILE *f) {
+        char magic[sizeof(SERIALIZE_MAGIC) - 1];
+        uint32_t version;
+        size_t n;
+
+        assert(d);
+        assert(f);
+
+        zero(*d);
+        d->f = f;
+
+        /* Figure out which format this is. The text format starts
+         * with a manager item, hence cannot contain a NUL byte where
+         * the magic has them. */
+
+        n = fread(magic, 1, sizeof(magic), f);
+        if (n == sizeof(magic) && memcmp(magic, SERIALIZE_MAGIC, sizeof(magic)) == 0) {
+
+                if (fread(&version, sizeof(version), 1, f) != 1)
+                        return ferror(f) ? -errno : -EBADMSG;
+
+                if (version != SERIALIZE_VERSION) {
+                        log_error("Unsupported serialization version %u.", version);
+                        return -EPROTONOSUPPORT;
+                }
+
+                d->binary = true;
+                return 0;
+        }
+
+        if (ferror(f))
+                return -errno;
+
+        /* Not ours, go back and read it as text */
+        if (fseeko(f, -(off_t) n, SEEK_CUR) < 0)
+                return -errno;
+
+        return deserializer_reserve(d, LINE_MAX);
+}
+
+void deserializer_done(Deserializer *d) {
+        assert(d);
+
+        free(d->buf);
+        d->buf = NULL;
+        d->allocated = 0;
+}
+
+static int deserializer_next_binary(Deserializer *d, char **key, char **value) {
+        SerializeRecord r;
+        size_t size;
+        int k;
+
+        if (fread(&r, sizeof(r), 1, d->f) != 1) {
+                if (ferror(d->f))
+                        return -errno;
+
+                d->eof = true;
+                return 0;
+        }
+
+        /* End marker */
+        if (r.key_size == 0)
+                return 0;
+
+        if (r.key_size > SERIALIZE_ITEM_MAX || r.value_size > SERIALIZE_ITEM_MAX)
+                return -EBADMSG;
+
+        /* Read key and value in one go, and NUL terminate them in
+         * place, so that we can hand out pointers into the buffer */
+        size = (size_t) r.key_size + 1 + (size_t) r.value_size + 1;
+        k = deserializer_reserve(d, size);
+        if (k < 0)
+                return k;
+
+        if (fread(d->buf, 1, r.key_size, d->f) != r.key_size)
+                return ferror(d->f) ? -errno : -EBADMSG;
+
+        d->buf[r.key_size] = 0;
+
+        if (r.value_size > 0 &&
+            fread(d->buf + r.key_size + 1, 1, r.value_size, d->f) != r.value_size)
+                return ferror(d->f) ? -errno : -EBADMSG;
+
+        d->buf[r.key_size + 1 + r.value_size] = 0;
+
+        *key = d->buf;
+        *value = d->buf + r.key_size + 1;
+        return 1;
+}
+
+static int deserializer_next_text(Deserializer *d, char **key, char **value) {
+        size_t n = 0, k;
+        char *l;
+        int r;
+
+        /* Lines longer than the buffer are read in several goes */
+        for (;;) {
+                if (!fgets(d->buf + n, d->allocated - n, d->f)) {
+                        if (ferror(d->f))
+                                return -errno;
+
+                        if (n == 0) {
+                                d->eof = true;
+                                return 0;
+                        }
+
+                        break;
+                }
+
+                n += strlen(d->buf + n);
+                if (n > 0 && d->buf[n-1] == '\n')
+                        break;
+
+                if (n >= SERIALIZE_ITEM_MAX)
+                        return -EBADMSG;
+
+                r = deserializer_reserve(d, d->allocated * 2);
+                if (r < 0)
+                        return r;
+        }
+
+        l = strstrip(d->buf);
+
+        /* End marker */
+        if (l[0] == 0)
+                return 0;
+
+        k = strcspn(l, "=");
+
+        if (l[k] == '=') {
+                l[k] = 0;
+                *value = l+k+1;
+        } else
+                *value = l+k;
+
+        *key = l;
+        return 1;
+}
+
+int deserializer_next(Deserializer *d, char **key, char **value) {
+        assert(d);
+        assert(key);
+        assert(value);
+
+        /* Returns > 0 for an item, 0 at the end of a section or of
+         * the file, which can be told apart by looking at d->eof. */
+
+        if (d->eof)
+                return 0;
+
+        if (d->binary)
+                return deserializer_next_binary(d, key, value);
+
+        return deserializer_next_text(d, key, value);
+}
@@ -0,0 +1,60 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+#pragma once
+
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include "macro.h"
+#include "time-util.h"
+
+/* The state we pass on over reload and reexecution is a sequence of
+ * key/value items, grouped into sections that are terminated by an
+ * empty item. On reload we write it as length-prefixed binary
+ * records. On reexecution we write the key=value text lines older
+ * versions understand, since the new binary might be one of them.
+ * Both formats are read. */
+
+#define SERIALIZE_MAGIC "\0SDSER\0"
+#define SERIALIZE_VERSION 1
+
+int serialize_header(FILE *f, bool binary);
+
+void serialize_item(FILE *f, const char *key, const char *value);
+void serialize_item_format(FILE *f, const char *key, const char *format, ...) _printf_attr_(3,4);
+void serialize_item_formatv(FILE *f, const char *key, const char *format, va_list ap) _printf_attr_(3,0);
+void serialize_dual_timestamp(FILE *f, const char *key, dual_timestamp *t);
+void serialize_end(FILE *f);
+int serialize_finish(FILE *f);
+
+typedef struct Deserializer {
+        FILE *f;
+        bool binary;
+        bool eof;
+
+        char *buf;
+        size_t allocated;
+} Deserializer;
+
+int deserializer_init(Deserializer *d, FILE *f);
+void deserializer_done(Deserializer *d);
+
+int deserializer_next(Deserializer *d, char **key, char **value);
@@ -141,6 +141,7 @@ static void service_init(Unit *u) {
         kill_context_init(&s->kill_context);
 
         RATELIMIT_INIT(s->start_limit, 10*USEC_PER_SEC, 5);
+        RATELIMIT_INIT(s->notify_limit, 0, 0);
 
         s->control_command_id = _SERVICE_EXEC_COMMAND_INVALID;
 }
@@ -1363,6 +1364,13 @@ static void service_dump(Unit *u, FILE *f, const char *prefix) {
                 fprintf(f, "%sStatus Text: %s\n",
                         prefix, s->status_text);
 
+        if (s->n_notify_messages > 0)
+                fprintf(f,
+                        "%sNotify Messages: %u\n"
+                        "%sNotify Dropped: %u\n",
+                        prefix, s->n_notify_messages,
+                        prefix, s->n_notify_dropped);
+
         free(p2);
 }
 
@@ -2135,6 +2143,9 @@ static void service_enter_start(Service *s) {
         if (r < 0)
                 goto fail;
 
+        dual_timestamp_get(&UNIT(s)->exec_timestamp);
+        zero(UNIT(s)->ready_timestamp);
+
         if (s->type == SERVICE_SIMPLE || s->type == SERVICE_IDLE) {
                 /* For simple services we immediately start
                  * the START_POST binaries. */
@@ -2580,8 +2591,8 @@ static int service_serialize(Unit *u, FILE *f, FDSet *fds) {
 
         if (s->main_exec_status.pid > 0) {
                 unit_serialize_item_format(u, f, "main-exec-status-pid", "%lu", (unsigned long) s->main_exec_status.pid);
-                dual_timestamp_serialize(f, "main-exec-status-start", &s->main_exec_status.start_timestamp);
-                dual_timestamp_serialize(f, "main-exec-status-exit", &s->main_exec_status.exit_timestamp);
+                serialize_dual_timestamp(f, "main-exec-status-start", &s->main_exec_status.start_timestamp);
+                serialize_dual_timestamp(f, "main-exec-status-exit", &s->main_exec_status.exit_timestamp);
 
                 if (dual_timestamp_is_set(&s->main_exec_status.exit_timestamp)) {
                         unit_serialize_item_format(u, f, "main-exec-status-code", "%i", s->main_exec_status.code);
@@ -2589,7 +2600,7 @@ static int service_serialize(Unit *u, FILE *f, FDSet *fds) {
                 }
         }
         if (dual_timestamp_is_set(&s->watchdog_timestamp))
-                dual_timestamp_serialize(f, "watchdog-timestamp", &s->watchdog_timestamp);
+                serialize_dual_timestamp(f, "watchdog-timestamp", &s->watchdog_timestamp);
 
         return 0;
 }
@@ -2812,7 +2823,6 @@ static int service_demand_pid_file(Service *s) {
         /* PATH_CHANGED would not be enough. There are daemons (sendmail) that
          * keep their PID file open all the time. */
         ps->type = PATH_MODIFIED;
-        ps->inotify_fd = -1;
 
         s->pid_file_pathspec = ps;
 
@@ -2826,7 +2836,7 @@ static void service_fd_event(Unit *u, int fd, uint32_t events, Watch *w) {
         assert(fd >= 0);
         assert(s->state == SERVICE_START || s->state == SERVICE_START_POST);
         assert(s->pid_file_pathspec);
-        assert(path_spec_owns_inotify_fd(s->pid_file_pathspec, fd));
+        assert(path_spec_owns_watch(s->pid_file_pathspec, w));
 
         log_debug_unit(u->id, "inotify event for %s", u->id);
 
@@ -3274,7 +3284,9 @@ static void service_cgroup_notify_event(Unit *u) {
 
 static void service_notify_message(Unit *u, pid_t pid, char **tags) {
         Service *s = SERVICE(u);
-        const char *e;
+        const char *main_pid = NULL, *status = NULL;
+        bool ready = false, watchdog = false, notify_dbus = false;
+        char **t;
 
         assert(u);
 
@@ -3292,68 +3304,98 @@ static void service_notify_message(Unit *u, pid_t pid, char **tags) {
                 return;
         }
 
+        s->n_notify_messages++;
+
+        /* Watchdog keep-alive pings are by far the most frequent
+         * message, handle them without further ado */
+        if (tags[0] && !tags[1] && streq(tags[0], "WATCHDOG=1")) {
+                if (dual_timestamp_is_set(&s->watchdog_timestamp))
+                        service_reset_watchdog(s);
+                return;
+        }
+
         log_debug_unit(u->id,
                        "%s: Got message", u->id);
 
+        STRV_FOREACH(t, tags) {
+                if (!main_pid && startswith(*t, "MAINPID="))
+                        main_pid = *t;
+                else if (!status && startswith(*t, "STATUS="))
+                        status = *t;
+                else if (streq(*t, "READY=1"))
+                        ready = true;
+                else if (streq(*t, "WATCHDOG=1"))
+                        watchdog = true;
+        }
+
         /* Interpret MAINPID= */
-        if ((e = strv_find_prefix(tags, "MAINPID=")) &&
+        if (main_pid &&
             (s->state == SERVICE_START ||
              s->state == SERVICE_START_POST ||
              s->state == SERVICE_RUNNING ||
              s->state == SERVICE_RELOAD)) {
 
-                if (parse_pid(e + 8, &pid) < 0)
+                if (parse_pid(main_pid + 8, &pid) < 0)
                         log_warning_unit(u->id,
-                                         "Failed to parse notification message %s", e);
+                                         "Failed to parse notification message %s", main_pid);
                 else {
                         log_debug_unit(u->id,
-                                       "%s: got %s", u->id, e);
+                                       "%s: got %s", u->id, main_pid);
                         service_set_main_pid(s, pid);
+                        notify_dbus = true;
                 }
         }
 
         /* Interpret READY= */
         if (s->type == SERVICE_NOTIFY &&
             s->state == SERVICE_START &&
-            strv_find(tags, "READY=1")) {
+            ready) {
                 log_debug_unit(u->id,
                                "%s: got READY=1", u->id);
 
+                dual_timestamp_get(&u->ready_timestamp);
                 service_enter_start_post(s);
+                notify_dbus = true;
         }
 
-        /* Interpret STATUS= */
-        e = strv_find_prefix(tags, "STATUS=");
-        if (e) {
-                char *t;
+        /* Interpret STATUS=, unless the service sends more updates
+         * than we are willing to process */
+        if (status && !ratelimit_test(&s->notify_limit)) {
+                if (s->n_notify_dropped++ == 0)
+                        log_warning_unit(u->id,
+                                         "%s: Status updates sent too frequently, ignoring some of them.", u->id);
+        } else if (status) {
+                char *k = NULL;
 
-                if (e[7]) {
+                if (status[7]) {
 
-                        if (!utf8_is_valid(e+7)) {
+                        if (!utf8_is_valid(status+7)) {
                                 log_warning_unit(u->id,
                                                  "Status message in notification is not UTF-8 clean.");
-                                return;
+                                goto finish;
                         }
 
-                        t = strdup(e+7);
-                        if (!t) {
+                        k = strdup(status+7);
+                        if (!k) {
                                 log_error_unit(u->id,
                                                "Failed to allocate string.");
-                                return;
+                                goto finish;
                         }
 
                         log_debug_unit(u->id,
-                                       "%s: got %s", u->id, e);
-
-                        free(s->status_text);
-                        s->status_text = t;
-                } else {
-                        free(s->status_text);
-                        s->status_text = NULL;
+                                       "%s: got %s", u->id, status);
                 }
 
+                if (!streq_ptr(s->status_text, k)) {
+                        free(s->status_text);
+                        s->status_text = k;
+                        notify_dbus = true;
+                } else
+                        free(k);
         }
-        if (strv_find(tags, "WATCHDOG=1")) {
+
+finish:
+        if (watchdog) {
                 log_debug_unit(u->id,
                                "%s: got WATCHDOG=1", u->id);
                 if (dual_timestamp_is_set(&s->watchdog_timestamp))
@@ -3361,7 +3403,8 @@ static void service_notify_message(Unit *u, pid_t pid, char **tags) {
         }
 
         /* Notify clients about changed status or main pid */
-        unit_add_to_dbus_queue(u);
+        if (notify_dbus)
+                unit_add_to_dbus_queue(u);
 }
 
 #ifdef HAVE_SYSV_COMPAT
@@ -3836,6 +3879,7 @@ const UnitVTable service_vtable = {
         .bus_query_pid_done = service_bus_query_pid_done,
 
         .bus_interface = "org.freedesktop.systemd1.Service",
+        .bus_append_properties = bus_service_append_properties,
         .bus_message_handler = bus_service_message_handler,
         .bus_invalidating_properties =  bus_service_invalidating_properties,
 
@@ -195,6 +195,10 @@ struct Service {
         PathSpec *pid_file_pathspec;
 
         NotifyAccess notify_access;
+        RateLimit notify_limit;
+
+        unsigned n_notify_messages;
+        unsigned n_notify_dropped;
 };
 
 extern const UnitVTable service_vtable;
@@ -304,5 +304,6 @@ const UnitVTable snapshot_vtable = {
         .sub_state_to_string = snapshot_sub_state_to_string,
 
         .bus_interface = "org.freedesktop.systemd1.Snapshot",
+        .bus_append_properties = bus_snapshot_append_properties,
         .bus_message_handler = bus_snapshot_message_handler
 };
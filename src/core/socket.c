@@ -51,6 +51,9 @@
 #include "exit-status.h"
 #include "def.h"
 
+/* Maximum number of connections accepted per wakeup on Accept=yes sockets */
+#define SOCKET_ACCEPT_BATCH 64
+
 static const UnitActiveState state_translation_table[_SOCKET_STATE_MAX] = {
         [SOCKET_DEAD] = UNIT_INACTIVE,
         [SOCKET_START_PRE] = UNIT_ACTIVATING,
@@ -1435,6 +1438,83 @@ fail:
         socket_enter_dead(s, SOCKET_FAILURE_RESOURCES);
 }
 
+static bool socket_service_dependencies_settled(Unit *u) {
+        static const UnitDependency requirements[] = {
+                UNIT_REQUIRES,
+                UNIT_REQUIRES_OVERRIDABLE,
+                UNIT_REQUISITE,
+                UNIT_REQUISITE_OVERRIDABLE,
+                UNIT_WANTS,
+                UNIT_BINDS_TO
+        };
+        static const UnitDependency conflicts[] = {
+                UNIT_CONFLICTS,
+                UNIT_CONFLICTED_BY
+        };
+        Unit *other;
+        Iterator i;
+        unsigned j;
+
+        assert(u);
+
+        /* Returns true if starting the connection service would not
+         * touch any other unit: everything it pulls in is already up
+         * and everything it conflicts with is already down, and none
+         * of them has a job pending. In that case the transaction
+         * would consist of the service's own job only, and we can
+         * skip building it. */
+
+        for (j = 0; j < ELEMENTSOF(requirements); j++)
+                SET_FOREACH(other, u->dependencies[requirements[j]], i)
+                        if (other->job ||
+                            !UNIT_IS_ACTIVE_OR_RELOADING(unit_active_state(other)))
+                                return false;
+
+        for (j = 0; j < ELEMENTSOF(conflicts); j++)
+                SET_FOREACH(other, u->dependencies[conflicts[j]], i)
+                        if (other->job ||
+                            !UNIT_IS_INACTIVE_OR_FAILED(unit_active_state(other)))
+                                return false;
+
+        return true;
+}
+
+static int socket_enqueue_instance_job(Unit *u) {
+        Job *j;
+        int r;
+
+        assert(u);
+        assert(!u->job);
+
+        /* The transaction for a connection instance whose
+         * dependencies are settled would consist of its start job
+         * only, hence install that job directly, like
+         * transaction_apply() would */
+
+        j = job_new(u, JOB_START);
+        if (!j)
+                return -ENOMEM;
+
+        j->override = true;
+
+        r = hashmap_put(u->manager->jobs, UINT32_TO_PTR(j->id), j);
+        if (r < 0) {
+                job_free(j);
+                return r;
+        }
+
+        assert_se(job_install(j) == j);
+
+        job_add_to_run_queue(j);
+        job_add_to_dbus_queue(j);
+        job_start_timer(j);
+
+        log_debug_unit(u->id,
+                       "Enqueued job %s/%s as %u without transaction", u->id,
+                       job_type_to_string(j->type), (unsigned) j->id);
+        return 0;
+}
+
 static void socket_enter_running(Socket *s, int cfd) {
         int r;
         DBusError error;
@@ -1552,7 +1632,15 @@ static void socket_enter_running(Socket *s, int cfd) {
                 cfd = -1;
                 s->n_connections ++;
 
-                r = manager_add_job(UNIT(s)->manager, JOB_START, UNIT(service), JOB_REPLACE, true, &error, NULL);
+                /* Fast path: if the dependencies of the instance
+                 * are all settled, enqueue its start job without
+                 * building a transaction. */
+                if (UNIT(service)->load_state == UNIT_LOADED &&
+                    !UNIT(service)->job &&
+                    socket_service_dependencies_settled(UNIT(service)))
+                        r = socket_enqueue_instance_job(UNIT(service));
+                else
+                        r = manager_add_job(UNIT(s)->manager, JOB_START, UNIT(service), JOB_REPLACE, true, &error, NULL);
                 if (r < 0)
                         goto fail;
 
@@ -1984,7 +2072,13 @@ static void socket_fd_event(Unit *u, int fd, uint32_t events, Watch *w) {
         }
 
         if (w->socket_accept) {
-                for (;;) {
+                unsigned n;
+
+                /* Take as many pending connections as we can get in
+                 * one go, but not unboundedly many so that a flood on
+                 * one socket cannot starve the rest of the event
+                 * loop. */
+                for (n = 0; n < SOCKET_ACCEPT_BATCH && s->state == SOCKET_LISTENING;) {
 
                         cfd = accept4(fd, NULL, NULL, SOCK_NONBLOCK);
                         if (cfd < 0) {
@@ -1992,18 +2086,27 @@ static void socket_fd_event(Unit *u, int fd, uint32_t events, Watch *w) {
                                 if (errno == EINTR)
                                         continue;
 
+                                if (errno == EAGAIN)
+                                        break;
+
                                 log_error_unit(u->id,
                                                "Failed to accept socket: %m");
                                 goto fail;
                         }
 
-                        break;
+                        n++;
+
+                        socket_apply_socket_options(s, cfd);
+                        socket_enter_running(s, cfd);
                 }
 
-                socket_apply_socket_options(s, cfd);
+                if (n > 1)
+                        log_debug_unit(u->id, "%s: Accepted %u connections in one wakeup.", u->id, n);
+
+                return;
         }
 
-        socket_enter_running(s, cfd);
+        socket_enter_running(s, -1);
         return;
 
 fail:
@@ -2392,6 +2495,7 @@ const UnitVTable socket_vtable = {
         .reset_failed = socket_reset_failed,
 
         .bus_interface = "org.freedesktop.systemd1.Socket",
+        .bus_append_properties = bus_socket_append_properties,
         .bus_message_handler = bus_socket_message_handler,
         .bus_invalidating_properties =  bus_socket_invalidating_properties,
 
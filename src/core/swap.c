@@ -1384,6 +1384,7 @@ const UnitVTable swap_vtable = {
         .reset_failed = swap_reset_failed,
 
         .bus_interface = "org.freedesktop.systemd1.Swap",
+        .bus_append_properties = bus_swap_append_properties,
         .bus_message_handler = bus_swap_message_handler,
         .bus_invalidating_properties =  bus_swap_invalidating_properties,
 
@@ -225,6 +225,7 @@ const UnitVTable target_vtable = {
         .sub_state_to_string = target_sub_state_to_string,
 
         .bus_interface = "org.freedesktop.systemd1.Target",
+        .bus_append_properties = bus_target_append_properties,
         .bus_message_handler = bus_target_message_handler,
 
         .status_message_formats = {
@@ -618,6 +618,7 @@ const UnitVTable timer_vtable = {
         .time_change = timer_time_change,
 
         .bus_interface = "org.freedesktop.systemd1.Timer",
+        .bus_append_properties = bus_timer_append_properties,
         .bus_message_handler = bus_timer_message_handler,
         .bus_invalidating_properties =  bus_timer_invalidating_properties
 };
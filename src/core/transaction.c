@@ -27,6 +27,19 @@
 
 static void transaction_unlink_job(Transaction *tr, Job *j, bool delete_dependencies);
 
+static Job *transaction_get_job(Transaction *tr, Unit *u) {
+        assert(tr);
+        assert(u);
+
+        /* Returns the list of prospective jobs for a unit, looked
+         * up by its dense id */
+
+        if (u->dense_id >= tr->n_jobs_by_dense_id)
+                return NULL;
+
+        return tr->jobs_by_dense_id[u->dense_id];
+}
+
 static void transaction_delete_job(Transaction *tr, Job *j, bool delete_dependencies) {
         assert(tr);
         assert(j);
@@ -44,7 +57,7 @@ static void transaction_delete_unit(Transaction *tr, Unit *u) {
         /* Deletes all jobs associated with a certain unit from the
          * transaction */
 
-        while ((j = hashmap_get(tr->jobs, u)))
+        while ((j = transaction_get_job(tr, u)))
                 transaction_delete_job(tr, j, true);
 }
 
@@ -230,17 +243,20 @@ static int delete_one_unmergeable_job(Transaction *tr, Job *j) {
 }
 
 static int transaction_merge_jobs(Transaction *tr, DBusError *e) {
-        Job *j;
-        Iterator i;
+        unsigned id;
         int r;
 
         assert(tr);
 
         /* First step, check whether any of the jobs for one specific
          * task conflict. If so, try to drop one of them. */
-        HASHMAP_FOREACH(j, tr->jobs, i) {
+        for (id = 0; id < tr->n_jobs_by_dense_id; id++) {
                 JobType t;
-                Job *k;
+                Job *j, *k;
+
+                j = tr->jobs_by_dense_id[id];
+                if (!j)
+                        continue;
 
                 t = j->type;
                 LIST_FOREACH(transaction, k, j->transaction_next) {
@@ -266,9 +282,15 @@ static int transaction_merge_jobs(Transaction *tr, DBusError *e) {
         }
 
         /* Second step, merge the jobs. */
-        HASHMAP_FOREACH(j, tr->jobs, i) {
-                JobType t = j->type;
-                Job *k;
+        for (id = 0; id < tr->n_jobs_by_dense_id; id++) {
+                JobType t;
+                Job *j, *k;
+
+                j = tr->jobs_by_dense_id[id];
+                if (!j)
+                        continue;
+
+                t = j->type;
 
                 /* Merge all transaction jobs for j->unit */
                 LIST_FOREACH(transaction, k, j->transaction_next)
@@ -290,8 +312,7 @@ static int transaction_merge_jobs(Transaction *tr, DBusError *e) {
 }
 
 static void transaction_drop_redundant(Transaction *tr) {
-        Job *j;
-        Iterator i;
+        unsigned id;
 
         /* Goes through the transaction and removes all jobs of the units
          * whose jobs are all noops. If not all of a unit's jobs are
@@ -299,9 +320,10 @@ static void transaction_drop_redundant(Transaction *tr) {
 
         assert(tr);
 
-rescan:
-        HASHMAP_FOREACH(j, tr->jobs, i) {
-                Job *k;
+        for (id = 0; id < tr->n_jobs_by_dense_id; id++) {
+                Job *j, *k;
+
+                j = tr->jobs_by_dense_id[id];
 
                 LIST_FOREACH(transaction, k, j) {
 
@@ -311,9 +333,12 @@ rescan:
                                 goto next_unit;
                 }
 
-                /* log_debug("Found redundant job %s/%s, dropping.", j->unit->id, job_type_to_string(j->type)); */
-                transaction_delete_job(tr, j, false);
-                goto rescan;
+                /* Dropping jobs without their dependencies does
+                 * not change whether the jobs of any other unit are
+                 * redundant, hence a single pass suffices. */
+                while ((j = tr->jobs_by_dense_id[id]))
+                        /* log_debug("Found redundant job %s/%s, dropping.", j->unit->id, job_type_to_string(j->type)); */
+                        transaction_delete_job(tr, j, false);
         next_unit:;
         }
 }
@@ -333,8 +358,8 @@ static bool unit_matters_to_anchor(Unit *u, Job *j) {
 }
 
 static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsigned generation, DBusError *e) {
-        Iterator i;
-        Unit *u;
+        Unit **before, *u;
+        unsigned n, k;
         int r;
 
         assert(tr);
@@ -417,11 +442,15 @@ static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsi
 
         /* We assume that the dependencies are bidirectional, and
          * hence can ignore UNIT_AFTER */
-        SET_FOREACH(u, j->unit->dependencies[UNIT_BEFORE], i) {
+        r = unit_get_dependency_array(j->unit, UNIT_BEFORE, &before, &n);
+        if (r < 0)
+                return r;
+
+        DEPENDENCY_ARRAY_FOREACH(u, before, n, k) {
                 Job *o;
 
                 /* Is there a job for this unit? */
-                o = hashmap_get(tr->jobs, u);
+                o = transaction_get_job(tr, u);
                 if (!o) {
                         /* Ok, there is no job for this in the
                          * transaction, but maybe there is already one
@@ -444,10 +473,8 @@ static int transaction_verify_order_one(Transaction *tr, Job *j, Job *from, unsi
 }
 
 static int transaction_verify_order(Transaction *tr, unsigned *generation, DBusError *e) {
-        Job *j;
+        unsigned g, id;
         int r;
-        Iterator i;
-        unsigned g;
 
         assert(tr);
         assert(generation);
@@ -457,47 +484,67 @@ static int transaction_verify_order(Transaction *tr, unsigned *generation, DBusE
 
         g = (*generation)++;
 
-        HASHMAP_FOREACH(j, tr->jobs, i)
+        for (id = 0; id < tr->n_jobs_by_dense_id; id++) {
+                Job *j;
+
+                j = tr->jobs_by_dense_id[id];
+                if (!j)
+                        continue;
+
                 if ((r = transaction_verify_order_one(tr, j, NULL, g, e)) < 0)
                         return r;
+        }
 
         return 0;
 }
 
 static void transaction_collect_garbage(Transaction *tr) {
-        Iterator i;
-        Job *j;
+        unsigned id;
+        bool again;
 
         assert(tr);
 
-        /* Drop jobs that are not required by any other job */
+        /* Drop jobs that are not required by any other job. Deleting
+         * a job might orphan jobs we already looked at, hence repeat
+         * until nothing changes anymore. */
 
-rescan:
-        HASHMAP_FOREACH(j, tr->jobs, i) {
-                if (tr->anchor_job == j || j->object_list) {
-                        /* log_debug("Keeping job %s/%s because of %s/%s", */
-                        /*           j->unit->id, job_type_to_string(j->type), */
-                        /*           j->object_list->subject ? j->object_list->subject->unit->id : "root", */
-                        /*           j->object_list->subject ? job_type_to_string(j->object_list->subject->type) : "root"); */
-                        continue;
-                }
+        do {
+                again = false;
 
-                /* log_debug("Garbage collecting job %s/%s", j->unit->id, job_type_to_string(j->type)); */
-                transaction_delete_job(tr, j, true);
-                goto rescan;
-        }
+                for (id = 0; id < tr->n_jobs_by_dense_id; id++) {
+                        Job *j;
+
+                        while ((j = tr->jobs_by_dense_id[id])) {
+                                if (tr->anchor_job == j || j->object_list) {
+                                        /* log_debug("Keeping job %s/%s because of %s/%s", */
+                                        /*           j->unit->id, job_type_to_string(j->type), */
+                                        /*           j->object_list->subject ? j->object_list->subject->unit->id : "root", */
+                                        /*           j->object_list->subject ? job_type_to_string(j->object_list->subject->type) : "root"); */
+                                        break;
+                                }
+
+                                /* log_debug("Garbage collecting job %s/%s", j->unit->id, job_type_to_string(j->type)); */
+                                transaction_delete_job(tr, j, true);
+                                again = true;
+                        }
+                }
+        } while (again);
 }
 
 static int transaction_is_destructive(Transaction *tr, DBusError *e) {
-        Iterator i;
-        Job *j;
+        unsigned id;
 
         assert(tr);
 
         /* Checks whether applying this transaction means that
          * existing jobs would be replaced */
 
-        HASHMAP_FOREACH(j, tr->jobs, i) {
+        for (id = 0; id < tr->n_jobs_by_dense_id; id++) {
+                Job *j;
+
+                j = tr->jobs_by_dense_id[id];
+                if (!j)
+                        continue;
 
                 /* Assume merged */
                 assert(!j->transaction_prev);
@@ -515,17 +562,20 @@ static int transaction_is_destructive(Transaction *tr, DBusError *e) {
 }
 
 static void transaction_minimize_impact(Transaction *tr) {
-        Job *j;
-        Iterator i;
+        unsigned id;
 
         assert(tr);
 
         /* Drops all unnecessary jobs that reverse already active jobs
-         * or that stop a running service. */
+         * or that stop a running service. Whether a job is dropped
+         * only depends on the job itself, hence a single pass over
+         * the units suffices. */
 
-rescan:
-        HASHMAP_FOREACH(j, tr->jobs, i) {
-                LIST_FOREACH(transaction, j, j) {
+        for (id = 0; id < tr->n_jobs_by_dense_id; id++) {
+                Job *j;
+
+        rescan:
+                LIST_FOREACH(transaction, j, tr->jobs_by_dense_id[id]) {
                         bool stops_running_service, changes_existing_job;
 
                         /* If it matters, we shouldn't drop it */
@@ -581,7 +631,7 @@ static int transaction_apply(Transaction *tr, Manager *m, JobMode mode) {
                 HASHMAP_FOREACH(j, m->jobs, i) {
                         assert(j->installed);
 
-                        if (hashmap_get(tr->jobs, j->unit))
+                        if (transaction_get_job(tr, j->unit))
                                 continue;
 
                         /* Not invalidating recursively. Avoids triggering
@@ -749,7 +799,7 @@ static Job* transaction_add_one_job(Transaction *tr, JobType type, Unit *unit, b
          * it doesn't exist it is created and added to the prospective
          * jobs list. */
 
-        f = hashmap_get(tr->jobs, unit);
+        f = transaction_get_job(tr, unit);
 
         LIST_FOREACH(transaction, j, f) {
                 assert(j->unit == unit);
@@ -761,6 +811,22 @@ static Job* transaction_add_one_job(Transaction *tr, JobType type, Unit *unit, b
                 }
         }
 
+        if (unit->dense_id >= tr->n_jobs_by_dense_id) {
+                unsigned n;
+                Job **a;
+
+                /* Size the index for all units the manager knows
+                 * about, so that we don't have to grow it again */
+                n = MAX(unit->manager->n_units_by_dense_id, unit->dense_id + 1);
+                a = realloc(tr->jobs_by_dense_id, n * sizeof(Job*));
+                if (!a)
+                        return NULL;
+
+                memset(a + tr->n_jobs_by_dense_id, 0, (n - tr->n_jobs_by_dense_id) * sizeof(Job*));
+                tr->jobs_by_dense_id = a;
+                tr->n_jobs_by_dense_id = n;
+        }
+
         j = job_new(unit, type);
         if (!j)
                 return NULL;
@@ -778,6 +844,8 @@ static Job* transaction_add_one_job(Transaction *tr, JobType type, Unit *unit, b
                 return NULL;
         }
 
+        tr->jobs_by_dense_id[unit->dense_id] = f;
+
         if (is_new)
                 *is_new = true;
 
@@ -792,10 +860,14 @@ static void transaction_unlink_job(Transaction *tr, Job *j, bool delete_dependen
 
         if (j->transaction_prev)
                 j->transaction_prev->transaction_next = j->transaction_next;
-        else if (j->transaction_next)
+        else if (j->transaction_next) {
                 hashmap_replace(tr->jobs, j->unit, j->transaction_next);
-        else
+                tr->jobs_by_dense_id[j->unit->dense_id] = j->transaction_next;
+        } else {
                 hashmap_remove_value(tr->jobs, j->unit, j);
+                if (tr->jobs_by_dense_id[j->unit->dense_id] == j)
+                        tr->jobs_by_dense_id[j->unit->dense_id] = NULL;
+        }
 
         if (j->transaction_next)
                 j->transaction_next->transaction_prev = j->transaction_prev;
@@ -833,7 +905,8 @@ int transaction_add_job_and_dependencies(
                 DBusError *e) {
         Job *ret;
         Iterator i;
-        Unit *dep;
+        Unit **deps, *dep;
+        unsigned n, k;
         int r;
         bool is_new;
 
@@ -914,7 +987,11 @@ int transaction_add_job_and_dependencies(
 
                 /* Finally, recursively add in all dependencies. */
                 if (type == JOB_START || type == JOB_RESTART) {
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_REQUIRES], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_REQUIRES, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -925,7 +1002,11 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_BINDS_TO], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_BINDS_TO, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -936,7 +1017,11 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_REQUIRES_OVERRIDABLE], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_REQUIRES_OVERRIDABLE, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, !override, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_full_unit(r == -EADDRNOTAVAIL ? LOG_DEBUG : LOG_WARNING, dep->id,
@@ -948,7 +1033,11 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_WANTS], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_WANTS, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_START, dep, ret, false, false, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_full_unit(r == -EADDRNOTAVAIL ? LOG_DEBUG : LOG_WARNING, dep->id,
@@ -960,7 +1049,11 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_REQUISITE], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_REQUISITE, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_VERIFY_ACTIVE, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -971,7 +1064,11 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_REQUISITE_OVERRIDABLE], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_REQUISITE_OVERRIDABLE, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_VERIFY_ACTIVE, dep, ret, !override, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_full_unit(r == -EADDRNOTAVAIL ? LOG_DEBUG : LOG_WARNING, dep->id,
@@ -983,7 +1080,11 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_CONFLICTS], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_CONFLICTS, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_STOP, dep, ret, true, override, true, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -994,7 +1095,11 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_CONFLICTED_BY], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_CONFLICTED_BY, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_STOP, dep, ret, false, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_warning_unit(dep->id,
@@ -1010,7 +1115,11 @@ int transaction_add_job_and_dependencies(
 
                 if (type == JOB_STOP || type == JOB_RESTART) {
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_REQUIRED_BY], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_REQUIRED_BY, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, type, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -1021,7 +1130,11 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_BOUND_BY], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_BOUND_BY, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, type, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -1032,7 +1145,11 @@ int transaction_add_job_and_dependencies(
                                 }
                         }
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_CONSISTS_OF], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_CONSISTS_OF, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, type, dep, ret, true, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         if (r != -EBADR)
@@ -1047,7 +1164,11 @@ int transaction_add_job_and_dependencies(
 
                 if (type == JOB_RELOAD) {
 
-                        SET_FOREACH(dep, ret->unit->dependencies[UNIT_PROPAGATES_RELOAD_TO], i) {
+                        r = unit_get_dependency_array(ret->unit, UNIT_PROPAGATES_RELOAD_TO, &deps, &n);
+                        if (r < 0)
+                                goto fail;
+
+                        DEPENDENCY_ARRAY_FOREACH(dep, deps, n, k) {
                                 r = transaction_add_job_and_dependencies(tr, JOB_RELOAD, dep, ret, false, override, false, false, ignore_order, e);
                                 if (r < 0) {
                                         log_warning_unit(dep->id,
@@ -1070,18 +1191,18 @@ fail:
 }
 
 int transaction_add_isolate_jobs(Transaction *tr, Manager *m) {
-        Iterator i;
+        unsigned id;
         Unit *u;
-        char *k;
         int r;
 
         assert(tr);
         assert(m);
 
-        HASHMAP_FOREACH_KEY(u, k, m->units, i) {
+        for (id = 0; id < m->n_units_by_dense_id; id++) {
+                u = m->units_by_dense_id[id];
 
-                /* ignore aliases */
-                if (u->id != k)
+                /* ignore units merged into others */
+                if (u->load_state == UNIT_MERGED)
                         continue;
 
                 if (u->ignore_on_isolate)
@@ -1092,7 +1213,7 @@ int transaction_add_isolate_jobs(Transaction *tr, Manager *m) {
                         continue;
 
                 /* Is there already something listed for this? */
-                if (hashmap_get(tr->jobs, u))
+                if (transaction_get_job(tr, u))
                         continue;
 
                 r = transaction_add_job_and_dependencies(tr, JOB_STOP, u, tr->anchor_job, true, false, false, false, false, NULL);
@@ -1124,5 +1245,6 @@ Transaction *transaction_new(void) {
 void transaction_free(Transaction *tr) {
         assert(hashmap_isempty(tr->jobs));
         hashmap_free(tr->jobs);
+        free(tr->jobs_by_dense_id);
         free(tr);
 }
@@ -32,6 +32,8 @@ typedef struct Transaction Transaction;
 struct Transaction {
         /* Jobs to be added */
         Hashmap *jobs;      /* Unit object => Job object list 1:1 */
+        Job **jobs_by_dense_id; /* Unit dense id => Job object list, mirrors jobs */
+        unsigned n_jobs_by_dense_id;
         Job *anchor_job;      /* the job the user asked for */
 };
 
@@ -76,6 +76,25 @@ Unit *unit_new(Manager *m, size_t size) {
                 return NULL;
         }
 
+        if (m->n_units_by_dense_id >= m->n_units_by_dense_id_allocated) {
+                unsigned n;
+                Unit **a;
+
+                n = MAX(m->n_units_by_dense_id_allocated * 2, 64U);
+                a = realloc(m->units_by_dense_id, n * sizeof(Unit*));
+                if (!a) {
+                        set_free(u->names);
+                        free(u);
+                        return NULL;
+                }
+
+                m->units_by_dense_id = a;
+                m->n_units_by_dense_id_allocated = n;
+        }
+
+        u->dense_id = m->n_units_by_dense_id++;
+        m->units_by_dense_id[u->dense_id] = u;
+
         u->manager = m;
         u->type = _UNIT_TYPE_INVALID;
         u->deserialized_job = _JOB_TYPE_INVALID;
@@ -314,8 +333,10 @@ void unit_add_to_dbus_queue(Unit *u) {
         if (u->load_state == UNIT_STUB || u->in_dbus_queue)
                 return;
 
-        /* Shortcut things if nobody cares */
+        /* Shortcut things if nobody cares, but remember the state
+         * for the next signal */
         if (!bus_has_subscriber(u->manager)) {
+                bus_unit_update_state(u);
                 u->sent_dbus_new_signal = true;
                 return;
         }
@@ -339,6 +360,8 @@ static void bidi_set_free(Unit *u, Set *s) {
                 for (d = 0; d < _UNIT_DEPENDENCY_MAX; d++)
                         set_remove(other->dependencies[d], u);
 
+                other->dependency_array_dirty = true;
+
                 unit_add_to_gc_queue(other);
         }
 
@@ -376,6 +399,19 @@ void unit_free(Unit *u) {
         for (d = 0; d < _UNIT_DEPENDENCY_MAX; d++)
                 bidi_set_free(u, u->dependencies[d]);
 
+        free(u->dependency_array);
+
+        /* Keep the dense ids dense by moving the last unit into our
+         * slot */
+        assert(u->manager->units_by_dense_id[u->dense_id] == u);
+        u->manager->n_units_by_dense_id--;
+        if (u->dense_id < u->manager->n_units_by_dense_id) {
+                Unit *last = u->manager->units_by_dense_id[u->manager->n_units_by_dense_id];
+
+                last->dense_id = u->dense_id;
+                u->manager->units_by_dense_id[u->dense_id] = last;
+        }
+
         if (u->requires_mounts_for) {
                 LIST_REMOVE(Unit, has_requires_mounts_for, u->manager->has_requires_mounts_for, u);
                 strv_free(u->requires_mounts_for);
@@ -403,6 +439,7 @@ void unit_free(Unit *u) {
 
         free(u->description);
         strv_free(u->documentation);
+        strv_free(u->dropin_paths);
         free(u->fragment_path);
         free(u->source_path);
         free(u->instance);
@@ -411,6 +448,8 @@ void unit_free(Unit *u) {
 
         condition_free_list(u->conditions);
 
+        free(u->blocked_by);
+
         while (u->refs)
                 unit_ref_unset(u->refs);
 
@@ -489,9 +528,13 @@ static void merge_dependencies(Unit *u, Unit *other, UnitDependency d) {
                                 else
                                         assert(r == -ENOENT);
                         }
+
+                back->dependency_array_dirty = true;
         }
 
         complete_move(&u->dependencies[d], &other->dependencies[d]);
+        u->dependency_array_dirty = true;
+        other->dependency_array_dirty = true;
 
         set_free(other->dependencies[d]);
         other->dependencies[d] = NULL;
@@ -703,6 +746,23 @@ void unit_dump(Unit *u, FILE *f, const char *prefix) {
                         prefix, strna(format_timestamp(timestamp1, sizeof(timestamp1), u->condition_timestamp.realtime)),
                         prefix, yes_no(u->condition_result));
 
+        if (dual_timestamp_is_set(&u->job_enqueue_timestamp))
+                fprintf(f,
+                        "%s\tJob Enqueue Timestamp: %s\n"
+                        "%s\tJob Start Timestamp: %s\n",
+                        prefix, strna(format_timestamp(timestamp1, sizeof(timestamp1), u->job_enqueue_timestamp.realtime)),
+                        prefix, strna(format_timestamp(timestamp2, sizeof(timestamp2), u->job_start_timestamp.realtime)));
+
+        if (dual_timestamp_is_set(&u->exec_timestamp))
+                fprintf(f,
+                        "%s\tExec Timestamp: %s\n"
+                        "%s\tReady Timestamp: %s\n",
+                        prefix, strna(format_timestamp(timestamp1, sizeof(timestamp1), u->exec_timestamp.realtime)),
+                        prefix, strna(format_timestamp(timestamp2, sizeof(timestamp2), u->ready_timestamp.realtime)));
+
+        if (u->blocked_by)
+                fprintf(f, "%s\tBlocked By: %s\n", prefix, u->blocked_by);
+
         for (d = 0; d < _UNIT_DEPENDENCY_MAX; d++) {
                 Unit *other;
 
@@ -1716,6 +1776,9 @@ int unit_add_dependency(Unit *u, UnitDependency d, Unit *other, bool add_referen
         if (u == other)
                 return 0;
 
+        u->dependency_array_dirty = true;
+        other->dependency_array_dirty = true;
+
         if ((r = set_ensure_allocated(&u->dependencies[d], trivial_hash_func, trivial_compare_func)) < 0)
                 return r;
 
@@ -1763,6 +1826,64 @@ fail:
         return r;
 }
 
+static int unit_build_dependency_array(Unit *u) {
+        UnitDependency d;
+        unsigned n = 0, k = 0;
+        Unit **a = NULL, *other;
+        Iterator i;
+
+        assert(u);
+
+        for (d = 0; d < _UNIT_DEPENDENCY_MAX; d++)
+                n += set_size(u->dependencies[d]);
+
+        if (n > 0) {
+                a = new(Unit*, n);
+                if (!a)
+                        return -ENOMEM;
+        }
+
+        for (d = 0; d < _UNIT_DEPENDENCY_MAX; d++) {
+                u->dependency_offset[d] = k;
+
+                SET_FOREACH(other, u->dependencies[d], i)
+                        a[k++] = other;
+        }
+
+        assert(k == n);
+        u->dependency_offset[_UNIT_DEPENDENCY_MAX] = k;
+
+        free(u->dependency_array);
+        u->dependency_array = a;
+        u->dependency_array_dirty = false;
+
+        return 0;
+}
+
+int unit_get_dependency_array(Unit *u, UnitDependency d, Unit ***deps, unsigned *n) {
+        int r;
+
+        assert(u);
+        assert(d >= 0 && d < _UNIT_DEPENDENCY_MAX);
+        assert(deps);
+        assert(n);
+
+        /* Returns the units of dependency type d as a plain array,
+         * for the hot loops of the transaction code. The array stays
+         * valid until the dependencies of the unit change. */
+
+        if (u->dependency_array_dirty) {
+                r = unit_build_dependency_array(u);
+                if (r < 0)
+                        return r;
+        }
+
+        *deps = u->dependency_array + u->dependency_offset[d];
+        *n = u->dependency_offset[d+1] - u->dependency_offset[d];
+
+        return 0;
+}
+
 int unit_add_two_dependencies(Unit *u, UnitDependency d, UnitDependency e, Unit *other, bool add_reference) {
         int r;
 
@@ -1963,6 +2084,18 @@ int unit_add_cgroup(Unit *u, CGroupBonding *b) {
                         LIST_REMOVE(CGroupBonding, by_path, l, b);
                         return r;
                 }
+
+                r = cgroup_bonding_index(u->manager, b->path, l);
+                if (r < 0) {
+                        LIST_REMOVE(CGroupBonding, by_path, l, b);
+
+                        if (l)
+                                hashmap_replace(u->manager->cgroup_bondings, b->path, l);
+                        else
+                                hashmap_remove(u->manager->cgroup_bondings, b->path);
+
+                        return r;
+                }
         }
 
         LIST_PREPEND(CGroupBonding, by_unit, u->cgroup_bondings, b);
@@ -2320,27 +2453,34 @@ int unit_serialize(Unit *u, FILE *f, FDSet *fds, bool serialize_jobs) {
 
         if (serialize_jobs) {
                 if (u->job) {
-                        fprintf(f, "job\n");
+                        serialize_item(f, "job", "");
                         job_serialize(u->job, f, fds);
                 }
 
                 if (u->nop_job) {
-                        fprintf(f, "job\n");
+                        serialize_item(f, "job", "");
                         job_serialize(u->nop_job, f, fds);
                 }
         }
 
-        dual_timestamp_serialize(f, "inactive-exit-timestamp", &u->inactive_exit_timestamp);
-        dual_timestamp_serialize(f, "active-enter-timestamp", &u->active_enter_timestamp);
-        dual_timestamp_serialize(f, "active-exit-timestamp", &u->active_exit_timestamp);
-        dual_timestamp_serialize(f, "inactive-enter-timestamp", &u->inactive_enter_timestamp);
-        dual_timestamp_serialize(f, "condition-timestamp", &u->condition_timestamp);
+        serialize_dual_timestamp(f, "inactive-exit-timestamp", &u->inactive_exit_timestamp);
+        serialize_dual_timestamp(f, "active-enter-timestamp", &u->active_enter_timestamp);
+        serialize_dual_timestamp(f, "active-exit-timestamp", &u->active_exit_timestamp);
+        serialize_dual_timestamp(f, "inactive-enter-timestamp", &u->inactive_enter_timestamp);
+        serialize_dual_timestamp(f, "condition-timestamp", &u->condition_timestamp);
+        serialize_dual_timestamp(f, "job-enqueue-timestamp", &u->job_enqueue_timestamp);
+        serialize_dual_timestamp(f, "job-start-timestamp", &u->job_start_timestamp);
+        serialize_dual_timestamp(f, "exec-timestamp", &u->exec_timestamp);
+        serialize_dual_timestamp(f, "ready-timestamp", &u->ready_timestamp);
+
+        if (u->blocked_by)
+                unit_serialize_item(u, f, "blocked-by", u->blocked_by);
 
         if (dual_timestamp_is_set(&u->condition_timestamp))
                 unit_serialize_item(u, f, "condition-result", yes_no(u->condition_result));
 
         /* End marker */
-        fputc('\n', f);
+        serialize_end(f);
         return 0;
 }
 
@@ -2352,14 +2492,9 @@ void unit_serialize_item_format(Unit *u, FILE *f, const char *key, const char *f
         assert(key);
         assert(format);
 
-        fputs(key, f);
-        fputc('=', f);
-
         va_start(ap, format);
-        vfprintf(f, format, ap);
+        serialize_item_formatv(f, key, format, ap);
         va_end(ap);
-
-        fputc('\n', f);
 }
 
 void unit_serialize_item(Unit *u, FILE *f, const char *key, const char *value) {
@@ -2368,43 +2503,26 @@ void unit_serialize_item(Unit *u, FILE *f, const char *key, const char *value) {
         assert(key);
         assert(value);
 
-        fprintf(f, "%s=%s\n", key, value);
+        serialize_item(f, key, value);
 }
 
-int unit_deserialize(Unit *u, FILE *f, FDSet *fds) {
+int unit_deserialize(Unit *u, Deserializer *d, FDSet *fds) {
         int r;
 
         assert(u);
-        assert(f);
+        assert(d);
         assert(fds);
 
         if (!unit_can_serialize(u))
                 return 0;
 
         for (;;) {
-                char line[LINE_MAX], *l, *v;
-                size_t k;
-
-                if (!fgets(line, sizeof(line), f)) {
-                        if (feof(f))
-                                return 0;
-                        return -errno;
-                }
-
-                char_array_0(line);
-                l = strstrip(line);
+                char *l, *v;
 
                 /* End marker */
-                if (l[0] == 0)
-                        return 0;
-
-                k = strcspn(l, "=");
-
-                if (l[k] == '=') {
-                        l[k] = 0;
-                        v = l+k+1;
-                } else
-                        v = l+k;
+                r = deserializer_next(d, &l, &v);
+                if (r <= 0)
+                        return r;
 
                 if (streq(l, "job")) {
                         if (v[0] == '\0') {
@@ -2413,7 +2531,7 @@ int unit_deserialize(Unit *u, FILE *f, FDSet *fds) {
                                 if (!j)
                                         return -ENOMEM;
 
-                                r = job_deserialize(j, f, fds);
+                                r = job_deserialize(j, d, fds);
                                 if (r < 0) {
                                         job_free(j);
                                         return r;
@@ -2455,6 +2573,28 @@ int unit_deserialize(Unit *u, FILE *f, FDSet *fds) {
                 } else if (streq(l, "condition-timestamp")) {
                         dual_timestamp_deserialize(v, &u->condition_timestamp);
                         continue;
+                } else if (streq(l, "job-enqueue-timestamp")) {
+                        dual_timestamp_deserialize(v, &u->job_enqueue_timestamp);
+                        continue;
+                } else if (streq(l, "job-start-timestamp")) {
+                        dual_timestamp_deserialize(v, &u->job_start_timestamp);
+                        continue;
+                } else if (streq(l, "exec-timestamp")) {
+                        dual_timestamp_deserialize(v, &u->exec_timestamp);
+                        continue;
+                } else if (streq(l, "ready-timestamp")) {
+                        dual_timestamp_deserialize(v, &u->ready_timestamp);
+                        continue;
+                } else if (streq(l, "blocked-by")) {
+                        char *b;
+
+                        b = strdup(v);
+                        if (!b)
+                                return -ENOMEM;
+
+                        free(u->blocked_by);
+                        u->blocked_by = b;
+                        continue;
                 } else if (streq(l, "condition-result")) {
                         int b;
 
@@ -2576,6 +2716,29 @@ bool unit_need_daemon_reload(Unit *u) {
                         return true;
         }
 
+        if (u->dropin_paths) {
+                usec_t mtime = 0;
+                char **p;
+
+                /* Drop-in directories change their mtime when
+                 * snippets are added or removed, and the snippets
+                 * when they are edited, hence comparing the newest
+                 * mtime is sufficient. */
+                STRV_FOREACH(p, u->dropin_paths) {
+                        zero(st);
+                        if (stat(*p, &st) < 0)
+                                return true;
+
+                        mtime = MAX(mtime, timespec_load(&st.st_mtim));
+                }
+
+                if (mtime != u->dropin_mtime)
+                        return true;
+        }
+
+        if (unit_dropin_added(u))
+                return true;
+
         return false;
 }
 
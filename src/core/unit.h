@@ -40,6 +40,7 @@ typedef struct UnitStatusMessageFormats UnitStatusMessageFormats;
 #include "condition.h"
 #include "install.h"
 #include "unit-name.h"
+#include "serialize.h"
 
 enum UnitActiveState {
         UNIT_ACTIVE,
@@ -117,6 +118,30 @@ enum UnitDependency {
 #include "cgroup.h"
 #include "cgroup-attr.h"
 
+typedef struct UnitBusState {
+        /* The values of the generic invalidating properties we last
+         * announced on the bus */
+        UnitLoadState load_state;
+        UnitActiveState active_state;
+        const char *sub_state;
+        usec_t inactive_exit_timestamp;
+        usec_t active_enter_timestamp;
+        usec_t active_exit_timestamp;
+        usec_t inactive_enter_timestamp;
+        uint32_t job_id;
+        /* Only updated when a signal is sent */
+        bool need_daemon_reload;
+} UnitBusState;
+
+struct UnitRef {
+        /* Keeps tracks of references to a unit. This is useful so
+         * that we can merge two units if necessary and correct all
+         * references to them */
+
+        Unit* unit;
+        LIST_FIELDS(UnitRef, refs);
+};
+
 struct Unit {
         Manager *manager;
 
@@ -130,6 +155,17 @@ struct Unit {
         Set *names;
         Set *dependencies[_UNIT_DEPENDENCY_MAX];
 
+        /* Dense index of this unit in the manager's units_by_dense_id
+         * array, stays within [0, n_units_by_dense_id) */
+        unsigned dense_id;
+
+        /* Flattened copy of dependencies[], with the units of
+         * dependency type d at dependency_array[dependency_offset[d]]
+         * up to dependency_array[dependency_offset[d+1]]. Rebuilt
+         * lazily after the dependencies changed. */
+        Unit **dependency_array;
+        unsigned dependency_offset[_UNIT_DEPENDENCY_MAX + 1];
+
         char **requires_mounts_for;
 
         char *description;
@@ -140,6 +176,11 @@ struct Unit {
         usec_t fragment_mtime;
         usec_t source_mtime;
 
+        /* drop-in directories and snippets this was loaded from, and
+         * the newest mtime among them */
+        char **dropin_paths;
+        usec_t dropin_mtime;
+
         /* If there is something to do with this unit, then this is the installed job for it */
         Job *job;
 
@@ -161,10 +202,24 @@ struct Unit {
         dual_timestamp active_exit_timestamp;
         dual_timestamp inactive_enter_timestamp;
 
+        /* Profiling data of the last activation: when the job was
+         * enqueued and started, when the main process was spawned
+         * and signalled readiness, and the unit whose job was the
+         * last one we had to wait for due to ordering */
+        dual_timestamp job_enqueue_timestamp;
+        dual_timestamp job_start_timestamp;
+        dual_timestamp exec_timestamp;
+        dual_timestamp ready_timestamp;
+        char *blocked_by;
+
         /* Counterparts in the cgroup filesystem */
         CGroupBonding *cgroup_bondings;
         CGroupAttribute *cgroup_attributes;
 
+        /* So that change signals only list properties that
+         * actually changed */
+        UnitBusState bus_state;
+
         /* Per type list */
         LIST_FIELDS(Unit, units_by_type);
 
@@ -235,15 +290,8 @@ struct Unit {
         bool no_gc:1;
 
         bool in_audit:1;
-};
 
-struct UnitRef {
-        /* Keeps tracks of references to a unit. This is useful so
-         * that we can merge two units if necessary and correct all
-         * references to them */
-
-        Unit* unit;
-        LIST_FIELDS(UnitRef, refs);
+        bool dependency_array_dirty:1;
 };
 
 struct UnitStatusMessageFormats {
@@ -346,7 +394,9 @@ struct UnitVTable {
          * ran empty */
         void (*cgroup_notify_empty)(Unit *u);
 
-        /* Called whenever a process of this unit sends us a message */
+        /* Called whenever a process of this unit sends us a
+         * message. The tags point into the receive buffer and are
+         * only valid during the call. */
         void (*notify_message)(Unit *u, pid_t pid, char **tags);
 
         /* Called whenever a name thus Unit registered for comes or
@@ -359,6 +409,10 @@ struct UnitVTable {
         /* Called for each message received on the bus */
         DBusHandlerResult (*bus_message_handler)(Unit *u, DBusConnection *c, DBusMessage *message);
 
+        /* Appends all properties of the unit, or only the listed
+         * ones, as a{sv} dictionary */
+        int (*bus_append_properties)(Unit *u, DBusMessageIter *i, char **properties);
+
         /* Return the unit this unit is following */
         Unit *(*following)(Unit *u);
 
@@ -431,6 +485,7 @@ void unit_free(Unit *u);
 int unit_add_name(Unit *u, const char *name);
 
 int unit_add_dependency(Unit *u, UnitDependency d, Unit *other, bool add_reference);
+int unit_get_dependency_array(Unit *u, UnitDependency d, Unit ***deps, unsigned *n);
 int unit_add_two_dependencies(Unit *u, UnitDependency d, UnitDependency e, Unit *other, bool add_reference);
 
 int unit_add_dependency_by_name(Unit *u, UnitDependency d, const char *name, const char *filename, bool add_reference);
@@ -513,7 +568,7 @@ bool unit_can_serialize(Unit *u);
 int unit_serialize(Unit *u, FILE *f, FDSet *fds, bool serialize_jobs);
 void unit_serialize_item_format(Unit *u, FILE *f, const char *key, const char *value, ...) _printf_attr_(4,5);
 void unit_serialize_item(Unit *u, FILE *f, const char *key, const char *value);
-int unit_deserialize(Unit *u, FILE *f, FDSet *fds);
+int unit_deserialize(Unit *u, Deserializer *d, FDSet *fds);
 
 int unit_add_node_link(Unit *u, const char *what, bool wants);
 
@@ -547,6 +602,9 @@ void unit_ref_unset(UnitRef *ref);
 
 #define UNIT_DEREF(ref) ((ref).unit)
 
+#define DEPENDENCY_ARRAY_FOREACH(other, deps, n, k)                     \
+        for ((k) = 0; (k) < (n) && ((other) = (deps)[(k)], true); (k)++)
+
 int unit_add_one_mount_link(Unit *u, Mount *m);
 int unit_add_mount_links(Unit *u);
 
@@ -0,0 +1,116 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#ifndef _LIBUDEV_DB_DEF_H_
+#define _LIBUDEV_DB_DEF_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "macro.h"
+#include "time-util.h"
+
+/*
+ * Snapshot of the device database in /run/udev/data, written by udevd
+ * when the event queue is idle. Every write to the database replaces or
+ * removes a file in /run/udev/data, so the snapshot is current as long as
+ * the directory has the timestamp recorded in the snapshot. The file
+ * lives in /run only, and uses the native byte order.
+ */
+#define UDEV_DB_SIG { 'U', 'D', 'E', 'V', 'D', 'A', 'T', 'A' }
+
+struct udev_db_header_f {
+        uint8_t signature[8];
+
+        /* version of tool which created the file */
+        uint64_t tool_version;
+        uint64_t file_size;
+
+        /* size of structures, to detect a different layout */
+        uint64_t header_size;
+        uint64_t device_size;
+        uint64_t index_entry_size;
+
+        /* modification time of /run/udev/data the snapshot was taken from */
+        uint64_t data_usec;
+        /* time the reading of /run/udev/data started */
+        uint64_t scan_usec;
+
+        /* devices, sorted by their database id */
+        uint64_t devices_off;
+        uint64_t devices_count;
+
+        /* string offsets of the devlinks, tags and properties of the devices */
+        uint64_t items_off;
+        uint64_t items_count;
+
+        /* (tag, device) pairs, sorted by tag and device */
+        uint64_t tags_off;
+        uint64_t tags_count;
+
+        uint64_t strings_off;
+        uint64_t strings_len;
+} _packed_;
+
+struct udev_db_device_f {
+        uint64_t id_off;
+        uint64_t devpath_off;
+        uint64_t subsystem_off;
+        uint64_t usec_initialized;
+        int64_t devlink_priority;
+        int64_t watch_handle;
+
+        /* the devlinks, the tags, then name and value of every property */
+        uint64_t items_first;
+        uint32_t devlinks_count;
+        uint32_t tags_count;
+        uint32_t properties_count;
+        uint32_t padding;
+} _packed_;
+
+struct udev_db_index_entry_f {
+        uint64_t key_off;
+        uint64_t device;
+} _packed_;
+
+/*
+ * A file written within the same tick of the file system timestamps as
+ * the snapshot was taken leaves the mtime of /run/udev/data unchanged.
+ * A snapshot is only trusted if the mtime is at least one tick older
+ * than the time it was taken.
+ */
+static inline uint64_t udev_db_tick(uint64_t usec)
+{
+        long hz;
+
+        /* file systems which store whole seconds only */
+        if (usec % USEC_PER_SEC == 0)
+                return USEC_PER_SEC;
+
+        hz = sysconf(_SC_CLK_TCK);
+        if (hz <= 0)
+                return USEC_PER_SEC;
+        return USEC_PER_SEC / hz;
+}
+
+static inline bool udev_db_racy(uint64_t data_usec, uint64_t scan_usec)
+{
+        return data_usec + udev_db_tick(data_usec) > scan_usec;
+}
+
+#endif
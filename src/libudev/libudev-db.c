@@ -0,0 +1,254 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libudev.h"
+#include "libudev-private.h"
+#include "libudev-db-def.h"
+
+/*
+ * Read access to the database snapshot. The snapshot is replaced by
+ * rename(), so a mapped file never changes. Before every use we check
+ * that the database did not change since the snapshot was taken, and
+ * look for a new snapshot if it did.
+ */
+struct udev_db {
+        struct stat st;
+        union {
+                const struct udev_db_header_f *head;
+                const char *map;
+        };
+};
+
+static const struct udev_db_device_f *db_device(const struct udev_db *db, uint64_t i)
+{
+        return (const struct udev_db_device_f *)(db->map + db->head->devices_off) + i;
+}
+
+/* the last byte of the strings is checked to be '\0' in db_open(), an invalid offset gives "" */
+static const char *db_string(const struct udev_db *db, uint64_t off)
+{
+        if (off >= db->head->strings_len)
+                off = db->head->strings_len - 1;
+        return db->map + db->head->strings_off + off;
+}
+
+static const char *db_item(const struct udev_db *db, uint64_t i)
+{
+        return db_string(db, ((const uint64_t *)(db->map + db->head->items_off))[i]);
+}
+
+static bool section_valid(const struct udev_db *db, uint64_t off, uint64_t count, uint64_t size)
+{
+        return off <= (uint64_t)db->st.st_size &&
+               count <= ((uint64_t)db->st.st_size - off) / size;
+}
+
+static struct udev_db *db_open(struct udev *udev)
+{
+        const char sig[] = UDEV_DB_SIG;
+        struct udev_db *db;
+        int fd;
+
+        db = calloc(1, sizeof(struct udev_db));
+        if (db == NULL)
+                return NULL;
+
+        fd = open(UDEV_DB_BIN, O_RDONLY|O_CLOEXEC);
+        if (fd < 0)
+                goto err;
+
+        if (fstat(fd, &db->st) < 0 || (size_t)db->st.st_size < sizeof(struct udev_db_header_f)) {
+                close(fd);
+                goto err;
+        }
+
+        db->map = mmap(NULL, db->st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (db->map == MAP_FAILED) {
+                db->map = NULL;
+                goto err;
+        }
+
+        if (memcmp(db->head->signature, sig, sizeof(db->head->signature)) != 0 ||
+            db->head->file_size != (uint64_t)db->st.st_size ||
+            db->head->header_size != sizeof(struct udev_db_header_f) ||
+            db->head->device_size != sizeof(struct udev_db_device_f) ||
+            db->head->index_entry_size != sizeof(struct udev_db_index_entry_f) ||
+            !section_valid(db, db->head->devices_off, db->head->devices_count, sizeof(struct udev_db_device_f)) ||
+            !section_valid(db, db->head->items_off, db->head->items_count, sizeof(uint64_t)) ||
+            !section_valid(db, db->head->tags_off, db->head->tags_count, sizeof(struct udev_db_index_entry_f)) ||
+            !section_valid(db, db->head->strings_off, db->head->strings_len, 1) ||
+            db->head->strings_len == 0 ||
+            db_string(db, db->head->strings_len - 1)[0] != '\0') {
+                udev_dbg(udev, "invalid database snapshot '%s'\n", UDEV_DB_BIN);
+                /* remember the file, but do not use it */
+                munmap((void *)db->map, db->st.st_size);
+                db->map = NULL;
+        }
+
+        return db;
+err:
+        udev_db_free(db);
+        return NULL;
+}
+
+void udev_db_free(struct udev_db *db)
+{
+        if (db == NULL)
+                return;
+        if (db->map != NULL)
+                munmap((void *)db->map, db->st.st_size);
+        free(db);
+}
+
+static bool db_is_current(const struct udev_db *db, const struct stat *st_data)
+{
+        return db->map != NULL &&
+               db->head->data_usec == timespec_load(&st_data->st_mtim) &&
+               !udev_db_racy(db->head->data_usec, db->head->scan_usec);
+}
+
+/* update *db to the current snapshot, returns NULL if there is none */
+struct udev_db *udev_db_refresh(struct udev *udev, struct udev_db **db)
+{
+        struct stat st_data, st;
+
+        if (stat("/run/udev/data", &st_data) < 0)
+                goto outdated;
+
+        if (*db != NULL && db_is_current(*db, &st_data))
+                return *db;
+
+        if (stat(UDEV_DB_BIN, &st) < 0)
+                goto outdated;
+
+        /* the file we already know about is outdated, until udevd replaces it */
+        if (*db != NULL &&
+            (*db)->st.st_dev == st.st_dev &&
+            (*db)->st.st_ino == st.st_ino &&
+            (*db)->st.st_mtim.tv_sec == st.st_mtim.tv_sec &&
+            (*db)->st.st_mtim.tv_nsec == st.st_mtim.tv_nsec)
+                return NULL;
+
+        udev_db_free(*db);
+        *db = db_open(udev);
+        if (*db != NULL && db_is_current(*db, &st_data))
+                return *db;
+        return NULL;
+
+outdated:
+        udev_db_free(*db);
+        *db = NULL;
+        return NULL;
+}
+
+static const struct udev_db_device_f *db_find_device(const struct udev_db *db, const char *id)
+{
+        uint64_t first = 0, last = db->head->devices_count;
+
+        while (first < last) {
+                uint64_t i = (first + last) / 2;
+                int cmp;
+
+                cmp = strcmp(id, db_string(db, db_device(db, i)->id_off));
+                if (cmp < 0)
+                        last = i;
+                else if (cmp > 0)
+                        first = i + 1;
+                else
+                        return db_device(db, i);
+        }
+        return NULL;
+}
+
+/* fill in the database entry of a device, the same way udev_device_read_db() does */
+int udev_db_read_device(struct udev_db *db, struct udev_device *udev_device, const char *id)
+{
+        const struct udev_db_device_f *d;
+        uint64_t item;
+        uint32_t i;
+
+        d = db_find_device(db, id);
+        if (d == NULL)
+                return -ENOENT;
+        if (d->items_first + d->devlinks_count + d->tags_count + 2 * (uint64_t)d->properties_count > db->head->items_count)
+                return -EINVAL;
+
+        udev_device_set_is_initialized(udev_device);
+
+        item = d->items_first;
+        for (i = 0; i < d->devlinks_count; i++)
+                udev_device_add_devlink(udev_device, db_item(db, item++));
+        for (i = 0; i < d->tags_count; i++)
+                udev_device_add_tag(udev_device, db_item(db, item++));
+        for (i = 0; i < d->properties_count; i++) {
+                struct udev_list_entry *entry;
+
+                entry = udev_device_add_property(udev_device, db_item(db, item), db_item(db, item + 1));
+                udev_list_entry_set_num(entry, true);
+                item += 2;
+        }
+
+        if (d->devlink_priority != 0)
+                udev_device_set_devlink_priority(udev_device, d->devlink_priority);
+        if (d->watch_handle >= 0)
+                udev_device_set_watch_handle(udev_device, d->watch_handle);
+        if (d->usec_initialized > 0)
+                udev_device_set_usec_initialized(udev_device, d->usec_initialized);
+        return 0;
+}
+
+/* add the devpaths of all devices with the tag to the list, with their subsystem as value */
+int udev_db_get_tag_devices(struct udev_db *db, const char *tag, struct udev_list *list)
+{
+        const struct udev_db_index_entry_f *tags;
+        uint64_t first = 0, last = db->head->tags_count;
+        int n = 0;
+
+        tags = (const struct udev_db_index_entry_f *)(db->map + db->head->tags_off);
+
+        /* find the first entry of the tag */
+        while (first < last) {
+                uint64_t i = (first + last) / 2;
+
+                if (strcmp(db_string(db, tags[i].key_off), tag) < 0)
+                        first = i + 1;
+                else
+                        last = i;
+        }
+
+        for (; first < db->head->tags_count && streq(db_string(db, tags[first].key_off), tag); first++) {
+                const struct udev_db_device_f *d;
+
+                if (tags[first].device >= db->head->devices_count)
+                        return -EINVAL;
+                d = db_device(db, tags[first].device);
+                if (udev_list_entry_add(list, db_string(db, d->devpath_off), db_string(db, d->subsystem_off)) == NULL)
+                        return -ENOMEM;
+                n++;
+        }
+        return n;
+}
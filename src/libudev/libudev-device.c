@@ -512,6 +512,7 @@ _public_ const char *udev_device_get_property_value(struct udev_device *udev_dev
 
 int udev_device_read_db(struct udev_device *udev_device, const char *dbfile)
 {
+        struct udev_db *db;
         char filename[UTIL_PATH_SIZE];
         char line[UTIL_LINE_SIZE];
         FILE *f;
@@ -527,6 +528,18 @@ int udev_device_read_db(struct udev_device *udev_device, const char *dbfile)
                 id = udev_device_get_id_filename(udev_device);
                 if (id == NULL)
                         return -1;
+
+                /* use the snapshot of the whole database, if it is current */
+                db = udev_get_db(udev_device->udev);
+                if (db != NULL) {
+                        if (udev_db_read_device(db, udev_device, id) < 0) {
+                                udev_dbg(udev_device->udev, "no db entry for '%s'\n", id);
+                                return -1;
+                        }
+                        udev_dbg(udev_device->udev, "device %p filled with db snapshot data\n", udev_device);
+                        return 0;
+                }
+
                 strscpyl(filename, sizeof(filename), "/run/udev/data/", id, NULL);
                 dbfile = filename;
         }
@@ -1376,7 +1389,8 @@ _public_ const char *udev_device_get_sysattr_value(struct udev_device *udev_devi
 
         strscpyl(path, sizeof(path), udev_device_get_syspath(udev_device), "/", sysattr, NULL);
         if (lstat(path, &statbuf) != 0) {
-                udev_list_entry_add(&udev_device->sysattr_value_list, sysattr, NULL);
+                if (errno == ENOENT)
+                        goto missing;
                 goto out;
         }
 
@@ -1392,7 +1406,7 @@ _public_ const char *udev_device_get_sysattr_value(struct udev_device *udev_devi
                     streq(sysattr, "module")) {
                         if (util_get_sys_core_link_value(udev_device->udev, sysattr,
                                                          udev_device->syspath, value, sizeof(value)) < 0)
-                                return NULL;
+                                goto out;
                         list_entry = udev_list_entry_add(&udev_device->sysattr_value_list, sysattr, value);
                         val = udev_list_entry_get_value(list_entry);
                         goto out;
@@ -1414,11 +1428,11 @@ _public_ const char *udev_device_get_sysattr_value(struct udev_device *udev_devi
 
         /* skip directories */
         if (S_ISDIR(statbuf.st_mode))
-                goto out;
+                goto missing;
 
         /* skip non-readable files */
         if ((statbuf.st_mode & S_IRUSR) == 0)
-                goto out;
+                goto missing;
 
         /* read attribute value */
         fd = open(path, O_RDONLY|O_CLOEXEC);
@@ -1438,6 +1452,14 @@ _public_ const char *udev_device_get_sysattr_value(struct udev_device *udev_devi
         val = udev_list_entry_get_value(list_entry);
 out:
         return val;
+missing:
+        /*
+         * Remember missing attributes, directories and non-readable files, to not
+         * look them up again. Failing to open or read an attribute might be a
+         * transient error, the next call tries again.
+         */
+        udev_list_entry_add(&udev_device->sysattr_value_list, sysattr, NULL);
+        return NULL;
 }
 
 static int udev_device_sysattr_list_read(struct udev_device *udev_device)
@@ -1456,18 +1478,19 @@ static int udev_device_sysattr_list_read(struct udev_device *udev_device)
                 return -1;
 
         for (dent = readdir(dir); dent != NULL; dent = readdir(dir)) {
-                char path[UTIL_PATH_SIZE];
                 struct stat statbuf;
 
                 /* only handle symlinks and regular files */
                 if (dent->d_type != DT_LNK && dent->d_type != DT_REG)
                         continue;
 
-                strscpyl(path, sizeof(path), udev_device_get_syspath(udev_device), "/", dent->d_name, NULL);
-                if (lstat(path, &statbuf) != 0)
-                        continue;
-                if ((statbuf.st_mode & S_IRUSR) == 0)
-                        continue;
+                /* symlinks are always readable, skip write-only files */
+                if (dent->d_type == DT_REG) {
+                        if (fstatat(dirfd(dir), dent->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) != 0)
+                                continue;
+                        if ((statbuf.st_mode & S_IRUSR) == 0)
+                                continue;
+                }
 
                 udev_list_entry_add(&udev_device->sysattr_list, dent->d_name, NULL);
                 num++;
@@ -779,9 +779,51 @@ _public_ int udev_enumerate_add_syspath(struct udev_enumerate *udev_enumerate, c
         return 0;
 }
 
+/* look up the tagged devices in the snapshot of the database */
+static void scan_db_tag(struct udev_enumerate *udev_enumerate, struct udev_db *db, const char *tag)
+{
+        struct udev_list devices;
+        struct udev_list_entry *list_entry;
+
+        udev_list_init(udev_enumerate->udev, &devices, false);
+        udev_db_get_tag_devices(db, tag, &devices);
+
+        udev_list_entry_foreach(list_entry, udev_list_get_entry(&devices)) {
+                char syspath[UTIL_PATH_SIZE];
+                struct udev_device *dev;
+
+                /* the database knows the subsystem, skip other devices without looking at /sys */
+                if (!match_subsystem(udev_enumerate, udev_list_entry_get_value(list_entry)))
+                        continue;
+
+                strscpyl(syspath, sizeof(syspath), "/sys", udev_list_entry_get_name(list_entry), NULL);
+                dev = udev_device_new_from_syspath(udev_enumerate->udev, syspath);
+                if (dev == NULL)
+                        continue;
+
+                if (!match_sysname(udev_enumerate, udev_device_get_sysname(dev)))
+                        goto nomatch;
+                if (!match_parent(udev_enumerate, dev))
+                        goto nomatch;
+                if (!match_property(udev_enumerate, dev))
+                        goto nomatch;
+                if (!match_sysattr(udev_enumerate, dev))
+                        goto nomatch;
+
+                syspath_add(udev_enumerate, udev_device_get_syspath(dev));
+nomatch:
+                udev_device_unref(dev);
+        }
+
+        udev_list_cleanup(&devices);
+}
+
 static int scan_devices_tags(struct udev_enumerate *udev_enumerate)
 {
         struct udev_list_entry *list_entry;
+        struct udev_db *db;
+
+        db = udev_get_db(udev_enumerate->udev);
 
         /* scan only tagged devices, use tags reverse-index, instead of searching all devices in /sys */
         udev_list_entry_foreach(list_entry, udev_list_get_entry(&udev_enumerate->tags_match_list)) {
@@ -789,6 +831,11 @@ static int scan_devices_tags(struct udev_enumerate *udev_enumerate)
                 struct dirent *dent;
                 char path[UTIL_PATH_SIZE];
 
+                if (db != NULL) {
+                        scan_db_tag(udev_enumerate, db, udev_list_entry_get_name(list_entry));
+                        continue;
+                }
+
                 strscpyl(path, sizeof(path), "/run/udev/tags/", udev_list_entry_get_name(list_entry), NULL);
                 dir = opendir(path);
                 if (dir == NULL)
@@ -26,6 +26,7 @@
 
 #include "libudev.h"
 #include "libudev-private.h"
+#include "hashmap.h"
 
 /**
  * SECTION:libudev-list
@@ -46,6 +47,7 @@ struct udev_list_entry {
         char *name;
         char *value;
         int num;
+        unsigned int hash;
 };
 
 /* the list's head points to itself if empty */
@@ -141,17 +143,75 @@ static int list_search(struct udev_list *list, const char *name)
         return -(first+1);
 }
 
+/*
+ * Unique lists are kept sorted by name, and have a hash index with open
+ * addressing and linear probing for the lookups. The index is at most
+ * half full, so a lookup rarely compares more than one name.
+ */
+static struct udev_list_entry **index_slot(struct udev_list *list, const char *name, unsigned int hash)
+{
+        unsigned int mask = list->index_size - 1;
+        unsigned int i;
+
+        for (i = hash & mask; list->index[i] != NULL; i = (i + 1) & mask)
+                if (list->index[i]->hash == hash && streq(list->index[i]->name, name))
+                        break;
+
+        /* the slot of the entry, or the free slot to store it */
+        return &list->index[i];
+}
+
+static int index_grow(struct udev_list *list)
+{
+        struct udev_list_entry **index;
+        unsigned int size, i;
+
+        size = list->index_size > 0 ? list->index_size * 2 : 64;
+        index = calloc(size, sizeof(struct udev_list_entry *));
+        if (index == NULL)
+                return -ENOMEM;
+
+        free(list->index);
+        list->index = index;
+        list->index_size = size;
+        for (i = 0; i < list->entries_cur; i++)
+                *index_slot(list, list->entries[i]->name, list->entries[i]->hash) = list->entries[i];
+        return 0;
+}
+
+static void index_remove(struct udev_list *list, struct udev_list_entry *entry)
+{
+        unsigned int mask = list->index_size - 1;
+        unsigned int i, j;
+
+        i = index_slot(list, entry->name, entry->hash) - list->index;
+        if (list->index[i] != entry)
+                return;
+
+        /* move entries of the same probe sequence into the gap */
+        for (j = (i + 1) & mask; list->index[j] != NULL; j = (j + 1) & mask) {
+                unsigned int home = list->index[j]->hash & mask;
+
+                if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+                        list->index[i] = list->index[j];
+                        i = j;
+                }
+        }
+        list->index[i] = NULL;
+}
+
 struct udev_list_entry *udev_list_entry_add(struct udev_list *list, const char *name, const char *value)
 {
         struct udev_list_entry *entry;
+        unsigned int hash = 0;
         int i = 0;
 
         if (list->unique) {
-                /* lookup existing name or insertion-index */
-                i = list_search(list, name);
-                if (i >= 0) {
-                        entry = list->entries[i];
+                hash = string_hash_func(name);
 
+                /* lookup existing name */
+                entry = list->index != NULL ? *index_slot(list, name, hash) : NULL;
+                if (entry != NULL) {
                         free(entry->value);
                         if (value == NULL) {
                                 entry->value = NULL;
@@ -162,6 +222,13 @@ struct udev_list_entry *udev_list_entry_add(struct udev_list *list, const char *
                                 return NULL;
                         return entry;
                 }
+
+                /* keep the index at most half full */
+                if ((list->entries_cur + 1) * 2 > list->index_size && index_grow(list) < 0)
+                        return NULL;
+
+                /* lookup insertion-index */
+                i = list_search(list, name);
         }
 
         /* add new name */
@@ -182,6 +249,8 @@ struct udev_list_entry *udev_list_entry_add(struct udev_list *list, const char *
                 }
         }
 
+        entry->hash = hash;
+
         if (list->unique) {
                 /* allocate or enlarge sorted array if needed */
                 if (list->entries_cur >= list->entries_max) {
@@ -216,6 +285,8 @@ struct udev_list_entry *udev_list_entry_add(struct udev_list *list, const char *
                         (list->entries_cur - i) * sizeof(struct udev_list_entry *));
                 list->entries[i] = entry;
                 list->entries_cur++;
+
+                *index_slot(list, name, hash) = entry;
         } else {
                 udev_list_entry_append(entry, list);
         }
@@ -238,6 +309,9 @@ void udev_list_entry_delete(struct udev_list_entry *entry)
                 }
         }
 
+        if (entry->list->index != NULL)
+                index_remove(entry->list, entry);
+
         udev_list_node_remove(&entry->node);
         free(entry->name);
         free(entry->value);
@@ -253,6 +327,9 @@ void udev_list_cleanup(struct udev_list *list)
         list->entries = NULL;
         list->entries_cur = 0;
         list->entries_max = 0;
+        free(list->index);
+        list->index = NULL;
+        list->index_size = 0;
         udev_list_entry_foreach_safe(entry_loop, entry_tmp, udev_list_get_entry(list))
                 udev_list_entry_delete(entry_loop);
 }
@@ -296,18 +373,16 @@ _public_ struct udev_list_entry *udev_list_entry_get_next(struct udev_list_entry
  */
 _public_ struct udev_list_entry *udev_list_entry_get_by_name(struct udev_list_entry *list_entry, const char *name)
 {
-        int i;
+        struct udev_list *list;
 
         if (list_entry == NULL)
                 return NULL;
 
-        if (!list_entry->list->unique)
+        list = list_entry->list;
+        if (!list->unique || list->index == NULL)
                 return NULL;
 
-        i = list_search(list_entry->list, name);
-        if (i < 0)
-                return NULL;
-        return list_entry->list->entries[i];
+        return *index_slot(list, name, string_hash_func(name));
 }
 
 /**
@@ -58,6 +58,7 @@ struct udev_monitor {
         socklen_t addrlen;
         struct udev_list filter_subsystem_list;
         struct udev_list filter_tag_list;
+        struct udev_list filter_property_list;
         bool bound;
 };
 
@@ -89,6 +90,52 @@ struct udev_monitor_netlink_header {
         unsigned int filter_devtype_hash;
         unsigned int filter_tag_bloom_hi;
         unsigned int filter_tag_bloom_lo;
+        /* bloom filter of the "KEY=VALUE" property strings; needs to be stored in network order */
+        unsigned int filter_property_bloom[8];
+};
+
+#define UDEV_MONITOR_BUF_SIZE                8192
+#define UDEV_MONITOR_BATCH_SIZE                32
+
+/**
+ * udev_monitor_event:
+ *
+ * Opaque object referencing a received event. The properties are read
+ * directly from the received message.
+ */
+struct udev_monitor_event {
+        struct udev_monitor *udev_monitor;
+        const char *properties;
+        const char *properties_end;
+        const char *action;
+        const char *devpath;
+        const char *subsystem;
+        const char *devtype;
+        const char *seqnum;
+        const char *tags;
+};
+
+union cred_msg {
+        struct cmsghdr cmsghdr;
+        char buf[CMSG_SPACE(sizeof(struct ucred))];
+};
+
+/**
+ * udev_monitor_batch:
+ *
+ * Opaque object holding the buffers to receive a number of events at once.
+ */
+struct udev_monitor_batch {
+        struct udev_monitor *udev_monitor;
+        int refcount;
+        unsigned int size;
+        unsigned int count;
+        struct mmsghdr *msgs;
+        struct iovec *iovs;
+        union sockaddr_union *addrs;
+        union cred_msg *creds;
+        char *bufs;
+        struct udev_monitor_event *events;
 };
 
 static struct udev_monitor *udev_monitor_new(struct udev *udev)
@@ -102,6 +149,7 @@ static struct udev_monitor *udev_monitor_new(struct udev *udev)
         udev_monitor->udev = udev;
         udev_list_init(udev, &udev_monitor->filter_subsystem_list, false);
         udev_list_init(udev, &udev_monitor->filter_tag_list, true);
+        udev_list_init(udev, &udev_monitor->filter_property_list, false);
         return udev_monitor;
 }
 
@@ -175,6 +223,41 @@ _public_ struct udev_monitor *udev_monitor_new_from_netlink(struct udev *udev, c
         return udev_monitor_new_from_netlink_fd(udev, name, -1);
 }
 
+/* set four of the 256 bits, taken from the hash of the string */
+static void property_bloom256(const char *str, unsigned int bloom[8])
+{
+        unsigned int hash = util_string_hash32(str);
+        unsigned int i;
+
+        for (i = 0; i < 4; i++) {
+                unsigned int bit = (hash >> (i * 8)) & 0xff;
+
+                bloom[bit / 32] |= 1U << (bit % 32);
+        }
+}
+
+static void property_bloom(const char *key, const char *value, unsigned int bloom[8])
+{
+        char property[UTIL_LINE_SIZE];
+
+        strscpyl(property, sizeof(property), key, "=", value, NULL);
+        property_bloom256(property, bloom);
+}
+
+/* number of filter instructions to match a property */
+static unsigned int property_match_len(const char *key, const char *value)
+{
+        unsigned int bloom[8] = {};
+        unsigned int len = 1;
+        unsigned int w;
+
+        property_bloom(key, value, bloom);
+        for (w = 0; w < ELEMENTSOF(bloom); w++)
+                if (bloom[w] != 0)
+                        len += 3;
+        return len;
+}
+
 static inline void bpf_stmt(struct sock_filter *inss, unsigned int *i,
                             unsigned short code, unsigned int data)
 {
@@ -216,7 +299,8 @@ _public_ int udev_monitor_filter_update(struct udev_monitor *udev_monitor)
         int err;
 
         if (udev_list_get_entry(&udev_monitor->filter_subsystem_list) == NULL &&
-            udev_list_get_entry(&udev_monitor->filter_tag_list) == NULL)
+            udev_list_get_entry(&udev_monitor->filter_tag_list) == NULL &&
+            udev_list_get_entry(&udev_monitor->filter_property_list) == NULL)
                 return 0;
 
         memset(ins, 0x00, sizeof(ins));
@@ -263,6 +347,53 @@ _public_ int udev_monitor_filter_update(struct udev_monitor *udev_monitor)
                 bpf_stmt(ins, &i, BPF_RET|BPF_K, 0);
         }
 
+        if (udev_list_get_entry(&udev_monitor->filter_property_list) != NULL) {
+                unsigned int end;
+
+                /* calculate end of property match block, every match checks the words with bloom bits set */
+                end = 1;
+                udev_list_entry_foreach(list_entry, udev_list_get_entry(&udev_monitor->filter_property_list))
+                        end += property_match_len(udev_list_entry_get_name(list_entry), udev_list_entry_get_value(list_entry));
+                if (i + 3 + end + 1 >= ELEMENTSOF(ins))
+                        return -E2BIG;
+                end += i + 3;
+
+                /* load header size in A, it is stored in host order */
+                bpf_stmt(ins, &i, BPF_LD|BPF_W|BPF_ABS, offsetof(struct udev_monitor_netlink_header, header_size));
+                /* jump if the sender knows about the property bloom filter */
+                bpf_jmp(ins, &i, BPF_JMP|BPF_JEQ|BPF_K, ntohl(sizeof(struct udev_monitor_netlink_header)), 1, 0);
+                /* skip property match block, the properties are checked when receiving */
+                bpf_stmt(ins, &i, BPF_JMP|BPF_JA, end - (i + 1));
+
+                /* add all property matches */
+                udev_list_entry_foreach(list_entry, udev_list_get_entry(&udev_monitor->filter_property_list)) {
+                        unsigned int bloom[8] = {};
+                        unsigned int len;
+                        unsigned int w;
+
+                        property_bloom(udev_list_entry_get_name(list_entry), udev_list_entry_get_value(list_entry), bloom);
+                        len = property_match_len(udev_list_entry_get_name(list_entry), udev_list_entry_get_value(list_entry));
+                        for (w = 0; w < ELEMENTSOF(bloom); w++) {
+                                if (bloom[w] == 0)
+                                        continue;
+
+                                /* load device bloom bits in A */
+                                bpf_stmt(ins, &i, BPF_LD|BPF_W|BPF_ABS,
+                                         offsetof(struct udev_monitor_netlink_header, filter_property_bloom) + w * sizeof(unsigned int));
+                                /* clear bits (property bits & bloom bits) */
+                                bpf_stmt(ins, &i, BPF_ALU|BPF_AND|BPF_K, bloom[w]);
+                                /* jump to next property if it does not match */
+                                len -= 3;
+                                bpf_jmp(ins, &i, BPF_JMP|BPF_JEQ|BPF_K, bloom[w], 0, len);
+                        }
+                        /* jump behind end of property match block if property matches */
+                        bpf_stmt(ins, &i, BPF_JMP|BPF_JA, end - (i + 1));
+                }
+
+                /* nothing matched, drop packet */
+                bpf_stmt(ins, &i, BPF_RET|BPF_K, 0);
+        }
+
         /* add all subsystem matches */
         if (udev_list_get_entry(&udev_monitor->filter_subsystem_list) != NULL) {
                 udev_list_entry_foreach(list_entry, udev_list_get_entry(&udev_monitor->filter_subsystem_list)) {
@@ -421,6 +552,7 @@ _public_ struct udev_monitor *udev_monitor_unref(struct udev_monitor *udev_monit
                 close(udev_monitor->sock);
         udev_list_cleanup(&udev_monitor->filter_subsystem_list);
         udev_list_cleanup(&udev_monitor->filter_tag_list);
+        udev_list_cleanup(&udev_monitor->filter_property_list);
         free(udev_monitor);
         return NULL;
 }
@@ -455,7 +587,21 @@ _public_ int udev_monitor_get_fd(struct udev_monitor *udev_monitor)
         return udev_monitor->sock;
 }
 
-static int passes_filter(struct udev_monitor *udev_monitor, struct udev_device *udev_device)
+static bool event_has_tag(const struct udev_monitor_event *event, const char *tag)
+{
+        size_t len = strlen(tag);
+        const char *s;
+
+        /* the tags are stored as ":tag1:tag2:" */
+        if (event->tags == NULL)
+                return false;
+        for (s = strstr(event->tags, tag); s != NULL; s = strstr(s + 1, tag))
+                if (s > event->tags && s[-1] == ':' && s[len] == ':')
+                        return true;
+        return false;
+}
+
+static int passes_filter(struct udev_monitor *udev_monitor, struct udev_monitor_event *event)
 {
         struct udev_list_entry *list_entry;
 
@@ -463,36 +609,144 @@ static int passes_filter(struct udev_monitor *udev_monitor, struct udev_device *
                 goto tag;
         udev_list_entry_foreach(list_entry, udev_list_get_entry(&udev_monitor->filter_subsystem_list)) {
                 const char *subsys = udev_list_entry_get_name(list_entry);
-                const char *dsubsys = udev_device_get_subsystem(udev_device);
                 const char *devtype;
-                const char *ddevtype;
 
-                if (strcmp(dsubsys, subsys) != 0)
+                if (strcmp(event->subsystem, subsys) != 0)
                         continue;
 
                 devtype = udev_list_entry_get_value(list_entry);
                 if (devtype == NULL)
                         goto tag;
-                ddevtype = udev_device_get_devtype(udev_device);
-                if (ddevtype == NULL)
+                if (event->devtype == NULL)
                         continue;
-                if (strcmp(ddevtype, devtype) == 0)
+                if (strcmp(event->devtype, devtype) == 0)
                         goto tag;
         }
         return 0;
 
 tag:
         if (udev_list_get_entry(&udev_monitor->filter_tag_list) == NULL)
-                return 1;
+                goto property;
         udev_list_entry_foreach(list_entry, udev_list_get_entry(&udev_monitor->filter_tag_list)) {
                 const char *tag = udev_list_entry_get_name(list_entry);
 
-                if (udev_device_has_tag(udev_device, tag))
+                if (event_has_tag(event, tag))
+                        goto property;
+        }
+        return 0;
+
+property:
+        if (udev_list_get_entry(&udev_monitor->filter_property_list) == NULL)
+                return 1;
+        udev_list_entry_foreach(list_entry, udev_list_get_entry(&udev_monitor->filter_property_list)) {
+                const char *value;
+
+                value = udev_monitor_event_get_property_value(event, udev_list_entry_get_name(list_entry));
+                if (value != NULL && strcmp(value, udev_list_entry_get_value(list_entry)) == 0)
                         return 1;
         }
         return 0;
 }
 
+/* check a received message, and point the event to the properties in the message buffer */
+static bool message_parse(struct udev_monitor *udev_monitor, struct msghdr *smsg,
+                          char *buf, size_t buflen, struct udev_monitor_event *event)
+{
+        struct cmsghdr *cmsg;
+        struct ucred *cred;
+        struct udev_monitor_netlink_header *nlh;
+        size_t bufpos;
+        char *s;
+
+        if (buflen < 32 || buflen >= UDEV_MONITOR_BUF_SIZE) {
+                udev_dbg(udev_monitor->udev, "invalid message length\n");
+                return false;
+        }
+        buf[buflen] = '\0';
+
+        if (udev_monitor->snl.nl.nl_family != 0) {
+                union sockaddr_union *snl = smsg->msg_name;
+
+                if (snl->nl.nl_groups == 0) {
+                        /* unicast message, check if we trust the sender */
+                        if (udev_monitor->snl_trusted_sender.nl.nl_pid == 0 ||
+                            snl->nl.nl_pid != udev_monitor->snl_trusted_sender.nl.nl_pid) {
+                                udev_dbg(udev_monitor->udev, "unicast netlink message ignored\n");
+                                return false;
+                        }
+                } else if (snl->nl.nl_groups == UDEV_MONITOR_KERNEL) {
+                        if (snl->nl.nl_pid > 0) {
+                                udev_dbg(udev_monitor->udev, "multicast kernel netlink message from pid %d ignored\n",
+                                     snl->nl.nl_pid);
+                                return false;
+                        }
+                }
+        }
+
+        cmsg = CMSG_FIRSTHDR(smsg);
+        if (cmsg == NULL || cmsg->cmsg_type != SCM_CREDENTIALS) {
+                udev_dbg(udev_monitor->udev, "no sender credentials received, message ignored\n");
+                return false;
+        }
+
+        cred = (struct ucred *)CMSG_DATA(cmsg);
+        if (cred->uid != 0) {
+                udev_dbg(udev_monitor->udev, "sender uid=%d, message ignored\n", cred->uid);
+                return false;
+        }
+
+        if (memcmp(buf, "libudev", 8) == 0) {
+                /* udev message needs proper version magic */
+                nlh = (struct udev_monitor_netlink_header *) buf;
+                if (nlh->magic != htonl(UDEV_MONITOR_MAGIC)) {
+                        udev_err(udev_monitor->udev, "unrecognized message signature (%x != %x)\n",
+                            nlh->magic, htonl(UDEV_MONITOR_MAGIC));
+                        return false;
+                }
+                if (nlh->properties_off+32 > buflen)
+                        return false;
+                bufpos = nlh->properties_off;
+        } else {
+                /* kernel message with header */
+                bufpos = strlen(buf) + 1;
+                if (bufpos < sizeof("a@/d") || bufpos >= buflen) {
+                        udev_dbg(udev_monitor->udev, "invalid message length\n");
+                        return false;
+                }
+
+                /* check message header */
+                if (strstr(buf, "@/") == NULL) {
+                        udev_dbg(udev_monitor->udev, "unrecognized message header\n");
+                        return false;
+                }
+        }
+
+        zero(*event);
+        event->udev_monitor = udev_monitor;
+        event->properties = &buf[bufpos];
+        for (s = &buf[bufpos]; s < &buf[buflen] && s[0] != '\0'; s += strlen(s) + 1) {
+                if (startswith(s, "ACTION="))
+                        event->action = &s[7];
+                else if (startswith(s, "DEVPATH="))
+                        event->devpath = &s[8];
+                else if (startswith(s, "SUBSYSTEM="))
+                        event->subsystem = &s[10];
+                else if (startswith(s, "DEVTYPE="))
+                        event->devtype = &s[8];
+                else if (startswith(s, "SEQNUM="))
+                        event->seqnum = &s[7];
+                else if (startswith(s, "TAGS="))
+                        event->tags = &s[5];
+        }
+        event->properties_end = s;
+
+        if (event->devpath == NULL || event->subsystem == NULL) {
+                udev_dbg(udev_monitor->udev, "missing values, invalid device\n");
+                return false;
+        }
+        return true;
+}
+
 /**
  * udev_monitor_receive_device:
  * @udev_monitor: udev monitor
@@ -514,17 +768,13 @@ tag:
  **/
 _public_ struct udev_device *udev_monitor_receive_device(struct udev_monitor *udev_monitor)
 {
-        struct udev_device *udev_device;
         struct msghdr smsg;
         struct iovec iov;
-        char cred_msg[CMSG_SPACE(sizeof(struct ucred))];
-        struct cmsghdr *cmsg;
+        union cred_msg cred_msg;
         union sockaddr_union snl;
-        struct ucred *cred;
-        char buf[8192];
+        char buf[UDEV_MONITOR_BUF_SIZE];
         ssize_t buflen;
-        ssize_t bufpos;
-        struct udev_monitor_netlink_header *nlh;
+        struct udev_monitor_event event;
 
 retry:
         if (udev_monitor == NULL)
@@ -534,7 +784,7 @@ retry:
         memset (&smsg, 0x00, sizeof(struct msghdr));
         smsg.msg_iov = &iov;
         smsg.msg_iovlen = 1;
-        smsg.msg_control = cred_msg;
+        smsg.msg_control = &cred_msg;
         smsg.msg_controllen = sizeof(cred_msg);
 
         if (udev_monitor->snl.nl.nl_family != 0) {
@@ -549,102 +799,325 @@ retry:
                 return NULL;
         }
 
-        if (buflen < 32 || (size_t)buflen >= sizeof(buf)) {
-                udev_dbg(udev_monitor->udev, "invalid message length\n");
+        if (!message_parse(udev_monitor, &smsg, buf, buflen, &event))
                 return NULL;
-        }
 
-        if (udev_monitor->snl.nl.nl_family != 0) {
-                if (snl.nl.nl_groups == 0) {
-                        /* unicast message, check if we trust the sender */
-                        if (udev_monitor->snl_trusted_sender.nl.nl_pid == 0 ||
-                            snl.nl.nl_pid != udev_monitor->snl_trusted_sender.nl.nl_pid) {
-                                udev_dbg(udev_monitor->udev, "unicast netlink message ignored\n");
-                                return NULL;
-                        }
-                } else if (snl.nl.nl_groups == UDEV_MONITOR_KERNEL) {
-                        if (snl.nl.nl_pid > 0) {
-                                udev_dbg(udev_monitor->udev, "multicast kernel netlink message from pid %d ignored\n",
-                                     snl.nl.nl_pid);
-                                return NULL;
-                        }
-                }
-        }
+        /* skip device, if it does not pass the current filter */
+        if (!passes_filter(udev_monitor, &event)) {
+                struct pollfd pfd[1];
+                int rc;
 
-        cmsg = CMSG_FIRSTHDR(&smsg);
-        if (cmsg == NULL || cmsg->cmsg_type != SCM_CREDENTIALS) {
-                udev_dbg(udev_monitor->udev, "no sender credentials received, message ignored\n");
+                /* if something is queued, get next device */
+                pfd[0].fd = udev_monitor->sock;
+                pfd[0].events = POLLIN;
+                rc = poll(pfd, 1, 0);
+                if (rc > 0)
+                        goto retry;
                 return NULL;
         }
 
-        cred = (struct ucred *)CMSG_DATA(cmsg);
-        if (cred->uid != 0) {
-                udev_dbg(udev_monitor->udev, "sender uid=%d, message ignored\n", cred->uid);
+        return udev_monitor_event_new_device(&event);
+}
+
+/**
+ * udev_monitor_batch_new:
+ * @udev_monitor: udev monitor
+ * @size: maximum number of events to receive at once, or 0 for the default
+ *
+ * Create the buffers to receive a number of events with a single
+ * system call. Consumers which see bursts of events, can use
+ * udev_monitor_batch_receive() instead of udev_monitor_receive_device(),
+ * and look at the received events without creating a udev device for
+ * every one of them.
+ *
+ * The initial refcount is 1, and needs to be decremented to
+ * release the resources of the batch.
+ *
+ * Returns: a new udev monitor batch, or #NULL, in case of an error
+ **/
+_public_ struct udev_monitor_batch *udev_monitor_batch_new(struct udev_monitor *udev_monitor, unsigned int size)
+{
+        struct udev_monitor_batch *batch;
+
+        if (udev_monitor == NULL)
+                return NULL;
+        if (size == 0)
+                size = UDEV_MONITOR_BATCH_SIZE;
+
+        batch = calloc(1, sizeof(struct udev_monitor_batch));
+        if (batch == NULL)
+                return NULL;
+        batch->refcount = 1;
+        batch->size = size;
+        batch->msgs = calloc(size, sizeof(struct mmsghdr));
+        batch->iovs = calloc(size, sizeof(struct iovec));
+        batch->addrs = calloc(size, sizeof(union sockaddr_union));
+        batch->creds = calloc(size, sizeof(union cred_msg));
+        batch->bufs = calloc(size, UDEV_MONITOR_BUF_SIZE);
+        batch->events = calloc(size, sizeof(struct udev_monitor_event));
+        if (batch->msgs == NULL || batch->iovs == NULL || batch->addrs == NULL ||
+            batch->creds == NULL || batch->bufs == NULL || batch->events == NULL) {
+                udev_monitor_batch_unref(batch);
                 return NULL;
         }
+        batch->udev_monitor = udev_monitor_ref(udev_monitor);
+        return batch;
+}
 
-        if (memcmp(buf, "libudev", 8) == 0) {
-                /* udev message needs proper version magic */
-                nlh = (struct udev_monitor_netlink_header *) buf;
-                if (nlh->magic != htonl(UDEV_MONITOR_MAGIC)) {
-                        udev_err(udev_monitor->udev, "unrecognized message signature (%x != %x)\n",
-                            nlh->magic, htonl(UDEV_MONITOR_MAGIC));
-                        return NULL;
-                }
-                if (nlh->properties_off+32 > (size_t)buflen)
-                        return NULL;
-                bufpos = nlh->properties_off;
-        } else {
-                /* kernel message with header */
-                bufpos = strlen(buf) + 1;
-                if ((size_t)bufpos < sizeof("a@/d") || bufpos >= buflen) {
-                        udev_dbg(udev_monitor->udev, "invalid message length\n");
-                        return NULL;
-                }
+/**
+ * udev_monitor_batch_ref:
+ * @batch: udev monitor batch
+ *
+ * Take a reference of a udev monitor batch.
+ *
+ * Returns: the passed udev monitor batch
+ **/
+_public_ struct udev_monitor_batch *udev_monitor_batch_ref(struct udev_monitor_batch *batch)
+{
+        if (batch == NULL)
+                return NULL;
+        batch->refcount++;
+        return batch;
+}
 
-                /* check message header */
-                if (strstr(buf, "@/") == NULL) {
-                        udev_dbg(udev_monitor->udev, "unrecognized message header\n");
-                        return NULL;
+/**
+ * udev_monitor_batch_unref:
+ * @batch: udev monitor batch
+ *
+ * Drop a reference of a udev monitor batch. If the refcount reaches zero,
+ * the resources of the batch, and the events received with it, will be
+ * released.
+ *
+ * Returns: the passed udev monitor batch if it has still an active reference, or #NULL otherwise.
+ **/
+_public_ struct udev_monitor_batch *udev_monitor_batch_unref(struct udev_monitor_batch *batch)
+{
+        if (batch == NULL)
+                return NULL;
+        batch->refcount--;
+        if (batch->refcount > 0)
+                return batch;
+        udev_monitor_unref(batch->udev_monitor);
+        free(batch->msgs);
+        free(batch->iovs);
+        free(batch->addrs);
+        free(batch->creds);
+        free(batch->bufs);
+        free(batch->events);
+        free(batch);
+        return NULL;
+}
+
+/**
+ * udev_monitor_batch_receive:
+ * @batch: udev monitor batch
+ *
+ * Receive all queued messages from the udev monitor socket, up to the
+ * size of the batch. The events which pass the filter of the monitor
+ * are available with udev_monitor_batch_get_event(), until the next
+ * call to udev_monitor_batch_receive().
+ *
+ * Only socket connections with uid=0 are accepted.
+ *
+ * If the monitor socket is in blocking mode, the call waits for the
+ * first message only.
+ *
+ * Returns: the number of received events, which is 0 if all received
+ * messages were filtered out, or a negative error value; -EAGAIN if
+ * nothing is queued at a non-blocking socket.
+ **/
+_public_ int udev_monitor_batch_receive(struct udev_monitor_batch *batch)
+{
+        struct udev_monitor *udev_monitor;
+        unsigned int i;
+        int n;
+
+        if (batch == NULL)
+                return -EINVAL;
+        udev_monitor = batch->udev_monitor;
+        batch->count = 0;
+
+        for (i = 0; i < batch->size; i++) {
+                struct msghdr *smsg = &batch->msgs[i].msg_hdr;
+
+                batch->iovs[i].iov_base = &batch->bufs[i * UDEV_MONITOR_BUF_SIZE];
+                batch->iovs[i].iov_len = UDEV_MONITOR_BUF_SIZE;
+                memset(smsg, 0x00, sizeof(struct msghdr));
+                smsg->msg_iov = &batch->iovs[i];
+                smsg->msg_iovlen = 1;
+                smsg->msg_control = &batch->creds[i];
+                smsg->msg_controllen = sizeof(union cred_msg);
+
+                if (udev_monitor->snl.nl.nl_family != 0) {
+                        smsg->msg_name = &batch->addrs[i];
+                        smsg->msg_namelen = sizeof(union sockaddr_union);
                 }
         }
 
-        udev_device = udev_device_new(udev_monitor->udev);
-        if (udev_device == NULL)
-                return NULL;
-        udev_device_set_info_loaded(udev_device);
+        n = recvmmsg(udev_monitor->sock, batch->msgs, batch->size, MSG_WAITFORONE, NULL);
+        if (n < 0) {
+                int err = -errno;
+
+                if (err != -EINTR && err != -EAGAIN)
+                        udev_dbg(udev_monitor->udev, "unable to receive messages\n");
+                return err;
+        }
 
-        while (bufpos < buflen) {
-                char *key;
-                size_t keylen;
+        for (i = 0; i < (unsigned int)n; i++) {
+                struct udev_monitor_event *event = &batch->events[batch->count];
 
-                key = &buf[bufpos];
-                keylen = strlen(key);
-                if (keylen == 0)
-                        break;
-                bufpos += keylen + 1;
-                udev_device_add_property_from_string_parse(udev_device, key);
+                if (!message_parse(udev_monitor, &batch->msgs[i].msg_hdr,
+                                   batch->iovs[i].iov_base, batch->msgs[i].msg_len, event))
+                        continue;
+                if (!passes_filter(udev_monitor, event))
+                        continue;
+                batch->count++;
         }
+        return batch->count;
+}
 
-        if (udev_device_add_property_from_string_parse_finish(udev_device) < 0) {
-                udev_dbg(udev_monitor->udev, "missing values, invalid device\n");
-                udev_device_unref(udev_device);
+/**
+ * udev_monitor_batch_get_event:
+ * @batch: udev monitor batch
+ * @index: number of the event, starting with 0
+ *
+ * Retrieve an event of the last udev_monitor_batch_receive() call. The
+ * event is owned by the batch, and valid until the next receive call.
+ *
+ * Returns: the event, or #NULL if there is no event with this number
+ **/
+_public_ struct udev_monitor_event *udev_monitor_batch_get_event(struct udev_monitor_batch *batch, unsigned int index)
+{
+        if (batch == NULL)
                 return NULL;
-        }
+        if (index >= batch->count)
+                return NULL;
+        return &batch->events[index];
+}
 
-        /* skip device, if it does not pass the current filter */
-        if (!passes_filter(udev_monitor, udev_device)) {
-                struct pollfd pfd[1];
-                int rc;
+/**
+ * udev_monitor_event_get_action:
+ * @event: udev monitor event
+ *
+ * Returns: the kernel action value, like "add", or #NULL if there is none
+ **/
+_public_ const char *udev_monitor_event_get_action(struct udev_monitor_event *event)
+{
+        if (event == NULL)
+                return NULL;
+        return event->action;
+}
 
-                udev_device_unref(udev_device);
+/**
+ * udev_monitor_event_get_devpath:
+ * @event: udev monitor event
+ *
+ * Returns: the kernel devpath value of the device, the path does not contain the sys mount point
+ **/
+_public_ const char *udev_monitor_event_get_devpath(struct udev_monitor_event *event)
+{
+        if (event == NULL)
+                return NULL;
+        return event->devpath;
+}
 
-                /* if something is queued, get next device */
-                pfd[0].fd = udev_monitor->sock;
-                pfd[0].events = POLLIN;
-                rc = poll(pfd, 1, 0);
-                if (rc > 0)
-                        goto retry;
+/**
+ * udev_monitor_event_get_subsystem:
+ * @event: udev monitor event
+ *
+ * Returns: the subsystem name of the device
+ **/
+_public_ const char *udev_monitor_event_get_subsystem(struct udev_monitor_event *event)
+{
+        if (event == NULL)
+                return NULL;
+        return event->subsystem;
+}
+
+/**
+ * udev_monitor_event_get_devtype:
+ * @event: udev monitor event
+ *
+ * Returns: the devtype name of the device, or #NULL if there is none
+ **/
+_public_ const char *udev_monitor_event_get_devtype(struct udev_monitor_event *event)
+{
+        if (event == NULL)
+                return NULL;
+        return event->devtype;
+}
+
+/**
+ * udev_monitor_event_get_seqnum:
+ * @event: udev monitor event
+ *
+ * Returns: the kernel event sequence number, or 0 if there is none
+ **/
+_public_ unsigned long long int udev_monitor_event_get_seqnum(struct udev_monitor_event *event)
+{
+        if (event == NULL || event->seqnum == NULL)
+                return 0;
+        return strtoull(event->seqnum, NULL, 10);
+}
+
+/**
+ * udev_monitor_event_get_property_value:
+ * @event: udev monitor event
+ * @key: property name
+ *
+ * Get the value of a given property. The properties are looked up in
+ * the received message, without building a list of them.
+ *
+ * Returns: the property string, or #NULL if there is no such property.
+ **/
+_public_ const char *udev_monitor_event_get_property_value(struct udev_monitor_event *event, const char *key)
+{
+        const char *s;
+        size_t len;
+
+        if (event == NULL)
+                return NULL;
+        if (key == NULL)
+                return NULL;
+
+        len = strlen(key);
+        for (s = event->properties; s < event->properties_end; s += strlen(s) + 1)
+                if (strncmp(s, key, len) == 0 && s[len] == '=')
+                        return &s[len + 1];
+        return NULL;
+}
+
+/**
+ * udev_monitor_event_new_device:
+ * @event: udev monitor event
+ *
+ * Create a udev device from the received event, the same way
+ * udev_monitor_receive_device() does.
+ *
+ * The initial refcount is 1, and needs to be decremented to
+ * release the resources of the udev device.
+ *
+ * Returns: a new udev device, or #NULL, in case of an error
+ **/
+_public_ struct udev_device *udev_monitor_event_new_device(struct udev_monitor_event *event)
+{
+        struct udev_device *udev_device;
+        const char *s;
+
+        if (event == NULL)
+                return NULL;
+
+        udev_device = udev_device_new(event->udev_monitor->udev);
+        if (udev_device == NULL)
+                return NULL;
+        udev_device_set_info_loaded(udev_device);
+
+        for (s = event->properties; s < event->properties_end; s += strlen(s) + 1)
+                udev_device_add_property_from_string_parse(udev_device, s);
+
+        if (udev_device_add_property_from_string_parse_finish(udev_device) < 0) {
+                udev_dbg(event->udev_monitor->udev, "missing values, invalid device\n");
+                udev_device_unref(udev_device);
                 return NULL;
         }
 
@@ -663,6 +1136,8 @@ int udev_monitor_send_device(struct udev_monitor *udev_monitor,
         struct udev_monitor_netlink_header nlh;
         struct udev_list_entry *list_entry;
         uint64_t tag_bloom_bits;
+        unsigned int property_bloom_bits[8] = {};
+        unsigned int i;
 
         if (udev_monitor->snl.nl.nl_family == 0)
                 return -EINVAL;
@@ -693,6 +1168,12 @@ int udev_monitor_send_device(struct udev_monitor *udev_monitor,
                 nlh.filter_tag_bloom_lo = htonl(tag_bloom_bits & 0xffffffff);
         }
 
+        /* add property bloom filter */
+        for (val = buf; val < &buf[blen]; val += strlen(val) + 1)
+                property_bloom256(val, property_bloom_bits);
+        for (i = 0; i < ELEMENTSOF(property_bloom_bits); i++)
+                nlh.filter_property_bloom[i] = htonl(property_bloom_bits[i]);
+
         /* add properties list */
         nlh.properties_off = iov[0].iov_len;
         nlh.properties_len = blen;
@@ -765,6 +1246,31 @@ _public_ int udev_monitor_filter_add_match_tag(struct udev_monitor *udev_monitor
         return 0;
 }
 
+/**
+ * udev_monitor_filter_add_match_property:
+ * @udev_monitor: the monitor
+ * @property: the name of a property
+ * @value: the value the property needs to have
+ *
+ * This filter is efficiently executed inside the kernel, and libudev subscribers
+ * will usually not be woken up for devices which do not match. Devices pass
+ * the filter if any of the added properties has the given value.
+ *
+ * The filter must be installed before the monitor is switched to listening mode.
+ *
+ * Returns: 0 on success, otherwise a negative error value.
+ */
+_public_ int udev_monitor_filter_add_match_property(struct udev_monitor *udev_monitor, const char *property, const char *value)
+{
+        if (udev_monitor == NULL)
+                return -EINVAL;
+        if (property == NULL || value == NULL)
+                return -EINVAL;
+        if (udev_list_entry_add(&udev_monitor->filter_property_list, property, value) == NULL)
+                return -ENOMEM;
+        return 0;
+}
+
 /**
  * udev_monitor_filter_remove:
  * @udev_monitor: monitor
@@ -778,5 +1284,6 @@ _public_ int udev_monitor_filter_remove(struct udev_monitor *udev_monitor)
         static struct sock_fprog filter = { 0, NULL };
 
         udev_list_cleanup(&udev_monitor->filter_subsystem_list);
+        udev_list_cleanup(&udev_monitor->filter_property_list);
         return setsockopt(udev_monitor->sock, SOL_SOCKET, SO_ATTACH_FILTER, &filter, sizeof(filter));
 }
@@ -46,6 +46,7 @@
 #define udev_err(udev, arg...) udev_log_cond(udev, LOG_ERR, ## arg)
 
 /* libudev.c */
+struct udev_db;
 void udev_log(struct udev *udev,
               int priority, const char *file, int line, const char *fn,
               const char *format, ...)
@@ -53,6 +54,7 @@ void udev_log(struct udev *udev,
 int udev_get_rules_path(struct udev *udev, char **path[], usec_t *ts_usec[]);
 struct udev_list_entry *udev_add_property(struct udev *udev, const char *key, const char *value);
 struct udev_list_entry *udev_get_properties_list_entry(struct udev *udev);
+struct udev_db *udev_get_db(struct udev *udev);
 
 /* libudev-device.c */
 struct udev_device *udev_device_new(struct udev *udev);
@@ -110,6 +112,8 @@ struct udev_list {
         struct udev_list_entry **entries;
         unsigned int entries_cur;
         unsigned int entries_max;
+        struct udev_list_entry **index;
+        unsigned int index_size;
         bool unique;
 };
 #define UDEV_LIST(list) struct udev_list_node list = { &(list), &(list) }
@@ -139,6 +143,13 @@ void udev_list_entry_set_num(struct udev_list_entry *list_entry, int num);
              entry != NULL; \
              entry = tmp, tmp = udev_list_entry_get_next(tmp))
 
+/* libudev-db.c */
+#define UDEV_DB_BIN "/run/udev/data.bin"
+struct udev_db *udev_db_refresh(struct udev *udev, struct udev_db **db);
+void udev_db_free(struct udev_db *db);
+int udev_db_read_device(struct udev_db *db, struct udev_device *udev_device, const char *id);
+int udev_db_get_tag_devices(struct udev_db *db, const char *tag, struct udev_list *list);
+
 /* libudev-queue.c */
 unsigned long long int udev_get_kernel_seqnum(struct udev *udev);
 int udev_queue_read_seqnum(FILE *queue_file, unsigned long long int *seqnum);
@@ -52,6 +52,7 @@ struct udev {
         void *userdata;
         struct udev_list properties_list;
         int log_priority;
+        struct udev_db *db;
 };
 
 void udev_log(struct udev *udev,
@@ -240,6 +241,7 @@ _public_ struct udev *udev_unref(struct udev *udev)
         if (udev->refcount > 0)
                 return udev;
         udev_list_cleanup(&udev->properties_list);
+        udev_db_free(udev->db);
         free(udev);
         return NULL;
 }
@@ -312,3 +314,9 @@ struct udev_list_entry *udev_get_properties_list_entry(struct udev *udev)
 {
         return udev_list_get_entry(&udev->properties_list);
 }
+
+/* the current snapshot of the device database, or NULL */
+struct udev_db *udev_get_db(struct udev *udev)
+{
+        return udev_db_refresh(udev, &udev->db);
+}
@@ -129,8 +129,25 @@ struct udev_device *udev_monitor_receive_device(struct udev_monitor *udev_monito
 int udev_monitor_filter_add_match_subsystem_devtype(struct udev_monitor *udev_monitor,
                                                     const char *subsystem, const char *devtype);
 int udev_monitor_filter_add_match_tag(struct udev_monitor *udev_monitor, const char *tag);
+int udev_monitor_filter_add_match_property(struct udev_monitor *udev_monitor,
+                                           const char *property, const char *value);
 int udev_monitor_filter_update(struct udev_monitor *udev_monitor);
 int udev_monitor_filter_remove(struct udev_monitor *udev_monitor);
+/* receive a number of events at once, and read their properties from the received messages */
+struct udev_monitor_batch;
+struct udev_monitor_event;
+struct udev_monitor_batch *udev_monitor_batch_new(struct udev_monitor *udev_monitor, unsigned int size);
+struct udev_monitor_batch *udev_monitor_batch_ref(struct udev_monitor_batch *batch);
+struct udev_monitor_batch *udev_monitor_batch_unref(struct udev_monitor_batch *batch);
+int udev_monitor_batch_receive(struct udev_monitor_batch *batch);
+struct udev_monitor_event *udev_monitor_batch_get_event(struct udev_monitor_batch *batch, unsigned int index);
+const char *udev_monitor_event_get_action(struct udev_monitor_event *event);
+const char *udev_monitor_event_get_devpath(struct udev_monitor_event *event);
+const char *udev_monitor_event_get_subsystem(struct udev_monitor_event *event);
+const char *udev_monitor_event_get_devtype(struct udev_monitor_event *event);
+unsigned long long int udev_monitor_event_get_seqnum(struct udev_monitor_event *event);
+const char *udev_monitor_event_get_property_value(struct udev_monitor_event *event, const char *key);
+struct udev_device *udev_monitor_event_new_device(struct udev_monitor_event *event);
 
 /*
  * udev_enumerate
@@ -28,6 +28,8 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <ftw.h>
+#include <fcntl.h>
+#include <limits.h>
 
 #include "cgroup-util.h"
 #include "log.h"
@@ -191,157 +193,378 @@ int cg_rmdir(const char *controller, const char *path, bool honour_sticky) {
         return (r < 0 && errno != ENOENT) ? -errno : 0;
 }
 
-int cg_kill(const char *controller, const char *path, int sig, bool sigcont, bool ignore_self, Set *s) {
-        bool done = false;
-        int r, ret = 0;
+/* State shared by all passes of one kill operation. PIDs we already
+ * dealt with are tracked in a bitmap, which is a lot cheaper than a
+ * Set when tens of thousands of tasks need to be killed. The caller's
+ * Set, if any, is only consulted and updated once per PID. */
+typedef struct CGroupKill {
+        int sig;
+        bool sigcont;
+        bool ignore_self;
         pid_t my_pid;
-        FILE *f = NULL;
-        Set *allocated_set = NULL;
 
-        assert(controller);
-        assert(path);
-        assert(sig >= 0);
+        Set *s;
 
-        /* This goes through the tasks list and kills them all. This
-         * is repeated until no further processes are added to the
-         * tasks list, to properly handle forking processes */
+        unsigned long *seen;
+        size_t n_seen;
 
-        if (!s)
-                if (!(s = allocated_set = set_new(trivial_hash_func, trivial_compare_func)))
+        pid_t *batch;
+        size_t n_batch, n_batch_allocated;
+
+        int ret;
+} CGroupKill;
+
+#define BITS_PER_LONG (sizeof(unsigned long) * 8)
+
+static int cg_kill_mark(CGroupKill *k, pid_t pid) {
+        size_t i;
+        unsigned long m;
+
+        assert(k);
+        assert(pid > 0);
+
+        /* Returns 1 if the PID was not marked yet */
+
+        i = (size_t) pid / BITS_PER_LONG;
+        m = 1UL << ((size_t) pid % BITS_PER_LONG);
+
+        if (i >= k->n_seen) {
+                unsigned long *n;
+                size_t a;
+
+                a = MAX(i + 1, k->n_seen * 2);
+                a = MAX(a, (size_t) (32768 / BITS_PER_LONG));
+
+                n = realloc(k->seen, a * sizeof(unsigned long));
+                if (!n)
                         return -ENOMEM;
 
-        my_pid = getpid();
+                memset(n + k->n_seen, 0, (a - k->n_seen) * sizeof(unsigned long));
+                k->seen = n;
+                k->n_seen = a;
+        }
 
-        do {
-                pid_t pid = 0;
-                done = true;
+        if (k->seen[i] & m)
+                return 0;
 
-                if ((r = cg_enumerate_processes(controller, path, &f)) < 0) {
-                        if (ret >= 0 && r != -ENOENT)
-                                ret = r;
+        k->seen[i] |= m;
+        return 1;
+}
 
-                        goto finish;
+static int cg_kill_add(CGroupKill *k, pid_t pid) {
+        int r;
+
+        assert(k);
+
+        if (pid == k->my_pid && k->ignore_self)
+                return 0;
+
+        r = cg_kill_mark(k, pid);
+        if (r <= 0)
+                return r;
+
+        if (k->s && set_get(k->s, LONG_TO_PTR(pid)) == LONG_TO_PTR(pid))
+                return 0;
+
+        if (k->n_batch >= k->n_batch_allocated) {
+                pid_t *n;
+                size_t a;
+
+                a = MAX(k->n_batch_allocated * 2, (size_t) 64);
+                n = realloc(k->batch, a * sizeof(pid_t));
+                if (!n)
+                        return -ENOMEM;
+
+                k->batch = n;
+                k->n_batch_allocated = a;
+        }
+
+        k->batch[k->n_batch++] = pid;
+        return 1;
+}
+
+static int cg_kill_flush(CGroupKill *k) {
+        size_t i;
+        int r;
+
+        assert(k);
+
+        /* First signal everybody in the batch, and only then wake
+         * them up, so that nobody gets to run between the two */
+
+        for (i = 0; i < k->n_batch; i++)
+                if (kill(k->batch[i], k->sig) < 0) {
+                        if (k->ret >= 0 && errno != ESRCH)
+                                k->ret = -errno;
+                } else if (k->ret == 0)
+                        k->ret = 1;
+
+        if (k->sigcont && k->sig != SIGCONT && k->sig != SIGKILL)
+                for (i = 0; i < k->n_batch; i++)
+                        kill(k->batch[i], SIGCONT);
+
+        if (k->s)
+                for (i = 0; i < k->n_batch; i++) {
+                        r = set_put(k->s, LONG_TO_PTR(k->batch[i]));
+                        if (r < 0)
+                                return r;
                 }
 
-                while ((r = cg_read_pid(f, &pid)) > 0) {
+        k->n_batch = 0;
+        return 0;
+}
 
-                        if (pid == my_pid && ignore_self)
-                                continue;
+static int cg_kill_pass(CGroupKill *k, const char *controller, const char *path) {
+        int _cleanup_close_ fd = -1;
+        char buf[64*1024];
+        size_t n = 0;
+        bool eof = false, found = false;
+        char *fs;
+        int r;
 
-                        if (set_get(s, LONG_TO_PTR(pid)) == LONG_TO_PTR(pid))
+        assert(k);
+        assert(controller);
+        assert(path);
+
+        /* Reads cgroup.procs with large reads, and signals all new
+         * PIDs in it. Returns > 0 if there were any, 0 if not. */
+
+        r = cg_get_path(controller, path, "cgroup.procs", &fs);
+        if (r < 0)
+                return r;
+
+        fd = open(fs, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        free(fs);
+
+        if (fd < 0)
+                return errno == ENOENT ? 0 : -errno;
+
+        while (!eof) {
+                char *p, *e;
+                ssize_t l;
+
+                l = read(fd, buf + n, sizeof(buf) - n);
+                if (l < 0) {
+                        if (errno == EINTR)
                                 continue;
 
-                        /* If we haven't killed this process yet, kill
-                         * it */
-                        if (kill(pid, sig) < 0) {
-                                if (ret >= 0 && errno != ESRCH)
-                                        ret = -errno;
-                        } else if (ret == 0) {
+                        return -errno;
+                }
 
-                                if (sigcont)
-                                        kill(pid, SIGCONT);
+                eof = l == 0;
+                n += l;
 
-                                ret = 1;
+                for (p = buf; p < buf + n; p = e + 1) {
+                        unsigned long ul = 0;
+                        char *q;
+
+                        e = memchr(p, '\n', buf + n - p);
+                        if (!e) {
+                                if (!eof)
+                                        break;
+
+                                e = buf + n;
                         }
 
-                        done = false;
+                        if (e == p)
+                                continue;
 
-                        if ((r = set_put(s, LONG_TO_PTR(pid))) < 0) {
-                                if (ret >= 0)
-                                        ret = r;
+                        for (q = p; q < e; q++) {
+                                if (*q < '0' || *q > '9')
+                                        return -EIO;
 
-                                goto finish;
+                                ul = ul * 10 + (*q - '0');
+                                if (ul > (unsigned long) INT_MAX)
+                                        return -EIO;
                         }
-                }
 
-                if (r < 0) {
-                        if (ret >= 0)
-                                ret = r;
+                        if (ul <= 0)
+                                return -EIO;
 
-                        goto finish;
+                        r = cg_kill_add(k, (pid_t) ul);
+                        if (r < 0)
+                                return r;
+                        if (r > 0)
+                                found = true;
                 }
 
-                fclose(f);
-                f = NULL;
+                /* Move the incomplete last line to the front */
+                if (p < buf + n) {
+                        if (p == buf && n >= sizeof(buf))
+                                return -EIO;
 
-                /* To avoid racing against processes which fork
-                 * quicker than we can kill them we repeat this until
-                 * no new pids need to be killed. */
+                        memmove(buf, p, buf + n - p);
+                        n = buf + n - p;
+                } else
+                        n = 0;
 
-        } while (!done);
+                r = cg_kill_flush(k);
+                if (r < 0)
+                        return r;
+        }
 
-finish:
-        if (allocated_set)
-                set_free(allocated_set);
+        return found;
+}
 
-        if (f)
-                fclose(f);
+static int cg_kill_groups(CGroupKill *k, const char *controller, char **paths) {
+        unsigned n, i;
+        bool *done;
+        bool again;
+        int r;
 
-        return ret;
+        assert(k);
+        assert(controller);
+
+        /* This goes through the process lists of the groups and kills
+         * everything in them. Groups are read again until a pass
+         * finds no new processes in them, to properly handle forking
+         * processes. Groups that came up empty are not read again. */
+
+        n = strv_length(paths);
+        done = new0(bool, n);
+        if (!done)
+                return -ENOMEM;
+
+        do {
+                again = false;
+
+                for (i = 0; i < n; i++) {
+                        if (done[i])
+                                continue;
+
+                        r = cg_kill_pass(k, controller, paths[i]);
+                        if (r < 0) {
+                                if (k->ret >= 0)
+                                        k->ret = r;
+
+                                done[i] = true;
+                                continue;
+                        }
+
+                        if (r == 0)
+                                done[i] = true;
+                        else
+                                again = true;
+                }
+
+        } while (again);
+
+        free(done);
+        return 0;
 }
 
-int cg_kill_recursive(const char *controller, const char *path, int sig, bool sigcont, bool ignore_self, bool rem, Set *s) {
-        int r, ret = 0;
-        DIR *d = NULL;
-        char *fn;
-        Set *allocated_set = NULL;
+static void cg_kill_done(CGroupKill *k) {
+        assert(k);
+
+        free(k->seen);
+        free(k->batch);
+}
+
+int cg_kill(const char *controller, const char *path, int sig, bool sigcont, bool ignore_self, Set *s) {
+        CGroupKill k;
+        char *paths[2] = { (char*) path, NULL };
+        int r;
 
-        assert(path);
         assert(controller);
+        assert(path);
         assert(sig >= 0);
 
-        if (!s)
-                if (!(s = allocated_set = set_new(trivial_hash_func, trivial_compare_func)))
-                        return -ENOMEM;
+        zero(k);
+        k.sig = sig;
+        k.sigcont = sigcont;
+        k.ignore_self = ignore_self;
+        k.my_pid = getpid();
+        k.s = s;
 
-        ret = cg_kill(controller, path, sig, sigcont, ignore_self, s);
+        r = cg_kill_groups(&k, controller, paths);
+        if (r < 0 && k.ret >= 0)
+                k.ret = r;
 
-        if ((r = cg_enumerate_subgroups(controller, path, &d)) < 0) {
-                if (ret >= 0 && r != -ENOENT)
-                        ret = r;
+        cg_kill_done(&k);
+        return k.ret;
+}
 
-                goto finish;
-        }
+static int cg_enumerate_subgroups_recursive(const char *controller, const char *path, char ***l) {
+        DIR _cleanup_closedir_ *d = NULL;
+        char *fn;
+        int r;
+
+        assert(controller);
+        assert(path);
+        assert(l);
+
+        /* Appends all subgroups of the group, parents before their
+         * children */
+
+        r = cg_enumerate_subgroups(controller, path, &d);
+        if (r < 0)
+                return r == -ENOENT ? 0 : r;
 
         while ((r = cg_read_subgroup(d, &fn)) > 0) {
-                char *p = NULL;
+                char *p;
 
-                r = asprintf(&p, "%s/%s", path, fn);
+                p = strjoin(path, "/", fn, NULL);
                 free(fn);
 
-                if (r < 0) {
-                        if (ret >= 0)
-                                ret = -ENOMEM;
-
-                        goto finish;
-                }
+                if (!p)
+                        return -ENOMEM;
 
-                r = cg_kill_recursive(controller, p, sig, sigcont, ignore_self, rem, s);
+                r = strv_extend(l, p);
+                if (r >= 0)
+                        r = cg_enumerate_subgroups_recursive(controller, p, l);
                 free(p);
 
-                if (r != 0 && ret >= 0)
-                        ret = r;
+                if (r < 0)
+                        return r;
         }
 
-        if (r < 0 && ret >= 0)
-                ret = r;
+        return r;
+}
 
-        if (rem)
-                if ((r = cg_rmdir(controller, path, true)) < 0) {
-                        if (ret >= 0 &&
+int cg_kill_recursive(const char *controller, const char *path, int sig, bool sigcont, bool ignore_self, bool rem, Set *s) {
+        CGroupKill k;
+        char **paths = NULL, **i;
+        int r;
+
+        assert(path);
+        assert(controller);
+        assert(sig >= 0);
+
+        zero(k);
+        k.sig = sig;
+        k.sigcont = sigcont;
+        k.ignore_self = ignore_self;
+        k.my_pid = getpid();
+        k.s = s;
+
+        r = strv_extend(&paths, path);
+        if (r < 0)
+                return r;
+
+        r = cg_enumerate_subgroups_recursive(controller, path, &paths);
+        if (r < 0 && k.ret >= 0)
+                k.ret = r;
+
+        r = cg_kill_groups(&k, controller, paths);
+        if (r < 0 && k.ret >= 0)
+                k.ret = r;
+
+        /* Remove children before their parents */
+        if (rem) {
+                i = paths + strv_length(paths) - 1;
+                STRV_FOREACH_BACKWARDS(i, paths) {
+                        r = cg_rmdir(controller, *i, true);
+                        if (r < 0 && k.ret >= 0 &&
                             r != -ENOENT &&
                             r != -EBUSY)
-                                ret = r;
+                                k.ret = r;
                 }
+        }
 
-finish:
-        if (d)
-                closedir(d);
-
-        if (allocated_set)
-                set_free(allocated_set);
+        strv_free(paths);
+        cg_kill_done(&k);
 
-        return ret;
+        return k.ret;
 }
 
 int cg_kill_recursive_and_wait(const char *controller, const char *path, bool rem) {
@@ -835,6 +1058,68 @@ finish:
         return r;
 }
 
+int cg_get_by_pid_buf(const char *controller, pid_t pid, char *path, size_t size) {
+        char fs[sizeof("/proc/")-1+10+sizeof("/cgroup")];
+        char buf[4096], *l, *e;
+        int _cleanup_close_ fd = -1;
+        ssize_t n;
+        size_t cs;
+
+        assert(controller);
+        assert(path);
+        assert(size > 0);
+        assert(pid >= 0);
+
+        /* Like cg_get_by_pid(), but does not allocate memory. Returns
+         * -E2BIG if /proc/$PID/cgroup does not fit into our buffer,
+         * in which case the caller should fall back to
+         * cg_get_by_pid(). */
+
+        if (pid == 0)
+                pid = getpid();
+
+        snprintf(fs, sizeof(fs), "/proc/%lu/cgroup", (unsigned long) pid);
+
+        fd = open(fs, O_RDONLY|O_CLOEXEC|O_NOCTTY);
+        if (fd < 0)
+                return errno == ENOENT ? -ESRCH : -errno;
+
+        n = loop_read(fd, buf, sizeof(buf), false);
+        if (n < 0)
+                return (int) n;
+        if ((size_t) n >= sizeof(buf))
+                return -E2BIG;
+
+        buf[n] = 0;
+        cs = strlen(controller);
+
+        for (l = buf; l && *l; l = e) {
+                e = strchr(l, '\n');
+                if (e)
+                        *(e++) = 0;
+
+                l = strchr(l, ':');
+                if (!l)
+                        continue;
+
+                l++;
+                if (strncmp(l, controller, cs) != 0)
+                        continue;
+
+                if (l[cs] != ':')
+                        continue;
+
+                l += cs + 1;
+                if (strlen(l) >= size)
+                        return -ENAMETOOLONG;
+
+                strcpy(path, l);
+                return 0;
+        }
+
+        return -ENOENT;
+}
+
 int cg_install_release_agent(const char *controller, const char *agent) {
         char *fs = NULL, *contents = NULL, *line = NULL, *sc;
         int r;
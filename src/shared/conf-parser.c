@@ -110,7 +110,7 @@ int config_item_perf_lookup(
 }
 
 /* Run the user supplied parser for an assignment */
-static int next_assignment(
+int config_parse_assignment(
                 const char *filename,
                 unsigned line,
                 ConfigItemLookup lookup,
@@ -160,6 +160,8 @@ static int parse_line(
                 bool relaxed,
                 char **section,
                 char *l,
+                ConfigAssignmentHook hook,
+                void *hook_userdata,
                 void *userdata) {
 
         char *e;
@@ -185,7 +187,7 @@ static int parse_line(
                 if (!fn)
                         return -ENOMEM;
 
-                r = config_parse(fn, NULL, sections, lookup, table, relaxed, userdata);
+                r = config_parse_full(fn, NULL, sections, lookup, table, relaxed, hook, hook_userdata, userdata);
                 free(fn);
 
                 return r;
@@ -239,26 +241,39 @@ static int parse_line(
         *e = 0;
         e++;
 
-        return next_assignment(
+        l = strstrip(l);
+        e = strstrip(e);
+
+        if (hook) {
+                int r;
+
+                r = hook(filename, line, *section, l, e, hook_userdata);
+                if (r < 0)
+                        return r;
+        }
+
+        return config_parse_assignment(
                         filename,
                         line,
                         lookup,
                         table,
                         *section,
-                        strstrip(l),
-                        strstrip(e),
+                        l,
+                        e,
                         relaxed,
                         userdata);
 }
 
 /* Go through the file and parse each line */
-int config_parse(
+int config_parse_full(
                 const char *filename,
                 FILE *f,
                 const char *sections,
                 ConfigItemLookup lookup,
                 void *table,
                 bool relaxed,
+                ConfigAssignmentHook hook,
+                void *hook_userdata,
                 void *userdata) {
 
         unsigned line = 0;
@@ -340,6 +355,8 @@ int config_parse(
                                 relaxed,
                                 &section,
                                 p,
+                                hook,
+                                hook_userdata,
                                 userdata);
                 free(c);
 
@@ -359,6 +376,18 @@ finish:
         return r;
 }
 
+int config_parse(
+                const char *filename,
+                FILE *f,
+                const char *sections,
+                ConfigItemLookup lookup,
+                void *table,
+                bool relaxed,
+                void *userdata) {
+
+        return config_parse_full(filename, f, sections, lookup, table, relaxed, NULL, NULL, userdata);
+}
+
 int config_parse_int(
                 const char *filename,
                 unsigned line,
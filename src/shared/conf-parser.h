@@ -70,6 +70,18 @@ typedef int (*ConfigItemLookup)(
                 void **data,
                 void *userdata);
 
+/* Prototype for a function that is told about every assignment
+ * before it is dispatched, for example to record it so that it can
+ * be replayed later with config_parse_assignment() without touching
+ * the file again */
+typedef int (*ConfigAssignmentHook)(
+                const char *filename,
+                unsigned line,
+                const char *section,
+                const char *lvalue,
+                const char *rvalue,
+                void *userdata);
+
 /* Linear table search implementation of ConfigItemLookup, based on
  * ConfigTableItem arrays */
 int config_item_table_lookup(void *table, const char *section, const char *lvalue, ConfigParserCallback *func, int *ltype, void **data, void *userdata);
@@ -87,6 +99,29 @@ int config_parse(
                 bool relaxed,
                 void *userdata);
 
+int config_parse_full(
+                const char *filename,
+                FILE *f,
+                const char *sections,  /* nulstr */
+                ConfigItemLookup lookup,
+                void *table,
+                bool relaxed,
+                ConfigAssignmentHook hook,
+                void *hook_userdata,
+                void *userdata);
+
+/* Dispatches a single, already tokenized assignment */
+int config_parse_assignment(
+                const char *filename,
+                unsigned line,
+                ConfigItemLookup lookup,
+                void *table,
+                const char *section,
+                const char *lvalue,
+                const char *rvalue,
+                bool relaxed,
+                void *userdata);
+
 /* Generic parsers */
 int config_parse_int(const char *filename, unsigned line, const char *section, const char *lvalue, int ltype, const char *rvalue, void *data, void *userdata);
 int config_parse_unsigned(const char *filename, unsigned line, const char *section, const char *lvalue, int ltype, const char *rvalue, void *data, void *userdata);
@@ -266,6 +266,61 @@ const char *bus_error_message_or_strerror(const DBusError *error, int err) {
         return strerror(err);
 }
 
+int bus_append_bound_properties(
+                DBusMessageIter *iter,
+                const BusBoundProperties *bound_properties,
+                const char *interface,
+                char **properties) {
+
+        const BusBoundProperties *bp;
+        const BusProperty *p;
+        DBusMessageIter sub, sub2, sub3;
+        int r;
+
+        assert(iter);
+        assert(bound_properties);
+
+        /* Appends the properties of the specified interface, or of
+         * all interfaces if NULL or empty, as a{sv}. If a list of
+         * property names is passed only those are appended. */
+
+        if (!dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "{sv}", &sub))
+                return -ENOMEM;
+
+        for (bp = bound_properties; bp->interface; bp++) {
+                if (!isempty(interface) && !streq(bp->interface, interface))
+                        continue;
+
+                for (p = bp->properties; p->property; p++) {
+                        void *data;
+
+                        if (!strv_isempty(properties) && !strv_contains(properties, p->property))
+                                continue;
+
+                        if (!dbus_message_iter_open_container(&sub, DBUS_TYPE_DICT_ENTRY, NULL, &sub2) ||
+                            !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &p->property) ||
+                            !dbus_message_iter_open_container(&sub2, DBUS_TYPE_VARIANT, p->signature, &sub3))
+                                return -ENOMEM;
+
+                        data = (char*)bp->base + p->offset;
+                        if (p->indirect)
+                                data = *(void**)data;
+                        r = p->append(&sub3, p->property, data);
+                        if (r < 0)
+                                return r;
+
+                        if (!dbus_message_iter_close_container(&sub2, &sub3) ||
+                            !dbus_message_iter_close_container(&sub, &sub2))
+                                return -ENOMEM;
+                }
+        }
+
+        if (!dbus_message_iter_close_container(iter, &sub))
+                return -ENOMEM;
+
+        return 0;
+}
+
 DBusHandlerResult bus_default_message_handler(
                 DBusConnection *c,
                 DBusMessage *message,
@@ -348,9 +403,7 @@ get_prop:
 
         } else if (dbus_message_is_method_call(message, "org.freedesktop.DBus.Properties", "GetAll") && bound_properties) {
                 const char *interface;
-                const BusBoundProperties *bp;
-                const BusProperty *p;
-                DBusMessageIter iter, sub, sub2, sub3;
+                DBusMessageIter iter;
 
                 if (!dbus_message_get_args(
                             message,
@@ -370,38 +423,11 @@ get_prop:
 
                 dbus_message_iter_init_append(reply, &iter);
 
-                if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{sv}", &sub))
-                        goto oom;
-
-                for (bp = bound_properties; bp->interface; bp++) {
-                        if (interface[0] && !streq(bp->interface, interface))
-                                continue;
-
-                        for (p = bp->properties; p->property; p++) {
-                                void *data;
-
-                                if (!dbus_message_iter_open_container(&sub, DBUS_TYPE_DICT_ENTRY, NULL, &sub2) ||
-                                    !dbus_message_iter_append_basic(&sub2, DBUS_TYPE_STRING, &p->property) ||
-                                    !dbus_message_iter_open_container(&sub2, DBUS_TYPE_VARIANT, p->signature, &sub3))
-                                        goto oom;
-
-                                data = (char*)bp->base + p->offset;
-                                if (p->indirect)
-                                        data = *(void**)data;
-                                r = p->append(&sub3, p->property, data);
-                                if (r == -ENOMEM)
-                                        goto oom;
-                                if (r < 0)
-                                        return bus_send_error_reply(c, message, NULL, r);
-
-                                if (!dbus_message_iter_close_container(&sub2, &sub3) ||
-                                    !dbus_message_iter_close_container(&sub, &sub2))
-                                        goto oom;
-                        }
-                }
-
-                if (!dbus_message_iter_close_container(&iter, &sub))
+                r = bus_append_bound_properties(&iter, bound_properties, interface, NULL);
+                if (r == -ENOMEM)
                         goto oom;
+                if (r < 0)
+                        return bus_send_error_reply(c, message, NULL, r);
 
         } else if (dbus_message_is_method_call(message, "org.freedesktop.DBus.Properties", "Set") && bound_properties) {
                 const char *interface, *property;
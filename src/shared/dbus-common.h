@@ -114,6 +114,12 @@ typedef struct BusBoundProperties {
         const void *const base;          /* base pointer to which the offset must be added to reach data */
 } BusBoundProperties;
 
+int bus_append_bound_properties(
+                DBusMessageIter *iter,
+                const BusBoundProperties *bound_properties,
+                const char *interface,
+                char **properties);
+
 dbus_bool_t bus_maybe_send_reply (DBusConnection   *c,
                                   DBusMessage *message,
                                   DBusMessage *reply);
@@ -30,6 +30,7 @@
 #define DEFAULT_EXIT_USEC (5*USEC_PER_MINUTE)
 
 #define SYSTEMD_CGROUP_CONTROLLER "name=systemd"
+#define SYSTEMD_CGROUP_AGENT_SOCKET "/run/systemd/cgroups-agent"
 
 #define SIGNALS_CRASH_HANDLER SIGSEGV,SIGILL,SIGFPE,SIGBUS,SIGQUIT,SIGABRT
 #define SIGNALS_IGNORE SIGKILL,SIGPIPE
@@ -159,6 +159,687 @@ static int add_file_change(
         return 0;
 }
 
+/* For each config directory we keep an index of all symlinks below
+ * it, so that finding out whether a unit file is enabled does not
+ * require walking the whole tree and reading every link again for
+ * each unit file. Links are indexed under both their own name and the
+ * name of their destination, since either may refer to the unit. The
+ * index is kept for the lifetime of the process, revalidated by
+ * comparing the mtimes of all directories it covers, and our own
+ * changes to the tree are applied to it directly.
+ *
+ * Directory mtimes have a limited granularity, hence a directory
+ * changed again within the same clock tick after we read it keeps its
+ * mtime. We hence also remember when we read each directory, and one
+ * whose mtime is not at least one tick older than that is read again
+ * the next time the index is used, like one whose mtime changed. Only
+ * the directories which changed are read again, not the whole tree. */
+
+typedef struct SymlinkIndexDir {
+        /* SYMLINK_INDEX_ABSENT if the config directory does not exist */
+        usec_t mtime;
+        /* CLOCK_REALTIME before the mtime and the entries were read */
+        usec_t checked;
+} SymlinkIndexDir;
+
+typedef struct SymlinkIndex {
+        char *config_path;
+
+        /* directory → SymlinkIndexDir */
+        Hashmap *dirs;
+        /* link path → canonicalized link destination */
+        Hashmap *links;
+        /* unit name → strv of link paths */
+        Hashmap *names;
+
+        /* Generation this index was last validated in, see
+         * symlink_index_new_generation() */
+        unsigned generation;
+
+        /* First error hit while scanning the tree */
+        int error;
+} SymlinkIndex;
+
+#define SYMLINK_INDEX_ABSENT ((usec_t) -1)
+
+static Hashmap *symlink_indexes = NULL;
+static unsigned symlink_index_generation = 0;
+
+/* Operations that look up many unit files at once only need to check
+ * whether the indexes are current once, not for each unit file. They
+ * pass a new generation to the lookups, 0 means to always check. */
+static unsigned symlink_index_new_generation(void) {
+        if (++symlink_index_generation == 0)
+                symlink_index_generation = 1;
+
+        return symlink_index_generation;
+}
+
+static void symlink_index_free(SymlinkIndex *i) {
+        char *k;
+
+        if (!i)
+                return;
+
+        while ((k = hashmap_first_key(i->names))) {
+                strv_free(hashmap_remove(i->names, k));
+                free(k);
+        }
+        hashmap_free(i->names);
+
+        while ((k = hashmap_first_key(i->links))) {
+                free(hashmap_remove(i->links, k));
+                free(k);
+        }
+        hashmap_free(i->links);
+
+        while ((k = hashmap_first_key(i->dirs))) {
+                free(hashmap_remove(i->dirs, k));
+                free(k);
+        }
+        hashmap_free(i->dirs);
+
+        free(i->config_path);
+        free(i);
+}
+
+static void symlink_index_drop(SymlinkIndex *i) {
+        assert(i);
+
+        hashmap_remove(symlink_indexes, i->config_path);
+        symlink_index_free(i);
+}
+
+static int symlink_index_set_dir(SymlinkIndex *i, const char *path, usec_t mtime, usec_t checked) {
+        SymlinkIndexDir *d;
+        char *k;
+        int r;
+
+        assert(i);
+        assert(path);
+
+        d = hashmap_get(i->dirs, path);
+        if (d) {
+                d->mtime = mtime;
+                d->checked = checked;
+                return 0;
+        }
+
+        d = new(SymlinkIndexDir, 1);
+        if (!d)
+                return -ENOMEM;
+        d->mtime = mtime;
+        d->checked = checked;
+
+        k = strdup(path);
+        if (!k) {
+                free(d);
+                return -ENOMEM;
+        }
+
+        r = hashmap_put(i->dirs, k, d);
+        if (r < 0) {
+                free(k);
+                free(d);
+                return r;
+        }
+
+        return 0;
+}
+
+static void symlink_index_unset_dir(SymlinkIndex *i, const char *path) {
+        SymlinkIndexDir *d;
+        char *k;
+
+        assert(i);
+        assert(path);
+
+        d = hashmap_get2(i->dirs, path, (void**) &k);
+        if (!d)
+                return;
+
+        hashmap_remove(i->dirs, path);
+        free(k);
+        free(d);
+}
+
+static int symlink_index_add_name(SymlinkIndex *i, const char *name, const char *path) {
+        char **l;
+        char *k;
+        int r;
+
+        assert(i);
+        assert(name);
+        assert(path);
+
+        l = hashmap_get(i->names, name);
+        if (l) {
+                if (strv_contains(l, path))
+                        return 0;
+
+                r = strv_extend(&l, path);
+                if (r < 0)
+                        return r;
+
+                return hashmap_update(i->names, name, l);
+        }
+
+        l = strv_new(path, NULL);
+        if (!l)
+                return -ENOMEM;
+
+        k = strdup(name);
+        if (!k) {
+                strv_free(l);
+                return -ENOMEM;
+        }
+
+        r = hashmap_put(i->names, k, l);
+        if (r < 0) {
+                free(k);
+                strv_free(l);
+                return r;
+        }
+
+        return 0;
+}
+
+static void symlink_index_remove_name(SymlinkIndex *i, const char *name, const char *path) {
+        char **l;
+        char *k;
+
+        assert(i);
+        assert(name);
+        assert(path);
+
+        l = hashmap_get2(i->names, name, (void**) &k);
+        if (!l)
+                return;
+
+        strv_remove(l, path);
+        if (!strv_isempty(l))
+                return;
+
+        hashmap_remove(i->names, name);
+        free(k);
+        strv_free(l);
+}
+
+static void symlink_index_remove_link(SymlinkIndex *i, const char *path) {
+        char *dest, *k;
+
+        assert(i);
+        assert(path);
+
+        dest = hashmap_get2(i->links, path, (void**) &k);
+        if (!dest)
+                return;
+
+        symlink_index_remove_name(i, path_get_file_name(k), k);
+        symlink_index_remove_name(i, path_get_file_name(dest), k);
+
+        hashmap_remove(i->links, path);
+        free(k);
+        free(dest);
+}
+
+/* Takes possession of dest */
+static int symlink_index_add_link(SymlinkIndex *i, const char *path, char *dest) {
+        char *k;
+        int r;
+
+        assert(i);
+        assert(path);
+        assert(dest);
+
+        symlink_index_remove_link(i, path);
+
+        k = strdup(path);
+        if (!k) {
+                free(dest);
+                return -ENOMEM;
+        }
+
+        r = hashmap_put(i->links, k, dest);
+        if (r < 0) {
+                free(k);
+                free(dest);
+                return r;
+        }
+
+        r = symlink_index_add_name(i, path_get_file_name(k), k);
+        if (r < 0)
+                return r;
+
+        return symlink_index_add_name(i, path_get_file_name(dest), k);
+}
+
+/* Drops the links in path from the index, and if recursive also
+ * everything below it, including the subdirectories themselves */
+static int symlink_index_remove_dir(SymlinkIndex *i, const char *path, bool recursive) {
+        char _cleanup_strv_free_ **l = NULL;
+        Iterator j;
+        const char *k;
+        void *v;
+        char **p;
+        int r;
+
+        assert(i);
+        assert(path);
+
+        HASHMAP_FOREACH_KEY(v, k, i->links, j) {
+                const char *e;
+
+                e = path_startswith(k, path);
+                if (!e || (!recursive && strchr(e, '/')))
+                        continue;
+
+                r = strv_extend(&l, k);
+                if (r < 0)
+                        return r;
+        }
+
+        STRV_FOREACH(p, l)
+                symlink_index_remove_link(i, *p);
+
+        if (!recursive)
+                return 0;
+
+        strv_free(l);
+        l = NULL;
+
+        HASHMAP_FOREACH_KEY(v, k, i->dirs, j) {
+                if (!path_startswith(k, path) || path_equal(k, path))
+                        continue;
+
+                r = strv_extend(&l, k);
+                if (r < 0)
+                        return r;
+        }
+
+        STRV_FOREACH(p, l)
+                symlink_index_unset_dir(i, *p);
+
+        return 0;
+}
+
+/* With rescan, subdirectories already in the index are skipped, they
+ * are checked on their own */
+static int symlink_index_scan_fd(SymlinkIndex *i, int fd, const char *path, bool rescan) {
+        DIR _cleanup_closedir_ *d = NULL;
+        struct stat st;
+        usec_t checked;
+        int r;
+
+        assert(i);
+        assert(fd >= 0);
+        assert(path);
+
+        d = fdopendir(fd);
+        if (!d) {
+                close_nointr_nofail(fd);
+                return -errno;
+        }
+
+        /* Record the mtime before reading the entries, so that
+         * changes made while we read them invalidate the index */
+        checked = now(CLOCK_REALTIME);
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        r = symlink_index_set_dir(i, path, timespec_load(&st.st_mtim), checked);
+        if (r < 0)
+                return r;
+
+        for (;;) {
+                int k;
+                struct dirent *de;
+                union dirent_storage buf;
+
+                k = readdir_r(d, &buf.de, &de);
+                if (k != 0)
+                        return -errno;
+
+                if (!de)
+                        return 0;
+
+                if (ignore_file(de->d_name))
+                        continue;
+
+                dirent_ensure_type(d, de);
+
+                if (de->d_type == DT_DIR) {
+                        int nfd, q;
+                        char _cleanup_free_ *p = NULL;
+
+                        p = path_make_absolute(de->d_name, path);
+                        if (!p)
+                                return -ENOMEM;
+
+                        if (rescan && hashmap_get(i->dirs, p))
+                                continue;
+
+                        nfd = openat(fd, de->d_name, O_RDONLY|O_NONBLOCK|O_DIRECTORY|O_CLOEXEC|O_NOFOLLOW);
+                        if (nfd < 0) {
+                                if (errno == ENOENT)
+                                        continue;
+
+                                if (i->error == 0)
+                                        i->error = -errno;
+                                continue;
+                        }
+
+                        /* This will close nfd, regardless whether it succeeds or not */
+                        q = symlink_index_scan_fd(i, nfd, p, false);
+                        if (q == -ENOMEM)
+                                return q;
+
+                        if (q < 0 && i->error == 0)
+                                i->error = q;
+
+                } else if (de->d_type == DT_LNK) {
+                        char _cleanup_free_ *p = NULL;
+                        char *dest = NULL;
+                        int q;
+
+                        p = path_make_absolute(de->d_name, path);
+                        if (!p)
+                                return -ENOMEM;
+
+                        q = readlink_and_canonicalize(p, &dest);
+                        if (q < 0) {
+                                if (q == -ENOENT)
+                                        continue;
+
+                                if (i->error == 0)
+                                        i->error = q;
+                                continue;
+                        }
+
+                        q = symlink_index_add_link(i, p, dest);
+                        if (q < 0)
+                                return q;
+                }
+        }
+}
+
+/* The granularity of the file system timestamp mtime was taken from */
+static usec_t symlink_index_tick(usec_t mtime) {
+        long hz;
+
+        /* File systems which store whole seconds only */
+        if (mtime % USEC_PER_SEC == 0)
+                return USEC_PER_SEC;
+
+        hz = sysconf(_SC_CLK_TCK);
+        if (hz <= 0)
+                return USEC_PER_SEC;
+
+        return USEC_PER_SEC / hz;
+}
+
+/* Reads the directories which changed since we read them again.
+ * Returns < 0 if the index needs to be built from scratch. */
+static int symlink_index_refresh(SymlinkIndex *i) {
+        char _cleanup_strv_free_ **dirty = NULL;
+        SymlinkIndexDir *d;
+        Iterator j;
+        const char *p;
+        char **k;
+        int r;
+
+        assert(i);
+
+        HASHMAP_FOREACH_KEY(d, p, i->dirs, j) {
+                struct stat st;
+
+                if (stat(p, &st) < 0) {
+                        if (errno != ENOENT)
+                                return -errno;
+
+                        if (d->mtime == SYMLINK_INDEX_ABSENT)
+                                continue;
+
+                } else if (!S_ISDIR(st.st_mode))
+                        return -ENOTDIR;
+
+                /* Unchanged, and not possibly changed again within
+                 * the same tick after we read it */
+                else if (d->mtime == timespec_load(&st.st_mtim) &&
+                         d->mtime + symlink_index_tick(d->mtime) <= d->checked)
+                        continue;
+
+                r = strv_extend(&dirty, p);
+                if (r < 0)
+                        return r;
+        }
+
+        /* Parents first, which drop subdirectories that are gone
+         * together with them */
+        strv_sort(dirty);
+
+        STRV_FOREACH(k, dirty) {
+                int fd;
+
+                if (!hashmap_get(i->dirs, *k))
+                        continue;
+
+                fd = open(*k, O_RDONLY|O_NONBLOCK|O_DIRECTORY|O_CLOEXEC|O_NOFOLLOW);
+                if (fd < 0) {
+                        if (errno != ENOENT)
+                                return -errno;
+
+                        r = symlink_index_remove_dir(i, *k, true);
+                        if (r < 0)
+                                return r;
+
+                        if (path_equal(*k, i->config_path)) {
+                                r = symlink_index_set_dir(i, *k, SYMLINK_INDEX_ABSENT, 0);
+                                if (r < 0)
+                                        return r;
+                        } else
+                                symlink_index_unset_dir(i, *k);
+
+                        continue;
+                }
+
+                r = symlink_index_remove_dir(i, *k, false);
+                if (r < 0) {
+                        close_nointr_nofail(fd);
+                        return r;
+                }
+
+                /* This takes possession of fd and closes it */
+                r = symlink_index_scan_fd(i, fd, *k, true);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static int symlink_index_new(const char *config_path, SymlinkIndex **ret) {
+        SymlinkIndex *i;
+        int fd, r;
+
+        assert(config_path);
+        assert(ret);
+
+        i = new0(SymlinkIndex, 1);
+        if (!i)
+                return -ENOMEM;
+
+        i->config_path = strdup(config_path);
+        i->dirs = hashmap_new(string_hash_func, string_compare_func);
+        i->links = hashmap_new(string_hash_func, string_compare_func);
+        i->names = hashmap_new(string_hash_func, string_compare_func);
+        if (!i->config_path || !i->dirs || !i->links || !i->names) {
+                r = -ENOMEM;
+                goto fail;
+        }
+
+        path_kill_slashes(i->config_path);
+
+        fd = open(i->config_path, O_RDONLY|O_NONBLOCK|O_DIRECTORY|O_CLOEXEC|O_NOFOLLOW);
+        if (fd < 0) {
+                if (errno != ENOENT) {
+                        r = -errno;
+                        goto fail;
+                }
+
+                r = symlink_index_set_dir(i, i->config_path, SYMLINK_INDEX_ABSENT, 0);
+        } else
+                /* This takes possession of fd and closes it */
+                r = symlink_index_scan_fd(i, fd, i->config_path, false);
+        if (r < 0)
+                goto fail;
+
+        *ret = i;
+        return 0;
+
+fail:
+        symlink_index_free(i);
+        return r;
+}
+
+static int symlink_index_get(const char *config_path, unsigned generation, SymlinkIndex **ret) {
+        char _cleanup_free_ *p = NULL;
+        SymlinkIndex *i;
+        int r;
+
+        assert(config_path);
+        assert(ret);
+
+        p = strdup(config_path);
+        if (!p)
+                return -ENOMEM;
+
+        path_kill_slashes(p);
+
+        i = hashmap_get(symlink_indexes, p);
+        if (i) {
+                if ((generation != 0 && i->generation == generation) ||
+                    symlink_index_refresh(i) >= 0) {
+                        i->generation = generation;
+                        *ret = i;
+                        return 0;
+                }
+
+                symlink_index_drop(i);
+        }
+
+        r = hashmap_ensure_allocated(&symlink_indexes, string_hash_func, string_compare_func);
+        if (r < 0)
+                return r;
+
+        r = symlink_index_new(p, &i);
+        if (r < 0)
+                return r;
+
+        r = hashmap_put(symlink_indexes, i->config_path, i);
+        if (r < 0) {
+                symlink_index_free(i);
+                return r;
+        }
+
+        i->generation = generation;
+        *ret = i;
+        return 0;
+}
+
+/* Returns the cached index covering path, if there is one, brought
+ * up to date. Call this before changing anything below a config
+ * directory and symlink_index_sync() afterwards. */
+static SymlinkIndex *symlink_index_prepare(const char *path) {
+        SymlinkIndex *i;
+        Iterator j;
+
+        assert(path);
+
+        HASHMAP_FOREACH(i, symlink_indexes, j) {
+                if (!path_startswith(path, i->config_path))
+                        continue;
+
+                if (symlink_index_refresh(i) >= 0)
+                        return i;
+
+                symlink_index_drop(i);
+                return NULL;
+        }
+
+        return NULL;
+}
+
+/* Updates the index after path has been created, changed or
+ * removed, together with the directories leading to it */
+static void symlink_index_sync(SymlinkIndex **index, const char *path) {
+        char _cleanup_free_ *p = NULL;
+        SymlinkIndex *i;
+        struct stat st;
+        usec_t checked;
+        char *e;
+        int r;
+
+        assert(index);
+
+        i = *index;
+        if (!i)
+                return;
+
+        assert(path);
+
+        p = strdup(path);
+        if (!p)
+                goto fail;
+
+        path_kill_slashes(p);
+
+        symlink_index_remove_link(i, p);
+
+        if (lstat(p, &st) >= 0 && S_ISLNK(st.st_mode)) {
+                char *dest;
+
+                r = readlink_and_canonicalize(p, &dest);
+                if (r < 0)
+                        goto fail;
+
+                r = symlink_index_add_link(i, p, dest);
+                if (r < 0)
+                        goto fail;
+        }
+
+        while ((e = strrchr(p, '/')) && e != p) {
+                *e = 0;
+
+                if (!path_startswith(p, i->config_path))
+                        break;
+
+                checked = now(CLOCK_REALTIME);
+                if (stat(p, &st) >= 0)
+                        r = symlink_index_set_dir(i, p, timespec_load(&st.st_mtim), checked);
+                else if (errno != ENOENT)
+                        goto fail;
+                else if (path_equal(p, i->config_path))
+                        r = symlink_index_set_dir(i, p, SYMLINK_INDEX_ABSENT, 0);
+                else {
+                        symlink_index_unset_dir(i, p);
+                        r = 0;
+                }
+                if (r < 0)
+                        goto fail;
+
+                if (path_equal(p, i->config_path))
+                        break;
+        }
+
+        return;
+
+fail:
+        /* Rebuild it from scratch next time */
+        symlink_index_drop(i);
+        *index = NULL;
+}
+
 static int mark_symlink_for_removal(
                 Set **remove_symlinks_to,
                 const char *p) {
@@ -286,6 +967,9 @@ static int remove_marked_symlinks_fd(
                                 found = found && strv_contains(files, path_get_file_name(p));
 
                         if (found) {
+                                SymlinkIndex *i;
+
+                                i = symlink_index_prepare(p);
 
                                 if (unlink(p) < 0 && errno != ENOENT) {
 
@@ -295,6 +979,8 @@ static int remove_marked_symlinks_fd(
                                         rmdir_parents(p, config_path);
                                         path_kill_slashes(p);
 
+                                        symlink_index_sync(&i, p);
+
                                         add_file_change(changes, n_changes, UNIT_FILE_UNLINK, p, NULL);
 
                                         if (!set_get(remove_symlinks_to, p)) {
@@ -482,29 +1168,66 @@ static int find_symlinks_fd(
 static int find_symlinks(
                 const char *name,
                 const char *config_path,
+                unsigned generation,
                 bool *same_name_link) {
 
-        int fd;
+        SymlinkIndex *i;
+        char **p;
+        int fd, r;
 
         assert(name);
         assert(config_path);
         assert(same_name_link);
 
-        fd = open(config_path, O_RDONLY|O_NONBLOCK|O_DIRECTORY|O_CLOEXEC|O_NOFOLLOW);
-        if (fd < 0) {
-                if (errno == ENOENT)
-                        return 0;
-                return -errno;
+        if (path_is_absolute(name)) {
+                fd = open(config_path, O_RDONLY|O_NONBLOCK|O_DIRECTORY|O_CLOEXEC|O_NOFOLLOW);
+                if (fd < 0) {
+                        if (errno == ENOENT)
+                                return 0;
+                        return -errno;
+                }
+
+                /* This takes possession of fd and closes it */
+                return find_symlinks_fd(name, fd, config_path, config_path, same_name_link);
+        }
+
+        r = symlink_index_get(config_path, generation, &i);
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(p, (char**) hashmap_get(i->names, name)) {
+                const char *dest;
+
+                dest = hashmap_get(i->links, *p);
+                assert(dest);
+
+                if (streq(path_get_file_name(*p), name) &&
+                    streq(path_get_file_name(dest), name)) {
+                        char _cleanup_free_ *t = NULL;
+
+                        /* Filter out same name links in the main
+                         * config path */
+                        t = path_make_absolute(name, config_path);
+                        if (!t)
+                                return -ENOMEM;
+
+                        if (path_equal(t, *p)) {
+                                *same_name_link = true;
+                                continue;
+                        }
+                }
+
+                return 1;
         }
 
-        /* This takes possession of fd and closes it */
-        return find_symlinks_fd(name, fd, config_path, config_path, same_name_link);
+        return i->error;
 }
 
 static int find_symlinks_in_scope(
                 UnitFileScope scope,
                 const char *root_dir,
                 const char *name,
+                unsigned generation,
                 UnitFileState *state) {
 
         int r;
@@ -522,7 +1245,7 @@ static int find_symlinks_in_scope(
                 if (r < 0)
                         return r;
 
-                r = find_symlinks(name, path, &same_name_link_runtime);
+                r = find_symlinks(name, path, generation, &same_name_link_runtime);
                 if (r < 0)
                         return r;
                 else if (r > 0) {
@@ -536,7 +1259,7 @@ static int find_symlinks_in_scope(
         if (r < 0)
                 return r;
 
-        r = find_symlinks(name, path, &same_name_link);
+        r = find_symlinks(name, path, generation, &same_name_link);
         if (r < 0)
                 return r;
         else if (r > 0) {
@@ -579,6 +1302,7 @@ int unit_file_mask(
 
         STRV_FOREACH(i, files) {
                 char _cleanup_free_ *path = NULL;
+                SymlinkIndex *index;
 
                 if (!unit_name_is_valid(*i, true)) {
                         if (r == 0)
@@ -592,7 +1316,10 @@ int unit_file_mask(
                         break;
                 }
 
+                index = symlink_index_prepare(path);
+
                 if (symlink("/dev/null", path) >= 0) {
+                        symlink_index_sync(&index, path);
                         add_file_change(changes, n_changes, UNIT_FILE_SYMLINK, path, "/dev/null");
 
                         continue;
@@ -605,8 +1332,10 @@ int unit_file_mask(
 
                         if (force) {
                                 unlink(path);
+                                symlink_index_sync(&index, path);
 
                                 if (symlink("/dev/null", path) >= 0) {
+                                        symlink_index_sync(&index, path);
 
                                         add_file_change(changes, n_changes, UNIT_FILE_UNLINK, path, NULL);
                                         add_file_change(changes, n_changes, UNIT_FILE_SYMLINK, path, "/dev/null");
@@ -662,7 +1391,12 @@ int unit_file_unmask(
 
                 q = null_or_empty_path(path);
                 if (q > 0) {
+                        SymlinkIndex *index;
+
+                        index = symlink_index_prepare(path);
+
                         if (unlink(path) >= 0) {
+                                symlink_index_sync(&index, path);
                                 mark_symlink_for_removal(&remove_symlinks_to, path);
                                 add_file_change(changes, n_changes, UNIT_FILE_UNLINK, path, NULL);
 
@@ -718,6 +1452,7 @@ int unit_file_link(
 
         STRV_FOREACH(i, files) {
                 char _cleanup_free_ *path = NULL;
+                SymlinkIndex *index;
                 char *fn;
                 struct stat st;
 
@@ -752,7 +1487,10 @@ int unit_file_link(
                 if (!path)
                         return -ENOMEM;
 
+                index = symlink_index_prepare(path);
+
                 if (symlink(*i, path) >= 0) {
+                        symlink_index_sync(&index, path);
                         add_file_change(changes, n_changes, UNIT_FILE_SYMLINK, path, *i);
                         continue;
                 }
@@ -773,8 +1511,10 @@ int unit_file_link(
 
                         if (force) {
                                 unlink(path);
+                                symlink_index_sync(&index, path);
 
                                 if (symlink(*i, path) >= 0) {
+                                        symlink_index_sync(&index, path);
 
                                         add_file_change(changes, n_changes, UNIT_FILE_UNLINK, path, NULL);
                                         add_file_change(changes, n_changes, UNIT_FILE_SYMLINK, path, *i);
@@ -1148,14 +1888,18 @@ static int create_symlink(
                 unsigned *n_changes) {
 
         char _cleanup_free_ *dest = NULL;
+        SymlinkIndex *i;
         int r;
 
         assert(old_path);
         assert(new_path);
 
+        i = symlink_index_prepare(new_path);
+
         mkdir_parents_label(new_path, 0755);
 
         if (symlink(old_path, new_path) >= 0) {
+                symlink_index_sync(&i, new_path);
                 add_file_change(changes, n_changes, UNIT_FILE_SYMLINK, new_path, old_path);
                 return 0;
         }
@@ -1174,8 +1918,10 @@ static int create_symlink(
                 return -EEXIST;
 
         unlink(new_path);
+        symlink_index_sync(&i, new_path);
 
         if (symlink(old_path, new_path) >= 0) {
+                symlink_index_sync(&i, new_path);
                 add_file_change(changes, n_changes, UNIT_FILE_UNLINK, new_path, NULL);
                 add_file_change(changes, n_changes, UNIT_FILE_SYMLINK, new_path, old_path);
                 return 0;
@@ -1630,7 +2376,7 @@ UnitFileState unit_file_get_state(
                         return state;
                 }
 
-                r = find_symlinks_in_scope(scope, root_dir, name, &state);
+                r = find_symlinks_in_scope(scope, root_dir, name, 0, &state);
                 if (r < 0)
                         return r;
                 else if (r > 0)
@@ -1804,6 +2550,7 @@ int unit_file_get_list(
         char **i;
         char _cleanup_free_ *buf = NULL;
         DIR _cleanup_closedir_ *d = NULL;
+        unsigned generation;
         int r;
 
         assert(scope >= 0);
@@ -1817,6 +2564,9 @@ int unit_file_get_list(
         if (r < 0)
                 return r;
 
+        /* Check the symlink indexes only once for all unit files */
+        generation = symlink_index_new_generation();
+
         STRV_FOREACH(i, paths.unit_path) {
                 const char *units_dir;
 
@@ -1893,7 +2643,7 @@ int unit_file_get_list(
                                 goto found;
                         }
 
-                        r = find_symlinks_in_scope(scope, root_dir, de->d_name, &f->state);
+                        r = find_symlinks_in_scope(scope, root_dir, de->d_name, generation, &f->state);
                         if (r < 0)
                                 return r;
                         else if (r > 0) {
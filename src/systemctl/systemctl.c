@@ -79,6 +79,7 @@ static bool arg_no_pager = false;
 static bool arg_no_wtmp = false;
 static bool arg_no_wall = false;
 static bool arg_no_reload = false;
+static bool arg_incremental = false;
 static bool arg_ignore_inhibitors = false;
 static bool arg_dry = false;
 static bool arg_quiet = false;
@@ -445,15 +446,257 @@ static void output_units_list(const struct unit_info *unit_infos, unsigned c) {
         }
 }
 
-static int list_units(DBusConnection *bus, char **args) {
+static int unit_info_property(const char *name, DBusMessageIter *iter, struct unit_info *u) {
+
+        assert(name);
+        assert(iter);
+        assert(u);
+
+        switch (dbus_message_iter_get_arg_type(iter)) {
+
+        case DBUS_TYPE_STRING: {
+                const char *s;
+
+                dbus_message_iter_get_basic(iter, &s);
+
+                if (streq(name, "Id"))
+                        u->id = s;
+                else if (streq(name, "Description"))
+                        u->description = s;
+                else if (streq(name, "LoadState"))
+                        u->load_state = s;
+                else if (streq(name, "ActiveState"))
+                        u->active_state = s;
+                else if (streq(name, "SubState"))
+                        u->sub_state = s;
+                else if (streq(name, "Following"))
+                        u->following = s;
+
+                break;
+        }
+
+        case DBUS_TYPE_STRUCT:
+
+                if (streq(name, "Job")) {
+                        DBusMessageIter sub;
+
+                        dbus_message_iter_recurse(iter, &sub);
+
+                        if (bus_iter_get_basic_and_next(&sub, DBUS_TYPE_UINT32, &u->job_id, true) < 0 ||
+                            bus_iter_get_basic_and_next(&sub, DBUS_TYPE_OBJECT_PATH, &u->job_path, false) < 0)
+                                return -EIO;
+                }
+
+                break;
+        }
+
+        return 0;
+}
+
+static int get_unit_infos(DBusConnection *bus, DBusMessage **_reply, DBusMessage **_jobs, struct unit_info **_unit_infos, unsigned *_c) {
+        static const char *properties[] = {
+                "Id",
+                "Description",
+                "LoadState",
+                "ActiveState",
+                "SubState",
+                "Following",
+                "Job",
+                NULL
+        };
+
+        _cleanup_dbus_message_unref_ DBusMessage *reply = NULL, *jobs = NULL;
+        _cleanup_free_ struct unit_info *unit_infos = NULL;
+        _cleanup_free_ char *glob = NULL;
+        const char **properties_ptr = properties;
+        DBusMessageIter iter, sub, sub2, sub3, sub4, sub5;
+        char *names[2] = { NULL, NULL }, **names_ptr = names;
+        const char *states[2] = { NULL, NULL }, **states_ptr = states;
+        unsigned c = 0, n_units = 0, n_jobs = 0;
+        DBusError error;
+        int r;
+
+        /* Fetch only the properties we show, and let the manager
+         * filter by type and state, in a single call */
+
+        if (arg_type) {
+                glob = strappend("*.", arg_type);
+                if (!glob)
+                        return log_oom();
+
+                names[0] = glob;
+        }
+
+        if (arg_failed)
+                states[0] = "failed";
+        else if (arg_load_state)
+                states[0] = arg_load_state;
+
+        dbus_error_init(&error);
+
+        r = bus_method_call_with_reply(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.systemd1.Manager",
+                        "GetUnitProperties",
+                        &reply,
+                        &error,
+                        DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &names_ptr, strv_length(names),
+                        DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &states_ptr, strv_length((char**) states),
+                        DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &properties_ptr, ELEMENTSOF(properties) - 1,
+                        DBUS_TYPE_INVALID);
+        if (r < 0) {
+                if (dbus_error_has_name(&error, DBUS_ERROR_UNKNOWN_METHOD))
+                        r = -EOPNOTSUPP;
+                else
+                        log_error("Failed to issue method call: %s", bus_error_message(&error));
+
+                dbus_error_free(&error);
+                return r;
+        }
+
+        if (!dbus_message_iter_init(reply, &iter) ||
+            dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY ||
+            dbus_message_iter_get_element_type(&iter) != DBUS_TYPE_STRUCT)  {
+                log_error("Failed to parse reply.");
+                return -EIO;
+        }
+
+        for (dbus_message_iter_recurse(&iter, &sub);
+             dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID;
+             dbus_message_iter_next(&sub)) {
+                struct unit_info *u;
+                const char *id;
+
+                if (dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_STRUCT) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                if (c >= n_units) {
+                        struct unit_info *w;
+
+                        n_units = MAX(2*c, 16);
+                        w = realloc(unit_infos, sizeof(struct unit_info) * n_units);
+                        if (!w)
+                                return log_oom();
+
+                        unit_infos = w;
+                }
+
+                u = unit_infos + c;
+                zero(*u);
+                u->description = u->following = u->job_type = "";
+
+                dbus_message_iter_recurse(&sub, &sub2);
+
+                if (bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_STRING, &id, true) < 0 ||
+                    dbus_message_iter_get_arg_type(&sub2) != DBUS_TYPE_ARRAY) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                u->id = id;
+
+                for (dbus_message_iter_recurse(&sub2, &sub3);
+                     dbus_message_iter_get_arg_type(&sub3) != DBUS_TYPE_INVALID;
+                     dbus_message_iter_next(&sub3)) {
+                        const char *name;
+
+                        if (dbus_message_iter_get_arg_type(&sub3) != DBUS_TYPE_DICT_ENTRY) {
+                                log_error("Failed to parse reply.");
+                                return -EIO;
+                        }
+
+                        dbus_message_iter_recurse(&sub3, &sub4);
+
+                        if (bus_iter_get_basic_and_next(&sub4, DBUS_TYPE_STRING, &name, true) < 0 ||
+                            dbus_message_iter_get_arg_type(&sub4) != DBUS_TYPE_VARIANT) {
+                                log_error("Failed to parse reply.");
+                                return -EIO;
+                        }
+
+                        dbus_message_iter_recurse(&sub4, &sub5);
+
+                        if (unit_info_property(name, &sub5, u) < 0) {
+                                log_error("Failed to parse reply.");
+                                return -EIO;
+                        }
+                }
+
+                if (!u->load_state || !u->active_state || !u->sub_state) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                if (u->job_id > 0)
+                        n_jobs++;
+
+                c++;
+        }
+
+        if (n_jobs > 0) {
+                /* The job types are not unit properties, look them
+                 * up with one more call */
+                r = bus_method_call_with_reply(
+                                bus,
+                                "org.freedesktop.systemd1",
+                                "/org/freedesktop/systemd1",
+                                "org.freedesktop.systemd1.Manager",
+                                "ListJobs",
+                                &jobs,
+                                NULL,
+                                DBUS_TYPE_INVALID);
+                if (r < 0)
+                        return r;
+
+                if (!dbus_message_iter_init(jobs, &iter) ||
+                    dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY ||
+                    dbus_message_iter_get_element_type(&iter) != DBUS_TYPE_STRUCT)  {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                for (dbus_message_iter_recurse(&iter, &sub);
+                     dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID;
+                     dbus_message_iter_next(&sub)) {
+                        const char *name, *type;
+                        uint32_t id;
+                        unsigned i;
+
+                        dbus_message_iter_recurse(&sub, &sub2);
+
+                        if (bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_UINT32, &id, true) < 0 ||
+                            bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_STRING, &name, true) < 0 ||
+                            bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_STRING, &type, false) < 0) {
+                                log_error("Failed to parse reply.");
+                                return -EIO;
+                        }
+
+                        for (i = 0; i < c; i++)
+                                if (unit_infos[i].job_id == id)
+                                        unit_infos[i].job_type = type;
+                }
+        }
+
+        *_reply = reply;
+        *_jobs = jobs;
+        *_unit_infos = unit_infos;
+        *_c = c;
+        reply = jobs = NULL;
+        unit_infos = NULL;
+
+        return 0;
+}
+
+static int get_unit_infos_legacy(DBusConnection *bus, DBusMessage **_reply, struct unit_info **_unit_infos, unsigned *_c) {
         _cleanup_dbus_message_unref_ DBusMessage *reply = NULL;
         _cleanup_free_ struct unit_info *unit_infos = NULL;
         DBusMessageIter iter, sub, sub2;
         unsigned c = 0, n_units = 0;
         int r;
 
-        pager_open_if_enabled();
-
         r = bus_method_call_with_reply(
                         bus,
                         "org.freedesktop.systemd1",
@@ -513,6 +756,30 @@ static int list_units(DBusConnection *bus, char **args) {
                 c++;
         }
 
+        *_reply = reply;
+        *_unit_infos = unit_infos;
+        *_c = c;
+        reply = NULL;
+        unit_infos = NULL;
+
+        return 0;
+}
+
+static int list_units(DBusConnection *bus, char **args) {
+        _cleanup_dbus_message_unref_ DBusMessage *reply = NULL, *jobs = NULL;
+        _cleanup_free_ struct unit_info *unit_infos = NULL;
+        unsigned c = 0;
+        int r;
+
+        pager_open_if_enabled();
+
+        r = get_unit_infos(bus, &reply, &jobs, &unit_infos, &c);
+        if (r == -EOPNOTSUPP)
+                /* Older manager */
+                r = get_unit_infos_legacy(bus, &reply, &unit_infos, &c);
+        if (r < 0)
+                return r;
+
         if (c > 0) {
                 qsort(unit_infos, c, sizeof(struct unit_info), compare_unit_info);
                 output_units_list(unit_infos, c);
@@ -3233,40 +3500,24 @@ static int print_property(const char *name, DBusMessageIter *iter) {
         return 0;
 }
 
-static int show_one(const char *verb, DBusConnection *bus, const char *path, bool show_properties, bool *new_line) {
-        _cleanup_free_ DBusMessage *reply = NULL;
-        const char *interface = "";
+static int show_one_properties(const char *verb, DBusMessageIter *iter, bool show_properties, bool *new_line) {
         int r;
-        DBusMessageIter iter, sub, sub2, sub3;
+        DBusMessageIter sub, sub2, sub3;
         UnitStatusInfo info;
         ExecStatusInfo *p;
 
-        assert(path);
+        assert(iter);
         assert(new_line);
 
         zero(info);
 
-        r = bus_method_call_with_reply(
-                        bus,
-                        "org.freedesktop.systemd1",
-                        path,
-                        "org.freedesktop.DBus.Properties",
-                        "GetAll",
-                        &reply,
-                        NULL,
-                        DBUS_TYPE_STRING, &interface,
-                        DBUS_TYPE_INVALID);
-        if (r < 0)
-                return r;
-
-        if (!dbus_message_iter_init(reply, &iter) ||
-            dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY ||
-            dbus_message_iter_get_element_type(&iter) != DBUS_TYPE_DICT_ENTRY)  {
+        if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY ||
+            dbus_message_iter_get_element_type(iter) != DBUS_TYPE_DICT_ENTRY)  {
                 log_error("Failed to parse reply.");
                 return -EIO;
         }
 
-        dbus_message_iter_recurse(&iter, &sub);
+        dbus_message_iter_recurse(iter, &sub);
 
         if (*new_line)
                 printf("\n");
@@ -3324,6 +3575,162 @@ static int show_one(const char *verb, DBusConnection *bus, const char *path, boo
         return r;
 }
 
+static int show_one(const char *verb, DBusConnection *bus, const char *path, bool show_properties, bool *new_line) {
+        _cleanup_free_ DBusMessage *reply = NULL;
+        const char *interface = "";
+        DBusMessageIter iter;
+        int r;
+
+        assert(path);
+        assert(new_line);
+
+        r = bus_method_call_with_reply(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        path,
+                        "org.freedesktop.DBus.Properties",
+                        "GetAll",
+                        &reply,
+                        NULL,
+                        DBUS_TYPE_STRING, &interface,
+                        DBUS_TYPE_INVALID);
+        if (r < 0)
+                return r;
+
+        if (!dbus_message_iter_init(reply, &iter)) {
+                log_error("Failed to parse reply.");
+                return -EIO;
+        }
+
+        return show_one_properties(verb, &iter, show_properties, new_line);
+}
+
+/* GetUnitProperties() reports a unit it could not return with a
+ * single "Error" property instead of its properties */
+static bool unit_properties_error(DBusMessageIter *iter, const char **error_name, const char **error_message) {
+        DBusMessageIter sub, sub2, sub3, sub4;
+        const char *key;
+
+        if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY ||
+            dbus_message_iter_get_element_type(iter) != DBUS_TYPE_DICT_ENTRY)
+                return false;
+
+        dbus_message_iter_recurse(iter, &sub);
+        if (dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_DICT_ENTRY)
+                return false;
+
+        dbus_message_iter_recurse(&sub, &sub2);
+        if (bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_STRING, &key, true) < 0 ||
+            !streq(key, "Error") ||
+            dbus_message_iter_get_arg_type(&sub2) != DBUS_TYPE_VARIANT)
+                return false;
+
+        dbus_message_iter_recurse(&sub2, &sub3);
+        if (dbus_message_iter_get_arg_type(&sub3) != DBUS_TYPE_STRUCT)
+                return false;
+
+        dbus_message_iter_recurse(&sub3, &sub4);
+        if (bus_iter_get_basic_and_next(&sub4, DBUS_TYPE_STRING, error_name, true) < 0 ||
+            bus_iter_get_basic_and_next(&sub4, DBUS_TYPE_STRING, error_message, false) < 0)
+                return false;
+
+        return true;
+}
+
+static int show_units(const char *verb, DBusConnection *bus, char **names, bool show_properties, bool *new_line) {
+        _cleanup_dbus_message_unref_ DBusMessage *reply = NULL;
+        DBusMessageIter iter, sub, sub2;
+        DBusError error;
+        char **states = NULL, **properties = NULL, **name;
+        int r, ret = 0;
+
+        assert(new_line);
+
+        if (strv_isempty(names))
+                return 0;
+
+        /* Fetch the properties of all units in one go, rather than
+         * with one GetAll() call per unit */
+        if (show_properties)
+                properties = arg_property;
+
+        dbus_error_init(&error);
+
+        r = bus_method_call_with_reply(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.systemd1.Manager",
+                        "GetUnitProperties",
+                        &reply,
+                        &error,
+                        DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &names, strv_length(names),
+                        DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &states, 0,
+                        DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &properties, strv_length(properties),
+                        DBUS_TYPE_INVALID);
+        if (r < 0) {
+                if (!dbus_error_has_name(&error, DBUS_ERROR_UNKNOWN_METHOD)) {
+                        log_error("Failed to issue method call: %s", bus_error_message(&error));
+                        dbus_error_free(&error);
+                        return r;
+                }
+
+                /* Older manager, query unit by unit */
+                dbus_error_free(&error);
+
+                STRV_FOREACH(name, names) {
+                        _cleanup_free_ char *p = NULL;
+
+                        p = unit_dbus_path_from_name(*name);
+                        if (!p)
+                                return log_oom();
+
+                        r = show_one(verb, bus, p, show_properties, new_line);
+                        if (r != 0)
+                                ret = r;
+                }
+
+                return ret;
+        }
+
+        if (!dbus_message_iter_init(reply, &iter) ||
+            dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY ||
+            dbus_message_iter_get_element_type(&iter) != DBUS_TYPE_STRUCT)  {
+                log_error("Failed to parse reply.");
+                return -EIO;
+        }
+
+        for (dbus_message_iter_recurse(&iter, &sub);
+             dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_INVALID;
+             dbus_message_iter_next(&sub)) {
+                const char *id, *error_name, *error_message;
+
+                if (dbus_message_iter_get_arg_type(&sub) != DBUS_TYPE_STRUCT) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                dbus_message_iter_recurse(&sub, &sub2);
+
+                if (bus_iter_get_basic_and_next(&sub2, DBUS_TYPE_STRING, &id, true) < 0) {
+                        log_error("Failed to parse reply.");
+                        return -EIO;
+                }
+
+                if (unit_properties_error(&sub2, &error_name, &error_message)) {
+                        log_error("Failed to get properties of %s: %s", id, error_message);
+                        ret = streq(error_name, DBUS_ERROR_ACCESS_DENIED) ? -EACCES : -EIO;
+                        continue;
+                }
+
+                r = show_one_properties(verb, &sub2, show_properties, new_line);
+                if (r != 0)
+                        ret = r;
+        }
+
+        return ret;
+}
+
 static int show_one_by_pid(const char *verb, DBusConnection *bus, uint32_t pid, bool *new_line) {
         _cleanup_dbus_message_unref_ DBusMessage *reply = NULL;
         const char *path = NULL;
@@ -3362,6 +3769,7 @@ finish:
 }
 
 static int show(DBusConnection *bus, char **args) {
+        _cleanup_strv_free_ char **units = NULL;
         int r, ret = 0;
         bool show_properties, new_line = false;
         char **name;
@@ -3383,22 +3791,29 @@ static int show(DBusConnection *bus, char **args) {
                 uint32_t id;
 
                 if (safe_atou32(*name, &id) < 0) {
-                        _cleanup_free_ char *p = NULL, *n = NULL;
-                        /* Interpret as unit name */
+                        _cleanup_free_ char *n = NULL;
+                        /* Interpret as unit name, and queue it up
+                         * to be queried together with the other
+                         * unit names that follow */
 
                         n = unit_name_mangle(*name);
                         if (!n)
                                 return log_oom();
 
-                        p = unit_dbus_path_from_name(n);
-                        if (!p)
+                        if (strv_extend(&units, n) < 0)
                                 return log_oom();
 
-                        r = show_one(args[0], bus, p, show_properties, &new_line);
-                        if (r != 0)
-                                ret = r;
+                        continue;
+                }
+
+                r = show_units(args[0], bus, units, show_properties, &new_line);
+                if (r != 0)
+                        ret = r;
+
+                strv_free(units);
+                units = NULL;
 
-                } else if (show_properties) {
+                if (show_properties) {
                         _cleanup_free_ char *p = NULL;
 
                         /* Interpret as job id */
@@ -3417,6 +3832,10 @@ static int show(DBusConnection *bus, char **args) {
                 }
         }
 
+        r = show_units(args[0], bus, units, show_properties, &new_line);
+        if (r != 0)
+                ret = r;
+
         return ret;
 }
 
@@ -3587,6 +4006,7 @@ static int daemon_reload(DBusConnection *bus, char **args) {
                         streq(args[0], "reboot")        ? "Reboot" :
                         streq(args[0], "kexec")         ? "KExec" :
                         streq(args[0], "exit")          ? "Exit" :
+                        arg_incremental                 ? "ReloadIncremental" :
                                     /* "daemon-reload" */ "Reload";
         }
 
@@ -4315,6 +4735,8 @@ static int systemctl_help(void) {
                "     --no-wall        Don't send wall message before halt/power-off/reboot\n"
                "     --no-reload      When enabling/disabling unit files, don't reload daemon\n"
                "                      configuration\n"
+               "     --incremental    When reloading daemon configuration, only do so if\n"
+               "                      unit files changed\n"
                "     --no-legend      Do not print a legend (column headers and hints)\n"
                "     --no-pager       Do not pipe output into a pager\n"
                "     --no-ask-password\n"
@@ -4508,6 +4930,7 @@ static int systemctl_parse_argv(int argc, char *argv[]) {
                 ARG_ROOT,
                 ARG_FULL,
                 ARG_NO_RELOAD,
+                ARG_INCREMENTAL,
                 ARG_KILL_WHO,
                 ARG_NO_ASK_PASSWORD,
                 ARG_FAILED,
@@ -4539,6 +4962,7 @@ static int systemctl_parse_argv(int argc, char *argv[]) {
                 { "root",      required_argument, NULL, ARG_ROOT      },
                 { "force",     no_argument,       NULL, ARG_FORCE     },
                 { "no-reload", no_argument,       NULL, ARG_NO_RELOAD },
+                { "incremental", no_argument,     NULL, ARG_INCREMENTAL },
                 { "kill-who",  required_argument, NULL, ARG_KILL_WHO  },
                 { "signal",    required_argument, NULL, 's'           },
                 { "no-ask-password", no_argument, NULL, ARG_NO_ASK_PASSWORD },
@@ -4678,6 +5102,10 @@ static int systemctl_parse_argv(int argc, char *argv[]) {
                         arg_no_reload = true;
                         break;
 
+                case ARG_INCREMENTAL:
+                        arg_incremental = true;
+                        break;
+
                 case ARG_KILL_WHO:
                         arg_kill_who = optarg;
                         break;
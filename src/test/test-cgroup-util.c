@@ -20,8 +20,22 @@ static void test_cgroup_to_unit(void) {
         check_c_t_u("/system/getty", -EINVAL, "getty.service");
 }
 
+static void test_get_by_pid_buf(void) {
+        char _cleanup_free_ *a = NULL;
+        char b[PATH_MAX], c[1];
+        int r;
+
+        r = cg_get_by_pid("cpu", 0, &a);
+        assert_se(cg_get_by_pid_buf("cpu", 0, b, sizeof(b)) == r);
+        assert_se(r < 0 || streq(a, b));
+        assert_se(r < 0 || cg_get_by_pid_buf("cpu", 0, c, sizeof(c)) == -ENAMETOOLONG);
+
+        assert_se(cg_get_by_pid_buf("nonexistent-controller", 0, b, sizeof(b)) == -ENOENT);
+}
+
 int main(void) {
         test_cgroup_to_unit();
+        test_get_by_pid_buf();
 
         return 0;
 }
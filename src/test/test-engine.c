@@ -25,6 +25,131 @@
 #include <unistd.h>
 
 #include "manager.h"
+#include "fdset.h"
+
+static void write_bench_unit(const char *dir, unsigned i, unsigned n) {
+        char *p;
+        FILE *f;
+        unsigned c[3], k;
+
+        assert_se(asprintf(&p, "%s/bench-%u.target", dir, i) >= 0);
+        assert_se(f = fopen(p, "we"));
+
+        fputs("[Unit]\n"
+              "DefaultDependencies=no\n"
+              "AllowIsolate=yes\n", f);
+
+        /* A binary tree, so that everything is reachable from
+         * bench-0.target, plus one pseudo-random edge per unit. All
+         * edges point to higher ids, hence the ordering is acyclic. */
+        c[0] = 2 * i + 1;
+        c[1] = 2 * i + 2;
+        c[2] = (i * 7919 + 13) % n;
+
+        for (k = 0; k < ELEMENTSOF(c); k++)
+                if (c[k] > i && c[k] < n)
+                        fprintf(f,
+                                "Wants=bench-%u.target\n"
+                                "After=bench-%u.target\n", c[k], c[k]);
+
+        assert_se(fflush(f) == 0 && !ferror(f));
+        fclose(f);
+        free(p);
+}
+
+static void bench_add_job(Manager *m, Unit *u, JobMode mode, const char *what, unsigned n) {
+        char ts[FORMAT_TIMESPAN_MAX];
+        usec_t t;
+        Job *j;
+
+        manager_clear_jobs(m);
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(manager_add_job(m, JOB_START, u, mode, false, NULL, &j) == 0);
+        t = now(CLOCK_MONOTONIC) - t;
+
+        assert_se(hashmap_size(m->jobs) == n);
+
+        printf("%s: %u jobs in %s\n", what, n, format_timespan(ts, sizeof(ts), t));
+}
+
+static void bench_serialize(Manager *m, unsigned n) {
+        char ts[FORMAT_TIMESPAN_MAX];
+        Manager *copy = NULL;
+        Unit *root = NULL;
+        FDSet *fds;
+        FILE *f;
+        usec_t t;
+
+        /* Measures the two halves of a reload separately: writing
+         * out the state of all units and jobs, and reading it back
+         * into a fresh manager that already loaded the units */
+
+        assert_se(fds = fdset_new());
+        assert_se(f = tmpfile());
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(manager_serialize(m, f, fds, true, true) >= 0);
+        assert_se(fflush(f) == 0);
+        t = now(CLOCK_MONOTONIC) - t;
+        printf("Benchmark: serialized %u units in %s, %llu bytes\n",
+               n, format_timespan(ts, sizeof(ts), t), (unsigned long long) ftello(f));
+
+        assert_se(manager_new(SYSTEMD_SYSTEM, &copy) >= 0);
+        assert_se(manager_load_unit(copy, "bench-0.target", NULL, NULL, &root) >= 0);
+
+        rewind(f);
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(manager_deserialize(copy, f, fds) >= 0);
+        t = now(CLOCK_MONOTONIC) - t;
+        printf("Benchmark: deserialized %u units in %s\n", n, format_timespan(ts, sizeof(ts), t));
+
+        assert_se(hashmap_size(copy->jobs) == hashmap_size(m->jobs));
+
+        manager_free(copy);
+        fdset_free(fds);
+        fclose(f);
+}
+
+static void test_transaction_benchmark(unsigned n) {
+        char dir[] = "/tmp/test-engine.XXXXXX";
+        char ts[FORMAT_TIMESPAN_MAX];
+        Manager *m = NULL;
+        Unit *root = NULL;
+        unsigned i;
+        usec_t t;
+
+        /* Builds a synthetic graph of n target units and measures
+         * how long it takes to build transactions for all of them */
+
+        assert_se(mkdtemp(dir));
+
+        for (i = 0; i < n; i++)
+                write_bench_unit(dir, i, n);
+
+        assert_se(set_unit_path(dir) >= 0);
+        assert_se(manager_new(SYSTEMD_SYSTEM, &m) >= 0);
+
+        t = now(CLOCK_MONOTONIC);
+        assert_se(manager_load_unit(m, "bench-0.target", NULL, NULL, &root) >= 0);
+        t = now(CLOCK_MONOTONIC) - t;
+        printf("Benchmark: loaded %u units in %s\n", n, format_timespan(ts, sizeof(ts), t));
+
+        assert_se(m->n_units_by_dense_id >= n);
+
+        /* The first run builds the dependency arrays, the
+         * following ones reuse them */
+        bench_add_job(m, root, JOB_REPLACE, "Benchmark: start (cold)", n);
+        bench_add_job(m, root, JOB_REPLACE, "Benchmark: start (warm)", n);
+        bench_add_job(m, root, JOB_ISOLATE, "Benchmark: isolate", n);
+
+        bench_serialize(m, n);
+
+        manager_free(m);
+
+        assert_se(rm_rf_dangerous(dir, false, true, false) >= 0);
+}
 
 int main(int argc, char *argv[]) {
         Manager *m = NULL;
@@ -95,5 +220,7 @@ int main(int argc, char *argv[]) {
 
         manager_free(m);
 
+        test_transaction_benchmark(10000);
+
         return 0;
 }
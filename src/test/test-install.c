@@ -26,6 +26,7 @@
 
 #include "util.h"
 #include "path-util.h"
+#include "mkdir.h"
 #include "install.h"
 
 static void dump_changes(UnitFileChange *c, unsigned n) {
@@ -41,6 +42,116 @@ static void dump_changes(UnitFileChange *c, unsigned n) {
         }
 }
 
+/* The state of unit files is looked up in an index of the config
+ * symlinks, which needs to notice links added after it was built, also
+ * if the directory mtime did not change */
+static void test_link_after_index(void) {
+        char root[] = "/tmp/test-install.XXXXXX";
+        char _cleanup_free_ *unit = NULL, *wants = NULL, *link = NULL;
+        Hashmap *h;
+        UnitFileList *p;
+        struct stat st;
+        struct timespec ts[2];
+
+        assert_se(mkdtemp(root));
+
+        unit = strappend(root, "/etc/systemd/system/test-link.service");
+        wants = strappend(root, "/etc/systemd/system/multi-user.target.wants");
+        link = strappend(wants, "/test-link.service");
+        assert_se(unit && wants && link);
+
+        assert_se(mkdir_p(wants, 0755) >= 0);
+        assert_se(write_one_line_file(unit, "[Install]\nWantedBy=multi-user.target") >= 0);
+
+        assert_se(unit_file_get_state(UNIT_FILE_SYSTEM, root, "test-link.service") == UNIT_FILE_DISABLED);
+
+        /* Add a link within the same clock tick as the index was
+         * built, which leaves the directory mtime unchanged */
+        assert_se(stat(wants, &st) >= 0);
+        assert_se(symlink("/etc/systemd/system/test-link.service", link) >= 0);
+        ts[0] = st.st_atim;
+        ts[1] = st.st_mtim;
+        assert_se(utimensat(AT_FDCWD, wants, ts, 0) >= 0);
+        assert_se(unit_file_get_state(UNIT_FILE_SYSTEM, root, "test-link.service") == UNIT_FILE_ENABLED);
+
+        h = hashmap_new(string_hash_func, string_compare_func);
+        assert_se(h);
+        assert_se(unit_file_get_list(UNIT_FILE_SYSTEM, root, h) >= 0);
+        p = hashmap_get(h, "test-link.service");
+        assert_se(p && p->state == UNIT_FILE_ENABLED);
+        unit_file_list_free(h);
+
+        assert_se(unlink(link) >= 0);
+        assert_se(unit_file_get_state(UNIT_FILE_SYSTEM, root, "test-link.service") == UNIT_FILE_DISABLED);
+
+        assert_se(rm_rf_dangerous(root, false, true, false) >= 0);
+}
+
+static void set_mtime(const char *path, time_t t) {
+        struct timespec ts[2];
+
+        ts[0].tv_sec = ts[1].tv_sec = t;
+        ts[0].tv_nsec = ts[1].tv_nsec = 0;
+        assert_se(utimensat(AT_FDCWD, path, ts, 0) >= 0);
+}
+
+/* Enabling updates the index in place, and the next operation only
+ * reads the directories which changed again, not the whole tree. To
+ * tell, a link is added behind the back of the index into a directory
+ * which keeps its old mtime: only a rebuild would find it. */
+static void test_index_incremental(void) {
+        char root[] = "/tmp/test-install.XXXXXX";
+        char _cleanup_free_ *config = NULL, *other = NULL, *link = NULL, *runtime = NULL;
+        const char *units[] = { "a.service", "b.service", "c.service" };
+        char *files[2] = { NULL, NULL };
+        UnitFileChange *changes = NULL;
+        unsigned n_changes = 0, k;
+        time_t old;
+
+        assert_se(mkdtemp(root));
+
+        config = strappend(root, "/etc/systemd/system");
+        other = strappend(config, "/other.target.wants");
+        link = strappend(other, "/c.service");
+        runtime = strappend(root, "/run/systemd/system");
+        assert_se(config && other && link && runtime);
+
+        assert_se(mkdir_p(other, 0755) >= 0);
+        assert_se(mkdir_p(runtime, 0755) >= 0);
+        for (k = 0; k < ELEMENTSOF(units); k++) {
+                char _cleanup_free_ *p = NULL;
+
+                p = strjoin(runtime, "/", units[k], NULL);
+                assert_se(p);
+                assert_se(write_one_line_file(p, "[Install]\nWantedBy=multi-user.target") >= 0);
+        }
+
+        old = time(NULL) - 3600;
+        set_mtime(other, old);
+        set_mtime(config, old);
+
+        assert_se(unit_file_get_state(UNIT_FILE_SYSTEM, root, "c.service") == UNIT_FILE_DISABLED);
+
+        assert_se(symlink("/run/systemd/system/c.service", link) >= 0);
+        set_mtime(other, old);
+
+        files[0] = (char*) "a.service";
+        assert_se(unit_file_enable(UNIT_FILE_SYSTEM, false, root, files, false, &changes, &n_changes) >= 0);
+        files[0] = (char*) "b.service";
+        assert_se(unit_file_enable(UNIT_FILE_SYSTEM, false, root, files, false, &changes, &n_changes) >= 0);
+        unit_file_changes_free(changes, n_changes);
+
+        assert_se(unit_file_get_state(UNIT_FILE_SYSTEM, root, "a.service") == UNIT_FILE_ENABLED);
+        assert_se(unit_file_get_state(UNIT_FILE_SYSTEM, root, "b.service") == UNIT_FILE_ENABLED);
+        assert_se(unit_file_get_state(UNIT_FILE_SYSTEM, root, "c.service") == UNIT_FILE_DISABLED);
+
+        /* Once the directory is seen to change, the link is found */
+        set_mtime(other, old + 1);
+        assert_se(unit_file_get_state(UNIT_FILE_SYSTEM, root, "c.service") == UNIT_FILE_ENABLED);
+
+        assert_se(rm_rf_dangerous(root, false, true, false) >= 0);
+}
+
 int main(int argc, char* argv[]) {
         Hashmap *h;
         UnitFileList *p;
@@ -51,6 +162,9 @@ int main(int argc, char* argv[]) {
         UnitFileChange *changes = NULL;
         unsigned n_changes = 0;
 
+        test_link_after_index();
+        test_index_incremental();
+
         h = hashmap_new(string_hash_func, string_compare_func);
         r = unit_file_get_list(UNIT_FILE_SYSTEM, NULL, h);
         assert_se(r == 0);
@@ -0,0 +1,141 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libudev.h"
+#include "libudev-private.h"
+#include "hashmap.h"
+#include "util.h"
+
+/* find names, which all start probing at the given slot of the index */
+static void find_names(unsigned int mask, unsigned int home, char names[][16], unsigned int n)
+{
+        unsigned int k, found = 0;
+
+        for (k = 0; found < n; k++) {
+                snprintf(names[found], sizeof(names[found]), "key%u", k);
+                if ((string_hash_func(names[found]) & mask) == home)
+                        found++;
+        }
+}
+
+static void check_lookup(struct udev_list *list, const char *name, bool present)
+{
+        struct udev_list_entry *entry;
+
+        entry = udev_list_entry_get_by_name(udev_list_get_entry(list), name);
+        if (present)
+                assert_se(entry != NULL && streq(udev_list_entry_get_name(entry), name));
+        else
+                assert_se(entry == NULL);
+}
+
+/*
+ * Names probing from the last slot of the index wrap around to the first
+ * slots, and share them with names probing from slot 0. Deleting entries
+ * has to move the remaining ones back into the gaps across the boundary.
+ */
+static void test_index_wrap(struct udev *udev)
+{
+        struct udev_list list;
+        struct udev_list_entry *entry;
+        char last[3][16], first[2][16];
+        unsigned int mask, i;
+
+        udev_list_init(udev, &list, true);
+
+        /* the index is created with the first entry, and stays at its initial size */
+        assert_se(udev_list_entry_add(&list, "anchor", NULL) != NULL);
+        mask = list.index_size - 1;
+        find_names(mask, mask, last, ELEMENTSOF(last));
+        find_names(mask, 0, first, ELEMENTSOF(first));
+
+        for (i = 0; i < ELEMENTSOF(last); i++)
+                assert_se(udev_list_entry_add(&list, last[i], "last") != NULL);
+        for (i = 0; i < ELEMENTSOF(first); i++)
+                assert_se(udev_list_entry_add(&list, first[i], "first") != NULL);
+        assert_se(list.index_size == mask + 1);
+
+        /* delete the head of the probe sequence in the last slot */
+        entry = udev_list_entry_get_by_name(udev_list_get_entry(&list), last[0]);
+        assert_se(entry != NULL);
+        udev_list_entry_delete(entry);
+        check_lookup(&list, last[0], false);
+        check_lookup(&list, last[1], true);
+        check_lookup(&list, last[2], true);
+        check_lookup(&list, first[0], true);
+        check_lookup(&list, first[1], true);
+
+        /* delete an entry which wrapped around into slot 0 */
+        entry = udev_list_entry_get_by_name(udev_list_get_entry(&list), last[2]);
+        assert_se(entry != NULL);
+        udev_list_entry_delete(entry);
+        check_lookup(&list, last[1], true);
+        check_lookup(&list, last[2], false);
+        check_lookup(&list, first[0], true);
+        check_lookup(&list, first[1], true);
+
+        /* delete a name which lives in slot 0 */
+        entry = udev_list_entry_get_by_name(udev_list_get_entry(&list), first[0]);
+        assert_se(entry != NULL);
+        udev_list_entry_delete(entry);
+        check_lookup(&list, last[1], true);
+        check_lookup(&list, first[0], false);
+        check_lookup(&list, first[1], true);
+
+        /* add the deleted names again, and update an existing one */
+        assert_se(udev_list_entry_add(&list, last[0], "again") != NULL);
+        assert_se(udev_list_entry_add(&list, last[2], "again") != NULL);
+        assert_se(udev_list_entry_add(&list, first[0], "again") != NULL);
+        assert_se(udev_list_entry_add(&list, last[1], "update") != NULL);
+        for (i = 0; i < ELEMENTSOF(last); i++)
+                check_lookup(&list, last[i], true);
+        for (i = 0; i < ELEMENTSOF(first); i++)
+                check_lookup(&list, first[i], true);
+        check_lookup(&list, "anchor", true);
+
+        entry = udev_list_entry_get_by_name(udev_list_get_entry(&list), last[1]);
+        assert_se(streq(udev_list_entry_get_value(entry), "update"));
+
+        /* every name is in the list only once, and the list is still sorted */
+        i = 0;
+        udev_list_entry_foreach(entry, udev_list_get_entry(&list)) {
+                struct udev_list_entry *next = udev_list_entry_get_next(entry);
+
+                if (next != NULL)
+                        assert_se(strcmp(udev_list_entry_get_name(entry), udev_list_entry_get_name(next)) < 0);
+                i++;
+        }
+        assert_se(i == 1 + ELEMENTSOF(last) + ELEMENTSOF(first));
+
+        udev_list_cleanup(&list);
+}
+
+int main(int argc, char *argv[])
+{
+        struct udev *udev;
+
+        udev = udev_new();
+        assert_se(udev != NULL);
+
+        test_index_wrap(udev);
+
+        udev_unref(udev);
+        return 0;
+}
@@ -158,6 +158,61 @@ static int test_device_parents(struct udev *udev, const char *syspath)
         return 0;
 }
 
+/* micro-benchmark of the property and sysattr lookups of a device */
+static int test_device_lookup(struct udev *udev, const char *syspath, unsigned int rounds)
+{
+        struct udev_device *device;
+        struct udev_list_entry *list_entry;
+        const char *names[256];
+        unsigned int n_properties = 0, n = 0, i, r;
+        unsigned int found = 0;
+        usec_t t;
+
+        device = udev_device_new_from_syspath(udev, syspath);
+        if (device == NULL) {
+                printf("no device found\n");
+                return -1;
+        }
+
+        udev_list_entry_foreach(list_entry, udev_device_get_properties_list_entry(device)) {
+                if (n_properties >= ARRAY_SIZE(names) / 2)
+                        break;
+                names[n_properties++] = udev_list_entry_get_name(list_entry);
+        }
+        names[n_properties++] = "NO_SUCH_PROPERTY";
+
+        t = now(CLOCK_MONOTONIC);
+        for (r = 0; r < rounds; r++)
+                for (i = 0; i < n_properties; i++)
+                        if (udev_device_get_property_value(device, names[i]) != NULL)
+                                found++;
+        t = now(CLOCK_MONOTONIC) - t;
+        printf("%u property lookups (%u found) in %llu us, %llu ns/lookup\n",
+               rounds * n_properties, found, (unsigned long long) t,
+               (unsigned long long) (t * 1000 / MAX(rounds * n_properties, 1U)));
+
+        udev_list_entry_foreach(list_entry, udev_device_get_sysattr_list_entry(device)) {
+                if (n >= ARRAY_SIZE(names) - 1)
+                        break;
+                names[n++] = udev_list_entry_get_name(list_entry);
+        }
+        names[n++] = "no_such_attribute";
+
+        found = 0;
+        t = now(CLOCK_MONOTONIC);
+        for (r = 0; r < rounds; r++)
+                for (i = 0; i < n; i++)
+                        if (udev_device_get_sysattr_value(device, names[i]) != NULL)
+                                found++;
+        t = now(CLOCK_MONOTONIC) - t;
+        printf("%u sysattr lookups (%u found) in %llu us, %llu ns/lookup\n",
+               rounds * n, found, (unsigned long long) t,
+               (unsigned long long) (t * 1000 / MAX(rounds * n, 1U)));
+
+        udev_device_unref(device);
+        return 0;
+}
+
 static int test_device_devnum(struct udev *udev)
 {
         dev_t devnum = makedev(1, 3);
@@ -506,6 +561,7 @@ int main(int argc, char *argv[])
         test_device_devnum(udev);
         test_device_subsys_name(udev);
         test_device_parents(udev, syspath);
+        test_device_lookup(udev, syspath, 100000);
 
         test_enumerate(udev, subsystem);
 
@@ -0,0 +1,98 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "manager.h"
+#include "path.h"
+
+static void write_unit(const char *dir, const char *name, const char *contents) {
+        char *p;
+
+        assert_se(p = strjoin(dir, "/", name, NULL));
+        assert_se(write_one_line_file(p, contents) >= 0);
+        free(p);
+}
+
+/* Events are dispatched by hand, so that two of them are sure to
+ * arrive within one CoalesceSec= window */
+static void test_coalesce(void) {
+        char dir[] = "/tmp/test-path.XXXXXX";
+        char *contents;
+        Manager *m = NULL;
+        Unit *u = NULL, *t = NULL;
+        Path *p;
+        PathSpec *s;
+
+        assert_se(mkdtemp(dir));
+
+        assert_se(asprintf(&contents,
+                           "[Path]\n"
+                           "PathChanged=%s/trigger\n"
+                           "Unit=coalesce.target\n"
+                           "CoalesceSec=1h", dir) >= 0);
+        write_unit(dir, "coalesce.path", contents);
+        free(contents);
+        write_unit(dir, "coalesce.target", "[Unit]\nDefaultDependencies=no");
+
+        assert_se(set_unit_path(dir) >= 0);
+        assert_se(manager_new(SYSTEMD_SYSTEM, &m) >= 0);
+
+        assert_se(manager_load_unit(m, "coalesce.path", NULL, NULL, &u) >= 0);
+        assert_se(manager_load_unit(m, "coalesce.target", NULL, NULL, &t) >= 0);
+
+        p = PATH(u);
+        s = p->specs;
+        assert_se(s && !s->spec_next);
+
+        assert_se(unit_start(u) >= 0);
+        assert_se(p->state == PATH_WAITING);
+
+        /* The first event opens the window, the second one falls
+         * into it, neither activates anything yet */
+        s->primary_changed = true;
+        UNIT_VTABLE(u)->fd_event(u, m->inotify_watch.fd, EPOLLIN, &s->watch);
+        assert_se(p->state == PATH_WAITING);
+        assert_se(!t->job);
+
+        s->primary_changed = true;
+        UNIT_VTABLE(u)->fd_event(u, m->inotify_watch.fd, EPOLLIN, &s->watch);
+        assert_se(p->state == PATH_WAITING);
+        assert_se(!t->job);
+
+        /* The end of the window activates the unit once */
+        assert_se(p->coalesce_watch.type == WATCH_UNIT_TIMER);
+        UNIT_VTABLE(u)->timer_event(u, 1, &p->coalesce_watch);
+        assert_se(p->state == PATH_RUNNING);
+        assert_se(t->job && t->job->type == JOB_START);
+        assert_se(!p->coalesce_changed);
+
+        manager_free(m);
+        assert_se(rm_rf_dangerous(dir, false, true, false) >= 0);
+}
+
+int main(int argc, char *argv[]) {
+        test_coalesce();
+
+        return 0;
+}
@@ -0,0 +1,144 @@
+/*-*- Mode: C; c-basic-offset: 8; indent-tabs-mode: nil -*-*/
+
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+/* Connection rate benchmark for Accept=yes sockets. Point it at the
+ * listening address of a socket unit whose service reads its input
+ * until EOF and exits, e.g.:
+ *
+ *   test-socket-accept 127.0.0.1:7777 10000 16
+ *
+ * It opens the given number of connections from the given number of
+ * parallel clients, waits for the service to close each of them and
+ * prints the rate at which they were served. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "util.h"
+#include "log.h"
+#include "socket-util.h"
+
+static int run_client(const SocketAddress *a, unsigned n) {
+        unsigned i;
+
+        for (i = 0; i < n; i++) {
+                int _cleanup_close_ fd = -1;
+                char buf[256];
+                ssize_t l;
+
+                fd = socket(socket_address_family(a), a->type | SOCK_CLOEXEC, a->protocol);
+                if (fd < 0)
+                        return -errno;
+
+                if (connect(fd, &a->sockaddr.sa, a->size) < 0)
+                        return -errno;
+
+                if (shutdown(fd, SHUT_WR) < 0)
+                        return -errno;
+
+                do
+                        l = read(fd, buf, sizeof(buf));
+                while (l > 0 || (l < 0 && errno == EINTR));
+
+                if (l < 0 && errno != ECONNRESET)
+                        return -errno;
+        }
+
+        return 0;
+}
+
+int main(int argc, char *argv[]) {
+        SocketAddress a;
+        unsigned n = 1000, parallel = 1, i, failed = 0;
+        usec_t t;
+        int r;
+
+        log_set_max_level(LOG_DEBUG);
+        log_parse_environment();
+
+        if (argc < 2 || argc > 4) {
+                log_error("Usage: %s ADDRESS [CONNECTIONS] [PARALLEL]", program_invocation_short_name);
+                return EXIT_FAILURE;
+        }
+
+        zero(a);
+        r = socket_address_parse(&a, argv[1]);
+        if (r < 0) {
+                log_error("Failed to parse address %s: %s", argv[1], strerror(-r));
+                return EXIT_FAILURE;
+        }
+
+        if ((argc > 2 && (safe_atou(argv[2], &n) < 0 || n <= 0)) ||
+            (argc > 3 && (safe_atou(argv[3], &parallel) < 0 || parallel <= 0))) {
+                log_error("Invalid number of connections or clients.");
+                return EXIT_FAILURE;
+        }
+
+        t = now(CLOCK_MONOTONIC);
+
+        for (i = 0; i < parallel; i++) {
+                pid_t pid;
+
+                pid = fork();
+                if (pid < 0) {
+                        log_error("fork() failed: %m");
+                        return EXIT_FAILURE;
+                }
+
+                if (pid == 0) {
+                        r = run_client(&a, n / parallel + (i < n % parallel));
+                        if (r < 0) {
+                                log_error("Client %u failed: %s", i, strerror(-r));
+                                _exit(EXIT_FAILURE);
+                        }
+
+                        _exit(EXIT_SUCCESS);
+                }
+        }
+
+        for (i = 0; i < parallel; i++) {
+                int status;
+
+                if (wait(&status) < 0) {
+                        log_error("wait() failed: %m");
+                        return EXIT_FAILURE;
+                }
+
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+                        failed++;
+        }
+
+        t = now(CLOCK_MONOTONIC) - t;
+
+        printf("%u connections from %u clients in %llu.%03llus, %llu connections/s\n",
+               n, parallel,
+               (unsigned long long) (t / USEC_PER_SEC),
+               (unsigned long long) (t % USEC_PER_SEC / USEC_PER_MSEC),
+               (unsigned long long) (n * USEC_PER_SEC / MAX(t, (usec_t) 1)));
+
+        if (failed > 0) {
+                log_error("%u clients failed.", failed);
+                return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,239 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+/* Scheduling benchmark for the udevd event queue. It queues the events
+ * of a synthetic coldplug of a host with many SCSI LUNs and network
+ * interfaces, and runs them through the udevd scheduling loop with the
+ * given number of workers, completing the oldest running event after
+ * each pass:
+ *
+ *   test-udev-depend 30000 64
+ *
+ * The same run is repeated with a linear scan of the queue for each
+ * event, and the order in which events were started is compared. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "udev.h"
+
+struct event {
+        struct udev_list_node node;
+        enum {
+                EVENT_QUEUED,
+                EVENT_RUNNING,
+        } state;
+        unsigned long long int seqnum;
+        char devpath[128];
+        size_t devpath_len;
+        struct udev_depend_entry depend;
+};
+
+static inline struct event *node_to_event(struct udev_list_node *node)
+{
+        return container_of(node, struct event, node);
+}
+
+static unsigned int generate(struct event *events, unsigned int n)
+{
+        unsigned int i = 0, lun = 0;
+
+        while (i < n) {
+                unsigned int host = lun / 4096, target = lun / 256 % 16, l = lun % 256;
+                struct event *e;
+
+                /* a network interface for every 64 LUNs */
+                if (lun % 64 == 0) {
+                        e = &events[i++];
+                        snprintf(e->devpath, sizeof(e->devpath), "/devices/pci0000:00/0000:00:1c.%u/0000:%02x:00.0/net/eth%u",
+                                 lun / 64 % 8, lun / 512, lun / 64);
+                        e->depend.ifindex = lun / 64 + 2;
+                        if (i >= n)
+                                break;
+                }
+
+                e = &events[i++];
+                snprintf(e->devpath, sizeof(e->devpath), "/devices/pci0000:00/0000:00:03.0/0000:08:00.%u/host%u/rport-%u:0-%u/target%u:0:%u/%u:0:%u:%u",
+                         host % 4, host, host, target, host, target, host, target, l);
+                if (i >= n)
+                        break;
+
+                e = &events[i++];
+                snprintf(e->devpath, sizeof(e->devpath), "/devices/pci0000:00/0000:00:03.0/0000:08:00.%u/host%u/rport-%u:0-%u/target%u:0:%u/%u:0:%u:%u/block/sd%u",
+                         host % 4, host, host, target, host, target, host, target, l, lun);
+                e->depend.devnum = makedev(8 + lun / 16 % 8, lun % 16 * 16);
+                e->depend.is_block = true;
+
+                lun++;
+        }
+
+        for (i = 0; i < n; i++) {
+                events[i].seqnum = events[i].depend.seqnum = 1000 + i;
+                events[i].devpath_len = strlen(events[i].devpath);
+        }
+        return n;
+}
+
+/* the scan udevd did before it had an index */
+static bool is_devpath_busy_linear(struct udev_list_node *list, struct event *event)
+{
+        struct udev_list_node *loop;
+
+        udev_list_node_foreach(loop, list) {
+                struct event *loop_event = node_to_event(loop);
+                size_t common;
+
+                if (loop_event->seqnum >= event->seqnum)
+                        break;
+
+                if (major(event->depend.devnum) != 0 && event->depend.devnum == loop_event->depend.devnum &&
+                    event->depend.is_block == loop_event->depend.is_block)
+                        return true;
+
+                if (event->depend.ifindex != 0 && event->depend.ifindex == loop_event->depend.ifindex)
+                        return true;
+
+                common = MIN(loop_event->devpath_len, event->devpath_len);
+                if (memcmp(loop_event->devpath, event->devpath, common) != 0)
+                        continue;
+
+                if (loop_event->devpath_len == event->devpath_len)
+                        return true;
+
+                if (event->devpath[common] == '/' || loop_event->devpath[common] == '/')
+                        return true;
+        }
+
+        return false;
+}
+
+static usec_t run(struct event *events, unsigned int n, unsigned int workers, struct udev_depend *depend,
+                  unsigned long long int *order, unsigned int *passes)
+{
+        UDEV_LIST(queue);
+        struct event *running[workers];
+        unsigned int i, n_running = 0, n_started = 0;
+        usec_t t;
+
+        t = now(CLOCK_MONOTONIC);
+
+        for (i = 0; i < n; i++) {
+                events[i].state = EVENT_QUEUED;
+                udev_list_node_append(&events[i].node, &queue);
+                if (depend != NULL && udev_depend_add(depend, &events[i].depend, events[i].devpath) < 0) {
+                        log_error("Failed to index event.");
+                        exit(EXIT_FAILURE);
+                }
+        }
+
+        *passes = 0;
+        while (!udev_list_node_is_empty(&queue)) {
+                struct udev_list_node *loop;
+
+                udev_list_node_foreach(loop, &queue) {
+                        struct event *event = node_to_event(loop);
+                        bool busy;
+
+                        if (event->state != EVENT_QUEUED)
+                                continue;
+
+                        if (depend != NULL)
+                                busy = udev_depend_is_busy(depend, &event->depend);
+                        else
+                                busy = is_devpath_busy_linear(&queue, event);
+                        if (busy)
+                                continue;
+
+                        event->state = EVENT_RUNNING;
+                        running[n_running++] = event;
+                        order[n_started++] = event->seqnum;
+                        if (n_running >= workers)
+                                break;
+                }
+                (*passes)++;
+
+                /* the oldest running event finishes */
+                if (n_running == 0) {
+                        log_error("Queue is stuck.");
+                        exit(EXIT_FAILURE);
+                }
+                udev_list_node_remove(&running[0]->node);
+                if (depend != NULL)
+                        udev_depend_remove(depend, &running[0]->depend);
+                memmove(running, running + 1, --n_running * sizeof(struct event *));
+        }
+
+        return now(CLOCK_MONOTONIC) - t;
+}
+
+int main(int argc, char *argv[])
+{
+        struct udev *udev;
+        struct udev_depend *depend;
+        struct event *events;
+        unsigned long long int *order_index, *order_linear;
+        unsigned int n = 30000, workers = 64, passes;
+        usec_t t_index, t_linear;
+
+        log_set_max_level(LOG_DEBUG);
+        log_parse_environment();
+
+        if (argc > 3 ||
+            (argc > 1 && (safe_atou(argv[1], &n) < 0 || n <= 0)) ||
+            (argc > 2 && (safe_atou(argv[2], &workers) < 0 || workers <= 0))) {
+                log_error("Usage: %s [EVENTS] [WORKERS]", program_invocation_short_name);
+                return EXIT_FAILURE;
+        }
+
+        udev = udev_new();
+        depend = udev_depend_new(udev);
+        events = calloc(n, sizeof(struct event));
+        order_index = calloc(n, sizeof(unsigned long long int));
+        order_linear = calloc(n, sizeof(unsigned long long int));
+        if (udev == NULL || depend == NULL || events == NULL || order_index == NULL || order_linear == NULL) {
+                log_oom();
+                return EXIT_FAILURE;
+        }
+
+        generate(events, n);
+
+        t_index = run(events, n, workers, depend, order_index, &passes);
+        printf("indexed: %u events, %u workers, %u passes in %llu.%03llus\n",
+               n, workers, passes,
+               (unsigned long long) (t_index / USEC_PER_SEC),
+               (unsigned long long) (t_index % USEC_PER_SEC / USEC_PER_MSEC));
+
+        t_linear = run(events, n, workers, NULL, order_linear, &passes);
+        printf("linear:  %u events, %u workers, %u passes in %llu.%03llus\n",
+               n, workers, passes,
+               (unsigned long long) (t_linear / USEC_PER_SEC),
+               (unsigned long long) (t_linear % USEC_PER_SEC / USEC_PER_MSEC));
+
+        if (memcmp(order_index, order_linear, n * sizeof(unsigned long long int)) != 0) {
+                log_error("Events were started in different order.");
+                return EXIT_FAILURE;
+        }
+
+        free(order_linear);
+        free(order_index);
+        free(events);
+        udev_depend_free(depend);
+        udev_unref(udev);
+
+        return EXIT_SUCCESS;
+}
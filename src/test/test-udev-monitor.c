@@ -0,0 +1,288 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+/* Throughput benchmark for udev monitor consumers. It sends a burst of
+ * synthetic events from one monitor to another over a unicast netlink
+ * socket, the way udevd passes events to its listeners, and receives them
+ * with udev_monitor_receive_device() and with udev_monitor_batch_receive():
+ *
+ *   test-udev-monitor 100000
+ *
+ * At last, a property match filter is installed, and only the events of
+ * the matching device are expected to arrive. The sender credentials are
+ * only accepted from root, so it needs to run as root. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "udev.h"
+
+/* messages sent before they are received, to not overflow the socket buffer */
+#define BURST 64
+
+static const char *properties_disk[] = {
+        "ACTION=change",
+        "DEVPATH=/devices/pci0000:00/0000:00:1f.2/ata1/host0/target0:0:0/0:0:0:0/block/sda/sda1",
+        "SUBSYSTEM=block",
+        "DEVTYPE=partition",
+        "DEVNAME=/dev/sda1",
+        "MAJOR=8",
+        "MINOR=1",
+        "ID_ATA=1",
+        "ID_BUS=ata",
+        "ID_MODEL=INTEL_SSDSA2CW160G3",
+        "ID_SERIAL=INTEL_SSDSA2CW160G3_CVPR123456789",
+        "ID_SERIAL_SHORT=CVPR123456789",
+        "ID_TYPE=disk",
+        "ID_PATH=pci-0000:00:1f.2-scsi-0:0:0:0",
+        "ID_PATH_TAG=pci-0000_00_1f_2-scsi-0_0_0_0",
+        "ID_PART_TABLE_TYPE=dos",
+        "ID_FS_UUID=4f3e2d1c-0b9a-4877-a665-544332211000",
+        "ID_FS_UUID_ENC=4f3e2d1c-0b9a-4877-a665-544332211000",
+        "ID_FS_VERSION=1.0",
+        "ID_FS_TYPE=ext4",
+        "ID_FS_USAGE=filesystem",
+        "DEVLINKS=/dev/disk/by-id/ata-INTEL_SSDSA2CW160G3_CVPR123456789-part1 /dev/disk/by-uuid/4f3e2d1c-0b9a-4877-a665-544332211000",
+        "TAGS=:systemd:",
+        "USEC_INITIALIZED=1234567",
+        NULL
+};
+
+static const char *properties_net[] = {
+        "ACTION=change",
+        "DEVPATH=/devices/pci0000:00/0000:00:19.0/net/eth0",
+        "SUBSYSTEM=net",
+        "INTERFACE=eth0",
+        "IFINDEX=2",
+        "ID_BUS=pci",
+        "ID_MODEL_FROM_DATABASE=82579LM Gigabit Network Connection",
+        "ID_NET_NAME_MAC=enx001122334455",
+        "ID_NET_NAME_ONBOARD=eno1",
+        "ID_NET_NAME_PATH=enp0s25",
+        "ID_VENDOR_FROM_DATABASE=Intel Corporation",
+        "TAGS=:systemd:",
+        "USEC_INITIALIZED=1234567",
+        NULL
+};
+
+static struct udev_device *device_new(struct udev *udev, const char **properties)
+{
+        struct udev_device *dev;
+        unsigned int i;
+
+        dev = udev_device_new(udev);
+        if (dev == NULL)
+                return NULL;
+        udev_device_set_info_loaded(dev);
+        for (i = 0; properties[i] != NULL; i++)
+                udev_device_add_property_from_string_parse(dev, properties[i]);
+        if (udev_device_add_property_from_string_parse_finish(dev) < 0) {
+                udev_device_unref(dev);
+                return NULL;
+        }
+        return dev;
+}
+
+static struct udev_monitor *monitor_new(struct udev *udev, struct udev_monitor *sender)
+{
+        struct udev_monitor *monitor;
+
+        monitor = udev_monitor_new_from_netlink(udev, NULL);
+        if (monitor == NULL)
+                return NULL;
+        udev_monitor_allow_unicast_sender(monitor, sender);
+        udev_monitor_set_receive_buffer_size(monitor, 128*1024*1024);
+        return monitor;
+}
+
+/* odd sequence numbers are sent with the net device, even ones with the disk */
+static unsigned int send_burst(struct udev_monitor *sender, struct udev_monitor *receiver,
+                               struct udev_device **devices, unsigned long long int *seqnum)
+{
+        unsigned int i;
+
+        for (i = 0; i < BURST; i++) {
+                struct udev_device *dev;
+                char num[32];
+
+                (*seqnum)++;
+                dev = devices[*seqnum % 2];
+                snprintf(num, sizeof(num), "%llu", *seqnum);
+                udev_device_add_property(dev, "SEQNUM", num);
+                if (udev_monitor_send_device(sender, receiver, dev) < 0) {
+                        fprintf(stderr, "error sending message: %m\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+        return i;
+}
+
+static void check_event(unsigned long long int seqnum, unsigned long long int expected, const char *fs_type)
+{
+        if (seqnum != expected || (fs_type != NULL) != (seqnum % 2 == 0)) {
+                fprintf(stderr, "unexpected event %llu, expected %llu\n", seqnum, expected);
+                exit(EXIT_FAILURE);
+        }
+}
+
+static unsigned int receive_devices(struct udev_monitor *receiver, unsigned long long int *seqnum, unsigned int step)
+{
+        struct udev_device *dev;
+        unsigned int n = 0;
+
+        while ((dev = udev_monitor_receive_device(receiver)) != NULL) {
+                *seqnum += step;
+                check_event(udev_device_get_seqnum(dev), *seqnum,
+                            udev_device_get_property_value(dev, "ID_FS_TYPE"));
+                udev_device_unref(dev);
+                n++;
+        }
+        return n;
+}
+
+static unsigned int receive_batch(struct udev_monitor_batch *batch, unsigned long long int *seqnum, unsigned int step)
+{
+        unsigned int n = 0;
+        int count;
+
+        while ((count = udev_monitor_batch_receive(batch)) >= 0) {
+                int i;
+
+                for (i = 0; i < count; i++) {
+                        struct udev_monitor_event *event = udev_monitor_batch_get_event(batch, i);
+
+                        *seqnum += step;
+                        check_event(udev_monitor_event_get_seqnum(event), *seqnum,
+                                    udev_monitor_event_get_property_value(event, "ID_FS_TYPE"));
+                }
+                n += count;
+        }
+        return n;
+}
+
+static void print_result(const char *name, unsigned int sent, unsigned int received, usec_t t)
+{
+        printf("%-24s %u events sent, %u received in %llu us, %llu ns/event\n",
+               name, sent, received, (unsigned long long) t,
+               (unsigned long long) (t * 1000 / MAX(received, 1U)));
+}
+
+int main(int argc, char *argv[])
+{
+        struct udev *udev;
+        struct udev_monitor *sender, *receiver;
+        struct udev_monitor_batch *batch;
+        struct udev_device *devices[2];
+        unsigned int count = 100000;
+        unsigned long long int seqnum_sent, seqnum_received;
+        unsigned int sent, received;
+        usec_t t, t_start;
+        int err = EXIT_FAILURE;
+
+        if (argc > 1)
+                count = strtoul(argv[1], NULL, 0);
+
+        if (getuid() != 0) {
+                printf("need to run as root, skipping\n");
+                return EXIT_SUCCESS;
+        }
+
+        udev = udev_new();
+        if (udev == NULL)
+                return EXIT_FAILURE;
+
+        sender = udev_monitor_new_from_netlink(udev, NULL);
+        if (sender == NULL || udev_monitor_enable_receiving(sender) < 0) {
+                fprintf(stderr, "error setting up sender\n");
+                return EXIT_FAILURE;
+        }
+
+        devices[0] = device_new(udev, properties_disk);
+        devices[1] = device_new(udev, properties_net);
+        if (devices[0] == NULL || devices[1] == NULL)
+                return EXIT_FAILURE;
+
+        /* one udev device per message */
+        receiver = monitor_new(udev, sender);
+        if (receiver == NULL || udev_monitor_enable_receiving(receiver) < 0)
+                return EXIT_FAILURE;
+        sent = received = 0;
+        seqnum_sent = seqnum_received = 0;
+        t = 0;
+        while (sent < count) {
+                sent += send_burst(sender, receiver, devices, &seqnum_sent);
+                t_start = now(CLOCK_MONOTONIC);
+                received += receive_devices(receiver, &seqnum_received, 1);
+                t += now(CLOCK_MONOTONIC) - t_start;
+        }
+        print_result("receive_device", sent, received, t);
+        if (received != sent)
+                goto out;
+
+        /* batches of messages, properties read from the received message */
+        batch = udev_monitor_batch_new(receiver, 0);
+        if (batch == NULL)
+                goto out;
+        sent = received = 0;
+        seqnum_sent = seqnum_received = 0;
+        t = 0;
+        while (sent < count) {
+                sent += send_burst(sender, receiver, devices, &seqnum_sent);
+                t_start = now(CLOCK_MONOTONIC);
+                received += receive_batch(batch, &seqnum_received, 1);
+                t += now(CLOCK_MONOTONIC) - t_start;
+        }
+        print_result("batch_receive", sent, received, t);
+        udev_monitor_batch_unref(batch);
+        udev_monitor_unref(receiver);
+        if (received != sent)
+                goto out;
+
+        /* only the disk matches the filter, the net device is dropped in the kernel */
+        receiver = monitor_new(udev, sender);
+        if (receiver == NULL ||
+            udev_monitor_filter_add_match_property(receiver, "ID_FS_TYPE", "ext4") < 0 ||
+            udev_monitor_enable_receiving(receiver) < 0)
+                goto out;
+        batch = udev_monitor_batch_new(receiver, 0);
+        if (batch == NULL)
+                goto out;
+        sent = received = 0;
+        seqnum_sent = seqnum_received = 0;
+        t = 0;
+        while (sent < count) {
+                sent += send_burst(sender, receiver, devices, &seqnum_sent);
+                t_start = now(CLOCK_MONOTONIC);
+                received += receive_batch(batch, &seqnum_received, 2);
+                t += now(CLOCK_MONOTONIC) - t_start;
+        }
+        print_result("batch_receive, filtered", sent, received, t);
+        udev_monitor_batch_unref(batch);
+        udev_monitor_unref(receiver);
+        if (received != sent / 2)
+                goto out;
+
+        err = EXIT_SUCCESS;
+out:
+        udev_device_unref(devices[0]);
+        udev_device_unref(devices[1]);
+        udev_monitor_unref(sender);
+        udev_unref(udev);
+        return err;
+}
@@ -0,0 +1,84 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+/* udevd publishes its rules for the workers with udev_rules_write(), also
+ * after a reload which mapped the compiled rules.bin. Writing mapped rules
+ * needs to give the same file as writing the parsed rules. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "udev.h"
+
+static void test_write_mapped(struct udev *udev)
+{
+        char parsed[] = "/tmp/test-udev-rules-parsed.XXXXXX";
+        char mapped[] = "/tmp/test-udev-rules-mapped.XXXXXX";
+        struct udev_rules *rules;
+        char *buf1, *buf2;
+        size_t len1, len2;
+        int fd;
+
+        fd = mkstemp(parsed);
+        assert_se(fd >= 0);
+        close(fd);
+        fd = mkstemp(mapped);
+        assert_se(fd >= 0);
+        close(fd);
+
+        /* compile the rules, like "udevadm rules --update" */
+        rules = udev_rules_new(udev, -1);
+        assert_se(rules != NULL);
+        assert_se(udev_rules_write(rules, parsed) == 0);
+        udev_rules_unref(rules);
+
+        /* map them, like udevd does with an up-to-date rules.bin, and publish them */
+        rules = udev_rules_new_from_file(udev, parsed);
+        assert_se(rules != NULL);
+        assert_se(udev_rules_write(rules, mapped) == 0);
+        udev_rules_unref(rules);
+
+        assert_se(read_full_file(parsed, &buf1, &len1) == 0);
+        assert_se(read_full_file(mapped, &buf2, &len2) == 0);
+        assert_se(len1 == len2);
+        assert_se(memcmp(buf1, buf2, len1) == 0);
+
+        /* the published copy can be mapped by the workers */
+        rules = udev_rules_new_from_file(udev, mapped);
+        assert_se(rules != NULL);
+        udev_rules_unref(rules);
+
+        free(buf1);
+        free(buf2);
+        unlink(parsed);
+        unlink(mapped);
+}
+
+int main(int argc, char *argv[])
+{
+        struct udev *udev;
+
+        udev = udev_new();
+        assert_se(udev != NULL);
+
+        test_write_mapped(udev);
+
+        udev_unref(udev);
+        return 0;
+}
@@ -35,6 +35,7 @@ enum udev_ctrl_msg_type {
         UDEV_CTRL_SET_CHILDREN_MAX,
         UDEV_CTRL_PING,
         UDEV_CTRL_EXIT,
+        UDEV_CTRL_SETTLE,
 };
 
 struct udev_ctrl_msg_wire {
@@ -44,6 +45,10 @@ struct udev_ctrl_msg_wire {
         union {
                 int intval;
                 char buf[256];
+                struct {
+                        unsigned long long int start;
+                        unsigned long long int end;
+                } seqnum;
         };
 };
 
@@ -239,20 +244,17 @@ struct udev_ctrl_connection *udev_ctrl_connection_unref(struct udev_ctrl_connect
         return NULL;
 }
 
-static int ctrl_send(struct udev_ctrl *uctrl, enum udev_ctrl_msg_type type, int intval, const char *buf, int timeout)
+static void ctrl_msg_wire_init(struct udev_ctrl_msg_wire *ctrl_msg_wire, enum udev_ctrl_msg_type type)
 {
-        struct udev_ctrl_msg_wire ctrl_msg_wire;
-        int err = 0;
-
-        memset(&ctrl_msg_wire, 0x00, sizeof(struct udev_ctrl_msg_wire));
-        strcpy(ctrl_msg_wire.version, "udev-" VERSION);
-        ctrl_msg_wire.magic = UDEV_CTRL_MAGIC;
-        ctrl_msg_wire.type = type;
+        memset(ctrl_msg_wire, 0x00, sizeof(struct udev_ctrl_msg_wire));
+        strcpy(ctrl_msg_wire->version, "udev-" VERSION);
+        ctrl_msg_wire->magic = UDEV_CTRL_MAGIC;
+        ctrl_msg_wire->type = type;
+}
 
-        if (buf != NULL)
-                strscpy(ctrl_msg_wire.buf, sizeof(ctrl_msg_wire.buf), buf);
-        else
-                ctrl_msg_wire.intval = intval;
+static int ctrl_send_wire(struct udev_ctrl *uctrl, const struct udev_ctrl_msg_wire *ctrl_msg_wire, int timeout)
+{
+        int err = 0;
 
         if (!uctrl->connected) {
                 if (connect(uctrl->sock, (struct sockaddr *)&uctrl->saddr, uctrl->addrlen) < 0) {
@@ -261,7 +263,7 @@ static int ctrl_send(struct udev_ctrl *uctrl, enum udev_ctrl_msg_type type, int
                 }
                 uctrl->connected = true;
         }
-        if (send(uctrl->sock, &ctrl_msg_wire, sizeof(ctrl_msg_wire), 0) < 0) {
+        if (send(uctrl->sock, ctrl_msg_wire, sizeof(struct udev_ctrl_msg_wire), 0) < 0) {
                 err = -errno;
                 goto out;
         }
@@ -294,6 +296,19 @@ out:
         return err;
 }
 
+static int ctrl_send(struct udev_ctrl *uctrl, enum udev_ctrl_msg_type type, int intval, const char *buf, int timeout)
+{
+        struct udev_ctrl_msg_wire ctrl_msg_wire;
+
+        ctrl_msg_wire_init(&ctrl_msg_wire, type);
+        if (buf != NULL)
+                strscpy(ctrl_msg_wire.buf, sizeof(ctrl_msg_wire.buf), buf);
+        else
+                ctrl_msg_wire.intval = intval;
+
+        return ctrl_send_wire(uctrl, &ctrl_msg_wire, timeout);
+}
+
 int udev_ctrl_send_set_log_level(struct udev_ctrl *uctrl, int priority, int timeout)
 {
         return ctrl_send(uctrl, UDEV_CTRL_SET_LOG_LEVEL, priority, NULL, timeout);
@@ -329,6 +344,18 @@ int udev_ctrl_send_ping(struct udev_ctrl *uctrl, int timeout)
         return ctrl_send(uctrl, UDEV_CTRL_PING, 0, NULL, timeout);
 }
 
+/* the daemon closes the connection when the events in the range are handled, a timeout < 0 waits forever */
+int udev_ctrl_send_settle(struct udev_ctrl *uctrl, unsigned long long int start, unsigned long long int end, int timeout)
+{
+        struct udev_ctrl_msg_wire ctrl_msg_wire;
+
+        ctrl_msg_wire_init(&ctrl_msg_wire, UDEV_CTRL_SETTLE);
+        ctrl_msg_wire.seqnum.start = start;
+        ctrl_msg_wire.seqnum.end = end;
+
+        return ctrl_send_wire(uctrl, &ctrl_msg_wire, timeout);
+}
+
 int udev_ctrl_send_exit(struct udev_ctrl *uctrl, int timeout)
 {
         return ctrl_send(uctrl, UDEV_CTRL_EXIT, 0, NULL, timeout);
@@ -488,3 +515,12 @@ int udev_ctrl_get_exit(struct udev_ctrl_msg *ctrl_msg)
                 return 1;
         return -1;
 }
+
+int udev_ctrl_get_settle(struct udev_ctrl_msg *ctrl_msg, unsigned long long int *start, unsigned long long int *end)
+{
+        if (ctrl_msg->ctrl_msg_wire.type != UDEV_CTRL_SETTLE)
+                return -1;
+        *start = ctrl_msg->ctrl_msg_wire.seqnum.start;
+        *end = ctrl_msg->ctrl_msg_wire.seqnum.end;
+        return 1;
+}
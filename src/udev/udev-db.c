@@ -0,0 +1,307 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "udev.h"
+#include "strbuf.h"
+#include "libudev-db-def.h"
+
+/*
+ * Write a snapshot of the device database, which libudev maps instead of
+ * reading the file of every single device. It contains the entries of
+ * the existing devices, sorted by database id, and an index of the tags.
+ */
+
+struct db_builder {
+        struct strbuf *strbuf;
+        struct udev_db_device_f *devices;
+        size_t devices_cur;
+        size_t devices_max;
+        uint64_t *items;
+        size_t items_cur;
+        size_t items_max;
+        struct udev_db_index_entry_f *tags;
+        size_t tags_cur;
+        size_t tags_max;
+};
+
+static int grow(void **array, size_t *max, size_t cur, size_t size)
+{
+        void *a;
+        size_t n;
+
+        if (cur < *max)
+                return 0;
+
+        n = *max > 0 ? *max * 2 : 256;
+        a = realloc(*array, n * size);
+        if (a == NULL)
+                return -ENOMEM;
+        *array = a;
+        *max = n;
+        return 0;
+}
+
+static int add_item(struct db_builder *b, const char *s)
+{
+        ssize_t off;
+
+        if (grow((void **)&b->items, &b->items_max, b->items_cur, sizeof(uint64_t)) < 0)
+                return -ENOMEM;
+        off = strbuf_add_string(b->strbuf, s, strlen(s));
+        if (off < 0)
+                return -ENOMEM;
+        b->items[b->items_cur++] = off;
+        return 0;
+}
+
+static int add_device(struct db_builder *b, struct udev *udev, char *id)
+{
+        struct udev_device *dev;
+        struct udev_db_device_f *d;
+        struct udev_list_entry *list_entry;
+        char filename[UTIL_PATH_SIZE];
+        ssize_t id_off, devpath_off, subsystem_off;
+        int err = -ENOMEM;
+
+        dev = udev_device_new_from_device_id(udev, id);
+        if (dev == NULL)
+                return 0;
+
+        strscpyl(filename, sizeof(filename), "/run/udev/data/", id, NULL);
+        if (udev_device_read_db(dev, filename) < 0) {
+                udev_device_unref(dev);
+                return 0;
+        }
+        /* we have read the database file, do not look at the snapshot */
+        udev_device_set_info_loaded(dev);
+
+        if (grow((void **)&b->devices, &b->devices_max, b->devices_cur, sizeof(struct udev_db_device_f)) < 0)
+                goto out;
+
+        id_off = strbuf_add_string(b->strbuf, id, strlen(id));
+        devpath_off = strbuf_add_string(b->strbuf, udev_device_get_devpath(dev), strlen(udev_device_get_devpath(dev)));
+        subsystem_off = strbuf_add_string(b->strbuf, strempty(udev_device_get_subsystem(dev)),
+                                          strlen(strempty(udev_device_get_subsystem(dev))));
+        if (id_off < 0 || devpath_off < 0 || subsystem_off < 0)
+                goto out;
+
+        d = &b->devices[b->devices_cur];
+        zero(*d);
+        d->id_off = id_off;
+        d->devpath_off = devpath_off;
+        d->subsystem_off = subsystem_off;
+        d->usec_initialized = udev_device_get_usec_initialized(dev);
+        d->devlink_priority = udev_device_get_devlink_priority(dev);
+        d->watch_handle = udev_device_get_watch_handle(dev);
+        d->items_first = b->items_cur;
+
+        udev_list_entry_foreach(list_entry, udev_device_get_devlinks_list_entry(dev)) {
+                if (add_item(b, udev_list_entry_get_name(list_entry)) < 0)
+                        goto out;
+                d->devlinks_count++;
+        }
+        udev_list_entry_foreach(list_entry, udev_device_get_tags_list_entry(dev)) {
+                if (add_item(b, udev_list_entry_get_name(list_entry)) < 0)
+                        goto out;
+                d->tags_count++;
+        }
+        udev_list_entry_foreach(list_entry, udev_device_get_properties_list_entry(dev)) {
+                if (!udev_list_entry_get_num(list_entry))
+                        continue;
+                if (add_item(b, udev_list_entry_get_name(list_entry)) < 0 ||
+                    add_item(b, udev_list_entry_get_value(list_entry)) < 0)
+                        goto out;
+                d->properties_count++;
+        }
+
+        b->devices_cur++;
+        err = 0;
+out:
+        udev_device_unref(dev);
+        return err;
+}
+
+static const char *sort_strings;
+
+static int device_cmp(const void *a, const void *b)
+{
+        const struct udev_db_device_f *d1 = a, *d2 = b;
+
+        return strcmp(sort_strings + d1->id_off, sort_strings + d2->id_off);
+}
+
+static int index_entry_cmp(const void *a, const void *b)
+{
+        const struct udev_db_index_entry_f *e1 = a, *e2 = b;
+        int r;
+
+        r = strcmp(sort_strings + e1->key_off, sort_strings + e2->key_off);
+        if (r != 0)
+                return r;
+        return e1->device < e2->device ? -1 : e1->device > e2->device;
+}
+
+static int build_tags_index(struct db_builder *b)
+{
+        size_t i;
+
+        for (i = 0; i < b->devices_cur; i++) {
+                uint32_t t;
+
+                for (t = 0; t < b->devices[i].tags_count; t++) {
+                        if (grow((void **)&b->tags, &b->tags_max, b->tags_cur, sizeof(struct udev_db_index_entry_f)) < 0)
+                                return -ENOMEM;
+                        b->tags[b->tags_cur].key_off = b->items[b->devices[i].items_first + b->devices[i].devlinks_count + t];
+                        b->tags[b->tags_cur].device = i;
+                        b->tags_cur++;
+                }
+        }
+        qsort(b->tags, b->tags_cur, sizeof(struct udev_db_index_entry_f), index_entry_cmp);
+        return 0;
+}
+
+static void write_section(FILE *f, const void *data, size_t len, uint64_t *off)
+{
+        static const char pad[8];
+
+        *off = ftello(f);
+        fwrite(data, len, 1, f);
+        if (len % 8 != 0)
+                fwrite(pad, 8 - len % 8, 1, f);
+}
+
+static int db_store(struct db_builder *b, const char *filename, const struct stat *st_data, usec_t scan_usec)
+{
+        const char sig[] = UDEV_DB_SIG;
+        struct udev_db_header_f h = {
+                .tool_version = atoi(VERSION),
+                .header_size = sizeof(struct udev_db_header_f),
+                .device_size = sizeof(struct udev_db_device_f),
+                .index_entry_size = sizeof(struct udev_db_index_entry_f),
+                .data_usec = timespec_load(&st_data->st_mtim),
+                .scan_usec = scan_usec,
+                .devices_count = b->devices_cur,
+                .items_count = b->items_cur,
+                .tags_count = b->tags_cur,
+                .strings_len = b->strbuf->len,
+        };
+        struct stat st;
+        FILE *f;
+        char *filename_tmp;
+        int err;
+
+        memcpy(h.signature, sig, sizeof(h.signature));
+
+        /* a database file written right after we started to read them might not have changed the mtime */
+        if (udev_db_racy(h.data_usec, h.scan_usec))
+                return -EAGAIN;
+
+        err = fopen_temporary(filename, &f, &filename_tmp);
+        if (err < 0)
+                return err;
+        fchmod(fileno(f), 0644);
+
+        fseeko(f, sizeof(struct udev_db_header_f), SEEK_SET);
+        write_section(f, b->devices, b->devices_cur * sizeof(struct udev_db_device_f), &h.devices_off);
+        write_section(f, b->items, b->items_cur * sizeof(uint64_t), &h.items_off);
+        write_section(f, b->tags, b->tags_cur * sizeof(struct udev_db_index_entry_f), &h.tags_off);
+        write_section(f, b->strbuf->buf, b->strbuf->len, &h.strings_off);
+        h.file_size = ftello(f);
+
+        fseeko(f, 0, SEEK_SET);
+        fwrite(&h, sizeof(struct udev_db_header_f), 1, f);
+        fflush(f);
+        err = ferror(f) ? -EIO : 0;
+        fclose(f);
+
+        /* a database file was written while we read them, do not bother to store the snapshot */
+        if (err == 0 &&
+            (stat("/run/udev/data", &st) < 0 ||
+             st.st_mtim.tv_sec != st_data->st_mtim.tv_sec ||
+             st.st_mtim.tv_nsec != st_data->st_mtim.tv_nsec))
+                err = -EAGAIN;
+
+        if (err < 0 || rename(filename_tmp, filename) < 0) {
+                if (err == 0)
+                        err = -errno;
+                unlink(filename_tmp);
+        }
+        free(filename_tmp);
+        return err;
+}
+
+int udev_db_write(struct udev *udev, const char *filename)
+{
+        struct db_builder b;
+        struct stat st;
+        usec_t scan_usec;
+        DIR *dir;
+        struct dirent *dent;
+        int err = 0;
+
+        zero(b);
+
+        scan_usec = now(CLOCK_REALTIME);
+        if (stat("/run/udev/data", &st) < 0)
+                return -errno;
+        dir = opendir("/run/udev/data");
+        if (dir == NULL)
+                return -errno;
+
+        b.strbuf = strbuf_new();
+        if (b.strbuf == NULL) {
+                err = -ENOMEM;
+                goto out;
+        }
+
+        for (dent = readdir(dir); dent != NULL; dent = readdir(dir)) {
+                if (dent->d_name[0] == '.')
+                        continue;
+                if (endswith(dent->d_name, ".tmp"))
+                        continue;
+
+                err = add_device(&b, udev, dent->d_name);
+                if (err < 0)
+                        goto out;
+        }
+        strbuf_complete(b.strbuf);
+
+        sort_strings = b.strbuf->buf;
+        qsort(b.devices, b.devices_cur, sizeof(struct udev_db_device_f), device_cmp);
+        err = build_tags_index(&b);
+        if (err < 0)
+                goto out;
+
+        err = db_store(&b, filename, &st, scan_usec);
+        if (err == 0)
+                log_debug("wrote database snapshot of %zu devices, %zu tags, %zu bytes of strings\n",
+                          b.devices_cur, b.tags_cur, b.strbuf->len);
+out:
+        closedir(dir);
+        strbuf_cleanup(b.strbuf);
+        free(b.devices);
+        free(b.items);
+        free(b.tags);
+        return err;
+}
@@ -0,0 +1,385 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "udev.h"
+
+/*
+ * Index of the queued and running events, to find out whether an event
+ * has to wait for an earlier one to finish. Events are indexed by the
+ * major/minor of their device node, by network interface index, and by
+ * devpath in a tree with one node per path component. Events for parent
+ * devices are found by walking up the tree from the event's node, and
+ * every event counts the earlier events for its child devices, so none
+ * of the checks needs to look at unrelated events in the queue.
+ *
+ * Events are added in the order of their sequence numbers, which keeps
+ * all lists in the index sorted by sequence number.
+ */
+
+#define DEPEND_BUCKETS 1024
+
+struct udev_depend_node {
+        struct udev_depend_node *parent;
+        struct udev_depend_node *hash_next;
+        /* events for exactly this devpath */
+        struct udev_list_node entries;
+        /* number of child nodes */
+        unsigned int children;
+        /* number of events for devices below this one */
+        unsigned int below;
+        unsigned int hash;
+        size_t len;
+        char name[];
+};
+
+struct udev_depend {
+        struct udev *udev;
+        struct udev_depend_node *root;
+        struct udev_depend_node **nodes;
+        unsigned int nodes_size;
+        unsigned int nodes_count;
+        struct udev_list_node devnums[DEPEND_BUCKETS];
+        struct udev_list_node ifindexes[DEPEND_BUCKETS];
+};
+
+static inline struct udev_depend_entry *node_to_entry(struct udev_list_node *node)
+{
+        return container_of(node, struct udev_depend_entry, node);
+}
+
+static inline struct udev_depend_entry *devnum_node_to_entry(struct udev_list_node *node)
+{
+        return container_of(node, struct udev_depend_entry, devnum_node);
+}
+
+static inline struct udev_depend_entry *ifindex_node_to_entry(struct udev_list_node *node)
+{
+        return container_of(node, struct udev_depend_entry, ifindex_node);
+}
+
+static inline struct udev_list_node *devnum_bucket(struct udev_depend *depend, dev_t devnum, bool is_block)
+{
+        return &depend->devnums[(major(devnum) * 31 + minor(devnum) * 2 + is_block) % DEPEND_BUCKETS];
+}
+
+static inline struct udev_list_node *ifindex_bucket(struct udev_depend *depend, int ifindex)
+{
+        return &depend->ifindexes[(unsigned int) ifindex % DEPEND_BUCKETS];
+}
+
+static unsigned int node_hash(const struct udev_depend_node *parent, const char *name, size_t len)
+{
+        unsigned int hash = 2166136261U ^ (unsigned int) ((uintptr_t) parent >> 4);
+        size_t i;
+
+        for (i = 0; i < len; i++) {
+                hash ^= (unsigned char) name[i];
+                hash *= 16777619U;
+        }
+        return hash;
+}
+
+static struct udev_depend_node *node_lookup(struct udev_depend *depend, struct udev_depend_node *parent,
+                                            const char *name, size_t len)
+{
+        struct udev_depend_node *node;
+        unsigned int hash;
+
+        hash = node_hash(parent, name, len);
+        for (node = depend->nodes[hash % depend->nodes_size]; node != NULL; node = node->hash_next)
+                if (node->hash == hash && node->parent == parent &&
+                    node->len == len && memcmp(node->name, name, len) == 0)
+                        return node;
+        return NULL;
+}
+
+static int nodes_resize(struct udev_depend *depend)
+{
+        struct udev_depend_node **nodes;
+        unsigned int size, i;
+
+        size = depend->nodes_size * 4;
+        nodes = calloc(size, sizeof(struct udev_depend_node *));
+        if (nodes == NULL)
+                return -ENOMEM;
+
+        for (i = 0; i < depend->nodes_size; i++) {
+                struct udev_depend_node *node, *next;
+
+                for (node = depend->nodes[i]; node != NULL; node = next) {
+                        next = node->hash_next;
+                        node->hash_next = nodes[node->hash % size];
+                        nodes[node->hash % size] = node;
+                }
+        }
+
+        free(depend->nodes);
+        depend->nodes = nodes;
+        depend->nodes_size = size;
+        return 0;
+}
+
+static struct udev_depend_node *node_get(struct udev_depend *depend, struct udev_depend_node *parent,
+                                         const char *name, size_t len)
+{
+        struct udev_depend_node *node;
+
+        node = node_lookup(depend, parent, name, len);
+        if (node != NULL)
+                return node;
+
+        if (depend->nodes_count >= depend->nodes_size * 2 && nodes_resize(depend) < 0)
+                return NULL;
+
+        node = calloc(1, sizeof(struct udev_depend_node) + len + 1);
+        if (node == NULL)
+                return NULL;
+
+        node->parent = parent;
+        udev_list_node_init(&node->entries);
+        node->hash = node_hash(parent, name, len);
+        node->len = len;
+        memcpy(node->name, name, len);
+
+        node->hash_next = depend->nodes[node->hash % depend->nodes_size];
+        depend->nodes[node->hash % depend->nodes_size] = node;
+        depend->nodes_count++;
+        parent->children++;
+        return node;
+}
+
+/* free the node and its parents, as long as nothing refers to them */
+static void node_put(struct udev_depend *depend, struct udev_depend_node *node)
+{
+        while (node != depend->root && node->children == 0 && udev_list_node_is_empty(&node->entries)) {
+                struct udev_depend_node *parent = node->parent;
+                struct udev_depend_node **n;
+
+                for (n = &depend->nodes[node->hash % depend->nodes_size]; *n != node; n = &(*n)->hash_next)
+                        ;
+                *n = node->hash_next;
+                depend->nodes_count--;
+
+                parent->children--;
+                free(node);
+                node = parent;
+        }
+}
+
+static struct udev_depend_node *node_find(struct udev_depend *depend, const char *devpath, bool create)
+{
+        struct udev_depend_node *node = depend->root;
+        const char *s = devpath;
+
+        for (;;) {
+                struct udev_depend_node *child;
+                size_t len;
+
+                s += strspn(s, "/");
+                if (s[0] == '\0')
+                        return node;
+
+                len = strcspn(s, "/");
+                if (create)
+                        child = node_get(depend, node, s, len);
+                else
+                        child = node_lookup(depend, node, s, len);
+                if (child == NULL) {
+                        if (create)
+                                node_put(depend, node);
+                        return NULL;
+                }
+
+                node = child;
+                s += len;
+        }
+}
+
+struct udev_depend *udev_depend_new(struct udev *udev)
+{
+        struct udev_depend *depend;
+        unsigned int i;
+
+        depend = calloc(1, sizeof(struct udev_depend));
+        if (depend == NULL)
+                return NULL;
+
+        depend->udev = udev;
+        depend->nodes_size = 256;
+        depend->nodes = calloc(depend->nodes_size, sizeof(struct udev_depend_node *));
+        depend->root = calloc(1, sizeof(struct udev_depend_node));
+        if (depend->nodes == NULL || depend->root == NULL) {
+                free(depend->nodes);
+                free(depend->root);
+                free(depend);
+                return NULL;
+        }
+        udev_list_node_init(&depend->root->entries);
+
+        for (i = 0; i < DEPEND_BUCKETS; i++) {
+                udev_list_node_init(&depend->devnums[i]);
+                udev_list_node_init(&depend->ifindexes[i]);
+        }
+        return depend;
+}
+
+void udev_depend_free(struct udev_depend *depend)
+{
+        unsigned int i;
+
+        if (depend == NULL)
+                return;
+
+        for (i = 0; i < depend->nodes_size; i++) {
+                struct udev_depend_node *node, *next;
+
+                for (node = depend->nodes[i]; node != NULL; node = next) {
+                        next = node->hash_next;
+                        free(node);
+                }
+        }
+        free(depend->nodes);
+        free(depend->root);
+        free(depend);
+}
+
+int udev_depend_add(struct udev_depend *depend, struct udev_depend_entry *entry, const char *devpath)
+{
+        struct udev_depend_node *node, *p;
+
+        node = node_find(depend, devpath, true);
+        if (node == NULL)
+                return -ENOMEM;
+
+        /* all events below us are earlier than this one */
+        entry->devpath = node;
+        entry->children = node->below;
+        udev_list_node_append(&entry->node, &node->entries);
+        for (p = node->parent; p != NULL; p = p->parent)
+                p->below++;
+
+        if (major(entry->devnum) != 0)
+                udev_list_node_append(&entry->devnum_node, devnum_bucket(depend, entry->devnum, entry->is_block));
+        if (entry->ifindex != 0)
+                udev_list_node_append(&entry->ifindex_node, ifindex_bucket(depend, entry->ifindex));
+        return 0;
+}
+
+void udev_depend_remove(struct udev_depend *depend, struct udev_depend_entry *entry)
+{
+        struct udev_depend_node *p;
+
+        udev_list_node_remove(&entry->node);
+        for (p = entry->devpath->parent; p != NULL; p = p->parent) {
+                struct udev_list_node *loop;
+
+                p->below--;
+
+                /* parent events queued after us no longer wait for us */
+                udev_list_node_foreach(loop, &p->entries) {
+                        struct udev_depend_entry *e = node_to_entry(loop);
+
+                        if (e->seqnum > entry->seqnum)
+                                e->children--;
+                }
+        }
+
+        if (major(entry->devnum) != 0)
+                udev_list_node_remove(&entry->devnum_node);
+        if (entry->ifindex != 0)
+                udev_list_node_remove(&entry->ifindex_node);
+
+        node_put(depend, entry->devpath);
+        entry->devpath = NULL;
+}
+
+static bool node_has_earlier(struct udev_depend_node *node, unsigned long long int seqnum)
+{
+        if (udev_list_node_is_empty(&node->entries))
+                return false;
+        return node_to_entry(node->entries.next)->seqnum < seqnum;
+}
+
+/* lookup earlier event for identical, parent, child device */
+bool udev_depend_is_busy(struct udev_depend *depend, struct udev_depend_entry *entry)
+{
+        struct udev_list_node *loop;
+        struct udev_depend_node *p;
+
+        /* check major/minor */
+        if (major(entry->devnum) != 0) {
+                udev_list_node_foreach(loop, devnum_bucket(depend, entry->devnum, entry->is_block)) {
+                        struct udev_depend_entry *e = devnum_node_to_entry(loop);
+
+                        if (e->seqnum >= entry->seqnum)
+                                break;
+                        if (e->devnum == entry->devnum && e->is_block == entry->is_block)
+                                return true;
+                }
+        }
+
+        /* check network device ifindex */
+        if (entry->ifindex != 0) {
+                udev_list_node_foreach(loop, ifindex_bucket(depend, entry->ifindex)) {
+                        struct udev_depend_entry *e = ifindex_node_to_entry(loop);
+
+                        if (e->seqnum >= entry->seqnum)
+                                break;
+                        if (e->ifindex == entry->ifindex)
+                                return true;
+                }
+        }
+
+        /* check our old name */
+        if (entry->devpath_old != NULL) {
+                p = node_find(depend, entry->devpath_old, false);
+                if (p != NULL && node_has_earlier(p, entry->seqnum))
+                        return true;
+        }
+
+        /* identical device event found */
+        udev_list_node_foreach(loop, &entry->devpath->entries) {
+                struct udev_depend_entry *e = node_to_entry(loop);
+
+                if (e->seqnum >= entry->seqnum)
+                        break;
+                /* devices names might have changed/swapped in the meantime */
+                if (major(entry->devnum) != 0 && (entry->devnum != e->devnum || entry->is_block != e->is_block))
+                        continue;
+                if (entry->ifindex != 0 && entry->ifindex != e->ifindex)
+                        continue;
+                return true;
+        }
+
+        /* allow to bypass the dependency tracking */
+        if (entry->nodelay)
+                return false;
+
+        /* parent device event found */
+        for (p = entry->devpath->parent; p != NULL; p = p->parent)
+                if (node_has_earlier(p, entry->seqnum))
+                        return true;
+
+        /* child device event found */
+        return entry->children > 0;
+}
@@ -126,6 +126,72 @@ exit:
         return err;
 }
 
+/* the entry of a device which was removed without an event might still be there */
+static bool link_stack_entry_exists(struct udev *udev, const char *id)
+{
+        struct udev_device *dev;
+        char path[UTIL_PATH_SIZE];
+        unsigned int maj, min;
+        char type;
+
+        /* device links point to device nodes, look at /sys/dev/{block,char}/<maj>:<min> */
+        if (sscanf(id, "%c%u:%u", &type, &maj, &min) == 3 && (type == 'b' || type == 'c')) {
+                snprintf(path, sizeof(path), "/sys/dev/%s/%u:%u", type == 'b' ? "block" : "char", maj, min);
+                return access(path, F_OK) == 0;
+        }
+
+        dev = udev_device_new_from_device_id(udev, (char *)id);
+        if (dev == NULL)
+                return false;
+        udev_device_unref(dev);
+        return true;
+}
+
+/*
+ * Every device claiming a link has an entry in the stack directory of the
+ * link. The entry is a symlink named after the device, its target carries
+ * the priority and the device node of the device: "<priority>:<devnode>".
+ */
+static int link_stack_entry_read(struct udev *udev, int dir_fd, char *id, int *priority, char *buf, size_t bufsize)
+{
+        char entry[UTIL_PATH_SIZE];
+        struct udev_device *dev_db;
+        const char *devnode;
+        char *colon;
+        ssize_t len;
+
+        len = readlinkat(dir_fd, id, entry, sizeof(entry));
+        if (len > 0 && len < (ssize_t)sizeof(entry)) {
+                entry[len] = '\0';
+                colon = strchr(entry, ':');
+                if (colon == NULL || colon[1] != '/')
+                        return -EINVAL;
+                colon[0] = '\0';
+                if (safe_atoi(entry, priority) < 0)
+                        return -EINVAL;
+                if (!link_stack_entry_exists(udev, id))
+                        return -ENODEV;
+                strscpy(buf, bufsize, &colon[1]);
+                return 0;
+        }
+        if (len >= 0 || errno != EINVAL)
+                return -EINVAL;
+
+        /* empty file created by an earlier version, look at the database */
+        dev_db = udev_device_new_from_device_id(udev, id);
+        if (dev_db == NULL)
+                return -ENODEV;
+        devnode = udev_device_get_devnode(dev_db);
+        if (devnode == NULL) {
+                udev_device_unref(dev_db);
+                return -ENODEV;
+        }
+        *priority = udev_device_get_devlink_priority(dev_db);
+        strscpy(buf, bufsize, devnode);
+        udev_device_unref(dev_db);
+        return 0;
+}
+
 /* find device node of device with highest priority */
 static const char *link_find_prioritized(struct udev_device *dev, bool add, const char *stackdir, char *buf, size_t bufsize)
 {
@@ -144,8 +210,9 @@ static const char *link_find_prioritized(struct udev_device *dev, bool add, cons
         if (dir == NULL)
                 return target;
         for (;;) {
-                struct udev_device *dev_db;
                 struct dirent *dent;
+                char devnode[UTIL_PATH_SIZE];
+                int prio;
 
                 dent = readdir(dir);
                 if (dent == NULL || dent->d_name[0] == '\0')
@@ -159,21 +226,14 @@ static const char *link_find_prioritized(struct udev_device *dev, bool add, cons
                 if (strcmp(dent->d_name, udev_device_get_id_filename(dev)) == 0)
                         continue;
 
-                dev_db = udev_device_new_from_device_id(udev, dent->d_name);
-                if (dev_db != NULL) {
-                        const char *devnode;
-
-                        devnode = udev_device_get_devnode(dev_db);
-                        if (devnode != NULL) {
-                                if (target == NULL || udev_device_get_devlink_priority(dev_db) > priority) {
-                                        log_debug("'%s' claims priority %i for '%s'\n",
-                                                  udev_device_get_syspath(dev_db), udev_device_get_devlink_priority(dev_db), stackdir);
-                                        priority = udev_device_get_devlink_priority(dev_db);
-                                        strscpy(buf, bufsize, devnode);
-                                        target = buf;
-                                }
-                        }
-                        udev_device_unref(dev_db);
+                if (link_stack_entry_read(udev, dirfd(dir), dent->d_name, &prio, devnode, sizeof(devnode)) < 0)
+                        continue;
+
+                if (target == NULL || prio > priority) {
+                        log_debug("'%s' claims priority %i for '%s'\n", dent->d_name, prio, stackdir);
+                        priority = prio;
+                        strscpy(buf, bufsize, devnode);
+                        target = buf;
                 }
         }
         closedir(dir);
@@ -186,6 +246,7 @@ static void link_update(struct udev_device *dev, const char *slink, bool add)
         struct udev *udev = udev_device_get_udev(dev);
         char name_enc[UTIL_PATH_SIZE];
         char filename[UTIL_PATH_SIZE * 2];
+        char filename_tmp[UTIL_PATH_SIZE * 2 + sizeof(TMP_FILE_EXT)];
         char dirname[UTIL_PATH_SIZE];
         const char *target;
         char buf[UTIL_PATH_SIZE];
@@ -208,20 +269,27 @@ static void link_update(struct udev_device *dev, const char *slink, bool add)
         }
 
         if (add) {
+                char entry[UTIL_PATH_SIZE];
                 int err;
 
+                /* hidden until it is renamed, it replaces the entry of an earlier event */
+                snprintf(entry, sizeof(entry), "%i:%s",
+                         udev_device_get_devlink_priority(dev), udev_device_get_devnode(dev));
+                strscpyl(filename_tmp, sizeof(filename_tmp),
+                         dirname, "/.", udev_device_get_id_filename(dev), TMP_FILE_EXT, NULL);
+                unlink(filename_tmp);
                 do {
-                        int fd;
-
-                        err = mkdir_parents(filename, 0755);
+                        err = mkdir_parents(filename_tmp, 0755);
                         if (err != 0 && err != -ENOENT)
                                 break;
-                        fd = open(filename, O_WRONLY|O_CREAT|O_CLOEXEC|O_TRUNC|O_NOFOLLOW, 0444);
-                        if (fd >= 0)
-                                close(fd);
-                        else
+                        err = symlink(entry, filename_tmp);
+                        if (err != 0)
                                 err = -errno;
                 } while (err == -ENOENT);
+                if (err == 0 && rename(filename_tmp, filename) < 0) {
+                        log_error("rename '%s' '%s' failed: %m\n", filename_tmp, filename);
+                        unlink(filename_tmp);
+                }
         }
 }
 
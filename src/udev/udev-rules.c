@@ -28,6 +28,8 @@
 #include <dirent.h>
 #include <fnmatch.h>
 #include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "udev.h"
 #include "path-util.h"
@@ -50,14 +52,31 @@ struct udev_rules {
         usec_t *dirs_ts_usec;
         int resolve_names;
 
+        /* newest timestamp and number of the rules files, to detect a stale compiled file;
+         * with early name resolving, the timestamps of the user and group databases count too */
+        usec_t sources_usec;
+        unsigned int sources_count;
+
         /* every key in the rules file becomes a token */
         struct token *tokens;
         unsigned int token_cur;
         unsigned int token_max;
 
+        /* precompiled match keys and rules, one for every token */
+        struct token_match *matches;
+        struct match_alt *alts;
+        unsigned int alts_cur;
+        unsigned int alts_max;
+        unsigned int blocks_count;
+
         /* all key strings are copied and de-duplicated in a single continous string buffer */
         struct strbuf *strbuf;
 
+        /* rules mapped from a file, all arrays point into the mapping */
+        void *map;
+        size_t map_size;
+        const char *strings;
+
         /* during rule parsing, uid/gid lookup results are cached */
         struct uid_gid *uids;
         unsigned int uids_cur;
@@ -68,6 +87,8 @@ struct udev_rules {
 };
 
 static char *rules_str(struct udev_rules *rules, unsigned int off) {
+        if (rules->map != NULL)
+                return (char *) rules->strings + off;
         return rules->strbuf->buf + off;
 }
 
@@ -201,6 +222,36 @@ struct token {
         };
 };
 
+/* the alternatives of a match key, split and classified at load time */
+enum match_alt_type {
+        ALT_LITERAL,                    /* no special chars */
+        ALT_PREFIX,                     /* "abc*" */
+        ALT_SUFFIX,                     /* "*abc" */
+        ALT_GLOB,                       /* anything else, fnmatch() */
+};
+
+struct match_alt {
+        unsigned int value_off;
+        unsigned int len;
+        enum match_alt_type type;
+};
+
+struct token_match {
+        union {
+                /* match keys: the range of their alternatives */
+                struct {
+                        unsigned int alt;
+                        unsigned int alt_count;
+                } key;
+                /* rules: skip to the token skip_to if the token skip_key
+                 * does not match, it is shared by all rules in between */
+                struct {
+                        unsigned int skip_key;
+                        unsigned int skip_to;
+                } rule;
+        };
+};
+
 #define MAX_TK                64
 struct rule_tmp {
         struct udev_rules *rules;
@@ -1575,6 +1626,249 @@ static int parse_file(struct udev_rules *rules, const char *filename)
         return 0;
 }
 
+static bool token_uses_match_key(enum token_type type)
+{
+        switch (type) {
+        case TK_M_ACTION:
+        case TK_M_DEVPATH:
+        case TK_M_KERNEL:
+        case TK_M_DEVLINK:
+        case TK_M_NAME:
+        case TK_M_ENV:
+        case TK_M_SUBSYSTEM:
+        case TK_M_DRIVER:
+        case TK_M_ATTR:
+        case TK_M_KERNELS:
+        case TK_M_SUBSYSTEMS:
+        case TK_M_DRIVERS:
+        case TK_M_ATTRS:
+        case TK_M_RESULT:
+                return true;
+        default:
+                return false;
+        }
+}
+
+static int add_match_alt(struct udev_rules *rules, const char *s, size_t len, bool glob)
+{
+        struct match_alt *alt;
+        char value[len + 1];
+        ssize_t off;
+
+        /* grow buffer if needed */
+        if (rules->alts_cur >= rules->alts_max) {
+                struct match_alt *alts;
+                unsigned int add;
+
+                add = rules->alts_max;
+                if (add < 64)
+                        add = 64;
+
+                alts = realloc(rules->alts, (rules->alts_max + add) * sizeof(struct match_alt));
+                if (alts == NULL)
+                        return -1;
+                rules->alts = alts;
+                rules->alts_max += add;
+        }
+        alt = &rules->alts[rules->alts_cur];
+
+        memcpy(value, s, len);
+        value[len] = '\0';
+
+        if (!glob || strpbrk(value, "*?[\\") == NULL) {
+                alt->type = ALT_LITERAL;
+        } else if (len > 0 && value[len-1] == '*' && strcspn(value, "*?[\\") == len-1) {
+                alt->type = ALT_PREFIX;
+                value[--len] = '\0';
+        } else if (value[0] == '*' && strpbrk(value+1, "*?[\\") == NULL) {
+                alt->type = ALT_SUFFIX;
+                memmove(value, value+1, len--);
+        } else {
+                alt->type = ALT_GLOB;
+        }
+
+        off = strbuf_add_string(rules->strbuf, value, len);
+        if (off < 0)
+                return -1;
+        alt->value_off = off;
+        alt->len = len;
+        rules->alts_cur++;
+        return 0;
+}
+
+/* pre-split the alternatives of a match key and classify them */
+static int compile_key(struct udev_rules *rules, unsigned int i)
+{
+        struct token *token = &rules->tokens[i];
+        struct token_match *m = &rules->matches[i];
+        char *value, *s;
+        bool split, glob;
+
+        if (token->key.glob == GL_UNSET || token->key.glob == GL_SOMETHING)
+                return 0;
+
+        split = token->key.glob == GL_SPLIT || token->key.glob == GL_SPLIT_GLOB;
+        glob = token->key.glob == GL_GLOB || token->key.glob == GL_SPLIT_GLOB;
+
+        /* the string buffer may move while we add to it */
+        value = strdup(rules_str(rules, token->key.value_off));
+        if (value == NULL)
+                return -1;
+
+        m->key.alt = rules->alts_cur;
+        for (s = value;;) {
+                size_t len = split ? strcspn(s, "|") : strlen(s);
+
+                if (add_match_alt(rules, s, len, glob) < 0) {
+                        free(value);
+                        return -1;
+                }
+                m->key.alt_count++;
+
+                if (s[len] == '\0')
+                        break;
+                s += len+1;
+        }
+
+        free(value);
+        return 0;
+}
+
+static bool rule_has_key(struct udev_rules *rules, unsigned int rule, const struct token *key)
+{
+        unsigned int i;
+
+        for (i = rule+1; i < rule + rules->tokens[rule].rule.token_count; i++) {
+                const struct token *token = &rules->tokens[i];
+
+                if (token->key.type == key->key.type &&
+                    token->key.op == key->key.op &&
+                    token->key.value_off == key->key.value_off)
+                        return true;
+        }
+        return false;
+}
+
+/*
+ * Precompile the rules: split the alternatives of all match keys, and find
+ * runs of consecutive rules which all match the same ACTION, KERNEL or
+ * SUBSYSTEM. When the key does not match the event, none of the rules can
+ * match, and the whole run is skipped with a single comparison.
+ */
+static int rules_compile(struct udev_rules *rules)
+{
+        unsigned int i;
+        unsigned int block_end = 0;
+        enum token_type block_type = TK_UNSET;
+
+        rules->matches = calloc(rules->token_cur, sizeof(struct token_match));
+        if (rules->matches == NULL)
+                return -1;
+
+        for (i = 0; i < rules->token_cur; i++)
+                if (token_uses_match_key(rules->tokens[i].type) && compile_key(rules, i) < 0)
+                        return -1;
+
+        for (i = 0; rules->tokens[i].type == TK_RULE; i += rules->tokens[i].rule.token_count) {
+                unsigned int k, best_key = 0, best_end = 0, best_count = 0;
+
+                /* we are inside a run of rules sharing a key of this type */
+                if (i >= block_end)
+                        block_type = TK_UNSET;
+
+                for (k = i+1; k < i + rules->tokens[i].rule.token_count; k++) {
+                        struct token *key = &rules->tokens[k];
+                        unsigned int end, count;
+
+                        if (key->type != TK_M_ACTION && key->type != TK_M_KERNEL && key->type != TK_M_SUBSYSTEM)
+                                continue;
+                        if (key->type == block_type)
+                                continue;
+
+                        end = i + rules->tokens[i].rule.token_count;
+                        for (count = 1; rules->tokens[end].type == TK_RULE && rule_has_key(rules, end, key); count++)
+                                end += rules->tokens[end].rule.token_count;
+
+                        if (count > best_count) {
+                                best_key = k;
+                                best_end = end;
+                                best_count = count;
+                        }
+                }
+
+                if (best_count < 2)
+                        continue;
+
+                rules->matches[i].rule.skip_key = best_key;
+                rules->matches[i].rule.skip_to = best_end;
+                rules->blocks_count++;
+                if (best_end > block_end) {
+                        block_end = best_end;
+                        block_type = rules->tokens[best_key].type;
+                }
+        }
+
+        return 0;
+}
+
+static int rules_list_files(struct udev_rules *rules, char ***files)
+{
+        char **f;
+        unsigned int i;
+        int r;
+
+        rules->dirs = strv_new("/etc/udev/rules.d",
+                               "/run/udev/rules.d",
+                               UDEVLIBEXECDIR "/rules.d",
+                               NULL);
+        if (!rules->dirs) {
+                log_error("failed to build config directory array");
+                return -ENOMEM;
+        }
+        if (!path_strv_canonicalize(rules->dirs)) {
+                log_error("failed to canonicalize config directories\n");
+                return -ENOMEM;
+        }
+        strv_uniq(rules->dirs);
+
+        rules->dirs_ts_usec = calloc(strv_length(rules->dirs), sizeof(long long));
+        if(!rules->dirs_ts_usec)
+                return -ENOMEM;
+        udev_rules_check_timestamp(rules);
+
+        r = conf_files_list_strv(files, ".rules", NULL, (const char **)rules->dirs);
+        if (r < 0) {
+                log_error("failed to enumerate rules files: %s\n", strerror(-r));
+                return r;
+        }
+
+        /* remember the state of the files before they are read */
+        rules->sources_usec = 0;
+        for (i = 0; rules->dirs[i]; i++)
+                rules->sources_usec = MAX(rules->sources_usec, rules->dirs_ts_usec[i]);
+        rules->sources_count = 0;
+        STRV_FOREACH(f, *files) {
+                struct stat stats;
+
+                if (stat(*f, &stats) == 0)
+                        rules->sources_usec = MAX(rules->sources_usec, timespec_load(&stats.st_mtim));
+                rules->sources_count++;
+        }
+
+        /* with early name resolving, the compiled rules carry user and group ids */
+        if (rules->resolve_names > 0) {
+                const char *db[] = { "/etc/passwd", "/etc/group" };
+
+                for (i = 0; i < ELEMENTSOF(db); i++) {
+                        struct stat stats;
+
+                        if (stat(db[i], &stats) == 0)
+                                rules->sources_usec = MAX(rules->sources_usec, timespec_load(&stats.st_mtim));
+                }
+        }
+        return 0;
+}
+
 struct udev_rules *udev_rules_new(struct udev *udev, int resolve_names)
 {
         struct udev_rules *rules;
@@ -1600,30 +1894,9 @@ struct udev_rules *udev_rules_new(struct udev *udev, int resolve_names)
         if (!rules->strbuf)
                 return udev_rules_unref(rules);
 
-        rules->dirs = strv_new("/etc/udev/rules.d",
-                               "/run/udev/rules.d",
-                               UDEVLIBEXECDIR "/rules.d",
-                               NULL);
-        if (!rules->dirs) {
-                log_error("failed to build config directory array");
-                return udev_rules_unref(rules);
-        }
-        if (!path_strv_canonicalize(rules->dirs)) {
-                log_error("failed to canonicalize config directories\n");
+        r = rules_list_files(rules, &files);
+        if (r < 0)
                 return udev_rules_unref(rules);
-        }
-        strv_uniq(rules->dirs);
-
-        rules->dirs_ts_usec = calloc(strv_length(rules->dirs), sizeof(long long));
-        if(!rules->dirs_ts_usec)
-                return udev_rules_unref(rules);
-        udev_rules_check_timestamp(rules);
-
-        r = conf_files_list_strv(&files, ".rules", NULL, (const char **)rules->dirs);
-        if (r < 0) {
-                log_error("failed to enumerate rules files: %s\n", strerror(-r));
-                return udev_rules_unref(rules);
-        }
 
         /*
          * The offset value in the rules strct is limited; add all
@@ -1640,8 +1913,16 @@ struct udev_rules *udev_rules_new(struct udev *udev, int resolve_names)
         memset(&end_token, 0x00, sizeof(struct token));
         end_token.type = TK_END;
         add_token(rules, &end_token);
+
+        if (rules_compile(rules) < 0) {
+                log_error("failed to compile rules\n");
+                return udev_rules_unref(rules);
+        }
+
         log_debug("rules contain %zu bytes tokens (%u * %zu bytes), %zu bytes strings\n",
                   rules->token_max * sizeof(struct token), rules->token_max, sizeof(struct token), rules->strbuf->len);
+        log_debug("%u match alternatives, %u blocks of rules sharing a key\n",
+                  rules->alts_cur, rules->blocks_count);
 
         /* cleanup temporary strbuf data */
         log_debug("%zu strings (%zu bytes), %zu de-duplicated (%zu bytes), %zu trie nodes used\n",
@@ -1667,8 +1948,14 @@ struct udev_rules *udev_rules_unref(struct udev_rules *rules)
 {
         if (rules == NULL)
                 return NULL;
-        free(rules->tokens);
-        strbuf_cleanup(rules->strbuf);
+        if (rules->map != NULL) {
+                munmap(rules->map, rules->map_size);
+        } else {
+                free(rules->tokens);
+                free(rules->matches);
+                free(rules->alts);
+                strbuf_cleanup(rules->strbuf);
+        }
         free(rules->uids);
         free(rules->gids);
         strv_free(rules->dirs);
@@ -1677,12 +1964,215 @@ struct udev_rules *udev_rules_unref(struct udev_rules *rules)
         return NULL;
 }
 
+/*
+ * The rules can be written to a file and mapped by other processes. The
+ * file holds the token array, the compiled match data and the string
+ * buffer as they are in memory, so it is only valid for the udev version
+ * and architecture which created it.
+ */
+#define RULES_SIG { 'U', 'D', 'E', 'V', 'R', 'U', 'L', 'E' }
+
+struct rules_header_f {
+        uint8_t signature[8];
+
+        /* version of tool which created the file */
+        uint64_t tool_version;
+        uint64_t file_size;
+
+        /* size of structures, to detect a different layout */
+        uint64_t header_size;
+        uint64_t token_size;
+        uint64_t token_match_size;
+        uint64_t match_alt_size;
+
+        /* state of the rules files the file was compiled from */
+        int64_t resolve_names;
+        uint64_t sources_usec;
+        uint64_t sources_count;
+
+        /* sections, every one of them is 8 byte aligned */
+        uint64_t tokens_off;
+        uint64_t tokens_count;
+        uint64_t matches_off;
+        uint64_t alts_off;
+        uint64_t alts_count;
+        uint64_t strings_off;
+        uint64_t strings_len;
+} _packed_;
+
+static void write_section(FILE *f, const void *data, size_t len, uint64_t *off)
+{
+        static const char pad[8];
+
+        *off = ftello(f);
+        fwrite(data, len, 1, f);
+        if (len % 8 != 0)
+                fwrite(pad, 8 - len % 8, 1, f);
+}
+
+int udev_rules_write(struct udev_rules *rules, const char *filename)
+{
+        const char sig[] = RULES_SIG;
+        struct rules_header_f h = {
+                .tool_version = atoi(VERSION),
+                .header_size = sizeof(struct rules_header_f),
+                .token_size = sizeof(struct token),
+                .token_match_size = sizeof(struct token_match),
+                .match_alt_size = sizeof(struct match_alt),
+                .resolve_names = rules->resolve_names,
+                .sources_usec = rules->sources_usec,
+                .sources_count = rules->sources_count,
+                .tokens_count = rules->token_cur,
+                .alts_count = rules->alts_cur,
+        };
+        const char *strings;
+        FILE *f;
+        char *filename_tmp;
+        int err;
+
+        memcpy(h.signature, sig, sizeof(h.signature));
+
+        /* mapped rules have no string buffer, copy the strings of the mapping */
+        if (rules->map != NULL) {
+                strings = rules->strings;
+                h.strings_len = ((const struct rules_header_f *) rules->map)->strings_len;
+        } else {
+                strings = rules->strbuf->buf;
+                h.strings_len = rules->strbuf->len;
+        }
+
+        err = fopen_temporary(filename, &f, &filename_tmp);
+        if (err < 0)
+                return err;
+        fchmod(fileno(f), 0444);
+
+        fseeko(f, sizeof(struct rules_header_f), SEEK_SET);
+        write_section(f, rules->tokens, rules->token_cur * sizeof(struct token), &h.tokens_off);
+        write_section(f, rules->matches, rules->token_cur * sizeof(struct token_match), &h.matches_off);
+        write_section(f, rules->alts, rules->alts_cur * sizeof(struct match_alt), &h.alts_off);
+        write_section(f, strings, h.strings_len, &h.strings_off);
+        h.file_size = ftello(f);
+
+        fseeko(f, 0, SEEK_SET);
+        fwrite(&h, sizeof(struct rules_header_f), 1, f);
+        fflush(f);
+        err = ferror(f) ? -EIO : 0;
+        fclose(f);
+        if (err < 0 || rename(filename_tmp, filename) < 0) {
+                if (err == 0)
+                        err = -errno;
+                unlink(filename_tmp);
+        }
+        free(filename_tmp);
+        return err;
+}
+
+struct udev_rules *udev_rules_new_from_file(struct udev *udev, const char *filename)
+{
+        const char sig[] = RULES_SIG;
+        struct udev_rules *rules;
+        const struct rules_header_f *h;
+        struct stat st;
+        int fd;
+
+        fd = open(filename, O_RDONLY|O_CLOEXEC);
+        if (fd < 0)
+                return NULL;
+
+        rules = calloc(1, sizeof(struct udev_rules));
+        if (rules == NULL) {
+                close(fd);
+                return NULL;
+        }
+        rules->udev = udev;
+
+        if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct rules_header_f))
+                goto err;
+
+        rules->map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (rules->map == MAP_FAILED) {
+                rules->map = NULL;
+                goto err;
+        }
+        rules->map_size = st.st_size;
+        close(fd);
+        fd = -1;
+
+        h = rules->map;
+        if (memcmp(h->signature, sig, sizeof(h->signature)) != 0 ||
+            h->tool_version != (uint64_t) atoi(VERSION) ||
+            h->file_size != (uint64_t) st.st_size ||
+            h->header_size != sizeof(struct rules_header_f) ||
+            h->token_size != sizeof(struct token) ||
+            h->token_match_size != sizeof(struct token_match) ||
+            h->match_alt_size != sizeof(struct match_alt)) {
+                log_debug("'%s' has an unknown format\n", filename);
+                goto err;
+        }
+
+        if (h->tokens_count == 0 ||
+            h->tokens_off + h->tokens_count * sizeof(struct token) > h->file_size ||
+            h->matches_off + h->tokens_count * sizeof(struct token_match) > h->file_size ||
+            h->alts_off + h->alts_count * sizeof(struct match_alt) > h->file_size ||
+            h->strings_off + h->strings_len > h->file_size) {
+                log_debug("'%s' is truncated\n", filename);
+                goto err;
+        }
+
+        rules->tokens = (struct token *) ((const uint8_t *) rules->map + h->tokens_off);
+        rules->token_cur = h->tokens_count;
+        rules->matches = (struct token_match *) ((const uint8_t *) rules->map + h->matches_off);
+        rules->alts = (struct match_alt *) ((const uint8_t *) rules->map + h->alts_off);
+        rules->alts_cur = h->alts_count;
+        rules->strings = (const char *) rules->map + h->strings_off;
+        rules->resolve_names = h->resolve_names;
+        rules->sources_usec = h->sources_usec;
+        rules->sources_count = h->sources_count;
+
+        log_debug("mapped rules from '%s', %u tokens, %llu bytes strings\n",
+                  filename, rules->token_cur, (unsigned long long) h->strings_len);
+        return rules;
+err:
+        if (fd >= 0)
+                close(fd);
+        return udev_rules_unref(rules);
+}
+
+/* map the compiled rules, if they are still in sync with the rules files */
+struct udev_rules *udev_rules_new_compiled(struct udev *udev, int resolve_names)
+{
+        struct udev_rules *rules;
+        const struct rules_header_f *h;
+        char **files = NULL;
+
+        rules = udev_rules_new_from_file(udev, UDEV_RULES_BIN);
+        if (rules == NULL)
+                return NULL;
+        h = rules->map;
+
+        if (rules->resolve_names != resolve_names) {
+                log_debug("'%s' was compiled with a different resolve-names setting\n", UDEV_RULES_BIN);
+                return udev_rules_unref(rules);
+        }
+
+        if (rules_list_files(rules, &files) < 0)
+                return udev_rules_unref(rules);
+        strv_free(files);
+
+        if (h->sources_usec != rules->sources_usec || h->sources_count != rules->sources_count) {
+                log_debug("'%s' is out of date, the rules files or the user database changed\n", UDEV_RULES_BIN);
+                return udev_rules_unref(rules);
+        }
+
+        return rules;
+}
+
 bool udev_rules_check_timestamp(struct udev_rules *rules)
 {
         unsigned int i;
         bool changed = false;
 
-        if (rules == NULL)
+        if (rules == NULL || rules->dirs == NULL)
                 goto out;
 
         for (i = 0; rules->dirs[i]; i++) {
@@ -1709,66 +2199,44 @@ out:
 
 static int match_key(struct udev_rules *rules, struct token *token, const char *val)
 {
-        char *key_value = rules_str(rules, token->key.value_off);
-        char *pos;
+        const struct token_match *m = &rules->matches[token - rules->tokens];
         bool match = false;
+        unsigned int i;
+        size_t len;
 
         if (val == NULL)
                 val = "";
 
         switch (token->key.glob) {
-        case GL_PLAIN:
-                match = (streq(key_value, val));
+        case GL_SOMETHING:
+                match = (val[0] != '\0');
                 break;
+        case GL_PLAIN:
         case GL_GLOB:
-                match = (fnmatch(key_value, val, 0) == 0);
-                break;
         case GL_SPLIT:
-                {
-                        const char *s;
-                        size_t len;
-
-                        s = rules_str(rules, token->key.value_off);
-                        len = strlen(val);
-                        for (;;) {
-                                const char *next;
-
-                                next = strchr(s, '|');
-                                if (next != NULL) {
-                                        size_t matchlen = (size_t)(next - s);
-
-                                        match = (matchlen == len && strncmp(s, val, matchlen) == 0);
-                                        if (match)
-                                                break;
-                                } else {
-                                        match = (streq(s, val));
-                                        break;
-                                }
-                                s = &next[1];
-                        }
-                        break;
-                }
         case GL_SPLIT_GLOB:
-                {
-                        char value[UTIL_PATH_SIZE];
-
-                        strscpy(value, sizeof(value), rules_str(rules, token->key.value_off));
-                        key_value = value;
-                        while (key_value != NULL) {
-                                pos = strchr(key_value, '|');
-                                if (pos != NULL) {
-                                        pos[0] = '\0';
-                                        pos = &pos[1];
-                                }
-                                match = (fnmatch(key_value, val, 0) == 0);
-                                if (match)
-                                        break;
-                                key_value = pos;
+                len = strlen(val);
+                for (i = m->key.alt; i < m->key.alt + m->key.alt_count; i++) {
+                        const struct match_alt *alt = &rules->alts[i];
+                        const char *s = rules_str(rules, alt->value_off);
+
+                        switch (alt->type) {
+                        case ALT_LITERAL:
+                                match = (len == alt->len && memcmp(val, s, len) == 0);
+                                break;
+                        case ALT_PREFIX:
+                                match = (len >= alt->len && memcmp(val, s, alt->len) == 0);
+                                break;
+                        case ALT_SUFFIX:
+                                match = (len >= alt->len && memcmp(val + len - alt->len, s, alt->len) == 0);
+                                break;
+                        case ALT_GLOB:
+                                match = (fnmatch(s, val, 0) == 0);
+                                break;
                         }
-                        break;
+                        if (match)
+                                break;
                 }
-        case GL_SOMETHING:
-                match = (val[0] != '\0');
                 break;
         case GL_UNSET:
                 return -1;
@@ -1830,6 +2298,21 @@ static int match_attr(struct udev_rules *rules, struct udev_device *dev, struct
         return match_key(rules, cur, value);
 }
 
+/* the event value for the key a block of rules is indexed by */
+static const char *rule_skip_value(struct udev_event *event, enum token_type type)
+{
+        switch (type) {
+        case TK_M_ACTION:
+                return udev_device_get_action(event->dev);
+        case TK_M_KERNEL:
+                return udev_device_get_sysname(event->dev);
+        case TK_M_SUBSYSTEM:
+                return udev_device_get_subsystem(event->dev);
+        default:
+                return NULL;
+        }
+}
+
 enum escape_type {
         ESCAPE_UNSET,
         ESCAPE_NONE,
@@ -1842,10 +2325,13 @@ int udev_rules_apply_to_event(struct udev_rules *rules, struct udev_event *event
         struct token *rule;
         enum escape_type esc = ESCAPE_UNSET;
         bool can_set_name;
+        usec_t start;
 
         if (rules->tokens == NULL)
                 return -1;
 
+        start = now(CLOCK_MONOTONIC);
+
         can_set_name = ((!streq(udev_device_get_action(event->dev), "remove")) &&
                         (major(udev_device_get_devnum(event->dev)) > 0 ||
                          udev_device_get_ifindex(event->dev) > 0));
@@ -1856,14 +2342,28 @@ int udev_rules_apply_to_event(struct udev_rules *rules, struct udev_event *event
         for (;;) {
                 dump_token(rules, cur);
                 switch (cur->type) {
-                case TK_RULE:
+                case TK_RULE: {
+                        const struct token_match *m = &rules->matches[cur - rules->tokens];
+
                         /* current rule */
                         rule = cur;
+                        event->rules_checked++;
+                        /* skip all following rules which share a key not matching this event */
+                        if (m->rule.skip_to > 0) {
+                                struct token *key = &rules->tokens[m->rule.skip_key];
+
+                                if (match_key(rules, key, rule_skip_value(event, key->type)) != 0) {
+                                        dump_token(rules, key);
+                                        cur = &rules->tokens[m->rule.skip_to];
+                                        continue;
+                                }
+                        }
                         /* possibly skip rules which want to set NAME, SYMLINK, OWNER, GROUP, MODE */
                         if (!can_set_name && rule->rule.can_set_name)
                                 goto nomatch;
                         esc = ESCAPE_UNSET;
                         break;
+                }
                 case TK_M_ACTION:
                         if (match_key(rules, cur, udev_device_get_action(event->dev)) != 0)
                                 goto nomatch;
@@ -2478,6 +2978,7 @@ int udev_rules_apply_to_event(struct udev_rules *rules, struct udev_event *event
                         cur = &rules->tokens[cur->key.rule_goto];
                         continue;
                 case TK_END:
+                        event->rules_usec += now(CLOCK_MONOTONIC) - start;
                         return 0;
 
                 case TK_M_PARENTS_MIN:
@@ -46,6 +46,9 @@ struct udev_event {
         int fd_signal;
         unsigned int builtin_run;
         unsigned int builtin_ret;
+        /* time spent in the rules, and the number of rules looked at */
+        usec_t rules_usec;
+        unsigned int rules_checked;
         bool sigterm;
         bool inotify_watch;
         bool inotify_watch_final;
@@ -67,9 +70,13 @@ struct udev_watch {
 };
 
 /* udev-rules.c */
+#define UDEV_RULES_BIN "/etc/udev/rules.bin"
 struct udev_rules;
 struct udev_rules *udev_rules_new(struct udev *udev, int resolve_names);
 struct udev_rules *udev_rules_unref(struct udev_rules *rules);
+struct udev_rules *udev_rules_new_from_file(struct udev *udev, const char *filename);
+struct udev_rules *udev_rules_new_compiled(struct udev *udev, int resolve_names);
+int udev_rules_write(struct udev_rules *rules, const char *filename);
 bool udev_rules_check_timestamp(struct udev_rules *rules);
 int udev_rules_apply_to_event(struct udev_rules *rules, struct udev_event *event, const sigset_t *sigmask);
 void udev_rules_apply_static_dev_perms(struct udev_rules *rules);
@@ -99,6 +106,32 @@ void udev_node_add(struct udev_device *dev, bool apply, mode_t mode, uid_t uid,
 void udev_node_remove(struct udev_device *dev);
 void udev_node_update_old_links(struct udev_device *dev, struct udev_device *dev_old);
 
+/* udev-depend.c */
+struct udev_depend;
+struct udev_depend_node;
+struct udev_depend_entry {
+        struct udev_list_node node;
+        struct udev_list_node devnum_node;
+        struct udev_list_node ifindex_node;
+        struct udev_depend_node *devpath;
+        unsigned long long int seqnum;
+        const char *devpath_old;
+        dev_t devnum;
+        int ifindex;
+        bool is_block;
+        bool nodelay;
+        /* earlier events for child devices */
+        unsigned int children;
+};
+struct udev_depend *udev_depend_new(struct udev *udev);
+void udev_depend_free(struct udev_depend *depend);
+int udev_depend_add(struct udev_depend *depend, struct udev_depend_entry *entry, const char *devpath);
+void udev_depend_remove(struct udev_depend *depend, struct udev_depend_entry *entry);
+bool udev_depend_is_busy(struct udev_depend *depend, struct udev_depend_entry *entry);
+
+/* udev-db.c */
+int udev_db_write(struct udev *udev, const char *filename);
+
 /* udev-ctrl.c */
 struct udev_ctrl;
 struct udev_ctrl *udev_ctrl_new(struct udev *udev);
@@ -115,6 +148,7 @@ int udev_ctrl_send_start_exec_queue(struct udev_ctrl *uctrl, int timeout);
 int udev_ctrl_send_reload(struct udev_ctrl *uctrl, int timeout);
 int udev_ctrl_send_ping(struct udev_ctrl *uctrl, int timeout);
 int udev_ctrl_send_exit(struct udev_ctrl *uctrl, int timeout);
+int udev_ctrl_send_settle(struct udev_ctrl *uctrl, unsigned long long int start, unsigned long long int end, int timeout);
 int udev_ctrl_send_set_env(struct udev_ctrl *uctrl, const char *key, int timeout);
 int udev_ctrl_send_set_children_max(struct udev_ctrl *uctrl, int count, int timeout);
 struct udev_ctrl_connection;
@@ -131,6 +165,7 @@ int udev_ctrl_get_start_exec_queue(struct udev_ctrl_msg *ctrl_msg);
 int udev_ctrl_get_reload(struct udev_ctrl_msg *ctrl_msg);
 int udev_ctrl_get_ping(struct udev_ctrl_msg *ctrl_msg);
 int udev_ctrl_get_exit(struct udev_ctrl_msg *ctrl_msg);
+int udev_ctrl_get_settle(struct udev_ctrl_msg *ctrl_msg, unsigned long long int *start, unsigned long long int *end);
 const char *udev_ctrl_get_set_env(struct udev_ctrl_msg *ctrl_msg);
 int udev_ctrl_get_set_children_max(struct udev_ctrl_msg *ctrl_msg);
 
@@ -206,6 +241,7 @@ extern const struct udevadm_cmd udevadm_settle;
 extern const struct udevadm_cmd udevadm_control;
 extern const struct udevadm_cmd udevadm_monitor;
 extern const struct udevadm_cmd udevadm_hwdb;
+extern const struct udevadm_cmd udevadm_rules;
 extern const struct udevadm_cmd udevadm_test;
 extern const struct udevadm_cmd udevadm_test_builtin;
 #endif
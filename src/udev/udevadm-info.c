@@ -232,6 +232,7 @@ static void cleanup_db(struct udev *udev)
         DIR *dir;
 
         unlink("/run/udev/queue.bin");
+        unlink(UDEV_DB_BIN);
 
         dir = opendir("/run/udev/data");
         if (dir != NULL) {
@@ -0,0 +1,120 @@
+/***
+  This file is part of systemd.
+
+  systemd is free software; you can redistribute it and/or modify it
+  under the terms of the GNU Lesser General Public License as published by
+  the Free Software Foundation; either version 2.1 of the License, or
+  (at your option) any later version.
+
+  systemd is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with systemd; If not, see <http://www.gnu.org/licenses/>.
+***/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "util.h"
+#include "mkdir.h"
+
+#include "udev.h"
+
+static void help(void) {
+        printf("Usage: udevadm rules OPTIONS\n"
+               "  --update                        compile the rules files\n"
+               "  --check                         check if the compiled rules are up-to-date\n"
+               "  --resolve-names=early|late|never  when to resolve users and groups\n"
+               "  --help\n\n");
+}
+
+static int adm_rules(struct udev *udev, int argc, char *argv[]) {
+        static const struct option options[] = {
+                { "update", no_argument, NULL, 'u' },
+                { "check", no_argument, NULL, 'c' },
+                { "resolve-names", required_argument, NULL, 'N' },
+                { "help", no_argument, NULL, 'h' },
+                {}
+        };
+        bool update = false;
+        bool check = false;
+        int resolve_names = 1;
+        struct udev_rules *rules;
+        int err;
+
+        for (;;) {
+                int option;
+
+                option = getopt_long(argc, argv, "ucN:h", options, NULL);
+                if (option == -1)
+                        break;
+
+                switch (option) {
+                case 'u':
+                        update = true;
+                        break;
+                case 'c':
+                        check = true;
+                        break;
+                case 'N':
+                        if (streq(optarg, "early")) {
+                                resolve_names = 1;
+                        } else if (streq(optarg, "late")) {
+                                resolve_names = 0;
+                        } else if (streq(optarg, "never")) {
+                                resolve_names = -1;
+                        } else {
+                                log_error("resolve-names must be early, late or never\n");
+                                return EXIT_FAILURE;
+                        }
+                        break;
+                case 'h':
+                        help();
+                        return EXIT_SUCCESS;
+                }
+        }
+
+        if (!update && !check) {
+                help();
+                return EXIT_SUCCESS;
+        }
+
+        if (update) {
+                rules = udev_rules_new(udev, resolve_names);
+                if (rules == NULL) {
+                        log_error("error reading rules\n");
+                        return EXIT_FAILURE;
+                }
+
+                mkdir_parents(UDEV_RULES_BIN, 0755);
+                err = udev_rules_write(rules, UDEV_RULES_BIN);
+                udev_rules_unref(rules);
+                if (err < 0) {
+                        log_error("Failure writing %s: %s\n", UDEV_RULES_BIN, strerror(-err));
+                        return EXIT_FAILURE;
+                }
+        }
+
+        if (check) {
+                rules = udev_rules_new_compiled(udev, resolve_names);
+                if (rules == NULL) {
+                        printf("%s is missing or out of date\n", UDEV_RULES_BIN);
+                        return EXIT_FAILURE;
+                }
+                udev_rules_unref(rules);
+                printf("%s is up-to-date\n", UDEV_RULES_BIN);
+        }
+
+        return EXIT_SUCCESS;
+}
+
+const struct udevadm_cmd udevadm_rules = {
+        .name = "rules",
+        .cmd = adm_rules,
+        .help = "maintain the compiled rules",
+};
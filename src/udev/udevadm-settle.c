@@ -131,8 +131,35 @@ static int adm_settle(struct udev *udev, int argc, char *argv[])
                 }
         }
 
+        /* let the udev daemon tell us when the events are handled */
+        if (getuid() == 0 && exists == NULL) {
+                struct udev_ctrl *uctrl;
+
+                uctrl = udev_ctrl_new(udev);
+                if (uctrl != NULL) {
+                        int err;
+
+                        /* unless specified, wait for the events up to the current kernel seqnum */
+                        err = udev_ctrl_send_settle(uctrl, start, end > 0 ? end : udev_queue_get_kernel_seqnum(udev_queue),
+                                                    timeout > 0 ? (int) timeout : -1);
+                        udev_ctrl_unref(uctrl);
+                        if (err == -ECONNREFUSED || err == -ENOENT) {
+                                log_debug("no connection to daemon\n");
+                                rc = EXIT_SUCCESS;
+                                goto out;
+                        }
+                        if (err == 0) {
+                                char ts[FORMAT_TIMESPAN_MAX];
+
+                                log_debug("daemon reported settled queue after %s\n",
+                                          format_timespan(ts, sizeof(ts), now(CLOCK_MONOTONIC) - start_usec));
+                        }
+                        /* verify below, a daemon of an earlier version closes the connection right away */
+                }
+        }
+
         /* guarantee that the udev daemon isn't pre-processing */
-        if (getuid() == 0) {
+        if (getuid() == 0 && exists != NULL) {
                 struct udev_ctrl *uctrl;
 
                 uctrl = udev_ctrl_new(udev);
@@ -42,6 +42,7 @@ static int adm_test(struct udev *udev, int argc, char *argv[])
         struct udev_rules *rules = NULL;
         struct udev_list_entry *entry;
         sigset_t mask, sigmask_orig;
+        char ts[FORMAT_TIMESPAN_MAX];
         int err;
         int rc = 0;
 
@@ -154,6 +155,9 @@ static int adm_test(struct udev *udev, int argc, char *argv[])
                         printf("run: '%s'\n", program);
                 }
         }
+
+        printf("rules: %u checked in %s\n", event->rules_checked,
+               format_timespan(ts, sizeof(ts), event->rules_usec));
 out:
         if (event != NULL && event->fd_signal >= 0)
                 close(event->fd_signal);
@@ -26,36 +26,304 @@
 #include <fcntl.h>
 #include <syslog.h>
 #include <fnmatch.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/utsname.h>
 
 #include "udev.h"
+#include "sd-id128.h"
 
 static int verbose;
 static int dry_run;
 
-static void exec_list(struct udev_enumerate *udev_enumerate, const char *action)
+/* how long --wait-for-completion waits for udevd */
+#define TRIGGER_TIMEOUT_USEC (120 * USEC_PER_SEC)
+
+enum trigger_status {
+        TRIGGER_FAILED,
+        /* the event carries our trigger id */
+        TRIGGER_TAGGED,
+        /* the kernel does not support tagging, match by device and action */
+        TRIGGER_UNTAGGED,
+};
+
+/* shared between the writing processes */
+struct trigger_state {
+        unsigned int next;
+        unsigned char status[];
+};
+
+/*
+ * Arguments to the action written to the uevent file are supported since
+ * kernel 4.13. Older kernels log an unknown action, but do not fail the
+ * write and do not send an event.
+ */
+static bool kernel_supports_synth_uuid(void)
+{
+        struct utsname u;
+        unsigned int major, minor;
+
+        if (uname(&u) < 0)
+                return false;
+        if (sscanf(u.release, "%u.%u", &major, &minor) != 2)
+                return false;
+        return major > 4 || (major == 4 && minor >= 13);
+}
+
+static enum trigger_status write_uevent(const char *syspath, const char *action, const char *id)
+{
+        char filename[UTIL_PATH_SIZE];
+        char buf[UTIL_LINE_SIZE];
+        enum trigger_status status = TRIGGER_FAILED;
+        int fd;
+
+        strscpyl(filename, sizeof(filename), syspath, "/uevent", NULL);
+        fd = open(filename, O_WRONLY|O_CLOEXEC);
+        if (fd < 0)
+                return TRIGGER_FAILED;
+
+        if (id != NULL) {
+                /* "<action> <uuid>" results in SYNTH_UUID=<uuid> in the event */
+                snprintf(buf, sizeof(buf), "%s %s", action, id);
+                if (write(fd, buf, strlen(buf)) >= 0)
+                        status = TRIGGER_TAGGED;
+                else if (errno != EINVAL)
+                        log_debug("error writing '%s' to '%s': %m\n", buf, filename);
+        }
+
+        if (status == TRIGGER_FAILED) {
+                if (write(fd, action, strlen(action)) >= 0)
+                        status = TRIGGER_UNTAGGED;
+                else
+                        log_debug("error writing '%s' to '%s': %m\n", action, filename);
+        }
+
+        close(fd);
+        return status;
+}
+
+static void exec_range(const char **devices, unsigned int n, const char *action, const char *id, struct trigger_state *state)
+{
+        for (;;) {
+                unsigned int i;
+
+                /* devices are handed out in the order of the list */
+                i = __sync_fetch_and_add(&state->next, 1);
+                if (i >= n)
+                        break;
+                state->status[i] = write_uevent(devices[i], action, id);
+        }
+}
+
+static struct trigger_state *exec_list(const char **devices, unsigned int n, const char *action,
+                                       unsigned int parallel, const char *id)
+{
+        struct trigger_state *state;
+        unsigned int i, children = 0;
+
+        state = mmap(NULL, sizeof(struct trigger_state) + n, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+        if (state == MAP_FAILED)
+                return NULL;
+
+        for (i = 1; i < parallel && i < n; i++) {
+                pid_t pid;
+
+                pid = fork();
+                if (pid < 0) {
+                        log_error("fork() failed: %m\n");
+                        break;
+                }
+                if (pid == 0) {
+                        exec_range(devices, n, action, id, state);
+                        _exit(EXIT_SUCCESS);
+                }
+                children++;
+        }
+
+        exec_range(devices, n, action, id, state);
+
+        while (children > 0) {
+                if (wait(NULL) < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        break;
+                }
+                children--;
+        }
+
+        return state;
+}
+
+/* wait for the events of the triggered devices to be processed by udevd */
+static unsigned int wait_for_completion(struct udev *udev, struct udev_monitor *monitor,
+                                        const char **devices, unsigned int n, const char *action,
+                                        const char *id, struct trigger_state *state, usec_t timeout)
+{
+        struct udev_list pending;
+        unsigned int i, count = 0;
+        usec_t until;
+
+        udev_list_init(udev, &pending, true);
+        for (i = 0; i < n; i++) {
+                struct udev_list_entry *entry;
+
+                if (state->status[i] == TRIGGER_FAILED)
+                        continue;
+                entry = udev_list_entry_add(&pending, devices[i], NULL);
+                if (entry == NULL)
+                        continue;
+                udev_list_entry_set_num(entry, state->status[i]);
+                count++;
+        }
+
+        until = now(CLOCK_MONOTONIC) + timeout;
+        while (count > 0) {
+                struct pollfd pfd = {
+                        .fd = udev_monitor_get_fd(monitor),
+                        .events = POLLIN,
+                };
+                struct udev_device *dev;
+                struct udev_list_entry *entry;
+                const char *synth_id;
+                usec_t n_usec;
+                int r;
+
+                n_usec = now(CLOCK_MONOTONIC);
+                if (n_usec >= until)
+                        break;
+
+                r = poll(&pfd, 1, (until - n_usec + USEC_PER_MSEC - 1) / USEC_PER_MSEC);
+                if (r < 0 && errno != EINTR)
+                        break;
+                if (r <= 0)
+                        continue;
+
+                dev = udev_monitor_receive_device(monitor);
+                if (dev == NULL)
+                        continue;
+
+                entry = udev_list_entry_get_by_name(udev_list_get_entry(&pending), udev_device_get_syspath(dev));
+                if (entry != NULL) {
+                        synth_id = udev_device_get_property_value(dev, "SYNTH_UUID");
+
+                        switch (udev_list_entry_get_num(entry)) {
+                        case TRIGGER_TAGGED:
+                                if (synth_id == NULL || !streq(synth_id, id))
+                                        break;
+                                udev_list_entry_set_num(entry, TRIGGER_FAILED);
+                                count--;
+                                break;
+                        case TRIGGER_UNTAGGED:
+                                if (!streq_ptr(udev_device_get_action(dev), action))
+                                        break;
+                                udev_list_entry_set_num(entry, TRIGGER_FAILED);
+                                count--;
+                                break;
+                        }
+                }
+                udev_device_unref(dev);
+        }
+
+        udev_list_cleanup(&pending);
+        return count;
+}
+
+static int exec_trigger(struct udev *udev, struct udev_enumerate *udev_enumerate, const char *action,
+                        unsigned int parallel, bool wait_done)
 {
         struct udev_list_entry *entry;
+        struct udev_monitor *monitor = NULL;
+        struct trigger_state *state = NULL;
+        const char **devices;
+        unsigned int n = 0, i, triggered = 0, missing;
+        const char *tag = NULL;
+        char id[37];
+        usec_t start, done;
+        char ts_triggered[FORMAT_TIMESPAN_MAX], ts_done[FORMAT_TIMESPAN_MAX];
+        int rc = 0;
 
+        udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(udev_enumerate))
+                n++;
+        devices = new(const char *, MAX(n, 1U));
+        if (devices == NULL)
+                return 1;
+        n = 0;
         udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(udev_enumerate)) {
-                char filename[UTIL_PATH_SIZE];
-                int fd;
-
+                devices[n++] = udev_list_entry_get_name(entry);
                 if (verbose)
                         printf("%s\n", udev_list_entry_get_name(entry));
-                if (dry_run)
-                        continue;
-                strscpyl(filename, sizeof(filename), udev_list_entry_get_name(entry), "/uevent", NULL);
-                fd = open(filename, O_WRONLY);
-                if (fd < 0)
-                        continue;
-                if (write(fd, action, strlen(action)) < 0)
-                        log_debug("error writing '%s' to '%s': %m\n", action, filename);
-                close(fd);
         }
+        if (dry_run || n == 0)
+                goto out;
+
+        if (wait_done) {
+                sd_id128_t uuid;
+
+                if (sd_id128_randomize(&uuid) < 0) {
+                        rc = 1;
+                        goto out;
+                }
+                snprintf(id, sizeof(id), "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                         SD_ID128_FORMAT_VAL(uuid));
+
+                /* listen before the first event is triggered */
+                monitor = udev_monitor_new_from_netlink(udev, "udev");
+                if (monitor == NULL) {
+                        log_error("error creating udev monitor\n");
+                        rc = 1;
+                        goto out;
+                }
+                udev_monitor_set_receive_buffer_size(monitor, 128*1024*1024);
+                if (udev_monitor_enable_receiving(monitor) < 0) {
+                        log_error("error binding udev monitor\n");
+                        rc = 1;
+                        goto out;
+                }
+        }
+
+        /* without support for tagging, the completions are matched by device and action */
+        if (wait_done) {
+                if (kernel_supports_synth_uuid())
+                        tag = id;
+                else
+                        log_debug("kernel does not support uevent arguments, events are not tagged\n");
+        }
+
+        start = now(CLOCK_MONOTONIC);
+        state = exec_list(devices, n, action, parallel, tag);
+        if (state == NULL) {
+                rc = 1;
+                goto out;
+        }
+        for (i = 0; i < n; i++)
+                if (state->status[i] != TRIGGER_FAILED)
+                        triggered++;
+        done = now(CLOCK_MONOTONIC);
+        log_debug("triggered %u of %u devices in %s\n", triggered, n,
+                  format_timespan(ts_triggered, sizeof(ts_triggered), done - start));
+
+        if (!wait_done)
+                goto out;
+
+        missing = wait_for_completion(udev, monitor, devices, n, action, id, state, TRIGGER_TIMEOUT_USEC);
+        printf("%u events triggered in %s, processed in %s\n", triggered,
+               format_timespan(ts_triggered, sizeof(ts_triggered), done - start),
+               format_timespan(ts_done, sizeof(ts_done), now(CLOCK_MONOTONIC) - start));
+        if (missing > 0) {
+                log_error("%u events were not processed in time\n", missing);
+                rc = 1;
+        }
+out:
+        if (state != NULL)
+                munmap(state, sizeof(struct trigger_state) + n);
+        udev_monitor_unref(monitor);
+        free(devices);
+        return rc;
 }
 
 static const char *keyval(const char *str, const char **val, char *buf, size_t size)
@@ -87,6 +355,8 @@ static int adm_trigger(struct udev *udev, int argc, char *argv[])
                 { "tag-match", required_argument, NULL, 'g' },
                 { "sysname-match", required_argument, NULL, 'y' },
                 { "parent-match", required_argument, NULL, 'b' },
+                { "parallel", required_argument, NULL, 'j' },
+                { "wait-for-completion", no_argument, NULL, 'w' },
                 { "help", no_argument, NULL, 'h' },
                 {}
         };
@@ -95,6 +365,8 @@ static int adm_trigger(struct udev *udev, int argc, char *argv[])
                 TYPE_SUBSYSTEMS,
         } device_type = TYPE_DEVICES;
         const char *action = "change";
+        unsigned int parallel = 1;
+        bool wait_done = false;
         struct udev_enumerate *udev_enumerate;
         int rc = 0;
 
@@ -110,7 +382,7 @@ static int adm_trigger(struct udev *udev, int argc, char *argv[])
                 const char *val;
                 char buf[UTIL_PATH_SIZE];
 
-                option = getopt_long(argc, argv, "vng:o:t:hc:p:s:S:a:A:y:b:", options, NULL);
+                option = getopt_long(argc, argv, "vng:o:t:hc:p:s:S:a:A:y:b:j:w", options, NULL);
                 if (option == -1)
                         break;
 
@@ -180,6 +452,16 @@ static int adm_trigger(struct udev *udev, int argc, char *argv[])
                         udev_device_unref(dev);
                         break;
                 }
+                case 'j':
+                        if (safe_atou(optarg, &parallel) < 0 || parallel == 0) {
+                                log_error("invalid number of parallel writers --parallel=%s\n", optarg);
+                                rc = 2;
+                                goto exit;
+                        }
+                        break;
+                case 'w':
+                        wait_done = true;
+                        break;
                 case 'h':
                         printf("Usage: udevadm trigger OPTIONS\n"
                                "  --verbose                       print the list of devices while running\n"
@@ -196,6 +478,8 @@ static int adm_trigger(struct udev *udev, int argc, char *argv[])
                                "  --tag-match=<key>=<value>       trigger devices with a matching property\n"
                                "  --sysname-match=<name>          trigger devices with a matching name\n"
                                "  --parent-match=<name>           trigger devices with that parent device\n"
+                               "  --parallel=<number>             number of processes writing the events\n"
+                               "  --wait-for-completion           wait until udevd processed the triggered events\n"
                                "  --help\n\n");
                         goto exit;
                 default:
@@ -207,11 +491,11 @@ static int adm_trigger(struct udev *udev, int argc, char *argv[])
         switch (device_type) {
         case TYPE_SUBSYSTEMS:
                 udev_enumerate_scan_subsystems(udev_enumerate);
-                exec_list(udev_enumerate, action);
+                rc = exec_trigger(udev, udev_enumerate, action, parallel, wait_done);
                 goto exit;
         case TYPE_DEVICES:
                 udev_enumerate_scan_devices(udev_enumerate);
-                exec_list(udev_enumerate, action);
+                rc = exec_trigger(udev, udev_enumerate, action, parallel, wait_done);
                 goto exit;
         default:
                 goto exit;
@@ -41,6 +41,7 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/inotify.h>
 #include <sys/utsname.h>
 
@@ -60,20 +61,28 @@ void udev_main_log(struct udev *udev, int priority,
 
 static struct udev_rules *rules;
 static struct udev_queue_export *udev_queue_export;
+static struct udev_depend *event_depend;
 static struct udev_ctrl *udev_ctrl;
 static struct udev_monitor *monitor;
 static int worker_watch[2] = { -1, -1 };
+static int worker_queue = -1;
+static struct sockaddr_un worker_queue_addr;
+static socklen_t worker_queue_addrlen;
 static int fd_signal = -1;
 static int fd_ep = -1;
 static int fd_inotify = -1;
 static bool stop_exec_queue;
 static bool reload;
+static bool db_outdated = true;
+static pid_t db_writer_pid;
 static int children;
 static int children_max;
 static int exec_delay;
 static sigset_t sigmask_orig;
 static UDEV_LIST(event_list);
 static UDEV_LIST(worker_list);
+static UDEV_LIST(settle_list);
+static unsigned long long int seqnum_last;
 char *udev_cgroup;
 static bool udev_exit;
 
@@ -89,15 +98,11 @@ struct event {
         struct udev_device *dev;
         enum event_state state;
         int exitcode;
-        unsigned long long int delaying_seqnum;
         unsigned long long int seqnum;
         const char *devpath;
-        size_t devpath_len;
-        const char *devpath_old;
-        dev_t devnum;
-        int ifindex;
-        bool is_block;
-        bool nodelay;
+        struct udev_depend_entry depend;
+        /* worker slot while running */
+        int slot;
 };
 
 static inline struct event *node_to_event(struct udev_list_node *node)
@@ -119,30 +124,82 @@ struct worker {
         struct udev *udev;
         int refcount;
         pid_t pid;
-        struct udev_monitor *monitor;
+        struct sockaddr_un addr;
+        socklen_t addrlen;
         enum worker_state state;
         struct event *event;
         usec_t event_start_usec;
 };
 
+/*
+ * Events are passed to the workers in slots of a shared memory mapping,
+ * the request sent to the worker's socket carries only the index of the
+ * slot. The monitor buffer of a device never exceeds the size of a slot.
+ */
+#define WORKER_SLOTS                    4096
+#define WORKER_SLOT_SIZE                4096
+
+struct worker_slot {
+        unsigned int len;
+        char buf[WORKER_SLOT_SIZE];
+};
+
+/* passed from main process to worker */
+struct worker_request {
+        unsigned int slot;
+        unsigned int rules_generation;
+};
+
 /* passed from worker to main process */
 struct worker_message {
         pid_t pid;
         int exitcode;
 };
 
+/* results read with a single syscall */
+#define WORKER_MESSAGES                 64
+
+/* idle workers are kept around for the next burst of events */
+#define WORKER_IDLE_USEC                (30 * USEC_PER_SEC)
+
+/* the rules mapped by the running workers after a reload */
+#define UDEV_RULES_SHARED               "/run/udev/rules.bin"
+
+static struct worker_slot *worker_slots;
+static unsigned int slots_free[WORKER_SLOTS];
+static unsigned int slots_free_count;
+static unsigned int rules_generation;
+static unsigned int events_done;
+
 static inline struct worker *node_to_worker(struct udev_list_node *node)
 {
         return container_of(node, struct worker, node);
 }
 
+/* 'udevadm settle' client, the connection is closed when its events are handled */
+struct settle {
+        struct udev_list_node node;
+        struct udev_ctrl_connection *conn;
+        unsigned long long int start;
+        unsigned long long int end;
+};
+
+static inline struct settle *node_to_settle(struct udev_list_node *node)
+{
+        return container_of(node, struct settle, node);
+}
+
 static void event_queue_delete(struct event *event, bool export)
 {
         udev_list_node_remove(&event->node);
+        udev_depend_remove(event_depend, &event->depend);
+        if (event->slot >= 0)
+                slots_free[slots_free_count++] = event->slot;
 
         if (export) {
                 udev_queue_export_device_finished(udev_queue_export, event->dev);
                 log_debug("seq %llu done with %i\n", udev_device_get_seqnum(event->dev), event->exitcode);
+                events_done++;
         }
         udev_device_unref(event->dev);
         free(event);
@@ -157,7 +214,6 @@ static struct worker *worker_ref(struct worker *worker)
 static void worker_cleanup(struct worker *worker)
 {
         udev_list_node_remove(&worker->node);
-        udev_monitor_unref(worker->monitor);
         children--;
         free(worker);
 }
@@ -182,19 +238,97 @@ static void worker_list_cleanup(struct udev *udev)
         }
 }
 
+static void settle_add(struct udev_ctrl_connection *conn, unsigned long long int start, unsigned long long int end)
+{
+        struct settle *settle;
+
+        settle = calloc(1, sizeof(struct settle));
+        if (settle == NULL)
+                return;
+        settle->conn = udev_ctrl_connection_ref(conn);
+        settle->start = start;
+        settle->end = end;
+        udev_list_node_append(&settle->node, &settle_list);
+}
+
+static bool settle_is_done(struct settle *settle)
+{
+        struct udev_list_node *loop;
+
+        /* not all events of the range are received yet */
+        if (seqnum_last < settle->end)
+                return false;
+
+        udev_list_node_foreach(loop, &event_list) {
+                struct event *event = node_to_event(loop);
+
+                if (event->seqnum > settle->end)
+                        break;
+                if (event->seqnum >= settle->start)
+                        return false;
+        }
+        return true;
+}
+
+/* wake up the clients waiting for their events, or all of them */
+static void settle_release(bool all)
+{
+        struct udev_list_node *loop, *tmp;
+
+        udev_list_node_foreach_safe(loop, tmp, &settle_list) {
+                struct settle *settle = node_to_settle(loop);
+
+                if (!all && !settle_is_done(settle))
+                        continue;
+
+                udev_list_node_remove(&settle->node);
+                udev_ctrl_connection_unref(settle->conn);
+                free(settle);
+        }
+}
+
+static struct udev_device *worker_slot_get_device(struct udev *udev, const struct worker_slot *slot)
+{
+        struct udev_device *dev;
+        size_t bufpos = 0;
+
+        dev = udev_device_new(udev);
+        if (dev == NULL)
+                return NULL;
+        udev_device_set_info_loaded(dev);
+
+        while (bufpos < slot->len) {
+                const char *key;
+                size_t keylen;
+
+                key = &slot->buf[bufpos];
+                keylen = strnlen(key, slot->len - bufpos);
+                if (keylen == 0 || bufpos + keylen >= slot->len)
+                        break;
+                bufpos += keylen + 1;
+                udev_device_add_property_from_string_parse(dev, key);
+        }
+
+        if (udev_device_add_property_from_string_parse_finish(dev) < 0) {
+                udev_device_unref(dev);
+                return NULL;
+        }
+        return dev;
+}
+
 static void worker_new(struct event *event)
 {
         struct udev *udev = event->udev;
         struct worker *worker;
         struct udev_monitor *worker_monitor;
+        struct sockaddr_un sa;
+        int fd_request;
         pid_t pid;
 
-        /* listen for new events */
+        /* send processed events to libudev listeners */
         worker_monitor = udev_monitor_new_from_netlink(udev, NULL);
         if (worker_monitor == NULL)
                 return;
-        /* allow the main daemon netlink address to send devices to the worker */
-        udev_monitor_allow_unicast_sender(worker_monitor, monitor);
         udev_monitor_enable_receiving(worker_monitor);
 
         worker = calloc(1, sizeof(struct worker));
@@ -206,13 +340,30 @@ static void worker_new(struct event *event)
         worker->refcount = 2;
         worker->udev = udev;
 
+        /* listen for new events, autobind to an abstract address, accept only the main daemon */
+        fd_request = socket(AF_LOCAL, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+        memset(&sa, 0, sizeof(struct sockaddr_un));
+        sa.sun_family = AF_LOCAL;
+        worker->addrlen = sizeof(struct sockaddr_un);
+        if (fd_request < 0 ||
+            bind(fd_request, (struct sockaddr *) &sa, sizeof(sa_family_t)) < 0 ||
+            connect(fd_request, (struct sockaddr *) &worker_queue_addr, worker_queue_addrlen) < 0 ||
+            getsockname(fd_request, (struct sockaddr *) &worker->addr, &worker->addrlen) < 0) {
+                log_error("error creating worker socket: %m\n");
+                if (fd_request >= 0)
+                        close(fd_request);
+                udev_monitor_unref(worker_monitor);
+                free(worker);
+                return;
+        }
+
         pid = fork();
         switch (pid) {
         case 0: {
                 struct udev_device *dev = NULL;
-                int fd_monitor;
-                struct epoll_event ep_signal, ep_monitor;
+                struct epoll_event ep_signal, ep_request;
                 sigset_t mask;
+                bool exit_after = false;
                 int rc = EXIT_SUCCESS;
 
                 /* take initial device from queue */
@@ -220,14 +371,17 @@ static void worker_new(struct event *event)
                 event->dev = NULL;
 
                 free(worker);
+                settle_release(true);
                 worker_list_cleanup(udev);
                 event_queue_cleanup(udev, EVENT_UNDEF);
+                udev_depend_free(event_depend);
                 udev_queue_export_unref(udev_queue_export);
                 udev_monitor_unref(monitor);
                 udev_ctrl_unref(udev_ctrl);
                 close(fd_signal);
                 close(fd_ep);
                 close(worker_watch[READ_END]);
+                close(worker_queue);
 
                 sigfillset(&mask);
                 fd_signal = signalfd(-1, &mask, SFD_NONBLOCK|SFD_CLOEXEC);
@@ -248,13 +402,12 @@ static void worker_new(struct event *event)
                 ep_signal.events = EPOLLIN;
                 ep_signal.data.fd = fd_signal;
 
-                fd_monitor = udev_monitor_get_fd(worker_monitor);
-                memset(&ep_monitor, 0, sizeof(struct epoll_event));
-                ep_monitor.events = EPOLLIN;
-                ep_monitor.data.fd = fd_monitor;
+                memset(&ep_request, 0, sizeof(struct epoll_event));
+                ep_request.events = EPOLLIN;
+                ep_request.data.fd = fd_request;
 
                 if (epoll_ctl(fd_ep, EPOLL_CTL_ADD, fd_signal, &ep_signal) < 0 ||
-                    epoll_ctl(fd_ep, EPOLL_CTL_ADD, fd_monitor, &ep_monitor) < 0) {
+                    epoll_ctl(fd_ep, EPOLL_CTL_ADD, fd_request, &ep_request) < 0) {
                         log_error("fail to add fds to epoll: %m\n");
                         rc = 4;
                         goto out;
@@ -311,7 +464,7 @@ static void worker_new(struct event *event)
                         udev_device_unref(dev);
                         dev = NULL;
 
-                        if (udev_event->sigterm) {
+                        if (udev_event->sigterm || exit_after) {
                                 udev_event_unref(udev_event);
                                 goto out;
                         }
@@ -333,8 +486,33 @@ static void worker_new(struct event *event)
                                 }
 
                                 for (i = 0; i < fdcount; i++) {
-                                        if (ev[i].data.fd == fd_monitor && ev[i].events & EPOLLIN) {
-                                                dev = udev_monitor_receive_device(worker_monitor);
+                                        if (ev[i].data.fd == fd_request && ev[i].events & EPOLLIN) {
+                                                struct worker_request req;
+                                                ssize_t size;
+
+                                                size = recv(fd_request, &req, sizeof(struct worker_request), MSG_DONTWAIT);
+                                                if (size != sizeof(struct worker_request) || req.slot >= WORKER_SLOTS)
+                                                        continue;
+
+                                                /* the rules have been reloaded, map the new ones */
+                                                if (req.rules_generation != rules_generation) {
+                                                        struct udev_rules *rules_new;
+
+                                                        rules_new = udev_rules_new_from_file(udev, UDEV_RULES_SHARED);
+                                                        if (rules_new != NULL) {
+                                                                udev_rules_unref(rules);
+                                                                rules = rules_new;
+                                                                udev_builtin_exit(udev);
+                                                                udev_builtin_init(udev);
+                                                        } else {
+                                                                log_error("unable to map '%s', exit after this event\n",
+                                                                          UDEV_RULES_SHARED);
+                                                                exit_after = true;
+                                                        }
+                                                        rules_generation = req.rules_generation;
+                                                }
+
+                                                dev = worker_slot_get_device(udev, &worker_slots[req.slot]);
                                                 break;
                                         } else if (ev[i].data.fd == fd_signal && ev[i].events & EPOLLIN) {
                                                 struct signalfd_siginfo fdsi;
@@ -358,6 +536,7 @@ out:
                 if (fd_ep >= 0)
                         close(fd_ep);
                 close(fd_inotify);
+                close(fd_request);
                 close(worker_watch[WRITE_END]);
                 udev_rules_unref(rules);
                 udev_builtin_exit(udev);
@@ -367,15 +546,16 @@ out:
                 exit(rc);
         }
         case -1:
+                close(fd_request);
                 udev_monitor_unref(worker_monitor);
                 event->state = EVENT_QUEUED;
                 free(worker);
                 log_error("fork of child failed: %m\n");
                 break;
         default:
-                /* close monitor, but keep address around */
-                udev_monitor_disconnect(worker_monitor);
-                worker->monitor = worker_monitor;
+                /* close sockets, but keep address around */
+                close(fd_request);
+                udev_monitor_unref(worker_monitor);
                 worker->pid = pid;
                 worker->state = WORKER_RUNNING;
                 worker->event_start_usec = now(CLOCK_MONOTONIC);
@@ -388,20 +568,58 @@ out:
         }
 }
 
+/* pass the event in a shared memory slot to an idle worker */
+static int worker_send(struct worker *worker, struct event *event)
+{
+        struct worker_request req;
+        const char *buf;
+        ssize_t len;
+
+        if (slots_free_count == 0)
+                return -EBUSY;
+
+        len = udev_device_get_properties_monitor_buf(event->dev, &buf);
+        if (len < 0 || len > WORKER_SLOT_SIZE)
+                return -E2BIG;
+
+        req.slot = slots_free[--slots_free_count];
+        req.rules_generation = rules_generation;
+        memcpy(worker_slots[req.slot].buf, buf, len);
+        worker_slots[req.slot].len = len;
+
+        if (sendto(worker_queue, &req, sizeof(struct worker_request), MSG_DONTWAIT,
+                   (struct sockaddr *) &worker->addr, worker->addrlen) < 0) {
+                slots_free[slots_free_count++] = req.slot;
+                return -errno;
+        }
+
+        event->slot = req.slot;
+        return 0;
+}
+
 static void event_run(struct event *event)
 {
         struct udev_list_node *loop;
 
         udev_list_node_foreach(loop, &worker_list) {
                 struct worker *worker = node_to_worker(loop);
-                ssize_t count;
+                int err;
 
                 if (worker->state != WORKER_IDLE)
                         continue;
 
-                count = udev_monitor_send_device(monitor, worker->monitor, event->dev);
-                if (count < 0) {
-                        log_error("worker [%u] did not accept message %zi (%m), kill it\n", worker->pid, count);
+                err = worker_send(worker, event);
+                if (err == -EBUSY) {
+                        log_debug("all %u worker slots in use\n", WORKER_SLOTS);
+                        return;
+                }
+                /* not the fault of the worker, a new worker takes the device directly at fork() */
+                if (err == -E2BIG) {
+                        log_debug("seq %llu does not fit into a worker slot\n", udev_device_get_seqnum(event->dev));
+                        break;
+                }
+                if (err < 0) {
+                        log_error("worker [%u] did not accept message (%s), kill it\n", worker->pid, strerror(-err));
                         kill(worker->pid, SIGKILL);
                         worker->state = WORKER_KILLED;
                         continue;
@@ -435,14 +653,22 @@ static int event_queue_insert(struct udev_device *dev)
         event->udev = udev_device_get_udev(dev);
         event->dev = dev;
         event->seqnum = udev_device_get_seqnum(dev);
+        if (event->seqnum > seqnum_last)
+                seqnum_last = event->seqnum;
         event->devpath = udev_device_get_devpath(dev);
-        event->devpath_len = strlen(event->devpath);
-        event->devpath_old = udev_device_get_devpath_old(dev);
-        event->devnum = udev_device_get_devnum(dev);
-        event->is_block = streq("block", udev_device_get_subsystem(dev));
-        event->ifindex = udev_device_get_ifindex(dev);
+        event->slot = -1;
+        event->depend.seqnum = event->seqnum;
+        event->depend.devpath_old = udev_device_get_devpath_old(dev);
+        event->depend.devnum = udev_device_get_devnum(dev);
+        event->depend.is_block = streq("block", udev_device_get_subsystem(dev));
+        event->depend.ifindex = udev_device_get_ifindex(dev);
         if (streq(udev_device_get_subsystem(dev), "firmware"))
-                event->nodelay = true;
+                event->depend.nodelay = true;
+
+        if (udev_depend_add(event_depend, &event->depend, event->devpath) < 0) {
+                free(event);
+                return -1;
+        }
 
         udev_queue_export_device_queued(udev_queue_export, dev);
         log_debug("seq %llu queued, '%s' '%s'\n", udev_device_get_seqnum(dev),
@@ -468,81 +694,28 @@ static void worker_kill(struct udev *udev)
         }
 }
 
-/* lookup event for identical, parent, child device */
-static bool is_devpath_busy(struct event *event)
+/* use the compiled rules if they are up-to-date, parse the rules files otherwise */
+static struct udev_rules *rules_load(struct udev *udev, int resolve_names)
 {
-        struct udev_list_node *loop;
-        size_t common;
-
-        /* check if queue contains events we depend on */
-        udev_list_node_foreach(loop, &event_list) {
-                struct event *loop_event = node_to_event(loop);
+        struct udev_rules *rules_new;
 
-                /* we already found a later event, earlier can not block us, no need to check again */
-                if (loop_event->seqnum < event->delaying_seqnum)
-                        continue;
-
-                /* event we checked earlier still exists, no need to check again */
-                if (loop_event->seqnum == event->delaying_seqnum)
-                        return true;
-
-                /* found ourself, no later event can block us */
-                if (loop_event->seqnum >= event->seqnum)
-                        break;
-
-                /* check major/minor */
-                if (major(event->devnum) != 0 && event->devnum == loop_event->devnum && event->is_block == loop_event->is_block)
-                        return true;
-
-                /* check network device ifindex */
-                if (event->ifindex != 0 && event->ifindex == loop_event->ifindex)
-                        return true;
-
-                /* check our old name */
-                if (event->devpath_old != NULL && strcmp(loop_event->devpath, event->devpath_old) == 0) {
-                        event->delaying_seqnum = loop_event->seqnum;
-                        return true;
-                }
-
-                /* compare devpath */
-                common = MIN(loop_event->devpath_len, event->devpath_len);
-
-                /* one devpath is contained in the other? */
-                if (memcmp(loop_event->devpath, event->devpath, common) != 0)
-                        continue;
-
-                /* identical device event found */
-                if (loop_event->devpath_len == event->devpath_len) {
-                        /* devices names might have changed/swapped in the meantime */
-                        if (major(event->devnum) != 0 && (event->devnum != loop_event->devnum || event->is_block != loop_event->is_block))
-                                continue;
-                        if (event->ifindex != 0 && event->ifindex != loop_event->ifindex)
-                                continue;
-                        event->delaying_seqnum = loop_event->seqnum;
-                        return true;
-                }
-
-                /* allow to bypass the dependency tracking */
-                if (event->nodelay)
-                        continue;
-
-                /* parent device event found */
-                if (event->devpath[common] == '/') {
-                        event->delaying_seqnum = loop_event->seqnum;
-                        return true;
-                }
+        rules_new = udev_rules_new_compiled(udev, resolve_names);
+        if (rules_new != NULL)
+                return rules_new;
+        return udev_rules_new(udev, resolve_names);
+}
 
-                /* child device event found */
-                if (loop_event->devpath[common] == '/') {
-                        event->delaying_seqnum = loop_event->seqnum;
-                        return true;
-                }
+/* write the rules for the running workers, they map them with their next event */
+static void rules_publish(struct udev *udev)
+{
+        int err;
 
-                /* no matching device */
-                continue;
+        rules_generation++;
+        err = udev_rules_write(rules, UDEV_RULES_SHARED);
+        if (err < 0) {
+                log_error("unable to write '%s': %s, restart workers\n", UDEV_RULES_SHARED, strerror(-err));
+                worker_kill(udev);
         }
-
-        return false;
 }
 
 static void event_queue_start(struct udev *udev)
@@ -556,10 +729,14 @@ static void event_queue_start(struct udev *udev)
                         continue;
 
                 /* do not start event if parent or child event is still running */
-                if (is_devpath_busy(event))
+                if (udev_depend_is_busy(event_depend, &event->depend))
                         continue;
 
                 event_run(event);
+
+                /* no worker available, no later event can be started either */
+                if (event->state == EVENT_QUEUED && children >= children_max)
+                        break;
         }
 }
 
@@ -579,33 +756,54 @@ static void event_queue_cleanup(struct udev *udev, enum event_state match_type)
 
 static void worker_returned(int fd_worker)
 {
+        struct worker_message msg[WORKER_MESSAGES];
+        struct mmsghdr mmsg[WORKER_MESSAGES];
+        struct iovec iov[WORKER_MESSAGES];
+        unsigned int i;
+
+        for (i = 0; i < WORKER_MESSAGES; i++) {
+                iov[i].iov_base = &msg[i];
+                iov[i].iov_len = sizeof(struct worker_message);
+                memset(&mmsg[i], 0, sizeof(struct mmsghdr));
+                mmsg[i].msg_hdr.msg_iov = &iov[i];
+                mmsg[i].msg_hdr.msg_iovlen = 1;
+        }
+
         for (;;) {
-                struct worker_message msg;
-                ssize_t size;
-                struct udev_list_node *loop;
+                int count;
 
-                size = recv(fd_worker, &msg, sizeof(struct worker_message), MSG_DONTWAIT);
-                if (size != sizeof(struct worker_message))
+                count = recvmmsg(fd_worker, mmsg, WORKER_MESSAGES, MSG_DONTWAIT, NULL);
+                if (count <= 0)
                         break;
 
-                /* lookup worker who sent the signal */
-                udev_list_node_foreach(loop, &worker_list) {
-                        struct worker *worker = node_to_worker(loop);
+                for (i = 0; i < (unsigned int) count; i++) {
+                        struct udev_list_node *loop;
 
-                        if (worker->pid != msg.pid)
+                        if (mmsg[i].msg_len != sizeof(struct worker_message))
                                 continue;
 
-                        /* worker returned */
-                        if (worker->event) {
-                                worker->event->exitcode = msg.exitcode;
-                                event_queue_delete(worker->event, true);
-                                worker->event = NULL;
+                        /* lookup worker who sent the signal */
+                        udev_list_node_foreach(loop, &worker_list) {
+                                struct worker *worker = node_to_worker(loop);
+
+                                if (worker->pid != msg[i].pid)
+                                        continue;
+
+                                /* worker returned */
+                                if (worker->event) {
+                                        worker->event->exitcode = msg[i].exitcode;
+                                        event_queue_delete(worker->event, true);
+                                        worker->event = NULL;
+                                }
+                                if (worker->state != WORKER_KILLED)
+                                        worker->state = WORKER_IDLE;
+                                worker_unref(worker);
+                                break;
                         }
-                        if (worker->state != WORKER_KILLED)
-                                worker->state = WORKER_IDLE;
-                        worker_unref(worker);
-                        break;
                 }
+
+                if (count < WORKER_MESSAGES)
+                        break;
         }
 }
 
@@ -615,6 +813,7 @@ static struct udev_ctrl_connection *handle_ctrl_msg(struct udev_ctrl *uctrl)
         struct udev *udev = udev_ctrl_get_udev(uctrl);
         struct udev_ctrl_connection *ctrl_conn;
         struct udev_ctrl_msg *ctrl_msg = NULL;
+        unsigned long long int seqnum_start, seqnum_end;
         const char *str;
         int i;
 
@@ -685,6 +884,11 @@ static struct udev_ctrl_connection *handle_ctrl_msg(struct udev_ctrl *uctrl)
         if (udev_ctrl_get_ping(ctrl_msg) > 0)
                 log_debug("udevd message (SYNC) received\n");
 
+        if (udev_ctrl_get_settle(ctrl_msg, &seqnum_start, &seqnum_end) > 0) {
+                log_debug("udevd message (SETTLE) received, seqnum %llu-%llu\n", seqnum_start, seqnum_end);
+                settle_add(ctrl_conn, seqnum_start, seqnum_end);
+        }
+
         if (udev_ctrl_get_exit(ctrl_msg) > 0) {
                 log_debug("udevd message (EXIT) received\n");
                 udev_exit = true;
@@ -746,6 +950,36 @@ static int handle_inotify(struct udev *udev)
         return 0;
 }
 
+/* the snapshot is written by a child, to not block the event handling while it reads the database */
+static void db_writer_spawn(struct udev *udev)
+{
+        pid_t pid;
+
+        pid = fork();
+        switch (pid) {
+        case 0: {
+                int err;
+
+                /* do not keep 'settle' clients waiting until the snapshot is written */
+                settle_release(true);
+                sigprocmask(SIG_SETMASK, &sigmask_orig, NULL);
+                err = udev_db_write(udev, UDEV_DB_BIN);
+                if (err < 0 && err != -EAGAIN)
+                        log_error("error writing %s: %s\n", UDEV_DB_BIN, strerror(-err));
+                /* the database changed while we read it, tell udevd to try again */
+                _exit(err == -EAGAIN ? 2 : err < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+        }
+        case -1:
+                log_error("fork of database writer failed: %m\n");
+                break;
+        default:
+                log_debug("database writer [%u] started\n", pid);
+                db_writer_pid = pid;
+                db_outdated = false;
+                break;
+        }
+}
+
 static void handle_signal(struct udev *udev, int signo)
 {
         switch (signo) {
@@ -763,6 +997,14 @@ static void handle_signal(struct udev *udev, int signo)
                         if (pid <= 0)
                                 break;
 
+                        if (pid == db_writer_pid) {
+                                log_debug("database writer [%u] exit\n", pid);
+                                db_writer_pid = 0;
+                                if (WIFEXITED(status) && WEXITSTATUS(status) == 2)
+                                        db_outdated = true;
+                                continue;
+                        }
+
                         udev_list_node_foreach_safe(loop, tmp, &worker_list) {
                                 struct worker *worker = node_to_worker(loop);
 
@@ -1245,6 +1487,13 @@ int main(int argc, char *argv[])
                 log_error("error creating queue file\n");
                 goto exit;
         }
+        seqnum_last = udev_get_kernel_seqnum(udev);
+
+        event_depend = udev_depend_new(udev);
+        if (event_depend == NULL) {
+                log_error("error creating event index\n");
+                goto exit;
+        }
 
         if (daemonize) {
                 pid_t pid;
@@ -1312,9 +1561,40 @@ int main(int argc, char *argv[])
         }
         fd_worker = worker_watch[READ_END];
 
+        /* socket to pass new events to the workers, autobind to an abstract address */
+        worker_queue = socket(AF_LOCAL, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+        if (worker_queue >= 0) {
+                memset(&worker_queue_addr, 0, sizeof(struct sockaddr_un));
+                worker_queue_addr.sun_family = AF_LOCAL;
+                worker_queue_addrlen = sizeof(struct sockaddr_un);
+                if (bind(worker_queue, (struct sockaddr *) &worker_queue_addr, sizeof(sa_family_t)) < 0 ||
+                    getsockname(worker_queue, (struct sockaddr *) &worker_queue_addr, &worker_queue_addrlen) < 0) {
+                        close(worker_queue);
+                        worker_queue = -1;
+                }
+        }
+        if (worker_queue < 0) {
+                fprintf(stderr, "error creating worker socket\n");
+                log_error("error creating worker socket: %m\n");
+                rc = 6;
+                goto exit;
+        }
+
+        /* event slots shared with the workers */
+        worker_slots = mmap(NULL, WORKER_SLOTS * sizeof(struct worker_slot), PROT_READ|PROT_WRITE,
+                            MAP_SHARED|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+        if (worker_slots == MAP_FAILED) {
+                worker_slots = NULL;
+                log_error("error mapping worker slots: %m\n");
+                rc = 6;
+                goto exit;
+        }
+        for (slots_free_count = 0; slots_free_count < WORKER_SLOTS; slots_free_count++)
+                slots_free[slots_free_count] = WORKER_SLOTS - 1 - slots_free_count;
+
         udev_builtin_init(udev);
 
-        rules = udev_rules_new(udev, resolve_names);
+        rules = rules_load(udev, resolve_names);
         if (rules == NULL) {
                 log_error("error reading rules\n");
                 goto exit;
@@ -1375,6 +1655,8 @@ int main(int argc, char *argv[])
 
         for (;;) {
                 static usec_t last_usec;
+                static usec_t burst_usec;
+                static usec_t idle_usec;
                 struct epoll_event ev[8];
                 int fdcount;
                 int timeout;
@@ -1413,12 +1695,17 @@ int main(int argc, char *argv[])
                         timeout = -1;
 
                         /* cleanup possible left-over processes in our cgroup */
-                        if (udev_cgroup)
+                        if (udev_cgroup && db_writer_pid == 0)
                                 cg_kill(SYSTEMD_CGROUP_CONTROLLER, udev_cgroup, SIGKILL, false, true, NULL);
                 } else {
                         /* kill idle or hanging workers */
                         timeout = 3 * 1000;
                 }
+
+                /* write the database snapshot after the queue was empty for a second */
+                if (db_outdated && db_writer_pid == 0 && !udev_exit && udev_list_node_is_empty(&event_list))
+                        timeout = 1000;
+
                 fdcount = epoll_wait(fd_ep, ev, ELEMENTSOF(ev), timeout);
                 if (fdcount < 0)
                         continue;
@@ -1432,8 +1719,12 @@ int main(int argc, char *argv[])
                                 break;
                         }
 
-                        /* kill idle workers */
-                        if (udev_list_node_is_empty(&event_list)) {
+                        if (db_outdated && db_writer_pid == 0 && udev_list_node_is_empty(&event_list))
+                                db_writer_spawn(udev);
+
+                        /* kill workers which were idle for a while */
+                        if (udev_list_node_is_empty(&event_list) &&
+                            (now(CLOCK_MONOTONIC) - idle_usec) > WORKER_IDLE_USEC) {
                                 log_debug("cleanup idle workers\n");
                                 worker_kill(udev);
                         }
@@ -1488,17 +1779,31 @@ int main(int argc, char *argv[])
                         last_usec = now(CLOCK_MONOTONIC);
                 }
 
-                /* reload requested, HUP signal received, rules changed, builtin changed */
+                /* reload requested, HUP signal received, rules changed, builtin changed;
+                 * the workers pick up the new rules with their next event */
                 if (reload) {
-                        worker_kill(udev);
                         rules = udev_rules_unref(rules);
                         udev_builtin_exit(udev);
                         reload = false;
                 }
 
                 /* event has finished */
-                if (is_worker)
+                if (is_worker) {
                         worker_returned(fd_worker);
+                        db_outdated = true;
+
+                        if (burst_usec > 0 && udev_list_node_is_empty(&event_list)) {
+                                usec_t usec;
+
+                                idle_usec = now(CLOCK_MONOTONIC);
+                                usec = MAX(idle_usec - burst_usec, (usec_t) 1);
+                                log_debug("queue is empty, %u events in %llu ms, %llu events/s\n", events_done,
+                                          (unsigned long long) (usec / USEC_PER_MSEC),
+                                          (unsigned long long) events_done * USEC_PER_SEC / usec);
+                                burst_usec = 0;
+                                events_done = 0;
+                        }
+                }
 
                 if (is_netlink) {
                         struct udev_device *dev;
@@ -1508,14 +1813,19 @@ int main(int argc, char *argv[])
                                 udev_device_set_usec_initialized(dev, now(CLOCK_MONOTONIC));
                                 if (event_queue_insert(dev) < 0)
                                         udev_device_unref(dev);
+                                else if (burst_usec == 0)
+                                        burst_usec = now(CLOCK_MONOTONIC);
                         }
                 }
 
                 /* start new events */
                 if (!udev_list_node_is_empty(&event_list) && !udev_exit && !stop_exec_queue) {
                         udev_builtin_init(udev);
-                        if (rules == NULL)
-                                rules = udev_rules_new(udev, resolve_names);
+                        if (rules == NULL) {
+                                rules = rules_load(udev, resolve_names);
+                                if (rules != NULL)
+                                        rules_publish(udev);
+                        }
                         if (rules != NULL)
                                 event_queue_start(udev);
                 }
@@ -1548,6 +1858,10 @@ int main(int argc, char *argv[])
                  */
                 if (is_ctrl)
                         ctrl_conn = handle_ctrl_msg(udev_ctrl);
+
+                /* wake up 'settle' clients */
+                if (!udev_list_node_is_empty(&settle_list))
+                        settle_release(false);
         }
 
         rc = EXIT_SUCCESS;
@@ -1557,12 +1871,18 @@ exit:
 exit_daemonize:
         if (fd_ep >= 0)
                 close(fd_ep);
+        settle_release(true);
         worker_list_cleanup(udev);
         event_queue_cleanup(udev, EVENT_UNDEF);
+        udev_depend_free(event_depend);
         udev_rules_unref(rules);
         udev_builtin_exit(udev);
         if (fd_signal >= 0)
                 close(fd_signal);
+        if (worker_queue >= 0)
+                close(worker_queue);
+        if (worker_slots != NULL)
+                munmap(worker_slots, WORKER_SLOTS * sizeof(struct worker_slot));
         if (worker_watch[READ_END] >= 0)
                 close(worker_watch[READ_END]);
         if (worker_watch[WRITE_END] >= 0)